@@ -0,0 +1,1444 @@
+// Microbenchmarks for the hot paths of fude, prints JSON to stdout.
+//   ./build/bin/bench [filter]
+// FUDE_BENCH_COMMIT is copied into the report so runs can be compared across commits.
+// FUDE_BENCH_FONT names a .ttf file for the text/ benchmarks, they're skipped without it.
+#define GM_IMPLEMENTATION
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+
+#include <stdio.h>
+#include <stdlib.h> // getenv()
+#include <string.h> // strstr(), strcmp(), memcmp()
+#include <time.h>   // time()
+
+#define BENCH_MINIMUM_SECONDS 0.1
+#define BENCH_REPETITIONS 5
+#define BENCH_MAXIMUM_RESULTS 64
+
+typedef struct {
+    uint64_t bytes_per_op; // 0 when throughput in bytes makes no sense
+    void* user_data;
+} bench_context;
+
+// runs `iterations` operations and returns the seconds they took
+typedef double (*bench_proc)(bench_context* ctx, uint64_t iterations);
+
+typedef struct {
+    const char* name;
+    uint64_t iterations;
+    double ns_per_op;     // median of the repetitions
+    double ns_per_op_min;
+    double bytes_per_second;
+} bench_result;
+
+static struct {
+    bench_result results[BENCH_MAXIMUM_RESULTS];
+    uint32_t count;
+    const char* filter;
+} bench = {0};
+
+// keeps the optimizer from dropping the work
+static volatile float bench_sink_f;
+static volatile uint64_t bench_sink_u;
+
+static void bench_sort(double* values, uint32_t count)
+{
+    for(uint32_t i = 1; i < count; ++i) {
+        double value = values[i];
+        uint32_t j = i;
+        for(; j > 0 && values[j - 1] > value; --j)
+            values[j] = values[j - 1];
+        values[j] = value;
+    }
+}
+
+static void bench_run(const char* name, bench_proc proc, void* user_data)
+{
+    if(bench.filter && !strstr(name, bench.filter)) return;
+    if(bench.count >= BENCH_MAXIMUM_RESULTS) return;
+
+    bench_context ctx = { .bytes_per_op = 0, .user_data = user_data };
+
+    // grow the iteration count until a single repetition is long enough to time
+    uint64_t iterations = 1;
+    double seconds = proc(&ctx, iterations);
+    while(seconds < BENCH_MINIMUM_SECONDS) {
+        double scale = seconds > 0.0 ? 1.5*BENCH_MINIMUM_SECONDS/seconds : 100.0;
+        if(scale > 100.0) scale = 100.0;
+        if(scale < 2.0) scale = 2.0;
+        iterations = (uint64_t)(iterations*scale);
+        seconds = proc(&ctx, iterations);
+    }
+
+    double ns[BENCH_REPETITIONS];
+    for(uint32_t i = 0; i < BENCH_REPETITIONS; ++i)
+        ns[i] = proc(&ctx, iterations)*1e9/(double)iterations;
+    bench_sort(ns, BENCH_REPETITIONS);
+
+    bench_result* result = bench.results + bench.count++;
+    result->name = name;
+    result->iterations = iterations;
+    result->ns_per_op = ns[BENCH_REPETITIONS/2];
+    result->ns_per_op_min = ns[0];
+    result->bytes_per_second = ctx.bytes_per_op ? (double)ctx.bytes_per_op*1e9/result->ns_per_op : 0.0;
+    fprintf(stderr, "%-28s %12.2f ns/op\n", name, result->ns_per_op);
+}
+
+//======================================================================
+// Batch submission
+//======================================================================
+// no GL needed as long as the batch never fills up, so the counters are
+// reset by hand instead of flushing
+static fude bench_app;
+
+static void bench_reset_batch(fude* app)
+{
+    app->renderer.vertices.count = 0;
+    app->renderer.indices.count = 0;
+    app->renderer.working.count = 0;
+}
+
+static double bench_vertex_submission(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    const uint32_t per_batch = (FUDE_RENDERER_MAXIMUM_VERTICES/3 - 1)*3;
+    ctx->bytes_per_op = sizeof(fude_vertex);
+    bench_reset_batch(app);
+
+    // user_data picks the matrix stack path: NULL, "translate" or "rotate"
+    f_load_identity(app);
+    if(ctx->user_data)
+        f_translate(app, 10.0f, 20.0f, 0.0f);
+    if(ctx->user_data && strcmp((const char*)ctx->user_data, "rotate") == 0)
+        f_rotate(app, 30.0f, 0.0f, 0.0f, 1.0f);
+
+    double start = _fude_get_seconds();
+    f_begin(app, FUDE_MODE_TRIANGLES, app->renderer.default_shader);
+    uint32_t in_batch = 0;
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_color4f(app, 1.0f, 0.5f, 0.25f, 1.0f);
+        f_vertex3f(app, (float)(i & 255), (float)(i >> 8 & 255), 0.0f);
+        if(++in_batch == per_batch) {
+            f_end(app);
+            bench_reset_batch(app);
+            f_begin(app, FUDE_MODE_TRIANGLES, app->renderer.default_shader);
+            in_batch = 0;
+        }
+    }
+    f_end(app);
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = app->renderer.indices.count;
+    bench_reset_batch(app);
+    f_load_identity(app);
+    return seconds;
+}
+
+static double bench_quad_indices(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    const uint32_t per_batch = FUDE_RENDERER_MAXIMUM_VERTICES/4 - 1;
+    ctx->bytes_per_op = 4*sizeof(fude_vertex) + 6*sizeof(uint32_t);
+    bench_reset_batch(app);
+
+    // user_data "cull" culls against a 128x128 view, so three quarters of the quads are dropped
+    if(ctx->user_data) {
+        app->renderer.camera.active = true;
+        app->renderer.camera.shader = app->renderer.default_shader.id;
+        app->renderer.camera.bounds.min = v3f(0.0f, 0.0f, -1.0f);
+        app->renderer.camera.bounds.max = v3f(127.0f, 127.0f, 1.0f);
+    }
+
+    double start = _fude_get_seconds();
+    uint32_t in_batch = 0;
+    for(uint64_t i = 0; i < iterations; ++i) {
+        float x = (float)(i & 255), y = (float)(i >> 8 & 255);
+        f_begin(app, FUDE_MODE_QUADS, app->renderer.default_shader);
+        f_vertex2f(app, x, y);
+        f_vertex2f(app, x + 1.0f, y);
+        f_vertex2f(app, x + 1.0f, y + 1.0f);
+        f_vertex2f(app, x, y + 1.0f);
+        f_end(app);
+        if(++in_batch == per_batch) {
+            bench_reset_batch(app);
+            in_batch = 0;
+        }
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = app->renderer.indices.count;
+    bench_reset_batch(app);
+    app->renderer.camera.active = false;
+    return seconds;
+}
+
+// one op replays a recorded list of 256 quads, compare with 256 ops of batch/quad_indices
+static double bench_replay_list(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    const uint32_t quads = 256;
+    ctx->bytes_per_op = quads*(4*sizeof(fude_vertex) + 6*sizeof(uint32_t));
+    bench_reset_batch(app);
+
+    fude_display_list list;
+    f_memzero(&list, sizeof(fude_display_list));
+    f_record_begin(app, &list);
+    for(uint32_t i = 0; i < quads; ++i) {
+        float x = (float)(i & 15), y = (float)(i >> 4);
+        f_begin(app, FUDE_MODE_QUADS, app->renderer.default_shader);
+        f_vertex2f(app, x, y);
+        f_vertex2f(app, x + 1.0f, y);
+        f_vertex2f(app, x + 1.0f, y + 1.0f);
+        f_vertex2f(app, x, y + 1.0f);
+        f_end(app);
+    }
+    f_record_end(app);
+    bench_reset_batch(app);
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_replay(app, &list);
+        bench_reset_batch(app);
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    f_destroy_display_list(app, &list);
+    return seconds;
+}
+
+// user_data "tessellated" builds the circle from 32 triangles the way it had to be done without
+// f_circle, otherwise it's one SDF quad
+static double bench_circle(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    const uint32_t segments = 32;
+    const bool tessellated = ctx->user_data != NULL;
+    const uint32_t per_batch = tessellated ? FUDE_RENDERER_MAXIMUM_VERTICES/(3*segments) - 1 :
+        FUDE_RENDERER_MAXIMUM_VERTICES/4 - 1;
+    ctx->bytes_per_op = tessellated ? 3*segments*(sizeof(fude_vertex) + sizeof(uint32_t)) :
+        4*sizeof(fude_vertex) + 6*sizeof(uint32_t);
+    bench_reset_batch(app);
+
+    float sines[33], cosines[33];
+    for(uint32_t k = 0; k <= segments; ++k) {
+        sines[k] = sinf(6.2831853f*(float)k/(float)segments);
+        cosines[k] = cosf(6.2831853f*(float)k/(float)segments);
+    }
+
+    double start = _fude_get_seconds();
+    uint32_t in_batch = 0;
+    for(uint64_t i = 0; i < iterations; ++i) {
+        float x = (float)(i & 255), y = (float)(i >> 8 & 255), radius = 8.0f;
+        if(tessellated) {
+            f_begin(app, FUDE_MODE_TRIANGLES, app->renderer.default_shader);
+            f_color4f(app, 1.0f, 0.5f, 0.25f, 1.0f);
+            for(uint32_t k = 0; k < segments; ++k) {
+                f_vertex2f(app, x, y);
+                f_vertex2f(app, x + radius*cosines[k], y + radius*sines[k]);
+                f_vertex2f(app, x + radius*cosines[k + 1], y + radius*sines[k + 1]);
+            }
+            f_end(app);
+        } else {
+            f_circle(app, x, y, radius, 0xFF8040FF);
+        }
+        if(++in_batch == per_batch) {
+            bench_reset_batch(app);
+            in_batch = 0;
+        }
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = app->renderer.indices.count;
+    bench_reset_batch(app);
+    return seconds;
+}
+
+// one op is one fill of a star with a round hole, user_data "tessellated" empties the
+// path cache every time so it measures flattening and ear clipping instead of the copy
+static double bench_fill_path(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    const bool tessellated = ctx->user_data != NULL;
+    ctx->bytes_per_op = 0;
+    bench_reset_batch(app);
+
+    fude_path path = {0};
+    for(uint32_t k = 0; k < 10; ++k) {
+        float angle = 0.62831853f*(float)k, radius = (k & 1) ? 40.0f : 100.0f;
+        if(k == 0) f_path_move_to(&path, radius*cosf(angle), radius*sinf(angle));
+        else f_path_line_to(&path, radius*cosf(angle), radius*sinf(angle));
+    }
+    f_path_close(&path);
+    const float r = 20.0f, c = 0.5523f*r;
+    f_path_move_to(&path, r, 0.0f);
+    f_path_cubic_to(&path, r, -c, c, -r, 0.0f, -r);
+    f_path_cubic_to(&path, -c, -r, -r, -c, -r, 0.0f);
+    f_path_cubic_to(&path, -r, c, -c, r, 0.0f, r);
+    f_path_cubic_to(&path, c, r, r, c, r, 0.0f);
+    f_path_close(&path);
+
+    // creates the cache
+    f_fill_path(app, &path, 0xFF8040FF);
+    bench_reset_batch(app);
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        if(tessellated) _fude_clear_path_cache(app->renderer.paths);
+        f_fill_path(app, &path, 0xFF8040FF);
+        bench_reset_batch(app);
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    f_destroy_path(&path);
+    return seconds;
+}
+
+//======================================================================
+// Headless flush
+//======================================================================
+static void bench_fill_quads(fude* app, uint32_t quads)
+{
+    f_begin(app, FUDE_MODE_QUADS, app->renderer.default_shader);
+    for(uint32_t i = 0; i < quads; ++i) {
+        float x = (float)(i % 64)/32.0f - 1.0f, y = (float)(i / 64 % 64)/32.0f - 1.0f;
+        f_color4f(app, 1.0f, 1.0f, 1.0f, 1.0f);
+        f_vertex2f(app, x, y);
+        f_vertex2f(app, x + 0.03f, y);
+        f_vertex2f(app, x + 0.03f, y + 0.03f);
+        f_vertex2f(app, x, y + 0.03f);
+    }
+    f_end(app);
+}
+
+// one full batch per op, glFinish so the upload and draw are actually paid for
+static double bench_flush(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = (fude*)ctx->user_data;
+    const uint32_t quads = FUDE_RENDERER_MAXIMUM_VERTICES/4 - 1;
+    ctx->bytes_per_op = quads*(4*sizeof(fude_vertex) + 6*sizeof(uint32_t));
+
+    double seconds = 0.0;
+    for(uint64_t i = 0; i < iterations; ++i) {
+        bench_fill_quads(app, quads);
+        double start = _fude_get_seconds();
+        f_flush(app);
+        glFinish();
+        seconds += _fude_get_seconds() - start;
+    }
+    return seconds;
+}
+
+// the same quads as bench_flush, uploaded once as a mesh
+static double bench_draw_mesh(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = (fude*)ctx->user_data;
+    const uint32_t quads = FUDE_RENDERER_MAXIMUM_VERTICES/4 - 1;
+    ctx->bytes_per_op = 0;
+
+    bench_fill_quads(app, quads);
+    fude_mesh mesh;
+    fude_result result = f_create_mesh(app, &mesh, app->renderer.vertices.data, app->renderer.vertices.count,
+            app->renderer.indices.data, app->renderer.indices.count);
+    bench_reset_batch(app);
+    if(result != FUDE_OK) return 0.0;
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_draw_mesh(app, &mesh, app->renderer.default_shader, NULL);
+        glFinish();
+    }
+    double seconds = _fude_get_seconds() - start;
+    f_destroy_mesh(app, &mesh);
+    return seconds;
+}
+
+//======================================================================
+// Particles
+//======================================================================
+#define BENCH_PARTICLES (1024*1024)
+#define BENCH_DRAWN_PARTICLES (64*1024) // llvmpipe spends seconds rasterizing a million
+
+// a pool kept full: about 1/120 of it dies and is emitted again every frame
+static fude_particles* bench_create_particles(uint32_t capacity, uint32_t threads)
+{
+    fude_particles* particles;
+    fude_particles_config config = { .capacity = capacity, .threads = threads, .seed = 1 };
+    config.gravity.y = 100.0f;
+    config.drag = 0.1f;
+    if(f_create_particles(&particles, &config) != FUDE_OK) return NULL;
+    return particles;
+}
+
+static void bench_refill_particles(fude_particles* particles)
+{
+    fude_particle_emitter emitter = { .life = 2.0f, .life_spread = 1.0f, .size_start = 1.0f, .size_end = 0.5f,
+        .color_start = 0xFFFFFFFF, .color_end = 0xFF000000 };
+    emitter.position.x = 640.0f;
+    emitter.position.y = 360.0f;
+    emitter.position_spread.x = 600.0f;
+    emitter.position_spread.y = 300.0f;
+    emitter.velocity_spread.x = 50.0f;
+    emitter.velocity_spread.y = 50.0f;
+    f_emit_particles(particles, &emitter, BENCH_PARTICLES); // clamped to the room left
+}
+
+// one op is one frame of 1M particles, user_data is the worker count
+static double bench_update_particles(bench_context* ctx, uint64_t iterations)
+{
+    fude_particles* particles = bench_create_particles(BENCH_PARTICLES, (uint32_t)(uintptr_t)ctx->user_data);
+    if(!particles) return 0.0;
+    ctx->bytes_per_op = (uint64_t)BENCH_PARTICLES*(8*sizeof(float) + sizeof(V4f));
+    bench_refill_particles(particles);
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_update_particles(particles, 1.0f/60.0f);
+        bench_refill_particles(particles);
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = f_particle_count(particles);
+    f_destroy_particles(particles);
+    return seconds;
+}
+
+// one op is one instanced draw of 64K particles
+static double bench_draw_particles(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = (fude*)ctx->user_data;
+    fude_particles* particles = bench_create_particles(BENCH_DRAWN_PARTICLES, 1);
+    if(!particles) return 0.0;
+    ctx->bytes_per_op = 0;
+    bench_refill_particles(particles);
+    fude_camera camera;
+    f_create_camera2d(&camera, 1280, 720);
+    f_use_camera(app, &camera, f_get_default_shader(app));
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_draw_particles(app, particles);
+        glFinish();
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    f_destroy_particles(particles);
+    return seconds;
+}
+
+//======================================================================
+// Tilemap
+//======================================================================
+#define BENCH_TILEMAP_SIZE 1024
+
+typedef struct {
+    fude* app;
+    fude_tilemap* tilemap;
+    fude_texture tileset;
+    fude_camera camera;
+    bool quads; // submit every visible tile with f_rectangle_tex instead
+} bench_tilemap;
+
+static bool bench_init_tilemap(bench_tilemap* bench_map, fude* app)
+{
+    static uint8_t pixels[64*64*4];
+    for(uint32_t i = 0; i < 64*64; ++i) {
+        pixels[i*4 + 0] = (uint8_t)(i*7);
+        pixels[i*4 + 1] = (uint8_t)(i*13);
+        pixels[i*4 + 2] = (uint8_t)(i >> 4);
+        pixels[i*4 + 3] = 255;
+    }
+    bench_map->app = app;
+    if(f_create_texture(app, &bench_map->tileset, pixels, 64, 64, 4) != FUDE_OK) return false;
+    fude_tilemap_config config = { .width = BENCH_TILEMAP_SIZE, .height = BENCH_TILEMAP_SIZE, .tile_size = 16.0f,
+        .tileset = bench_map->tileset, .columns = 4, .rows = 4 };
+    if(f_create_tilemap(&bench_map->tilemap, &config) != FUDE_OK) return false;
+    for(uint32_t y = 0; y < BENCH_TILEMAP_SIZE; ++y)
+        for(uint32_t x = 0; x < BENCH_TILEMAP_SIZE; ++x)
+            f_set_tile(bench_map->tilemap, x, y, (uint16_t)(1 + (x*7 + y*3) % 16));
+    f_create_camera2d(&bench_map->camera, 1280, 720);
+    f_set_camera_position(&bench_map->camera, 4000.0f, 4000.0f, 0.0f);
+    return true;
+}
+
+// a tilemap drawn at an offset without a camera must not move what's drawn after it, f_draw_mesh
+// puts the default shader's u_mvp back. Positions are in clip space, the sprite stays left of the map
+static void bench_draw_sprite_after_tilemap(fude* app, fude_tilemap* tilemap, fude_texture tileset, uint8_t* pixels)
+{
+    f_clear(app);
+    if(tilemap) f_draw_tilemap(app, tilemap, 0.5f, 0.0f);
+    f_begin(app, FUDE_MODE_QUADS, f_get_default_shader(app));
+    f_texture(app, tileset, 0.0f, 0.0f, 1); f_vertex2f(app, -0.75f, -0.75f);
+    f_texture(app, tileset, 1.0f, 0.0f, 1); f_vertex2f(app, -0.25f, -0.75f);
+    f_texture(app, tileset, 1.0f, 1.0f, 1); f_vertex2f(app, -0.25f, -0.25f);
+    f_texture(app, tileset, 0.0f, 1.0f, 1); f_vertex2f(app, -0.75f, -0.25f);
+    f_end(app);
+    f_flush(app);
+    f_read_pixels(app, 0, 0, 640, 360, pixels);
+}
+
+// before anything calls f_use_camera, so the default shader's u_mvp is still the identity
+static void bench_check_tilemap(fude* app)
+{
+    static uint8_t expected[640*360*4], pixels[640*360*4];
+    static uint8_t texels[16*16*4];
+    for(uint32_t i = 0; i < 16*16; ++i) {
+        texels[i*4 + 0] = (uint8_t)(i*5);
+        texels[i*4 + 1] = (uint8_t)(255 - i);
+        texels[i*4 + 2] = 96;
+        texels[i*4 + 3] = 255;
+    }
+    fude_texture tileset;
+    fude_tilemap* tilemap = NULL;
+    fude_tilemap_config config = { .width = 2, .height = 2, .tile_size = 0.25f, .columns = 4, .rows = 4 };
+    if(f_create_texture(app, &tileset, texels, 16, 16, 4) != FUDE_OK) return;
+    config.tileset = tileset;
+    if(f_create_tilemap(&tilemap, &config) == FUDE_OK) {
+        f_set_tile(tilemap, 0, 0, 1);
+        f_set_tile(tilemap, 1, 1, 6);
+        bench_draw_sprite_after_tilemap(app, NULL, tileset, expected);
+        bench_draw_sprite_after_tilemap(app, tilemap, tileset, pixels);
+        f_expect(memcmp(expected, pixels, sizeof(pixels)) == 0, "A tilemap drawn at an offset moved the sprite after it");
+        f_destroy_tilemap(app, tilemap);
+    }
+    f_destroy_texture(app, tileset);
+}
+
+static void bench_deinit_tilemap(bench_tilemap* bench_map)
+{
+    f_destroy_tilemap(bench_map->app, bench_map->tilemap);
+    f_destroy_texture(bench_map->app, bench_map->tileset);
+}
+
+// one op is one 1280x720 view of 16 pixel tiles
+static double bench_draw_tilemap(bench_context* ctx, uint64_t iterations)
+{
+    bench_tilemap* bench_map = (bench_tilemap*)ctx->user_data;
+    fude* app = bench_map->app;
+    ctx->bytes_per_op = 0;
+    f_use_camera(app, &bench_map->camera, f_get_default_shader(app));
+    f_draw_tilemap(app, bench_map->tilemap, 0.0f, 0.0f); // builds the visible chunks
+    f_flush(app);
+    glFinish();
+
+    const fude_camera* camera = &bench_map->camera;
+    const int tx0 = (int)(camera->bounds.min.x/16.0f), tx1 = (int)(camera->bounds.max.x/16.0f) + 1;
+    const int ty0 = (int)(camera->bounds.min.y/16.0f), ty1 = (int)(camera->bounds.max.y/16.0f) + 1;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        if(bench_map->quads) {
+            for(int y = ty0; y < ty1; ++y)
+                for(int x = tx0; x < tx1; ++x)
+                    f_rectangle_tex(app, (fude_rect){ x*16, y*16, 16, 16 }, bench_map->tileset);
+        } else {
+            f_draw_tilemap(app, bench_map->tilemap, 0.0f, 0.0f);
+        }
+        f_flush(app);
+        glFinish();
+    }
+    return _fude_get_seconds() - start;
+}
+
+//======================================================================
+// Render targets
+//======================================================================
+#define BENCH_BLUR_STEPS 4
+
+typedef struct {
+    fude* app;
+    bool pooled; // f_acquire_render_target instead of creating and destroying every target
+} bench_targets;
+
+// one op is one frame of a downsample chain from a half size target down to 1/32 of 1280x720
+static double bench_blur_chain(bench_context* ctx, uint64_t iterations)
+{
+    bench_targets* targets = (bench_targets*)ctx->user_data;
+    fude* app = targets->app;
+    ctx->bytes_per_op = 0;
+    fude_camera camera;
+    f_create_camera2d(&camera, 1, 1);
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        fude_render_target created[BENCH_BLUR_STEPS];
+        f_memzero(created, sizeof(created));
+        fude_render_target* previous = NULL;
+        for(uint32_t step = 0; step < BENCH_BLUR_STEPS; ++step) {
+            fude_render_target_config config = { .scale = 0.5f/(float)(1u << step) };
+            fude_render_target* target = created + step;
+            if(targets->pooled)
+                target = f_acquire_render_target(app, &config);
+            else if(f_create_render_target(app, target, &config) != FUDE_OK)
+                target = NULL;
+            if(!target) break;
+
+            f_begin_target(app, target);
+            f_clear(app);
+            f_set_camera_viewport(&camera, target->width, target->height);
+            f_use_camera(app, &camera, f_get_default_shader(app));
+            if(previous)
+                f_draw_render_target(app, previous, (fude_rect){ 0, 0, (int)target->width, (int)target->height });
+            else
+                f_rectangle(app, (fude_rect){ 0, 0, (int)target->width, (int)target->height }, 0x336699FF);
+            f_flush(app);
+            if(previous && targets->pooled)
+                f_release_render_target(app, previous);
+            previous = target;
+        }
+        f_end_target(app);
+        glFinish();
+        if(targets->pooled) {
+            _fude_recycle_render_targets(app);
+        } else {
+            for(uint32_t step = 0; step < BENCH_BLUR_STEPS; ++step)
+                f_destroy_render_target(app, created + step);
+        }
+    }
+    return _fude_get_seconds() - start;
+}
+
+//======================================================================
+// Frame graph
+//======================================================================
+typedef struct {
+    fude_camera* camera;
+    fude_graph_resource input, output;
+    bool* ran; // set when the pass executes
+} bench_graph_pass;
+
+typedef struct {
+    fude* app;
+    fude_frame_graph* graph;
+    fude_camera camera;
+    bench_graph_pass scene, down, up, composite, debug;
+    bool debug_ran;
+} bench_graph;
+
+static void bench_graph_viewport(fude* app, bench_graph_pass* pass, fude_render_target* target)
+{
+    uint32_t width = target ? target->width : (uint32_t)app->renderer.framebuffer.width;
+    uint32_t height = target ? target->height : (uint32_t)app->renderer.framebuffer.height;
+    f_set_camera_viewport(pass->camera, width, height);
+    f_use_camera(app, pass->camera, f_get_default_shader(app));
+}
+
+static void bench_graph_draw_scene(fude* app, fude_frame_graph* graph, void* user_data)
+{
+    bench_graph_pass* pass = (bench_graph_pass*)user_data;
+    fude_render_target* target = f_graph_get_target(graph, pass->output);
+    f_clear(app);
+    bench_graph_viewport(app, pass, target);
+    f_rectangle(app, (fude_rect){ 0, 0, (int)target->width, (int)target->height }, 0x102030FF);
+    f_circle(app, 80.0f, 80.0f, 60.0f, 0xFF8000FF);
+}
+
+// down, up and composite all resample their input into their output
+static void bench_graph_copy(fude* app, fude_frame_graph* graph, void* user_data)
+{
+    bench_graph_pass* pass = (bench_graph_pass*)user_data;
+    fude_render_target* source = f_graph_get_target(graph, pass->input);
+    fude_render_target* target = f_graph_get_target(graph, pass->output);
+    if(target) f_clear(app);
+    bench_graph_viewport(app, pass, target);
+    f_draw_render_target(app, source, (fude_rect){ 0, 0, target ? (int)target->width : app->renderer.framebuffer.width,
+            target ? (int)target->height : app->renderer.framebuffer.height });
+    if(pass->ran) *pass->ran = true;
+}
+
+// scene -> down -> up -> composite into the backbuffer, plus a debug pass nothing reads. Declared out of
+// order so the sort has something to do
+static void bench_build_graph(bench_graph* bench)
+{
+    fude_frame_graph* graph = bench->graph;
+    const fude_render_target_config half = { .scale = 0.5f }, quarter = { .scale = 0.25f };
+    f_reset_frame_graph(graph);
+    fude_graph_resource scene = f_graph_create_texture(graph, "scene", &half);
+    fude_graph_resource down = f_graph_create_texture(graph, "down", &quarter);
+    fude_graph_resource up = f_graph_create_texture(graph, "up", &half);
+    fude_graph_resource debug = f_graph_create_texture(graph, "debug", &half);
+    bench->scene = (bench_graph_pass){ &bench->camera, 0, scene, NULL };
+    bench->down = (bench_graph_pass){ &bench->camera, scene, down, NULL };
+    bench->up = (bench_graph_pass){ &bench->camera, down, up, NULL };
+    bench->composite = (bench_graph_pass){ &bench->camera, up, f_graph_backbuffer(graph), NULL };
+    bench->debug = (bench_graph_pass){ &bench->camera, scene, debug, &bench->debug_ran };
+
+    uint32_t pass = f_graph_add_pass(graph, "composite", bench_graph_copy, &bench->composite);
+    f_graph_read(graph, pass, up);
+    f_graph_write(graph, pass, f_graph_backbuffer(graph));
+    pass = f_graph_add_pass(graph, "debug", bench_graph_copy, &bench->debug);
+    f_graph_read(graph, pass, scene);
+    f_graph_write(graph, pass, debug);
+    pass = f_graph_add_pass(graph, "up", bench_graph_copy, &bench->up);
+    f_graph_read(graph, pass, down);
+    f_graph_write(graph, pass, up);
+    pass = f_graph_add_pass(graph, "down", bench_graph_copy, &bench->down);
+    f_graph_read(graph, pass, scene);
+    f_graph_write(graph, pass, down);
+    pass = f_graph_add_pass(graph, "scene", bench_graph_draw_scene, &bench->scene);
+    f_graph_write(graph, pass, scene);
+}
+
+// the debug pass is culled and up reuses scene's target once down has read it, a cycle runs nothing
+static bool bench_check_frame_graph(bench_graph* bench, fude* app)
+{
+    bench->app = app;
+    if(f_create_frame_graph(&bench->graph) != FUDE_OK) return false;
+    f_create_camera2d(&bench->camera, 1, 1);
+
+    bench_build_graph(bench);
+    bench->debug_ran = false;
+    f_expect(f_execute_frame_graph(app, bench->graph) == FUDE_OK, "The frame graph failed to execute");
+    fude_frame_graph_stats stats;
+    f_get_frame_graph_stats(bench->graph, &stats);
+    f_expect(stats.passes == 5 && stats.culled_passes == 1 && stats.textures == 3 && stats.targets == 2,
+            "Frame graph stats are off: %u passes, %u culled, %u textures on %u targets",
+            stats.passes, stats.culled_passes, stats.textures, stats.targets);
+    f_expect(!bench->debug_ran, "The frame graph ran a pass nothing reads");
+
+    f_reset_frame_graph(bench->graph);
+    const fude_render_target_config half = { .scale = 0.5f };
+    fude_graph_resource a = f_graph_create_texture(bench->graph, "a", &half);
+    fude_graph_resource b = f_graph_create_texture(bench->graph, "b", &half);
+    bench->debug = (bench_graph_pass){ &bench->camera, a, b, &bench->debug_ran };
+    uint32_t pass = f_graph_add_pass(bench->graph, "a to b", bench_graph_copy, &bench->debug);
+    f_graph_read(bench->graph, pass, a);
+    f_graph_write(bench->graph, pass, b);
+    pass = f_graph_add_pass(bench->graph, "b to a", bench_graph_copy, &bench->debug);
+    f_graph_read(bench->graph, pass, b);
+    f_graph_write(bench->graph, pass, a);
+    pass = f_graph_add_pass(bench->graph, "present", bench_graph_copy, &bench->debug);
+    f_graph_read(bench->graph, pass, a);
+    f_graph_write(bench->graph, pass, f_graph_backbuffer(bench->graph));
+    f_expect(f_execute_frame_graph(app, bench->graph) != FUDE_OK && !bench->debug_ran,
+            "The frame graph executed a cycle");
+    return true;
+}
+
+// one op is declaring and executing the whole graph for a frame, passes included
+static double bench_frame_graph(bench_context* ctx, uint64_t iterations)
+{
+    bench_graph* bench = (bench_graph*)ctx->user_data;
+    ctx->bytes_per_op = 0;
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        bench_build_graph(bench);
+        f_execute_frame_graph(bench->app, bench->graph);
+        f_flush(bench->app);
+        glFinish();
+        _fude_recycle_render_targets(bench->app);
+    }
+    return _fude_get_seconds() - start;
+}
+
+//======================================================================
+// Depth layers
+//======================================================================
+#define BENCH_LAYER_SPRITES (4*1024)
+#define BENCH_LAYER_TEXTURES 16
+#define BENCH_LAYER_COUNT 8
+
+typedef struct {
+    fude* app;
+    fude_camera camera;
+    fude_texture textures[BENCH_LAYER_TEXTURES];
+    fude_rect rects[BENCH_LAYER_SPRITES];
+    uint32_t texture[BENCH_LAYER_SPRITES];
+    bool layered; // f_begin_layers with a depth per layer instead of relying on submission order
+} bench_layers;
+
+static bench_layers bench_layer_scene;
+
+// opaque sprites of random textures stored layer by layer, the order a painter's algorithm needs
+static bool bench_init_layers(bench_layers* layers, fude* app)
+{
+    static uint8_t pixels[32*32*4];
+    layers->app = app;
+    for(uint32_t t = 0; t < BENCH_LAYER_TEXTURES; ++t) {
+        for(uint32_t i = 0; i < 32*32; ++i) {
+            pixels[i*4 + 0] = (uint8_t)(t*16);
+            pixels[i*4 + 1] = (uint8_t)(i*3);
+            pixels[i*4 + 2] = (uint8_t)(255 - t*16);
+            pixels[i*4 + 3] = 255;
+        }
+        if(f_create_texture(app, layers->textures + t, pixels, 32, 32, 4) != FUDE_OK) return false;
+    }
+    uint32_t seed = 12345;
+    for(uint32_t i = 0; i < BENCH_LAYER_SPRITES; ++i) {
+        seed = seed*1664525u + 1013904223u;
+        layers->rects[i] = (fude_rect){ (int)(seed >> 8) % 1248, (int)(seed >> 20) % 688, 32, 32 };
+        seed = seed*1664525u + 1013904223u;
+        layers->texture[i] = (seed >> 16) % BENCH_LAYER_TEXTURES;
+    }
+    f_create_camera2d(&layers->camera, 1280, 720);
+    return true;
+}
+
+static void bench_deinit_layers(bench_layers* layers)
+{
+    for(uint32_t t = 0; t < BENCH_LAYER_TEXTURES; ++t) {
+        if(layers->textures[t].id) f_destroy_texture(layers->app, layers->textures[t]);
+    }
+}
+
+// one op is one frame of the scene
+static double bench_draw_layers(bench_context* ctx, uint64_t iterations)
+{
+    bench_layers* layers = (bench_layers*)ctx->user_data;
+    fude* app = layers->app;
+    ctx->bytes_per_op = 0;
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_clear(app);
+        f_use_camera(app, &layers->camera, f_get_default_shader(app));
+        if(layers->layered) f_begin_layers(app);
+        for(uint32_t s = 0; s < BENCH_LAYER_SPRITES; ++s) {
+            if(layers->layered)
+                f_set_depth(app, (float)(s*BENCH_LAYER_COUNT/BENCH_LAYER_SPRITES)/BENCH_LAYER_COUNT);
+            f_rectangle_tex(app, layers->rects[s], layers->textures[layers->texture[s]]);
+        }
+        if(layers->layered) f_end_layers(app);
+        f_set_depth(app, 0.0f);
+        f_flush(app);
+        glFinish();
+    }
+    return _fude_get_seconds() - start;
+}
+
+//======================================================================
+// Blend modes
+//======================================================================
+#define BENCH_BLEND_SPRITES (4*1024)
+
+typedef struct {
+    fude* app;
+    fude_camera camera;
+    fude_texture texture;
+    fude_rect rects[BENCH_BLEND_SPRITES];
+    bool split; // flush on every mode change, what a batch per blend mode costs
+} bench_blend;
+
+static bench_blend bench_blend_scene;
+
+// translucent sprites, each with an additive glow on top, the way an effects pass interleaves them
+static bool bench_init_blend(bench_blend* blend, fude* app)
+{
+    static uint8_t pixels[32*32*4];
+    blend->app = app;
+    for(uint32_t i = 0; i < 32*32; ++i) {
+        pixels[i*4 + 0] = (uint8_t)(i*5);
+        pixels[i*4 + 1] = 128;
+        pixels[i*4 + 2] = (uint8_t)(255 - i*5);
+        pixels[i*4 + 3] = (uint8_t)(i*7);
+    }
+    if(f_create_texture(app, &blend->texture, pixels, 32, 32, 4) != FUDE_OK) return false;
+    uint32_t seed = 54321;
+    for(uint32_t i = 0; i < BENCH_BLEND_SPRITES; ++i) {
+        seed = seed*1664525u + 1013904223u;
+        blend->rects[i] = (fude_rect){ (int)(seed >> 8) % 1272, (int)(seed >> 20) % 712, 8, 8 };
+    }
+    f_create_camera2d(&blend->camera, 1280, 720);
+    return true;
+}
+
+// one op is one frame of the scene
+static double bench_draw_blend(bench_context* ctx, uint64_t iterations)
+{
+    bench_blend* blend = (bench_blend*)ctx->user_data;
+    fude* app = blend->app;
+    ctx->bytes_per_op = 0;
+
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_clear(app);
+        f_use_camera(app, &blend->camera, f_get_default_shader(app));
+        for(uint32_t s = 0; s < BENCH_BLEND_SPRITES; ++s) {
+            const fude_rect rect = blend->rects[s];
+            f_set_blend_mode(app, FUDE_BLEND_ALPHA);
+            f_rectangle_tex(app, rect, blend->texture);
+            if(blend->split) f_flush(app);
+            f_set_blend_mode(app, FUDE_BLEND_ADDITIVE);
+            f_circle(app, (float)rect.x + 4.0f, (float)rect.y + 4.0f, 6.0f, 0xFFC04040);
+            if(blend->split) f_flush(app);
+        }
+        f_set_blend_mode(app, FUDE_BLEND_ALPHA);
+        f_flush(app);
+        glFinish();
+    }
+    return _fude_get_seconds() - start;
+}
+
+//======================================================================
+// Text
+//======================================================================
+#define BENCH_TEXT_LABELS (16*1024)
+typedef struct {
+    fude* app;
+    fude_font* font;
+    uint32_t label_count; // more than the layout cache holds makes every draw a miss
+} bench_text;
+
+static char bench_labels[BENCH_TEXT_LABELS][24];
+
+// one op is one label of about 16 characters, the batch is reset by hand so nothing is drawn
+static double bench_draw_text(bench_context* ctx, uint64_t iterations)
+{
+    bench_text* text = (bench_text*)ctx->user_data;
+    fude* app = text->app;
+    const uint32_t per_batch = FUDE_RENDERER_MAXIMUM_VERTICES/(4*16) - 1;
+    ctx->bytes_per_op = 0;
+    f_set_font(app, text->font, 16.0f);
+    f_color4f(app, 1.0f, 1.0f, 1.0f, 1.0f);
+    bench_reset_batch(app);
+
+    // glyphs are rasterized outside the timed loop
+    f_draw_text(app, "Label 0123456789 x", 0.0f, 0.0f);
+    bench_reset_batch(app);
+
+    double start = _fude_get_seconds();
+    uint32_t in_batch = 0;
+    for(uint64_t i = 0; i < iterations; ++i) {
+        f_draw_text(app, bench_labels[i % text->label_count], (float)(i & 63)*16.0f, (float)(i >> 6 & 63)*16.0f);
+        if(++in_batch == per_batch) {
+            bench_reset_batch(app);
+            in_batch = 0;
+        }
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = app->renderer.indices.count;
+    bench_reset_batch(app);
+    return seconds;
+}
+
+//======================================================================
+// gm.h
+//======================================================================
+#define BENCH_GM_COUNT 1024
+static V4f bench_v4[BENCH_GM_COUNT];
+static M4f bench_m4[BENCH_GM_COUNT];
+
+static void bench_init_gm(void)
+{
+    for(uint32_t i = 0; i < BENCH_GM_COUNT; ++i) {
+        bench_v4[i] = v4f((float)i, (float)(i*3 % 7) + 1.0f, (float)(i % 5), 1.0f);
+        bench_m4[i] = m4f_ortho(0.0f, (float)(i + 1), (float)(i + 1), 0.0f, -1.0f, 1.0f);
+    }
+}
+
+static double bench_v4f_add(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = 2*sizeof(V4f);
+    V4f acc = v4f_zeros();
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        acc = v4f_add(acc, bench_v4[i & (BENCH_GM_COUNT - 1)]);
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc.x + acc.y + acc.z + acc.w;
+    return seconds;
+}
+
+static double bench_v4f_dot(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = 2*sizeof(V4f);
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        acc += v4f_dot(bench_v4[i & (BENCH_GM_COUNT - 1)], bench_v4[(i + 1) & (BENCH_GM_COUNT - 1)]);
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+static double bench_v4f_normalize(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = sizeof(V4f);
+    V4f acc = v4f_zeros();
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        acc = v4f_add(acc, v4f_normalize(bench_v4[i & (BENCH_GM_COUNT - 1)]));
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc.x + acc.y + acc.z + acc.w;
+    return seconds;
+}
+
+static double bench_m4f_dot(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = 2*sizeof(M4f);
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        M4f m = m4f_dot(bench_m4[i & (BENCH_GM_COUNT - 1)], bench_m4[(i + 7) & (BENCH_GM_COUNT - 1)]);
+        acc += m.elements[i & 15];
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+static double bench_m4f_dot_scalar(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = 2*sizeof(M4f);
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        M4f m = m4f_dot_scalar(bench_m4[i & (BENCH_GM_COUNT - 1)], bench_m4[(i + 7) & (BENCH_GM_COUNT - 1)]);
+        acc += m.elements[i & 15];
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+static double bench_m4f_inverse(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = sizeof(M4f);
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        acc += m4f_inverse(bench_m4[i & (BENCH_GM_COUNT - 1)]).elements[i & 15];
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+static double bench_m4f_transpose(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = sizeof(M4f);
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        acc += m4f_transpose(bench_m4[i & (BENCH_GM_COUNT - 1)]).elements[i & 15];
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+// one op is one transformed point
+static double bench_m4f_mul_v4f_batch(bench_context* ctx, uint64_t iterations)
+{
+    static V4f dst[BENCH_GM_COUNT];
+    bool scalar = ctx->user_data != NULL;
+    ctx->bytes_per_op = 2*sizeof(V4f);
+    double start = _fude_get_seconds();
+    for(uint64_t done = 0; done < iterations; done += BENCH_GM_COUNT) {
+        size_t count = iterations - done < BENCH_GM_COUNT ? (size_t)(iterations - done) : BENCH_GM_COUNT;
+        const M4f* m = bench_m4 + (done/BENCH_GM_COUNT & (BENCH_GM_COUNT - 1));
+        if(scalar)
+            m4f_mul_v4f_batch_scalar(m, bench_v4, dst, count);
+        else
+            m4f_mul_v4f_batch(m, bench_v4, dst, count);
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = dst[0].x;
+    return seconds;
+}
+
+// the SIMD paths have to agree with the scalar reference before their timings mean anything
+static float bench_relative_error(const float* a, const float* b, uint32_t count)
+{
+    float worst = 0.0f;
+    for(uint32_t i = 0; i < count; ++i) {
+        float error = fabsf(a[i] - b[i])/(1.0f + fabsf(b[i]));
+        if(error > worst) worst = error;
+    }
+    return worst;
+}
+
+static void bench_check_gm(void)
+{
+    const float tolerance = 1e-5f;
+    static V4f simd[BENCH_GM_COUNT], scalar[BENCH_GM_COUNT];
+    for(uint32_t i = 0; i < BENCH_GM_COUNT; ++i) {
+        V4f a = bench_v4[i], b = v4f_add_scalar(bench_v4[(i + 1) & (BENCH_GM_COUNT - 1)], v4f_ones()); // no zero divisors
+        M4f m = bench_m4[i], n = bench_m4[(i + 7) & (BENCH_GM_COUNT - 1)];
+        V4f v[2] = { v4f_sub(a, b), v4f_sub_scalar(a, b) };
+        f_expect(bench_relative_error(v[0].elements, v[1].elements, 4) <= tolerance, "v4f_sub disagrees with the scalar path");
+        v[0] = v4f_mul(a, b); v[1] = v4f_mul_scalar(a, b);
+        f_expect(bench_relative_error(v[0].elements, v[1].elements, 4) <= tolerance, "v4f_mul disagrees with the scalar path");
+        v[0] = v4f_div(a, b); v[1] = v4f_div_scalar(a, b);
+        f_expect(bench_relative_error(v[0].elements, v[1].elements, 4) <= tolerance, "v4f_div disagrees with the scalar path");
+        v[0] = v4f_normalize(a); v[1] = v4f_normalize_scalar(a);
+        f_expect(bench_relative_error(v[0].elements, v[1].elements, 4) <= tolerance, "v4f_normalize disagrees with the scalar path");
+        v[0] = m4f_mul_v4f(m, a); v[1] = m4f_mul_v4f_scalar(m, a);
+        f_expect(bench_relative_error(v[0].elements, v[1].elements, 4) <= tolerance, "m4f_mul_v4f disagrees with the scalar path");
+
+        M4f r[2] = { m4f_dot(m, n), m4f_dot_scalar(m, n) };
+        f_expect(bench_relative_error(r[0].elements, r[1].elements, 16) <= tolerance, "m4f_dot disagrees with the scalar path");
+        r[0] = m4f_transpose(m); r[1] = m4f_transpose_scalar(m);
+        f_expect(bench_relative_error(r[0].elements, r[1].elements, 16) <= tolerance, "m4f_transpose disagrees with the scalar path");
+        r[0] = m4f_inverse(m); r[1] = m4f_inverse_scalar(m);
+        f_expect(bench_relative_error(r[0].elements, r[1].elements, 16) <= tolerance, "m4f_inverse disagrees with the scalar path");
+    }
+    m4f_mul_v4f_batch(bench_m4, bench_v4, simd, BENCH_GM_COUNT - 1); // odd count covers the tail
+    m4f_mul_v4f_batch_scalar(bench_m4, bench_v4, scalar, BENCH_GM_COUNT - 1);
+    f_expect(bench_relative_error(simd[0].elements, scalar[0].elements, (BENCH_GM_COUNT - 1)*4) <= tolerance,
+            "m4f_mul_v4f_batch disagrees with the scalar path");
+}
+
+static double bench_m4f_ortho(bench_context* ctx, uint64_t iterations)
+{
+    ctx->bytes_per_op = 0;
+    float acc = 0.0f;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        float size = (float)(i & 1023) + 1.0f;
+        M4f m = m4f_ortho(0.0f, size, size, 0.0f, -1.0f, 1.0f);
+        acc += m.elements[0];
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_f = acc;
+    return seconds;
+}
+
+//======================================================================
+// Spatial index
+//======================================================================
+// 100K sprites spread over a world 50 screens wide and tall, queried with one screen
+#define BENCH_SPATIAL_COUNT 100000
+#define BENCH_SPATIAL_WORLD (50.0f*1920.0f)
+static fude_rectf bench_sprites[BENCH_SPATIAL_COUNT];
+static uint32_t bench_sprite_handles[BENCH_SPATIAL_COUNT];
+static uint32_t bench_visible[BENCH_SPATIAL_COUNT];
+
+static void bench_init_spatial(void)
+{
+    uint32_t seed = 12345;
+    for(uint32_t i = 0; i < BENCH_SPATIAL_COUNT; ++i) {
+        seed = seed*1664525u + 1013904223u;
+        bench_sprites[i].x = (float)(seed >> 8)/(float)(1u << 24)*BENCH_SPATIAL_WORLD;
+        seed = seed*1664525u + 1013904223u;
+        bench_sprites[i].y = (float)(seed >> 8)/(float)(1u << 24)*BENCH_SPATIAL_WORLD;
+        bench_sprites[i].width = 32.0f;
+        bench_sprites[i].height = 32.0f;
+    }
+}
+
+static fude_rectf bench_screen(uint64_t i)
+{
+    fude_rectf screen = { (float)(i*97 % 40)*1920.0f, (float)(i*31 % 40)*1080.0f, 1920.0f, 1080.0f };
+    return screen;
+}
+
+// one op is a screen sized query, user_data is the index or NULL for a linear scan
+static double bench_spatial_query(bench_context* ctx, uint64_t iterations)
+{
+    fude_spatial* spatial = (fude_spatial*)ctx->user_data;
+    uint64_t found = 0;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        fude_rectf screen = bench_screen(i);
+        if(spatial) {
+            found += f_spatial_query(spatial, screen, bench_visible, BENCH_SPATIAL_COUNT);
+            continue;
+        }
+        for(uint32_t j = 0; j < BENCH_SPATIAL_COUNT; ++j) {
+            const fude_rectf* r = bench_sprites + j;
+            if(r->x <= screen.x + screen.width && screen.x <= r->x + r->width &&
+                    r->y <= screen.y + screen.height && screen.y <= r->y + r->height)
+                bench_visible[found++ % BENCH_SPATIAL_COUNT] = j;
+        }
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_u = found;
+    return seconds;
+}
+
+// one op moves 1000 sprites a few pixels and back
+static double bench_spatial_move(bench_context* ctx, uint64_t iterations)
+{
+    fude_spatial* spatial = (fude_spatial*)ctx->user_data;
+    static fude_rectf moved[1000];
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        uint32_t first = (uint32_t)(i*1000 % (BENCH_SPATIAL_COUNT - 1000));
+        float dx = (i & 1) ? -3.0f : 3.0f;
+        for(uint32_t j = 0; j < 1000; ++j) {
+            moved[j] = bench_sprites[first + j];
+            moved[j].x += dx;
+        }
+        f_spatial_move(spatial, bench_sprite_handles + first, moved, 1000);
+    }
+    double seconds = _fude_get_seconds() - start;
+    f_spatial_move(spatial, bench_sprite_handles, bench_sprites, BENCH_SPATIAL_COUNT);
+    return seconds;
+}
+
+static void bench_spatial(void)
+{
+    bench_init_spatial();
+    bench_run("spatial/query_linear", bench_spatial_query, NULL);
+
+    fude_spatial* hash = NULL;
+    fude_spatial* quadtree = NULL;
+    fude_rectf world = { 0.0f, 0.0f, BENCH_SPATIAL_WORLD, BENCH_SPATIAL_WORLD };
+    if(f_create_spatial_hash(&hash, 128.0f) == FUDE_OK &&
+            f_spatial_insert(hash, bench_sprites, BENCH_SPATIAL_COUNT, bench_sprite_handles) == FUDE_OK) {
+        bench_run("spatial/query_hash", bench_spatial_query, hash);
+        bench_run("spatial/move_hash", bench_spatial_move, hash);
+    }
+    if(f_create_quadtree(&quadtree, world, 8) == FUDE_OK &&
+            f_spatial_insert(quadtree, bench_sprites, BENCH_SPATIAL_COUNT, bench_sprite_handles) == FUDE_OK) {
+        bench_run("spatial/query_quadtree", bench_spatial_query, quadtree);
+        bench_run("spatial/move_quadtree", bench_spatial_move, quadtree);
+    }
+    f_destroy_spatial(hash);
+    f_destroy_spatial(quadtree);
+}
+
+//======================================================================
+// Event queue
+//======================================================================
+// one op is a push and the matching pop
+static double bench_event_queue(bench_context* ctx, uint64_t iterations)
+{
+    fude* app = &bench_app;
+    ctx->bytes_per_op = sizeof(fude_event);
+    fude_event event;
+    uint64_t seen = 0;
+
+    double start = _fude_get_seconds();
+    uint64_t done = 0;
+    while(done < iterations) {
+        uint64_t batch = iterations - done;
+        if(batch > FUDE_EVENT_QUEUE_MAXIMUM_EVENTS - 1) batch = FUDE_EVENT_QUEUE_MAXIMUM_EVENTS - 1;
+        for(uint64_t i = 0; i < batch; ++i) {
+            fude_event* pushed = _fude_new_event(&app->event_queue, FUDE_EVENT_CURSOR_MOVED);
+            pushed->cursor.x = (int)i;
+        }
+        while(f_next_event(app, &event))
+            seen += (uint64_t)event.cursor.x;
+        done += batch;
+    }
+    double seconds = _fude_get_seconds() - start;
+
+    bench_sink_u = seen;
+    return seconds;
+}
+
+//======================================================================
+// Utilities
+//======================================================================
+typedef struct {
+    const char* path;
+    size_t size;
+} bench_file;
+
+static double bench_load_file(bench_context* ctx, uint64_t iterations)
+{
+    bench_file* file = (bench_file*)ctx->user_data;
+    ctx->bytes_per_op = file->size;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        size_t size = 0;
+        uint8_t* data = f_load_file_data(file->path, &size);
+        f_expect(data != NULL, "Failed to load %s", file->path);
+        bench_sink_u = data[size/2];
+        f_unload_file_data(data);
+    }
+    return _fude_get_seconds() - start;
+}
+
+typedef struct {
+    uint8_t* src;
+    uint8_t* dst;
+    size_t size;
+} bench_buffers;
+
+static double bench_memcpy(bench_context* ctx, uint64_t iterations)
+{
+    bench_buffers* buffers = (bench_buffers*)ctx->user_data;
+    ctx->bytes_per_op = buffers->size;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i) {
+        buffers->src[0] = (uint8_t)i;
+        f_memcpy(buffers->dst, buffers->src, buffers->size);
+    }
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_u = buffers->dst[0];
+    return seconds;
+}
+
+static double bench_memset(bench_context* ctx, uint64_t iterations)
+{
+    bench_buffers* buffers = (bench_buffers*)ctx->user_data;
+    ctx->bytes_per_op = buffers->size;
+    double start = _fude_get_seconds();
+    for(uint64_t i = 0; i < iterations; ++i)
+        f_memset(buffers->dst, (int)(i & 255), buffers->size);
+    double seconds = _fude_get_seconds() - start;
+    bench_sink_u = buffers->dst[buffers->size - 1];
+    return seconds;
+}
+
+static bool bench_write_file(const char* path, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if(!file) return false;
+    for(size_t i = 0; i < size; ++i)
+        fputc((int)(i*31 & 255), file);
+    fclose(file);
+    return true;
+}
+
+//======================================================================
+// Report
+//======================================================================
+static void bench_write_json(FILE* out)
+{
+    const char* commit = getenv("FUDE_BENCH_COMMIT");
+    fprintf(out, "{\n");
+    fprintf(out, "  \"commit\": \"%s\",\n", commit ? commit : "unknown");
+    fprintf(out, "  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(out, "  \"cpu_count\": %u,\n", _fude_cpu_count());
+    fprintf(out, "  \"gm_simd\": \"%s\",\n", GM_SIMD_AVX ? "avx" : GM_SIMD_SSE ? "sse" : GM_SIMD_NEON ? "neon" : "scalar");
+    fprintf(out, "  \"benchmarks\": [\n");
+    for(uint32_t i = 0; i < bench.count; ++i) {
+        const bench_result* result = bench.results + i;
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, "
+                "\"ns_per_op_min\": %.3f, \"bytes_per_second\": %.0f}%s\n",
+                result->name, (unsigned long long)result->iterations, result->ns_per_op,
+                result->ns_per_op_min, result->bytes_per_second, i + 1 < bench.count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench.filter = argc > 1 ? argv[1] : NULL;
+
+    bench_run("batch/vertex3f", bench_vertex_submission, NULL);
+    bench_run("batch/vertex3f_translated", bench_vertex_submission, "translate");
+    bench_run("batch/vertex3f_rotated", bench_vertex_submission, "rotate");
+    bench_run("batch/quad_indices", bench_quad_indices, NULL);
+    bench_run("batch/quad_indices_culled", bench_quad_indices, "cull");
+    bench_run("batch/replay_list", bench_replay_list, NULL);
+    bench_run("batch/circle_sdf", bench_circle, NULL);
+    bench_run("batch/circle_tessellated", bench_circle, "tessellated");
+    bench_run("path/fill_cached", bench_fill_path, NULL);
+    bench_run("path/fill_tessellated", bench_fill_path, "tessellated");
+    bench_run("particles/update_1m", bench_update_particles, (void*)(uintptr_t)1);
+    bench_run("particles/update_1m_pool", bench_update_particles, (void*)(uintptr_t)0);
+
+    bench_init_gm();
+    bench_check_gm();
+    bench_run("gm/v4f_add", bench_v4f_add, NULL);
+    bench_run("gm/v4f_dot", bench_v4f_dot, NULL);
+    bench_run("gm/v4f_normalize", bench_v4f_normalize, NULL);
+    bench_run("gm/m4f_dot", bench_m4f_dot, NULL);
+    bench_run("gm/m4f_dot_scalar", bench_m4f_dot_scalar, NULL);
+    bench_run("gm/m4f_inverse", bench_m4f_inverse, NULL);
+    bench_run("gm/m4f_transpose", bench_m4f_transpose, NULL);
+    bench_run("gm/m4f_mul_v4f_batch", bench_m4f_mul_v4f_batch, NULL);
+    bench_run("gm/m4f_mul_v4f_batch_scalar", bench_m4f_mul_v4f_batch, (void*)1);
+    bench_run("gm/m4f_ortho", bench_m4f_ortho, NULL);
+
+    bench_spatial();
+
+    bench_run("core/event_queue", bench_event_queue, NULL);
+
+    bench_file small_file = { "/tmp/fude_bench_4k.bin", 4*1024 };
+    bench_file large_file = { "/tmp/fude_bench_1m.bin", 1024*1024 };
+    if(bench_write_file(small_file.path, small_file.size) && bench_write_file(large_file.path, large_file.size)) {
+        bench_run("utils/load_file_4k", bench_load_file, &small_file);
+        bench_run("utils/load_file_1m", bench_load_file, &large_file);
+        remove(small_file.path);
+        remove(large_file.path);
+    } else {
+        f_trace_log(FUDE_LOG_WARNING, "Can't write to /tmp, skipping the file benchmarks");
+    }
+
+    bench_buffers small = { f_malloc(4*1024), f_malloc(4*1024), 4*1024 };
+    bench_buffers large = { f_malloc(8*1024*1024), f_malloc(8*1024*1024), 8*1024*1024 };
+    f_expect(small.src && small.dst && large.src && large.dst, "Failed to allocate the benchmark buffers");
+    f_memset(small.src, 1, small.size);
+    f_memset(large.src, 1, large.size);
+    bench_run("utils/memcpy_4k", bench_memcpy, &small);
+    bench_run("utils/memcpy_8m", bench_memcpy, &large);
+    bench_run("utils/memset_4k", bench_memset, &small);
+    bench_run("utils/memset_8m", bench_memset, &large);
+    f_free(small.src); f_free(small.dst);
+    f_free(large.src); f_free(large.dst);
+
+    // last, a GL context is the one thing that may not be available
+    const char* font_path = getenv("FUDE_BENCH_FONT");
+    bool text = font_path && (!bench.filter || strstr("text/draw_text_cached", bench.filter) ||
+            strstr("text/draw_text_uncached", bench.filter));
+    if(text || !bench.filter || strstr("gl/flush_headless", bench.filter) || strstr("gl/draw_mesh_headless", bench.filter) ||
+            strstr("gl/draw_particles_headless", bench.filter) || strstr("gl/tilemap_chunks_headless", bench.filter) ||
+            strstr("gl/tilemap_quads_headless", bench.filter) || strstr("gl/blur_chain_pooled_headless", bench.filter) ||
+            strstr("gl/blur_chain_created_headless", bench.filter) || strstr("gl/layers_painter_headless", bench.filter) ||
+            strstr("gl/layers_depth_headless", bench.filter) || strstr("gl/blend_split_headless", bench.filter) ||
+            strstr("gl/blend_shared_headless", bench.filter) || strstr("gl/frame_graph_headless", bench.filter)) {
+        static fude app;
+        fude_config config;
+        f_memzero(&config, sizeof(fude_config));
+        config.name = "bench";
+        config.width = 1280;
+        config.height = 720;
+        config.headless = true;
+        if(f_init(&app, &config) == FUDE_OK) {
+            bench_check_tilemap(&app);
+            bench_run("gl/flush_headless", bench_flush, &app);
+            bench_run("gl/draw_mesh_headless", bench_draw_mesh, &app);
+            bench_run("gl/draw_particles_headless", bench_draw_particles, &app);
+
+            bench_tilemap tilemap_chunks;
+            f_memzero(&tilemap_chunks, sizeof(bench_tilemap));
+            if(bench_init_tilemap(&tilemap_chunks, &app)) {
+                bench_tilemap tilemap_quads = tilemap_chunks;
+                tilemap_quads.quads = true;
+                bench_run("gl/tilemap_chunks_headless", bench_draw_tilemap, &tilemap_chunks);
+                bench_run("gl/tilemap_quads_headless", bench_draw_tilemap, &tilemap_quads);
+            }
+            bench_deinit_tilemap(&tilemap_chunks);
+
+            bench_targets targets_pooled = { &app, true };
+            bench_targets targets_created = { &app, false };
+            bench_run("gl/blur_chain_pooled_headless", bench_blur_chain, &targets_pooled);
+            bench_run("gl/blur_chain_created_headless", bench_blur_chain, &targets_created);
+
+            static bench_graph graph;
+            f_memzero(&graph, sizeof(bench_graph));
+            if(bench_check_frame_graph(&graph, &app))
+                bench_run("gl/frame_graph_headless", bench_frame_graph, &graph);
+            if(graph.graph) f_destroy_frame_graph(graph.graph);
+
+            f_memzero(&bench_layer_scene, sizeof(bench_layers));
+            if(bench_init_layers(&bench_layer_scene, &app)) {
+                bench_run("gl/layers_painter_headless", bench_draw_layers, &bench_layer_scene);
+                bench_layer_scene.layered = true;
+                bench_run("gl/layers_depth_headless", bench_draw_layers, &bench_layer_scene);
+            }
+            bench_deinit_layers(&bench_layer_scene);
+
+            f_memzero(&bench_blend_scene, sizeof(bench_blend));
+            if(bench_init_blend(&bench_blend_scene, &app)) {
+                bench_blend_scene.split = true;
+                bench_run("gl/blend_split_headless", bench_draw_blend, &bench_blend_scene);
+                bench_blend_scene.split = false;
+                bench_run("gl/blend_shared_headless", bench_draw_blend, &bench_blend_scene);
+                f_destroy_texture(&app, bench_blend_scene.texture);
+            }
+
+            bench_text text_cached = { &app, NULL, 1024 };
+            if(font_path && f_load_font(&app, &text_cached.font, font_path) == FUDE_OK) {
+                for(uint32_t i = 0; i < BENCH_TEXT_LABELS; ++i)
+                    snprintf(bench_labels[i], sizeof(bench_labels[i]), "Label %010u x", i*2654435761u);
+                bench_text text_uncached = text_cached;
+                text_uncached.label_count = BENCH_TEXT_LABELS;
+                bench_run("text/draw_text_cached", bench_draw_text, &text_cached);
+                bench_run("text/draw_text_uncached", bench_draw_text, &text_uncached);
+                f_destroy_font(&app, text_cached.font);
+            }
+            f_deinit(&app);
+        } else {
+            f_trace_log(FUDE_LOG_WARNING, "No headless GL context, skipping gl/flush_headless");
+        }
+    }
+
+    bench_write_json(stdout);
+    return 0;
+}
@@ -0,0 +1,50 @@
+set -xe
+
+cc="gcc"
+cflags="-Wall -Wextra -Wpedantic -Iinclude -Isrc -O2 -g -fPIC -DFUDE_SHAREDLIB"
+ldflags="-lglfw -lEGL -lm -ldl -lpthread"
+
+if [ ! -d "./build" ]; then 
+    mkdir "./build"
+fi
+if [ ! -d "./build/bin" ]; then 
+    mkdir "./build/bin"
+fi
+if [ ! -d "./build/bin-int" ]; then 
+    mkdir "./build/bin-int"
+fi
+
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_core.c.o"           "./src/fude_core.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_utils.c.o"          "./src/fude_utils.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_graphics.c.o"       "./src/fude_graphics.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_glfw.c.o"           "./src/fude_glfw.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_thread.c.o"         "./src/fude_thread.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_profiler.c.o"       "./src/fude_profiler.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_headless.c.o"       "./src/fude_headless.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_software.c.o"       "./src/fude_software.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_spatial.c.o"        "./src/fude_spatial.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_text.c.o"           "./src/fude_text.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_shapes.c.o"         "./src/fude_shapes.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_path.c.o"           "./src/fude_path.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_particles.c.o"      "./src/fude_particles.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_tilemap.c.o"        "./src/fude_tilemap.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_target.c.o"         "./src/fude_target.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/fude_frame_graph.c.o"    "./src/fude_frame_graph.c"
+$cc $cflags -DFUDE_EXPORT -c -o "./build/bin-int/glad.c.o"                "./src/glad/glad.c"
+
+objects="./build/bin-int/fude_core.c.o ./build/bin-int/fude_utils.c.o \
+    ./build/bin-int/fude_glfw.c.o ./build/bin-int/fude_graphics.c.o \
+    ./build/bin-int/fude_thread.c.o ./build/bin-int/fude_profiler.c.o \
+    ./build/bin-int/fude_headless.c.o ./build/bin-int/fude_software.c.o \
+    ./build/bin-int/fude_spatial.c.o ./build/bin-int/fude_text.c.o \
+    ./build/bin-int/fude_shapes.c.o ./build/bin-int/fude_path.c.o \
+    ./build/bin-int/fude_particles.c.o ./build/bin-int/fude_tilemap.c.o \
+    ./build/bin-int/fude_target.c.o ./build/bin-int/fude_frame_graph.c.o \
+    ./build/bin-int/glad.c.o"
+
+$cc -shared -o "./build/bin/libfude.so" $objects $ldflags
+
+$cc $cflags -o ./build/bin/example ./example/main.c -Lbuild/bin -lfude -Wl,-rpath,'$ORIGIN' $ldflags
+
+# the benchmarks link the objects directly, they poke at library internals
+$cc $cflags -DFUDE_EXPORT -o ./build/bin/bench ./bench/bench.c $objects $ldflags
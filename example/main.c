@@ -11,23 +11,24 @@ int main(void)
     fude_shader shader;
     fude_texture cute;
     fude_config config;
+    f_memzero(&config, sizeof(fude_config));
     config.name = "My Game";
     config.width = 800;
     config.height = 600;
 
     f_expect(f_init(f, &config) == FUDE_OK,
             "Failed to initialize %s", config.name);
-    f_expect(f_create_shader_from_file(&shader, "./example/main.vert", "./example/main.frag") == FUDE_OK, 
+    f_expect(f_create_shader_from_file(f, &shader, "./example/main.vert", "./example/main.frag") == FUDE_OK, 
             "Failed to create shader at line %d in %s", __LINE__, __FILE__);
 
     int width, height, channels;
     stbi_uc* data = stbi_load("./resources/cute.jpg", &width, &height, &channels, 0);
-    f_expect(f_create_texture(&cute, data, width, height, channels) == FUDE_OK,
+    f_expect(f_create_texture(f, &cute, data, width, height, channels) == FUDE_OK,
             "Failed to create cute texture");
     stbi_image_free(data);
 
-    M4f ortho = m4f_ortho(0.0f, config.width, config.height, 0.0f, -1.0f, 1.0f);
-    f_set_shader_uniform(shader, shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC], FUDE_SHADERDT_MAT4, 1, ortho.elements, false);
+    fude_camera camera;
+    f_create_camera2d(&camera, config.width, config.height);
         
     bool should_quit = false;
     fude_event event;
@@ -43,6 +44,7 @@ int main(void)
         }
 
         f_clear(f);
+        f_use_camera(f, &camera, shader);
 
         // // Colored Rectangle
         // f_begin(f, FUDE_MODE_QUADS, shader);
@@ -71,6 +73,6 @@ int main(void)
         f_present(f);
     }
 
-    f_destroy_shader(shader);
+    f_destroy_shader(f, shader);
     f_free(f);
 }
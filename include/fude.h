@@ -88,6 +88,15 @@
     #define NDEBUG 1
 #endif
 
+// define FUDE_PROFILER to 0 to compile every profiler zone out
+#ifndef FUDE_PROFILER
+    #ifdef FUDE_RELEASE
+        #define FUDE_PROFILER 0
+    #else
+        #define FUDE_PROFILER 1
+    #endif
+#endif
+
 #define FUDE_POSITION_VERTEX_ATRIBUTE_NAME "a_position"
 #define FUDE_COLOR_VERTEX_ATRIBUTE_NAME "a_color"
 #define FUDE_TEX_COORDS_VERTEX_ATRIBUTE_NAME "a_tex_coords"
@@ -101,10 +110,24 @@
 #define FUDE_MATRIX_MODEL_UNIFORM_NAME "u_model"
 
 #define FUDE_EVENT_QUEUE_MAXIMUM_EVENTS 512 // TODO: reconsider this value
+#define FUDE_INPUT_MAXIMUM_KEYS 512 // must cover GLFW_KEY_LAST
+#define FUDE_INPUT_MAXIMUM_MOUSE_BUTTONS 8
+#define FUDE_FRAME_TIME_HISTORY 128
+#define FUDE_GPU_TIMER_LATENCY 4 // frames between issuing a query and reading it back
+#define FUDE_GPU_TIMER_MAXIMUM_PASSES 32
+#define FUDE_PROFILER_THREAD_EVENTS (16*1024) // per thread ring, must be a power of two
+#define FUDE_PROFILER_MAXIMUM_DEPTH 64
+#define FUDE_RENDER_STATS_HISTORY 64
 #define FUDE_RENDERER_MAXIMUM_VERTICES (32*1024)
 #define FUDE_RENDERER_MAXIMUM_INDICIES (FUDE_RENDERER_MAXIMUM_VERTICES*6/4)
 #define FUDE_RENDERER_MAXIMUM_TEXTURES 8
+#define FUDE_MATRIX_STACK_DEPTH 32
 #define FUDE_SHADER_RETRIEVE_ALL_LOCATIONS 0
+#define FUDE_FONT_SDF_SIZE 32     // atlas pixels between a font's ascent and descent
+#define FUDE_FONT_SDF_SPREAD 4    // atlas pixels of distance stored around each outline
+#define FUDE_FONT_ATLAS_SIZE 1024
+#define FUDE_PATH_TOLERANCE 0.25f // pixels a flattened curve may stray from the real one
+#define FUDE_PATH_MITER_LIMIT 4.0f // miter length over stroke width before a miter join becomes a bevel
 
 //======================================================================
 // Types
@@ -159,6 +182,7 @@ typedef enum {
 
     FUDE_ATTRIBUTE_LOCATION_NOT_FOUND_ERROR,
     FUDE_UNIFORM_LOCATION_NOT_FOUND_ERROR,
+    FUDE_FONT_LOADING_ERROR,
 } fude_result;
 
 typedef struct { uint8_t r, g, b, a;  } fude_color;
@@ -169,11 +193,18 @@ typedef struct { uint8_t r, g, b, a;  } fude_color;
 #define FUDE_WHITE (fude_color){ .r=0xFF, .g=0xFF, .b=0xFF, .a=0xFF }
 
 typedef struct { int x, y, width, height; } fude_rect;
+typedef struct { float x, y, width, height; } fude_rectf;
 typedef struct { int x0, y0, x1, y1, x2, y2; } fude_triangle;
 
 // graphics
+// set by f_create_texture and f_update_texture when every texel has alpha 255
+#define FUDE_TEXTURE_OPAQUE 1
+// RGBA texels with alpha below 255, stored premultiplied. Shaders sampling it are blended as premultiplied
+#define FUDE_TEXTURE_PREMULTIPLIED 2
+
 typedef struct {
     uint32_t id;
+    uint32_t flags; // FUDE_TEXTURE_OPAQUE, FUDE_TEXTURE_PREMULTIPLIED
 } fude_texture;
 
 typedef enum {
@@ -211,15 +242,296 @@ typedef enum {
     FUDE_MODE_QUADS,
 } fude_draw_mode;
 
+// how f_set_blend_mode combines what's drawn with the framebuffer. The default shader blends premultiplied
+// color, so ALPHA, ADDITIVE and PREMULTIPLIED geometry share its batches, MULTIPLY and OPAQUE break them
+typedef enum {
+    FUDE_BLEND_ALPHA = 0,     // over, with the straight alpha of f_color
+    FUDE_BLEND_ADDITIVE,      // color times alpha is added
+    FUDE_BLEND_MULTIPLY,      // the framebuffer is multiplied by the color, alpha fades it out
+    FUDE_BLEND_PREMULTIPLIED, // over, f_color's rgb is already multiplied by alpha, alpha 0 adds
+    FUDE_BLEND_OPAQUE,        // no blending, the default shader writes its premultiplied color as is
+} fude_blend_mode;
+
+typedef enum {
+    FUDE_CAMERA_2D = 0,
+    FUDE_CAMERA_3D,
+} fude_camera_type;
+
+// change it through the f_set_camera_* setters, they mark the cached matrices dirty
 typedef struct {
+    fude_camera_type type;
+    V3f position;   // 2D: world point at the top-left of the viewport, 3D: eye position
+    V3f target;     // 3D only, the point looked at
+    V3f up;         // 3D only
+    float zoom;     // 2D: scale around the viewport center, 3D: magnifies the field of view
+    float rotation; // degrees, rolls around the view direction (the viewport center in 2D)
+    float fov;      // 3D only, vertical field of view in degrees
+    float near, far;
+    uint32_t width, height;
+
+    // cached, f_update_camera recomputes them only when dirty
     M4f projection_matrix;
     M4f view_matrix;
+    M4f view_projection;
+    M4f inverse_view_projection;
+    struct { V3f min, max; } bounds; // world-space box around everything the camera sees
+    uint64_t version;                // unique per recompute across all cameras
+    bool dirty;
 } fude_camera;
 
+// geometry kept in GL_STATIC_DRAW buffers, drawing it uploads nothing
+typedef struct {
+    uint32_t vbo, ibo; // the software backend keeps a CPU copy instead, vbo is its id
+    uint32_t vertex_count, index_count;
+    fude_texture textures[FUDE_RENDERER_MAXIMUM_TEXTURES]; // slot i is sampled by vertices with tex_index i
+    struct { V3f min, max; } bounds; // of the untransformed vertices
+} fude_mesh;
+
+// TrueType font rendered from signed distance fields kept in a glyph atlas, opaque
+typedef struct fude_font fude_font;
+
+// a glyph whose atlas cell recorded text samples, pinned there while a display list holds it
+typedef struct {
+    fude_font* font;
+    uint32_t glyph;
+} fude_display_glyph;
+
+// a run of recorded primitives sharing one shader, texture set, blend and draw mode, never larger than a batch
+typedef struct {
+    fude_shader shader;
+    fude_texture textures[FUDE_RENDERER_MAXIMUM_TEXTURES];
+    fude_blend_mode blend; // what its batch blends with, default shader vertices are converted already
+    fude_draw_mode mode;   // so replays between f_begin_layers and f_end_layers can split it into primitives
+    uint32_t first_vertex, vertex_count;
+    uint32_t first_index, index_count; // indices are relative to first_vertex
+    struct { V3f min, max; } bounds;
+} fude_display_segment;
+
+// geometry captured between f_record_begin and f_record_end, already transformed by the matrix stack
+typedef struct {
+    struct {
+        fude_vertex* data;
+        uint32_t count, capacity;
+    } vertices;
+    struct {
+        uint32_t* data;
+        uint32_t count, capacity;
+    } indices;
+    struct {
+        fude_display_segment* data;
+        uint32_t count, capacity;
+    } segments;
+    struct {
+        fude_mesh* data; // one per segment, only used when resident
+        uint32_t count, capacity;
+    } meshes;
+    struct {
+        fude_display_glyph* data; // released by the next f_record_begin or f_destroy_display_list
+        uint32_t count, capacity;
+    } glyphs;
+    uint64_t hash;          // of everything recorded, set by f_record_end
+    uint64_t resident_hash; // what the meshes hold, 0 = nothing uploaded yet
+    bool resident;          // f_replay draws GPU copies instead of copying into the batch
+} fude_display_list;
+
+typedef enum {
+    FUDE_PATH_MOVE = 0,  // 1 point
+    FUDE_PATH_LINE,      // 1 point
+    FUDE_PATH_QUADRATIC, // control, end
+    FUDE_PATH_CUBIC,     // control, control, end
+    FUDE_PATH_CLOSE,     // no point, back to the last move
+} fude_path_command;
+
+typedef enum {
+    FUDE_JOIN_MITER = 0,
+    FUDE_JOIN_ROUND,
+    FUDE_JOIN_BEVEL,
+} fude_line_join;
+
+typedef enum {
+    FUDE_CAP_BUTT = 0,
+    FUDE_CAP_ROUND,
+    FUDE_CAP_SQUARE,
+} fude_line_cap;
+
+// built with the f_path_* calls starting from all zeros, f_destroy_path frees the storage
+typedef struct {
+    struct {
+        uint8_t* data; // fude_path_command
+        uint32_t count, capacity;
+    } commands;
+    struct {
+        V2f* data;
+        uint32_t count, capacity;
+    } points;
+    uint64_t hash; // of the commands and points so far, tessellations are cached by it
+} fude_path;
+
+// tessellated paths by hash and scale, owned by a fude instance, opaque
+typedef struct fude_path_cache fude_path_cache;
+
+// structure-of-arrays particle pools, opaque
+typedef struct fude_particles fude_particles;
+
+// the instance buffer and program f_draw_particles uses on the GL backend, owned by a fude instance, opaque
+typedef struct fude_particle_stream fude_particle_stream;
+
+typedef struct {
+    uint32_t capacity;  // f_emit_particles drops what doesn't fit
+    uint32_t threads;   // f_update_particles workers including the caller, 0 = one per CPU
+    V2f gravity;        // world units per second squared
+    float drag;         // velocity lost per second, as a fraction
+    uint32_t seed;      // of the emitter spreads
+} fude_particles_config;
+
+// tiles per chunk side, every chunk is one mesh drawn with one call
+#define FUDE_TILEMAP_CHUNK_TILES 32
+
+// grid of tile ids split into chunks, opaque
+typedef struct fude_tilemap fude_tilemap;
+
+typedef struct {
+    uint32_t width, height;   // in tiles
+    float tile_size;          // world units
+    fude_texture tileset;     // tile n is cell n - 1 of a columns x rows grid, row by row from the top left
+    uint32_t columns, rows;
+} fude_tilemap_config;
+
+typedef enum {
+    FUDE_TARGET_RGBA8 = 0,
+    FUDE_TARGET_RGBA16F, // the software backend stores it as RGBA8
+} fude_target_format;
+
+typedef struct {
+    uint32_t width, height; // 0 = the default framebuffer's size times scale, followed when it resizes
+    float scale;            // of window relative targets, 0 means 1
+    fude_target_format format;
+    bool depth;             // a depth/stencil buffer cleared by f_clear with the color, GL only
+} fude_render_target_config;
+
+// offscreen framebuffer whose color is an ordinary texture, rows are bottom first like f_read_pixels
+typedef struct {
+    fude_texture color;
+    uint32_t fbo, depth; // GL names, fbo is 0 with threaded rendering and on the software backend
+    uint32_t width, height;
+    fude_render_target_config config;
+} fude_render_target;
+
+// frames a pooled target may stay unused before its storage is freed
+#define FUDE_TARGET_POOL_IDLE_FRAMES 60
+
+// render targets f_acquire_render_target hands out, owned by a fude instance, opaque
+typedef struct fude_target_pool fude_target_pool;
+
+// every particle gets the base values plus a uniform random offset within +-spread
+typedef struct {
+    V2f position, position_spread;
+    V2f velocity, velocity_spread;
+    float life, life_spread;          // seconds
+    float size_start, size_end;       // radius in world units at birth and at death
+    uint32_t color_start, color_end;  // 0xRRGGBBAA at birth and at death
+} fude_particle_emitter;
+
+typedef enum {
+    FUDE_GPU_PASS_CLEAR = 0,
+    FUDE_GPU_PASS_FLUSH,
+    FUDE_COUNT_GPU_PASS,
+} fude_gpu_pass;
+
+typedef struct {
+    uint64_t frame;     // index of the frame these timings belong to
+    float frame_ms;     // first pass start to last pass end
+    float pass_total_ms[FUDE_COUNT_GPU_PASS];
+    uint32_t pass_count;
+    struct { int type; float ms; } passes[FUDE_GPU_TIMER_MAXIMUM_PASSES];
+} fude_gpu_timings;
+
+typedef struct {
+    uint32_t elapsed[FUDE_GPU_TIMER_MAXIMUM_PASSES]; // GL_TIME_ELAPSED per pass
+    uint32_t timestamps[2];                          // GL_TIMESTAMP at frame begin/end
+    int types[FUDE_GPU_TIMER_MAXIMUM_PASSES];
+    uint32_t pass_count;
+    uint64_t frame;
+    bool issued;
+} fude_gpu_timer_frame;
+
+typedef struct {
+    fude_gpu_timer_frame frames[FUDE_GPU_TIMER_LATENCY];
+    uint32_t current;
+    uint64_t frame_count;
+    bool pass_active;
+    bool valid;
+    fude_gpu_timings latest;
+} fude_gpu_timer;
+
+typedef enum {
+    FUDE_BATCH_BREAK_FLUSH = 0, // f_flush was called
+    FUDE_BATCH_BREAK_CAPACITY,  // the vertex buffer was full
+    FUDE_BATCH_BREAK_SHADER,    // f_begin with a different shader
+    FUDE_BATCH_BREAK_TEXTURE,   // f_texture put a different texture into a used slot
+    FUDE_BATCH_BREAK_CAMERA,    // f_use_camera changed the matrix of the batch's shader
+    FUDE_BATCH_BREAK_MESH,      // f_draw_mesh has to come after what was submitted before it
+    FUDE_BATCH_BREAK_INSTANCES, // so does an instanced f_draw_particles
+    FUDE_BATCH_BREAK_TARGET,    // f_begin_target/f_end_target switched framebuffers
+    FUDE_BATCH_BREAK_DEPTH,     // the layer queue went from opaque to translucent or was entered/left
+    FUDE_BATCH_BREAK_BLEND,     // f_set_blend_mode changed how the batch's shader blends
+    FUDE_BATCH_BREAK_UNIFORM,   // f_set_shader_uniform changed a uniform of the batch's shader
+    FUDE_COUNT_BATCH_BREAK,
+} fude_batch_break;
+
+// how a batch uses the depth buffer, only f_end_layers and friends draw with anything but FUDE_DEPTH_OFF
+typedef enum {
+    FUDE_DEPTH_OFF = 0,
+    FUDE_DEPTH_OPAQUE,      // tested with GL_LEQUAL and written
+    FUDE_DEPTH_TRANSLUCENT, // tested but not written
+} fude_depth_mode;
+
+// primitives held back between f_begin_layers and f_end_layers, owned by a fude instance, opaque
+typedef struct fude_layer_queue fude_layer_queue;
+
+// what the current matrix does, so f_vertex3f can skip most of the multiply
+typedef enum {
+    FUDE_TRANSFORM_IDENTITY = 0, // the matrix isn't even read
+    FUDE_TRANSFORM_TRANSLATION,  // only elements 12..14 matter
+    FUDE_TRANSFORM_GENERAL,
+} fude_transform_kind;
+
+typedef struct {
+    M4f matrix;
+    fude_transform_kind kind;
+} fude_transform;
+
+// the u_mvp a shader holds between draws, f_draw_mesh puts it back after a moved mesh
+typedef struct {
+    uint32_t shader;
+    M4f matrix;
+} fude_shader_mvp;
+
+typedef struct {
+    uint64_t frame;
+    uint32_t draw_calls;
+    uint32_t batches;
+    uint32_t batch_breaks[FUDE_COUNT_BATCH_BREAK];
+    uint32_t vertices;
+    uint32_t indices;
+    uint64_t bytes_uploaded;
+    uint32_t texture_binds;   // slots whose texture changed since the previous draw
+    uint32_t program_switches;
+    uint32_t uniform_uploads; // this instance's, including each draw's sampler array
+    uint32_t culled_primitives; // quads and triangles dropped outside the camera's bounds
+    uint32_t mesh_draws;
+    uint32_t instances; // drawn by instanced draw calls
+} fude_render_stats;
+
 typedef struct {
     uint32_t id;
     fude_shader shader;
     uint32_t vbo, ibo;
+    uint32_t mesh_vao; // rebound to each mesh's buffers, VAOs aren't shared with the render thread
+    uint32_t default_framebuffer; // 0, or the offscreen framebuffer in headless mode
+    struct { int width, height; } framebuffer; // of the default one, the software backend's never resizes
+    uint32_t target_fbo; // the render thread reattaches targets to this, FBOs aren't shared either
+    fude_render_target* target; // bound by f_begin_target, NULL for the default framebuffer
     struct {
         fude_vertex data[FUDE_RENDERER_MAXIMUM_VERTICES];
         uint32_t count;
@@ -233,14 +545,65 @@ typedef struct {
         int samplers[FUDE_RENDERER_MAXIMUM_TEXTURES];
     } textures;
 
-    fude_shader default_shader;
-    fude_texture default_texture;
+    fude_shader default_shader;   // created by f_init on every backend
+    fude_texture default_texture; // id 0, an empty slot: the default shader draws vertex color for it
+    fude_gpu_timer gpu_timer;
+
+    struct {
+        fude_render_stats current;
+        fude_render_stats history[FUDE_RENDER_STATS_HISTORY];
+        uint32_t head, count;
+        uint32_t last_program;
+        uint32_t last_textures[FUDE_RENDERER_MAXIMUM_TEXTURES]; // per slot, what the previous draw bound
+    } stats;
+
+    // what f_use_camera last pushed, so an unchanged camera costs nothing
+    struct {
+        uint32_t shader;
+        uint64_t version;
+        M4f view_projection;
+        bool active;
+        struct { V3f min, max; } bounds;
+        float pixel_size; // world units per pixel of a 2D camera, 0 otherwise
+    } camera;
+
+    struct {
+        fude_shader_mvp* data; // set by f_use_camera and u_mvp uploads, shaders without one hold the identity
+        uint32_t count, capacity;
+    } mvps;
+
+    struct {
+        fude_transform current;
+        fude_transform stack[FUDE_MATRIX_STACK_DEPTH];
+        uint32_t depth;
+    } transform;
 
     struct {
         fude_vertex vertex;
         fude_draw_mode mode;
         uint32_t count;
     } working;
+
+    fude_display_list* recording; // f_end copies every primitive here too, NULL when not recording
+
+    fude_blend_mode blend_mode; // see f_set_blend_mode
+
+    struct {
+        float depth;             // z of f_vertex2f and the 2D shapes, see f_set_depth
+        fude_depth_mode mode;    // of the pending batch
+        bool depth_buffer;       // the bound framebuffer has one, kept by f_begin_target/f_end_target
+        bool active;             // between f_begin_layers and f_end_layers
+        fude_layer_queue* queue; // created by the first f_begin_layers
+    } layers;
+
+    struct {
+        fude_font* font;
+        float size; // pixels from ascent to descent
+    } text;
+
+    fude_path_cache* paths; // created by the first f_fill_path/f_stroke_path
+    fude_particle_stream* particles; // created by the first f_draw_particles on the GL backend
+    fude_target_pool* targets; // created by the first f_acquire_render_target
 } fude_renderer;
 
 // core
@@ -260,18 +623,91 @@ typedef struct {
     size_t tail, head;
 } fude_event_queue;
 
+// one bit per key/button, edges are cleared on every f_poll_events()
+typedef struct {
+    struct {
+        uint64_t down[FUDE_INPUT_MAXIMUM_KEYS/64];
+        uint64_t pressed[FUDE_INPUT_MAXIMUM_KEYS/64];
+        uint64_t released[FUDE_INPUT_MAXIMUM_KEYS/64];
+    } keyboard;
+    struct {
+        uint8_t down, pressed, released;
+    } mouse;
+    struct { float x, y, dx, dy; } cursor;
+    struct { float x, y; } scroll;
+} fude_input;
+
+typedef struct {
+    double start_time;          // _fude_get_seconds() at f_init
+    double last_frame_time;     // _fude_get_seconds() at the last frame boundary
+    double delta_time;          // seconds between the last two frame boundaries
+    double target_frame_time;   // 0 when the frame limiter is off
+    uint64_t frame_count;
+    struct {
+        float data[FUDE_FRAME_TIME_HISTORY]; // milliseconds
+        uint32_t head, count;
+    } history;
+    struct {
+        double estimate, mean, m2; // how long a 1ms sleep really takes
+        uint64_t count;
+        bool fine_resolution; // the system timer was raised to 1ms for this instance, see f_deinit
+    } sleep;
+} fude_timing;
+
 typedef struct GLFWwindow GLFWwindow;
+typedef struct fude_render_thread fude_render_thread;
+typedef struct fude_headless fude_headless;
+typedef struct fude_software fude_software;
+
+// 2D index of world space rectangles, queries only touch what's near the query rectangle
+typedef enum {
+    FUDE_SPATIAL_HASH = 0, // uniform grid of cell_size, hashed so the world can be unbounded
+    FUDE_SPATIAL_QUADTREE, // loose quadtree over a fixed world rectangle
+} fude_spatial_type;
+
+#define FUDE_QUADTREE_MAXIMUM_DEPTH 10
+typedef struct fude_spatial fude_spatial;
 
 typedef struct {
     GLFWwindow* window;
     fude_event_queue event_queue;
+    fude_input input;
+    fude_timing timing;
     fude_renderer renderer;
+    fude_render_thread* render_thread; // NULL unless config.threaded_rendering
+    fude_headless* headless;           // NULL unless config.headless
+    fude_software* software;           // NULL unless config.backend == FUDE_BACKEND_SOFTWARE
 } fude;
 
+// passes declared every frame with the textures they read and write, sorted, culled and run by
+// f_execute_frame_graph, opaque
+typedef struct fude_frame_graph fude_frame_graph;
+typedef uint32_t fude_graph_resource; // 0 is none
+typedef void (*fude_graph_pass_proc)(fude* f, fude_frame_graph* graph, void* user_data);
+
+typedef struct {
+    uint32_t passes;        // declared
+    uint32_t culled_passes; // nothing that ran read what they wrote
+    uint32_t textures;      // transient textures the passes that ran used
+    uint32_t targets;       // distinct render targets behind them, fewer when lifetimes didn't overlap
+} fude_frame_graph_stats;
+
+typedef enum {
+    FUDE_BACKEND_OPENGL = 0,
+    FUDE_BACKEND_SOFTWARE, // tiled CPU rasterizer, always shades like the default shader
+} fude_backend;
+
 typedef struct {
     const char* name;
     uint32_t width, height;
     bool resizable;
+    bool threaded_rendering; // f_flush/f_clear are recorded and replayed on a render thread
+    int swap_interval;       // 0 = vsync off, 1 = every vblank, n = every n-th vblank
+    bool adaptive_vsync;     // tear instead of waiting when a frame misses vblank (if supported)
+    float target_fps;        // frame limiter, 0 = uncapped
+    bool headless;           // no window, render into an offscreen framebuffer of width x height
+    fude_backend backend;
+    uint32_t software_threads; // software backend worker count including the caller, 0 = one per CPU
 } fude_config;
 
 //======================================================================
@@ -285,6 +721,22 @@ FAPI bool f_next_event(fude* f, fude_event* event);
 FAPI void f_present(fude* f);
 FAPI void f_clear(fude* f);
 
+FAPI bool f_is_key_down(fude* f, int key);
+FAPI bool f_key_pressed(fude* f, int key);
+FAPI bool f_key_released(fude* f, int key);
+FAPI bool f_is_mouse_button_down(fude* f, int button);
+FAPI bool f_mouse_button_pressed(fude* f, int button);
+FAPI bool f_mouse_button_released(fude* f, int button);
+FAPI V2f f_get_cursor_position(fude* f);
+FAPI V2f f_get_cursor_delta(fude* f);
+FAPI V2f f_get_scroll(fude* f);
+
+FAPI double f_get_time(fude* f);
+FAPI float f_get_delta_time(fude* f);
+FAPI float f_get_fps(fude* f);
+FAPI uint32_t f_get_frame_time_history(fude* f, float* frame_times_ms, uint32_t max_count);
+FAPI void f_set_target_fps(fude* f, float fps);
+
 // fude_graphics.c
 FAPI void f_flush(fude* f);
 
@@ -295,23 +747,164 @@ FAPI void f_color4f(fude* f, float r, float g, float b, float a);
 FAPI void f_color(fude* f, fude_color color);
 FAPI void f_vertex2f(fude* app, float x, float y);
 FAPI void f_vertex3f(fude* app, float x, float y, float z);
+FAPI void f_set_depth(fude* f, float depth);
+FAPI void f_set_blend_mode(fude* f, fude_blend_mode mode);
+
+FAPI void f_push_matrix(fude* f);
+FAPI void f_pop_matrix(fude* f);
+FAPI void f_load_identity(fude* f);
+FAPI void f_translate(fude* f, float x, float y, float z);
+FAPI void f_rotate(fude* f, float angle, float x, float y, float z);
+FAPI void f_scale(fude* f, float x, float y, float z);
+
+FAPI fude_shader f_get_default_shader(fude* f);
+FAPI fude_result f_create_shader(fude* f, fude_shader* shader, const char* vert_src, const char* frag_src);
+FAPI fude_result f_create_shader_from_file(fude* f, fude_shader* shader, const char* vert_path, const char* frag_path);
+FAPI void f_destroy_shader(fude* f, fude_shader shader);
+FAPI fude_result f_get_shader_uniform_location(fude* f, fude_shader shader, int* location, const char* name);
+FAPI fude_result f_set_shader_uniform(fude* f, fude_shader shader, int location, int data_type, int count, const void* data, bool transpose);
+
+FAPI fude_result f_create_texture(fude* f, fude_texture* texture, const void* data, int width, int height, int channels);
+FAPI void f_destroy_texture(fude* f, fude_texture texture);
+FAPI void f_update_texture(fude* f, fude_texture* texture, const void* data, int width, int height, int channels);
 
+FAPI fude_result f_create_camera2d(fude_camera* camera, uint32_t width, uint32_t height);
+FAPI fude_result f_create_camera3d(fude_camera* camera);
+FAPI void f_set_camera_position(fude_camera* camera, float x, float y, float z);
+FAPI void f_set_camera_target(fude_camera* camera, float x, float y, float z);
+FAPI void f_set_camera_zoom(fude_camera* camera, float zoom);
+FAPI void f_set_camera_rotation(fude_camera* camera, float degrees);
+FAPI void f_set_camera_viewport(fude_camera* camera, uint32_t width, uint32_t height);
+FAPI bool f_update_camera(fude_camera* camera);
+FAPI void f_use_camera(fude* f, fude_camera* camera, fude_shader shader);
+
+FAPI fude_result f_create_mesh(fude* f, fude_mesh* mesh, const fude_vertex* vertices, uint32_t vertex_count,
+        const uint32_t* indices, uint32_t index_count);
+FAPI fude_result f_update_mesh(fude* f, fude_mesh* mesh, const fude_vertex* vertices, uint32_t vertex_count,
+        const uint32_t* indices, uint32_t index_count);
+FAPI void f_destroy_mesh(fude* f, fude_mesh* mesh);
+FAPI void f_draw_mesh(fude* f, const fude_mesh* mesh, fude_shader shader, const M4f* transform);
+
+FAPI void f_record_begin(fude* f, fude_display_list* list);
+FAPI void f_record_end(fude* f);
+FAPI void f_replay(fude* f, fude_display_list* list);
+FAPI void f_destroy_display_list(fude* f, fude_display_list* list);
+
+FAPI void f_begin_layers(fude* f);
+FAPI void f_end_layers(fude* f);
+
+// fude_shapes.c
 FAPI void f_triangle(fude* f, fude_triangle triangle, uint32_t color);
 FAPI void f_rectangle(fude* f, fude_rect rect, uint32_t color);
 FAPI void f_rectangle_tex(fude* f, fude_rect rect, fude_texture texture);
-
-FAPI fude_result f_create_shader(fude_shader* shader, const char* vert_src, const char* frag_src);
-FAPI fude_result f_create_shader_from_file(fude_shader* shader, const char* vert_path, const char* frag_path);
-FAPI void f_destroy_shader(fude_shader shader);
-FAPI fude_result f_get_shader_uniform_location(fude_shader shader, int* location, const char* name);
-FAPI fude_result f_set_shader_uniform(fude_shader shader, int location, int data_type, int count, const void* data, bool transpose);
-
-FAPI fude_result f_create_texture(fude_texture* texture, const void* data, int width, int height, int channels);
-FAPI void f_destroy_texture(fude_texture texture);
-FAPI void f_update_texture(fude_texture texture, const void* data, int width, int height, int channels);
-
-FAPI fude_result f_create_camera2d(fude_camera* camera, uint32_t width, uint32_t height);
-FAPI fude_result f_create_camera3d(fude_camera* camera);
+FAPI void f_rounded_rectangle(fude* f, fude_rectf rect, float radius, uint32_t color);
+FAPI void f_rounded_rectangle_lines(fude* f, fude_rectf rect, float radius, float thickness, uint32_t color);
+FAPI void f_circle(fude* f, float x, float y, float radius, uint32_t color);
+FAPI void f_ring(fude* f, float x, float y, float radius, float thickness, uint32_t color);
+FAPI void f_capsule(fude* f, float x0, float y0, float x1, float y1, float radius, uint32_t color);
+FAPI void f_line(fude* f, float x0, float y0, float x1, float y1, float thickness, uint32_t color);
+
+// fude_path.c
+FAPI void f_path_move_to(fude_path* path, float x, float y);
+FAPI void f_path_line_to(fude_path* path, float x, float y);
+FAPI void f_path_quadratic_to(fude_path* path, float cx, float cy, float x, float y);
+FAPI void f_path_cubic_to(fude_path* path, float c0x, float c0y, float c1x, float c1y, float x, float y);
+FAPI void f_path_close(fude_path* path);
+FAPI void f_path_clear(fude_path* path);
+FAPI void f_destroy_path(fude_path* path);
+FAPI void f_fill_path(fude* f, const fude_path* path, uint32_t color);
+FAPI void f_stroke_path(fude* f, const fude_path* path, float width, fude_line_join join, fude_line_cap cap,
+        uint32_t color);
+
+// fude_particles.c
+FAPI fude_result f_create_particles(fude_particles** particles, const fude_particles_config* config);
+FAPI void f_destroy_particles(fude_particles* particles);
+FAPI uint32_t f_emit_particles(fude_particles* particles, const fude_particle_emitter* emitter, uint32_t count);
+FAPI void f_update_particles(fude_particles* particles, float dt);
+FAPI void f_clear_particles(fude_particles* particles);
+FAPI uint32_t f_particle_count(const fude_particles* particles);
+FAPI void f_draw_particles(fude* f, const fude_particles* particles);
+
+// fude_tilemap.c
+FAPI fude_result f_create_tilemap(fude_tilemap** tilemap, const fude_tilemap_config* config);
+FAPI void f_destroy_tilemap(fude* f, fude_tilemap* tilemap);
+FAPI void f_set_tile(fude_tilemap* tilemap, uint32_t x, uint32_t y, uint16_t tile);
+FAPI uint16_t f_get_tile(const fude_tilemap* tilemap, uint32_t x, uint32_t y);
+FAPI void f_set_tiles(fude_tilemap* tilemap, fude_rect rect, const uint16_t* tiles);
+FAPI void f_draw_tilemap(fude* f, fude_tilemap* tilemap, float x, float y);
+
+// fude_target.c
+FAPI fude_result f_create_render_target(fude* f, fude_render_target* target, const fude_render_target_config* config);
+FAPI void f_destroy_render_target(fude* f, fude_render_target* target);
+FAPI void f_begin_target(fude* f, fude_render_target* target);
+FAPI void f_end_target(fude* f);
+FAPI void f_draw_render_target(fude* f, const fude_render_target* target, fude_rect rect);
+FAPI fude_render_target* f_acquire_render_target(fude* f, const fude_render_target_config* config);
+FAPI void f_release_render_target(fude* f, fude_render_target* target);
+
+// fude_frame_graph.c
+FAPI fude_result f_create_frame_graph(fude_frame_graph** graph);
+FAPI void f_destroy_frame_graph(fude_frame_graph* graph);
+FAPI void f_reset_frame_graph(fude_frame_graph* graph);
+FAPI fude_graph_resource f_graph_backbuffer(fude_frame_graph* graph);
+FAPI fude_graph_resource f_graph_create_texture(fude_frame_graph* graph, const char* name,
+        const fude_render_target_config* config);
+FAPI fude_graph_resource f_graph_import_target(fude_frame_graph* graph, const char* name, fude_render_target* target);
+FAPI uint32_t f_graph_add_pass(fude_frame_graph* graph, const char* name, fude_graph_pass_proc execute, void* user_data);
+FAPI void f_graph_read(fude_frame_graph* graph, uint32_t pass, fude_graph_resource resource);
+FAPI void f_graph_write(fude_frame_graph* graph, uint32_t pass, fude_graph_resource resource);
+FAPI fude_result f_execute_frame_graph(fude* f, fude_frame_graph* graph);
+FAPI fude_render_target* f_graph_get_target(const fude_frame_graph* graph, fude_graph_resource resource);
+FAPI void f_get_frame_graph_stats(const fude_frame_graph* graph, fude_frame_graph_stats* stats);
+
+// fude_text.c
+FAPI fude_result f_create_font(fude* f, fude_font** font, const void* ttf_data, size_t size);
+FAPI fude_result f_load_font(fude* f, fude_font** font, const char* file_path);
+FAPI void f_destroy_font(fude* f, fude_font* font);
+FAPI void f_set_font(fude* f, fude_font* font, float size);
+FAPI void f_draw_text(fude* f, const char* text, float x, float y);
+FAPI V2f f_measure_text(fude* f, const char* text);
+
+// fude_spatial.c
+FAPI fude_result f_create_spatial_hash(fude_spatial** spatial, float cell_size);
+FAPI fude_result f_create_quadtree(fude_spatial** spatial, fude_rectf world, uint32_t depth);
+FAPI void f_destroy_spatial(fude_spatial* spatial);
+FAPI fude_result f_spatial_insert(fude_spatial* spatial, const fude_rectf* rects, uint32_t count, uint32_t* handles);
+FAPI void f_spatial_move(fude_spatial* spatial, const uint32_t* handles, const fude_rectf* rects, uint32_t count);
+FAPI void f_spatial_remove(fude_spatial* spatial, const uint32_t* handles, uint32_t count);
+FAPI uint32_t f_spatial_count(const fude_spatial* spatial);
+FAPI uint32_t f_spatial_query(fude_spatial* spatial, fude_rectf rect, uint32_t* handles, uint32_t max_count);
+FAPI uint32_t f_spatial_query_camera(fude_spatial* spatial, fude_camera* camera, uint32_t* handles, uint32_t max_count);
+
+// fude_headless.c
+FAPI fude_result f_read_pixels(fude* f, int x, int y, int width, int height, void* rgba8);
+
+// fude_profiler.c
+FAPI bool f_get_gpu_timings(fude* f, fude_gpu_timings* timings);
+FAPI bool f_get_render_stats(fude* f, fude_render_stats* stats, uint32_t frames_ago);
+FAPI void f_profile_begin(const char* name);
+FAPI void f_profile_end(void);
+FAPI fude_result f_profile_export_chrome_trace(const char* file_path);
+
+#if FUDE_PROFILER
+    #define F_PROFILE_BEGIN(name) f_profile_begin(name)
+    #define F_PROFILE_END() f_profile_end()
+    #if defined(__GNUC__) || defined(__clang__)
+        static inline void _f_profile_scope_end(int* unused) { (void)unused; f_profile_end(); }
+        #define _F_PROFILE_CONCAT2(a, b) a##b
+        #define _F_PROFILE_CONCAT(a, b) _F_PROFILE_CONCAT2(a, b)
+        // zone that ends when the enclosing scope does
+        #define F_PROFILE_SCOPE(name) \
+            __attribute__((cleanup(_f_profile_scope_end))) int _F_PROFILE_CONCAT(_f_profile_scope_, __LINE__) \
+                = (f_profile_begin(name), 0)
+    #else
+        #define F_PROFILE_SCOPE(name) ((void)0)
+    #endif
+#else
+    #define F_PROFILE_BEGIN(name) ((void)0)
+    #define F_PROFILE_END() ((void)0)
+    #define F_PROFILE_SCOPE(name) ((void)0)
+#endif
 
 // fude_utils.c
 FAPI void* f_malloc(uint64_t nbytes);
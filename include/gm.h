@@ -2,17 +2,17 @@
 #define GM_H
 
 #define GM_PI 3.14159265358979323846f
-#define GM_PI_2 2.0f * GMATH_PI
-#define GM_HALF_PI 0.5f * GMATH_PI
-#define GM_QUARTER_PI 0.25f * GMATH_PI
-#define GM_ONE_OVER_PI 1.0f / GMATH_PI
-#define GM_ONE_OVER_TWO_PI 1.0f / GMATH_PI_2
+#define GM_PI_2 (2.0f * GM_PI)
+#define GM_HALF_PI (0.5f * GM_PI)
+#define GM_QUARTER_PI (0.25f * GM_PI)
+#define GM_ONE_OVER_PI (1.0f / GM_PI)
+#define GM_ONE_OVER_TWO_PI (1.0f / GM_PI_2)
 #define GM_SQRT_TWO 1.41421356237309504880f
 #define GM_SQRT_THREE 1.73205080756887729352f
 #define GM_SQRT_ONE_OVER_TWO 0.70710678118654752440f
 #define GM_SQRT_ONE_OVER_THREE 0.57735026918962576450f
-#define GM_DEG2RAD_MULTIPLIER GMATH_PI / 180.0f
-#define GM_RAD2DEG_MULTIPLIER 180.0f / GMATH_PI
+#define GM_DEG2RAD_MULTIPLIER (GM_PI / 180.0f)
+#define GM_RAD2DEG_MULTIPLIER (180.0f / GM_PI)
 #define GM_SEC_TO_US_MULTIPLIER (1000.0f * 1000.0f)
 #define GM_SEC_TO_MS_MULTIPLIER 1000.0f
 #define GM_MS_TO_SEC_MULTIPLIER 0.001f
@@ -23,11 +23,36 @@
     #define GM_STATIC_INLINE static inline
 #endif
 
-#include <math.h> // sqrt fabs
+#include <math.h> // sqrtf fabsf tanf
+#include <stddef.h> // size_t
+
+// SIMD is picked at compile time from the target flags (-msse2, -mavx, aarch64...),
+// define GM_NO_SIMD to force the scalar paths. The *_scalar functions are always
+// available as the reference implementation.
+#if !defined(GM_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+    #include <xmmintrin.h>
+    #define GM_SIMD_SSE 1
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define GM_SIMD_AVX 1
+    #endif
+#elif !defined(GM_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+    #include <arm_neon.h>
+    #define GM_SIMD_NEON 1
+#endif
+#ifndef GM_SIMD_SSE
+    #define GM_SIMD_SSE 0
+#endif
+#ifndef GM_SIMD_AVX
+    #define GM_SIMD_AVX 0
+#endif
+#ifndef GM_SIMD_NEON
+    #define GM_SIMD_NEON 0
+#endif
 
 typedef unsigned char gm_bool;
 #define GM_TRUE 1
-#define GM_FALSE
+#define GM_FALSE 0
 
 typedef union V2f {
     float elements[2];
@@ -44,10 +69,10 @@ GM_STATIC_INLINE V2f v2f_add(V2f a, V2f b) { return (V2f){ .x=a.x+b.x, .y=a.y+b.
 GM_STATIC_INLINE V2f v2f_sub(V2f a, V2f b) { return (V2f){ .x=a.x-b.x, .y=a.y-b.y, }; }
 GM_STATIC_INLINE V2f v2f_mul(V2f a, V2f b) { return (V2f){ .x=a.x*b.x, .y=a.y*b.y, }; }
 GM_STATIC_INLINE V2f v2f_div(V2f a, V2f b) { return (V2f){ .x=a.x/b.x, .y=a.y/b.y, }; }
-GM_STATIC_INLINE float v2f_length(V2f a) { return (float)sqrt((double)(a.x*a.x + a.y*a.y)); }
+GM_STATIC_INLINE float v2f_length(V2f a) { return sqrtf(a.x*a.x + a.y*a.y); }
 GM_STATIC_INLINE V2f v2f_normalize(V2f a) { float l = v2f_length(a); return (V2f){ .x = a.x/l, .y = a.y/l, }; }
 GM_STATIC_INLINE float v2f_distance(V2f a, V2f b) { return v2f_length(v2f( a.x-b.x, a.y-b.y )); }
-GM_STATIC_INLINE gm_bool v2f_cmp(V2f a, V2f b) { return fabs(a.x-b.x) <= GM_EPSILON && fabs(a.y-b.y) <= GM_EPSILON; }
+GM_STATIC_INLINE gm_bool v2f_cmp(V2f a, V2f b) { return fabsf(a.x-b.x) <= GM_EPSILON && fabsf(a.y-b.y) <= GM_EPSILON; }
 
 typedef union V3f {
     float elements[3];
@@ -65,12 +90,14 @@ GM_STATIC_INLINE V3f v3f_add(V3f a, V3f b) { return (V3f){ .x=a.x+b.x, .y=a.y+b.
 GM_STATIC_INLINE V3f v3f_sub(V3f a, V3f b) { return (V3f){ .x=a.x-b.x, .y=a.y-b.y, .z=a.z-b.z}; }
 GM_STATIC_INLINE V3f v3f_mul(V3f a, V3f b) { return (V3f){ .x=a.x*b.x, .y=a.y*b.y, .z=a.z*b.z}; }
 GM_STATIC_INLINE V3f v3f_div(V3f a, V3f b) { return (V3f){ .x=a.x/b.x, .y=a.y/b.y, .z=a.z/b.z}; }
-GM_STATIC_INLINE float v3f_length(V3f a) { return (float)sqrt((double)(a.x*a.x + a.y*a.y + a.z*a.z)); }
+GM_STATIC_INLINE float v3f_length(V3f a) { return sqrtf(a.x*a.x + a.y*a.y + a.z*a.z); }
+GM_STATIC_INLINE float v3f_dot(V3f a, V3f b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+GM_STATIC_INLINE V3f v3f_cross(V3f a, V3f b) { return (V3f){ .x=a.y*b.z-a.z*b.y, .y=a.z*b.x-a.x*b.z, .z=a.x*b.y-a.y*b.x }; }
 GM_STATIC_INLINE V3f v3f_normalize(V3f a) { float l = v3f_length(a); return (V3f){ .x = a.x/l, .y = a.y/l, .z=a.z/l }; }
 GM_STATIC_INLINE float v3f_distance(V3f a, V3f b) { return v3f_length(v3f( a.x-b.x, a.y-b.y, a.z-b.z )); }
-GM_STATIC_INLINE gm_bool v3f_cmp(V3f a, V3f b) { return fabs(a.x-b.x) <= GM_EPSILON 
-    && fabs(a.y-b.y) <= GM_EPSILON
-    && fabs(a.z-b.z) <= GM_EPSILON; }
+GM_STATIC_INLINE gm_bool v3f_cmp(V3f a, V3f b) { return fabsf(a.x-b.x) <= GM_EPSILON 
+    && fabsf(a.y-b.y) <= GM_EPSILON
+    && fabsf(a.z-b.z) <= GM_EPSILON; }
 
 typedef union V4f {
     float elements[4];
@@ -85,18 +112,54 @@ typedef union V4f {
 GM_STATIC_INLINE V4f v4f(float x, float y, float z, float w) { return (V4f){ .x=x, .y=y, .z=z, .w=w }; }
 GM_STATIC_INLINE V4f v4f_zeros(void) { return (V4f){ .x=0.0f, .y=0.0f, .z=0.0f, .w=0.0f }; }
 GM_STATIC_INLINE V4f v4f_ones(void)  { return (V4f){ .x=1.0f, .y=1.0f, .z=1.0f, .w=1.0f }; }
-GM_STATIC_INLINE V4f v4f_add(V4f a, V4f b) { return (V4f){ .x=a.x+b.x, .y=a.y+b.y, .z=a.z+b.z, .w=a.w+b.w }; }
-GM_STATIC_INLINE V4f v4f_sub(V4f a, V4f b) { return (V4f){ .x=a.x+b.x, .y=a.y+b.y, .z=a.z+b.z, .w=a.w+b.w }; }
-GM_STATIC_INLINE V4f v4f_mul(V4f a, V4f b) { return (V4f){ .x=a.x+b.x, .y=a.y+b.y, .z=a.z+b.z, .w=a.w+b.w }; }
-GM_STATIC_INLINE V4f v4f_div(V4f a, V4f b) { return (V4f){ .x=a.x+b.x, .y=a.y+b.y, .z=a.z+b.z, .w=a.w+b.w }; }
-GM_STATIC_INLINE float v4f_length(V4f a) { return (float)sqrt((double)(a.x*a.x + a.y*a.y + a.z*a.z + a.w*a.w)); }
-GM_STATIC_INLINE V4f v4f_normalize(V4f a) { float l = v4f_length(a); return (V4f){ .x = a.x/l, .y = a.y/l, .z=a.z/l, .w=a.w/l }; }
-GM_STATIC_INLINE float v4f_distance(V4f a, V4f b) { return v4f_length(v4f( a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w )); }
-GM_STATIC_INLINE float v4f_dot(V4f a, V4f b) { return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w; }
-GM_STATIC_INLINE gm_bool v4f_cmp(V4f a, V4f b) { return fabs(a.x-b.x) <= GM_EPSILON 
-    && fabs(a.y-b.y) <= GM_EPSILON
-    && fabs(a.w-b.w) <= GM_EPSILON
-    && fabs(a.z-b.z) <= GM_EPSILON; }
+// scalar reference
+GM_STATIC_INLINE V4f v4f_add_scalar(V4f a, V4f b) { return (V4f){ .x=a.x+b.x, .y=a.y+b.y, .z=a.z+b.z, .w=a.w+b.w }; }
+GM_STATIC_INLINE V4f v4f_sub_scalar(V4f a, V4f b) { return (V4f){ .x=a.x-b.x, .y=a.y-b.y, .z=a.z-b.z, .w=a.w-b.w }; }
+GM_STATIC_INLINE V4f v4f_mul_scalar(V4f a, V4f b) { return (V4f){ .x=a.x*b.x, .y=a.y*b.y, .z=a.z*b.z, .w=a.w*b.w }; }
+GM_STATIC_INLINE V4f v4f_div_scalar(V4f a, V4f b) { return (V4f){ .x=a.x/b.x, .y=a.y/b.y, .z=a.z/b.z, .w=a.w/b.w }; }
+GM_STATIC_INLINE float v4f_dot_scalar(V4f a, V4f b) { return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w; }
+GM_STATIC_INLINE V4f v4f_normalize_scalar(V4f a) { float l = sqrtf(v4f_dot_scalar(a, a)); return (V4f){ .x = a.x/l, .y = a.y/l, .z=a.z/l, .w=a.w/l }; }
+
+// V4f/M4f have no alignment requirement (fude_vertex packs a V4f right after a V3f), so all loads are unaligned
+#if GM_SIMD_SSE
+GM_STATIC_INLINE __m128 _gm_load(V4f a) { return _mm_loadu_ps(a.elements); }
+GM_STATIC_INLINE V4f _gm_store(__m128 v) { V4f res; _mm_storeu_ps(res.elements, v); return res; }
+GM_STATIC_INLINE __m128 _gm_dot4(__m128 a, __m128 b) {
+    // horizontal sum broadcast to every lane
+    __m128 m = _mm_mul_ps(a, b);
+    m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+GM_STATIC_INLINE V4f v4f_add(V4f a, V4f b) { return _gm_store(_mm_add_ps(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_sub(V4f a, V4f b) { return _gm_store(_mm_sub_ps(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_mul(V4f a, V4f b) { return _gm_store(_mm_mul_ps(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_div(V4f a, V4f b) { return _gm_store(_mm_div_ps(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE float v4f_dot(V4f a, V4f b) { return _mm_cvtss_f32(_gm_dot4(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_normalize(V4f a) { __m128 v = _gm_load(a); return _gm_store(_mm_div_ps(v, _mm_sqrt_ps(_gm_dot4(v, v)))); }
+#elif GM_SIMD_NEON
+GM_STATIC_INLINE float32x4_t _gm_load(V4f a) { return vld1q_f32(a.elements); }
+GM_STATIC_INLINE V4f _gm_store(float32x4_t v) { V4f res; vst1q_f32(res.elements, v); return res; }
+GM_STATIC_INLINE V4f v4f_add(V4f a, V4f b) { return _gm_store(vaddq_f32(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_sub(V4f a, V4f b) { return _gm_store(vsubq_f32(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_mul(V4f a, V4f b) { return _gm_store(vmulq_f32(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_div(V4f a, V4f b) { return _gm_store(vdivq_f32(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE float v4f_dot(V4f a, V4f b) { return vaddvq_f32(vmulq_f32(_gm_load(a), _gm_load(b))); }
+GM_STATIC_INLINE V4f v4f_normalize(V4f a) { float32x4_t v = _gm_load(a); return _gm_store(vdivq_f32(v, vdupq_n_f32(sqrtf(vaddvq_f32(vmulq_f32(v, v)))))); }
+#else
+GM_STATIC_INLINE V4f v4f_add(V4f a, V4f b) { return v4f_add_scalar(a, b); }
+GM_STATIC_INLINE V4f v4f_sub(V4f a, V4f b) { return v4f_sub_scalar(a, b); }
+GM_STATIC_INLINE V4f v4f_mul(V4f a, V4f b) { return v4f_mul_scalar(a, b); }
+GM_STATIC_INLINE V4f v4f_div(V4f a, V4f b) { return v4f_div_scalar(a, b); }
+GM_STATIC_INLINE float v4f_dot(V4f a, V4f b) { return v4f_dot_scalar(a, b); }
+GM_STATIC_INLINE V4f v4f_normalize(V4f a) { return v4f_normalize_scalar(a); }
+#endif
+
+GM_STATIC_INLINE float v4f_length(V4f a) { return sqrtf(v4f_dot(a, a)); }
+GM_STATIC_INLINE float v4f_distance(V4f a, V4f b) { return v4f_length(v4f_sub(a, b)); }
+GM_STATIC_INLINE gm_bool v4f_cmp(V4f a, V4f b) { return fabsf(a.x-b.x) <= GM_EPSILON 
+    && fabsf(a.y-b.y) <= GM_EPSILON
+    && fabsf(a.w-b.w) <= GM_EPSILON
+    && fabsf(a.z-b.z) <= GM_EPSILON; }
 
 typedef union M3f {
     V4f rows[3];
@@ -117,6 +180,22 @@ GM_STATIC_INLINE M4f m4f_identity(void) {
     return res;
 }
 
+GM_STATIC_INLINE M4f m4f_translation(float x, float y, float z) {
+    M4f res = m4f_identity();
+    res.elements[12] = x;
+    res.elements[13] = y;
+    res.elements[14] = z;
+    return res;
+}
+
+GM_STATIC_INLINE M4f m4f_scaling(float x, float y, float z) {
+    M4f res = m4f_identity();
+    res.elements[0] = x;
+    res.elements[5] = y;
+    res.elements[10] = z;
+    return res;
+}
+
 GM_STATIC_INLINE M4f m4f_ortho(float left, float right, float bottom, float top, float near, float far) {
     M4f res = m4f_identity();
     float lr = 1.0f / (left - right);
@@ -135,7 +214,7 @@ GM_STATIC_INLINE M4f m4f_ortho(float left, float right, float bottom, float top,
 }
 
 GM_STATIC_INLINE M4f m4f_perspective(float fov, float aspect_ratio, float near, float far) {
-    float half_tan_fov = tan(fov*0.5f);
+    float half_tan_fov = tanf(fov*0.5f);
     M4f res = {0};
     res.elements[0] = 1.0f / (aspect_ratio * half_tan_fov);
     res.elements[5] = 1.0f / half_tan_fov;
@@ -145,27 +224,274 @@ GM_STATIC_INLINE M4f m4f_perspective(float fov, float aspect_ratio, float near,
     return res;
 }
 
-GM_STATIC_INLINE M4f m4f_dot(M4f a, M4f b) {
-    M4f res = m4f_identity();
-    const float* a_ptr = a.elements;
-    const float* b_ptr = b.elements;
-    float* dst_ptr = res.elements;
-
-    for(int i = 0; i < 4; ++i) {
-        for(int j = 0; j < 4; ++j) {
-            *dst_ptr =
-                a_ptr[0] * b_ptr[0 + j] +
-                a_ptr[1] * b_ptr[4 + j] +
-                a_ptr[2] * b_ptr[8 + j] +
-                a_ptr[3] * b_ptr[12 + j];
-            dst_ptr+=1;
+// Matrices are column-major like OpenGL expects them (translation in elements 12..14),
+// m4f_dot(a, b) is the product a*b, so transforming by it applies b first.
+
+// scalar reference
+GM_STATIC_INLINE M4f m4f_dot_scalar(M4f a, M4f b) {
+    M4f res;
+    for(int col = 0; col < 4; ++col) {
+        for(int row = 0; row < 4; ++row) {
+            res.elements[col*4 + row] =
+                a.elements[0*4 + row] * b.elements[col*4 + 0] +
+                a.elements[1*4 + row] * b.elements[col*4 + 1] +
+                a.elements[2*4 + row] * b.elements[col*4 + 2] +
+                a.elements[3*4 + row] * b.elements[col*4 + 3];
         }
-        b_ptr+=1;
     }
+    return res;
+}
+
+GM_STATIC_INLINE V4f m4f_mul_v4f_scalar(M4f m, V4f v) {
+    V4f res;
+    for(int row = 0; row < 4; ++row) {
+        res.elements[row] = m.elements[0*4 + row]*v.x + m.elements[1*4 + row]*v.y
+            + m.elements[2*4 + row]*v.z + m.elements[3*4 + row]*v.w;
+    }
+    return res;
+}
+
+GM_STATIC_INLINE void m4f_mul_v4f_batch_scalar(const M4f* m, const V4f* src, V4f* dst, size_t count) {
+    M4f mat = *m; // src/dst may alias m
+    for(size_t i = 0; i < count; ++i)
+        dst[i] = m4f_mul_v4f_scalar(mat, src[i]);
+}
+
+GM_STATIC_INLINE M4f m4f_transpose_scalar(M4f m) {
+    M4f res;
+    for(int col = 0; col < 4; ++col) {
+        for(int row = 0; row < 4; ++row)
+            res.elements[row*4 + col] = m.elements[col*4 + row];
+    }
+    return res;
+}
+
+// cofactor expansion, a singular matrix gives non-finite elements
+GM_STATIC_INLINE M4f m4f_inverse_scalar(M4f mat) {
+    const float* m = mat.elements;
+    M4f res;
+    float* inv = res.elements;
+    inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+    inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+    inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+    inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+    inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+    inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+    inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+    inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+    float inv_det = 1.0f/(m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12]);
+    for(int i = 0; i < 16; ++i)
+        inv[i] *= inv_det;
+    return res;
+}
+
+#if GM_SIMD_SSE
+#if GM_SIMD_AVX
+GM_STATIC_INLINE __m256 _gm_broadcast128(const float* p) {
+    __m128 v = _mm_loadu_ps(p);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+}
+#endif
+
+GM_STATIC_INLINE __m128 _gm_mul_col(__m128 c0, __m128 c1, __m128 c2, __m128 c3, const float* v) {
+    __m128 res = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+    res = _mm_add_ps(res, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+    res = _mm_add_ps(res, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+    return _mm_add_ps(res, _mm_mul_ps(c3, _mm_set1_ps(v[3])));
+}
+
+GM_STATIC_INLINE M4f m4f_dot(M4f a, M4f b) {
+    M4f res;
+#if GM_SIMD_AVX
+    // two result columns per iteration, the b scalars are splatted within each 128-bit half
+    __m256 a0 = _gm_broadcast128(a.elements + 0);
+    __m256 a1 = _gm_broadcast128(a.elements + 4);
+    __m256 a2 = _gm_broadcast128(a.elements + 8);
+    __m256 a3 = _gm_broadcast128(a.elements + 12);
+    for(int col = 0; col < 4; col += 2) {
+        __m256 bb = _mm256_loadu_ps(b.elements + col*4);
+        __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(bb, bb, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(bb, bb, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(bb, bb, 0xAA)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(bb, bb, 0xFF)));
+        _mm256_storeu_ps(res.elements + col*4, r);
+    }
+#else
+    __m128 c0 = _mm_loadu_ps(a.elements + 0), c1 = _mm_loadu_ps(a.elements + 4);
+    __m128 c2 = _mm_loadu_ps(a.elements + 8), c3 = _mm_loadu_ps(a.elements + 12);
+    for(int col = 0; col < 4; ++col)
+        _mm_storeu_ps(res.elements + col*4, _gm_mul_col(c0, c1, c2, c3, b.elements + col*4));
+#endif
+    return res;
+}
+
+GM_STATIC_INLINE V4f m4f_mul_v4f(M4f m, V4f v) {
+    __m128 c0 = _mm_loadu_ps(m.elements + 0), c1 = _mm_loadu_ps(m.elements + 4);
+    __m128 c2 = _mm_loadu_ps(m.elements + 8), c3 = _mm_loadu_ps(m.elements + 12);
+    return _gm_store(_gm_mul_col(c0, c1, c2, c3, v.elements));
+}
+
+GM_STATIC_INLINE void m4f_mul_v4f_batch(const M4f* m, const V4f* src, V4f* dst, size_t count) {
+    size_t i = 0;
+#if GM_SIMD_AVX
+    __m256 c0 = _gm_broadcast128(m->elements + 0);
+    __m256 c1 = _gm_broadcast128(m->elements + 4);
+    __m256 c2 = _gm_broadcast128(m->elements + 8);
+    __m256 c3 = _gm_broadcast128(m->elements + 12);
+    for(; i + 2 <= count; i += 2) {
+        __m256 v = _mm256_loadu_ps(src[i].elements);
+        __m256 r = _mm256_mul_ps(c0, _mm256_shuffle_ps(v, v, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_shuffle_ps(v, v, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_shuffle_ps(v, v, 0xAA)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_shuffle_ps(v, v, 0xFF)));
+        _mm256_storeu_ps(dst[i].elements, r);
+    }
+#endif
+    __m128 s0 = _mm_loadu_ps(m->elements + 0), s1 = _mm_loadu_ps(m->elements + 4);
+    __m128 s2 = _mm_loadu_ps(m->elements + 8), s3 = _mm_loadu_ps(m->elements + 12);
+    for(; i < count; ++i) {
+        __m128 v = _mm_loadu_ps(src[i].elements);
+        __m128 r = _mm_mul_ps(s0, _mm_shuffle_ps(v, v, 0x00));
+        r = _mm_add_ps(r, _mm_mul_ps(s1, _mm_shuffle_ps(v, v, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(s2, _mm_shuffle_ps(v, v, 0xAA)));
+        r = _mm_add_ps(r, _mm_mul_ps(s3, _mm_shuffle_ps(v, v, 0xFF)));
+        _mm_storeu_ps(dst[i].elements, r);
+    }
+}
+
+GM_STATIC_INLINE M4f m4f_transpose(M4f m) {
+    __m128 c0 = _mm_loadu_ps(m.elements + 0), c1 = _mm_loadu_ps(m.elements + 4);
+    __m128 c2 = _mm_loadu_ps(m.elements + 8), c3 = _mm_loadu_ps(m.elements + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    M4f res;
+    _mm_storeu_ps(res.elements + 0, c0);
+    _mm_storeu_ps(res.elements + 4, c1);
+    _mm_storeu_ps(res.elements + 8, c2);
+    _mm_storeu_ps(res.elements + 12, c3);
+    return res;
+}
+
+// block-wise inverse through 2x2 adjugates, stays the same whichever way the
+// elements are read since inverse(transpose(M)) == transpose(inverse(M))
+#define _GM_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+#define _GM_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+GM_STATIC_INLINE __m128 _gm_mat2_mul(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, _GM_SWIZZLE(b, 0, 3, 0, 3)),
+            _mm_mul_ps(_GM_SWIZZLE(a, 1, 0, 3, 2), _GM_SWIZZLE(b, 2, 1, 2, 1)));
+}
+GM_STATIC_INLINE __m128 _gm_mat2_adj_mul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(_GM_SWIZZLE(a, 3, 3, 0, 0), b),
+            _mm_mul_ps(_GM_SWIZZLE(a, 1, 1, 2, 2), _GM_SWIZZLE(b, 2, 3, 0, 1)));
+}
+GM_STATIC_INLINE __m128 _gm_mat2_mul_adj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, _GM_SWIZZLE(b, 3, 0, 3, 0)),
+            _mm_mul_ps(_GM_SWIZZLE(a, 1, 0, 3, 2), _GM_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+GM_STATIC_INLINE M4f m4f_inverse(M4f m) {
+    __m128 r0 = _mm_loadu_ps(m.elements + 0), r1 = _mm_loadu_ps(m.elements + 4);
+    __m128 r2 = _mm_loadu_ps(m.elements + 8), r3 = _mm_loadu_ps(m.elements + 12);
+
+    // 2x2 sub-matrices and their determinants
+    __m128 A = _mm_movelh_ps(r0, r1);
+    __m128 B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3);
+    __m128 D = _mm_movehl_ps(r3, r2);
+    __m128 det_sub = _mm_sub_ps(
+            _mm_mul_ps(_GM_SHUFFLE(r0, r2, 0, 2, 0, 2), _GM_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+            _mm_mul_ps(_GM_SHUFFLE(r0, r2, 1, 3, 1, 3), _GM_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+    __m128 det_a = _GM_SWIZZLE(det_sub, 0, 0, 0, 0);
+    __m128 det_b = _GM_SWIZZLE(det_sub, 1, 1, 1, 1);
+    __m128 det_c = _GM_SWIZZLE(det_sub, 2, 2, 2, 2);
+    __m128 det_d = _GM_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+    __m128 d_c = _gm_mat2_adj_mul(D, C);
+    __m128 a_b = _gm_mat2_adj_mul(A, B);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), _gm_mat2_mul(B, d_c));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), _gm_mat2_mul(C, a_b));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), _gm_mat2_mul_adj(D, a_b));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), _gm_mat2_mul_adj(A, d_c));
+
+    // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    __m128 tr = _mm_mul_ps(a_b, _GM_SWIZZLE(d_c, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, _GM_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, _GM_SWIZZLE(tr, 1, 0, 3, 2));
+    __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+    __m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+
+    x = _mm_mul_ps(x, inv_det);
+    y = _mm_mul_ps(y, inv_det);
+    z = _mm_mul_ps(z, inv_det);
+    w = _mm_mul_ps(w, inv_det);
+
+    M4f res;
+    _mm_storeu_ps(res.elements + 0, _GM_SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_storeu_ps(res.elements + 4, _GM_SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_storeu_ps(res.elements + 8, _GM_SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_storeu_ps(res.elements + 12, _GM_SHUFFLE(z, w, 2, 0, 2, 0));
+    return res;
+}
+#undef _GM_SWIZZLE
+#undef _GM_SHUFFLE
+#elif GM_SIMD_NEON
+GM_STATIC_INLINE float32x4_t _gm_mul_col(float32x4_t c0, float32x4_t c1, float32x4_t c2, float32x4_t c3, float32x4_t v) {
+    float32x4_t res = vmulq_laneq_f32(c0, v, 0);
+    res = vfmaq_laneq_f32(res, c1, v, 1);
+    res = vfmaq_laneq_f32(res, c2, v, 2);
+    return vfmaq_laneq_f32(res, c3, v, 3);
+}
 
+GM_STATIC_INLINE M4f m4f_dot(M4f a, M4f b) {
+    float32x4_t c0 = vld1q_f32(a.elements + 0), c1 = vld1q_f32(a.elements + 4);
+    float32x4_t c2 = vld1q_f32(a.elements + 8), c3 = vld1q_f32(a.elements + 12);
+    M4f res;
+    for(int col = 0; col < 4; ++col)
+        vst1q_f32(res.elements + col*4, _gm_mul_col(c0, c1, c2, c3, vld1q_f32(b.elements + col*4)));
+    return res;
+}
+
+GM_STATIC_INLINE V4f m4f_mul_v4f(M4f m, V4f v) {
+    float32x4_t c0 = vld1q_f32(m.elements + 0), c1 = vld1q_f32(m.elements + 4);
+    float32x4_t c2 = vld1q_f32(m.elements + 8), c3 = vld1q_f32(m.elements + 12);
+    return _gm_store(_gm_mul_col(c0, c1, c2, c3, _gm_load(v)));
+}
+
+GM_STATIC_INLINE void m4f_mul_v4f_batch(const M4f* m, const V4f* src, V4f* dst, size_t count) {
+    float32x4_t c0 = vld1q_f32(m->elements + 0), c1 = vld1q_f32(m->elements + 4);
+    float32x4_t c2 = vld1q_f32(m->elements + 8), c3 = vld1q_f32(m->elements + 12);
+    for(size_t i = 0; i < count; ++i)
+        vst1q_f32(dst[i].elements, _gm_mul_col(c0, c1, c2, c3, vld1q_f32(src[i].elements)));
+}
+
+GM_STATIC_INLINE M4f m4f_transpose(M4f m) {
+    // vld4 de-interleaves, which is exactly a 4x4 transpose
+    float32x4x4_t t = vld4q_f32(m.elements);
+    M4f res;
+    vst1q_f32(res.elements + 0, t.val[0]);
+    vst1q_f32(res.elements + 4, t.val[1]);
+    vst1q_f32(res.elements + 8, t.val[2]);
+    vst1q_f32(res.elements + 12, t.val[3]);
     return res;
 }
 
+GM_STATIC_INLINE M4f m4f_inverse(M4f m) { return m4f_inverse_scalar(m); }
+#else
+GM_STATIC_INLINE M4f m4f_dot(M4f a, M4f b) { return m4f_dot_scalar(a, b); }
+GM_STATIC_INLINE V4f m4f_mul_v4f(M4f m, V4f v) { return m4f_mul_v4f_scalar(m, v); }
+GM_STATIC_INLINE void m4f_mul_v4f_batch(const M4f* m, const V4f* src, V4f* dst, size_t count) { m4f_mul_v4f_batch_scalar(m, src, dst, count); }
+GM_STATIC_INLINE M4f m4f_transpose(M4f m) { return m4f_transpose_scalar(m); }
+GM_STATIC_INLINE M4f m4f_inverse(M4f m) { return m4f_inverse_scalar(m); }
+#endif
+
 #include <stdio.h>
 GM_STATIC_INLINE void m4f_dump(M4f m)
 {
@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 #include "fude_internal.h"
 
+#include <math.h> // sqrt()
+
 fude_result f_init(fude* app, const fude_config* config)
 {
     fude_result result = FUDE_OK;
@@ -10,28 +12,83 @@ fude_result f_init(fude* app, const fude_config* config)
     if(!app || !config) return FUDE_INVALID_ARGUMENTS_ERROR;
     f_memzero(app, sizeof(fude));
 
-    result = _fude_init_window(app, config);
+    bool software = config->backend == FUDE_BACKEND_SOFTWARE;
+    if(config->headless && software) {
+        result = FUDE_OK; // the software backend needs no context at all without a window
+    } else if(config->headless) {
+        result = _fude_init_headless(app, config);
+    } else {
+        result = _fude_init_window(app, config);
+    }
     if(result != FUDE_OK) return result;
 
-    result = _fude_init_renderer(app, config);
+    if(config->threaded_rendering && config->headless)
+        f_trace_log(FUDE_LOG_WARNING, "Threaded rendering is not available in headless mode, ignoring it");
+    else if(config->threaded_rendering && software)
+        f_trace_log(FUDE_LOG_WARNING, "Threaded rendering is not available with the software backend, ignoring it");
+
+    if(!config->headless && !software && config->threaded_rendering) {
+        result = _fude_init_render_thread(app, config);
+    } else {
+        if(!config->headless)
+            _fude_set_swap_interval(config);
+        result = software ? _fude_init_software(app, config) : _fude_init_renderer(app, config);
+    }
+    if(result == FUDE_OK)
+        result = _fude_create_default_shader(app);
     if(result != FUDE_OK) return result;
 
+    // a window's is kept current by _fude_framebuffer_size_callback
+    app->renderer.framebuffer.width = (int)config->width;
+    app->renderer.framebuffer.height = (int)config->height;
+    app->renderer.layers.depth_buffer = true;
+    if(app->window && !software)
+        glfwGetFramebufferSize(app->window, &app->renderer.framebuffer.width, &app->renderer.framebuffer.height);
+
+    app->timing.start_time = _fude_get_seconds();
+    app->timing.last_frame_time = app->timing.start_time;
+    app->timing.sleep.estimate = 0.005;
+    app->timing.sleep.fine_resolution = _fude_begin_sleep_resolution();
+    f_set_target_fps(app, config->target_fps);
     return FUDE_OK;
 }
 
 void f_deinit(fude* app)
 {
     if(!app) return;
-    glfwDestroyWindow(app->window);
+    // while a context is still current, the render thread only drops the program once it's done with it
+    if(app->renderer.default_shader.id)
+        f_destroy_shader(app, app->renderer.default_shader);
+    if(!app->render_thread)
+        _fude_destroy_particle_stream(app); // otherwise the render thread does, the stream's VAO is its
+    _fude_destroy_target_pool(app);
+    _fude_destroy_layer_queue(app);
+    if(app->renderer.mvps.data)
+        f_free(app->renderer.mvps.data);
+    if(app->render_thread)
+        _fude_deinit_render_thread(app);
+    if(app->software)
+        _fude_deinit_software(app);
+    if(app->headless)
+        _fude_deinit_headless(app);
+    if(app->window)
+        glfwDestroyWindow(app->window);
+    _fude_destroy_path_cache(app);
+    if(app->timing.sleep.fine_resolution)
+        _fude_end_sleep_resolution();
     f_memzero(app, sizeof(fude));
 }
 
 // event handling
 void f_poll_events(fude* app)
 {
+    F_PROFILE_BEGIN("f_poll_events");
     app->event_queue.head = 0;
     app->event_queue.tail = 0;
-    glfwPollEvents();
+    _fude_begin_input_frame(&app->input);
+    if(app->window)
+        glfwPollEvents();
+    F_PROFILE_END();
 }
 
 bool f_next_event(fude* app, fude_event* event)
@@ -45,15 +102,167 @@ bool f_next_event(fude* app, fude_event* event)
     return event->type != FUDE_EVENT_NONE;
 }
 
+// input state
+bool f_is_key_down(fude* app, int key)
+{
+    if(key < 0 || key >= FUDE_INPUT_MAXIMUM_KEYS) return false;
+    return _FUDE_BIT_GET(app->input.keyboard.down, key);
+}
+
+bool f_key_pressed(fude* app, int key)
+{
+    if(key < 0 || key >= FUDE_INPUT_MAXIMUM_KEYS) return false;
+    return _FUDE_BIT_GET(app->input.keyboard.pressed, key);
+}
+
+bool f_key_released(fude* app, int key)
+{
+    if(key < 0 || key >= FUDE_INPUT_MAXIMUM_KEYS) return false;
+    return _FUDE_BIT_GET(app->input.keyboard.released, key);
+}
+
+bool f_is_mouse_button_down(fude* app, int button)
+{
+    if(button < 0 || button >= FUDE_INPUT_MAXIMUM_MOUSE_BUTTONS) return false;
+    return (app->input.mouse.down >> button) & 1;
+}
+
+bool f_mouse_button_pressed(fude* app, int button)
+{
+    if(button < 0 || button >= FUDE_INPUT_MAXIMUM_MOUSE_BUTTONS) return false;
+    return (app->input.mouse.pressed >> button) & 1;
+}
+
+bool f_mouse_button_released(fude* app, int button)
+{
+    if(button < 0 || button >= FUDE_INPUT_MAXIMUM_MOUSE_BUTTONS) return false;
+    return (app->input.mouse.released >> button) & 1;
+}
+
+V2f f_get_cursor_position(fude* app)
+{
+    return (V2f){ .x = app->input.cursor.x, .y = app->input.cursor.y };
+}
+
+V2f f_get_cursor_delta(fude* app)
+{
+    return (V2f){ .x = app->input.cursor.dx, .y = app->input.cursor.dy };
+}
+
+V2f f_get_scroll(fude* app)
+{
+    return (V2f){ .x = app->input.scroll.x, .y = app->input.scroll.y };
+}
+
+// frame timing
+double f_get_time(fude* app)
+{
+    return _fude_get_seconds() - app->timing.start_time;
+}
+
+float f_get_delta_time(fude* app)
+{
+    return (float)app->timing.delta_time;
+}
+
+float f_get_fps(fude* app)
+{
+    if(app->timing.history.count == 0) return 0.0f;
+    float total_ms = 0.0f;
+    for(uint32_t i = 0; i < app->timing.history.count; ++i)
+        total_ms += app->timing.history.data[i];
+    return total_ms > 0.0f ? 1000.0f*app->timing.history.count/total_ms : 0.0f;
+}
+
+uint32_t f_get_frame_time_history(fude* app, float* frame_times_ms, uint32_t max_count)
+{
+    // oldest first
+    uint32_t count = app->timing.history.count < max_count ? app->timing.history.count : max_count;
+    uint32_t first = (app->timing.history.head + FUDE_FRAME_TIME_HISTORY - count) % FUDE_FRAME_TIME_HISTORY;
+    for(uint32_t i = 0; i < count; ++i)
+        frame_times_ms[i] = app->timing.history.data[(first + i) % FUDE_FRAME_TIME_HISTORY];
+    return count;
+}
+
+void f_set_target_fps(fude* app, float fps)
+{
+    app->timing.target_frame_time = fps > 0.0f ? 1.0/fps : 0.0;
+}
+
+static void _fude_wait_until(fude_timing* timing, double target_time)
+{
+    // sleep while the remaining time comfortably exceeds how long a sleep
+    // really takes, then spin the rest for accuracy
+    double now = _fude_get_seconds();
+    while(target_time - now > timing->sleep.estimate) {
+        double start = now;
+        _fude_sleep_ms(1);
+        now = _fude_get_seconds();
+
+        double observed = now - start;
+        if(timing->sleep.count > 1000) {
+            timing->sleep.count = 0;
+            timing->sleep.mean = 0.0;
+            timing->sleep.m2 = 0.0;
+        }
+        timing->sleep.count += 1;
+        double delta = observed - timing->sleep.mean;
+        timing->sleep.mean += delta/timing->sleep.count;
+        timing->sleep.m2 += delta*(observed - timing->sleep.mean);
+        double stddev = timing->sleep.count > 1 ? sqrt(timing->sleep.m2/(timing->sleep.count - 1)) : 0.0;
+        timing->sleep.estimate = timing->sleep.mean + stddev;
+    }
+
+    while(_fude_get_seconds() < target_time) {}
+}
+
+static void _fude_end_frame_timing(fude_timing* timing)
+{
+    if(timing->target_frame_time > 0.0)
+        _fude_wait_until(timing, timing->last_frame_time + timing->target_frame_time);
+
+    double now = _fude_get_seconds();
+    timing->delta_time = now - timing->last_frame_time;
+    timing->last_frame_time = now;
+    timing->frame_count += 1;
+
+    timing->history.data[timing->history.head] = (float)(timing->delta_time*1000.0);
+    timing->history.head = (timing->history.head + 1) % FUDE_FRAME_TIME_HISTORY;
+    if(timing->history.count < FUDE_FRAME_TIME_HISTORY)
+        timing->history.count += 1;
+}
+
 // rendering stuff
 void f_present(fude* app)
 {
-    glfwSwapBuffers(app->window);
+    F_PROFILE_BEGIN("f_present");
+    _fude_end_frame_timing(&app->timing);
+    _fude_end_render_stats_frame(&app->renderer);
+    _fude_recycle_render_targets(app);
+    if(app->render_thread) {
+        _fude_submit_frame(app);
+    } else if(app->software) {
+        _fude_software_present(app);
+    } else {
+        _fude_gpu_timer_end_frame(&app->renderer.gpu_timer);
+        if(!app->headless)
+            glfwSwapBuffers(app->window);
+    }
+    F_PROFILE_END();
 }
 
 void f_clear(fude* app)
 {
-    (void)app;
+    if(app->render_thread) {
+        _fude_record_clear(app);
+        return;
+    }
+    if(app->software) {
+        _fude_software_clear(app);
+        return;
+    }
+    _fude_gpu_timer_begin_pass(&app->renderer.gpu_timer, FUDE_GPU_PASS_CLEAR);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _fude_gpu_timer_end_pass(&app->renderer.gpu_timer);
 }
 
@@ -0,0 +1,366 @@
+#include "fude.h"
+#include "fude_internal.h"
+
+// passes and resources are declared again every frame after f_reset_frame_graph. f_execute_frame_graph
+// orders the passes so every reader runs after all writers of what it reads (declaration order breaks
+// ties, so several passes writing the backbuffer composite in the order they were added), drops passes
+// whose output nothing that runs reads, and backs each transient texture with a pooled render target
+// from its first use to its last. Released targets go straight back to the pool, so transient textures
+// of the same size and format whose lifetimes don't overlap end up sharing one target. Names aren't
+// copied, they have to outlive the frame (string literals)
+
+enum {
+    _FUDE_GRAPH_BACKBUFFER = 0, // the default framebuffer, always handle 1
+    _FUDE_GRAPH_TRANSIENT,      // a pooled target while a pass that runs uses it
+    _FUDE_GRAPH_IMPORTED,       // the caller's target, kept across frames
+};
+
+typedef struct {
+    const char* name;
+    int kind;
+    fude_render_target_config config; // transient ones
+    fude_render_target* target;       // imported, or the pooled one during its lifetime
+    uint32_t first, last;             // positions in the execution order of the first and last pass using it
+    bool used;                        // by a pass that runs
+} _fude_graph_resource;
+
+typedef struct {
+    const char* name;
+    fude_graph_pass_proc execute;
+    void* user_data;
+    fude_graph_resource write; // the target it draws into, one per pass
+    bool alive;
+} _fude_graph_pass;
+
+typedef struct {
+    uint32_t pass;
+    fude_graph_resource resource;
+} _fude_graph_read;
+
+typedef struct {
+    uint32_t from, to; // pass indices, from runs first
+} _fude_graph_edge;
+
+struct fude_frame_graph {
+    struct {
+        _fude_graph_resource* data;
+        uint32_t count, capacity;
+    } resources;
+    struct {
+        _fude_graph_pass* data;
+        uint32_t count, capacity;
+    } passes;
+    struct {
+        _fude_graph_read* data;
+        uint32_t count, capacity;
+    } reads;
+
+    // rebuilt by every f_execute_frame_graph
+    struct {
+        _fude_graph_edge* data;
+        uint32_t count, capacity;
+    } edges;
+    struct {
+        uint32_t* data; // pass indices in execution order
+        uint32_t count, capacity;
+    } order;
+    struct {
+        uint32_t* data;
+        uint32_t count, capacity;
+    } indegree;
+    struct {
+        fude_render_target** data; // distinct pooled targets this frame, for the stats
+        uint32_t count, capacity;
+    } targets;
+    fude_frame_graph_stats stats;
+};
+
+#define _FUDE_GRAPH_PUSH(array, value) do { \
+        (array).data = _fude_grow_array((array).data, (array).count, &(array).capacity, (array).count + 1, \
+                sizeof(*(array).data)); \
+        (array).data[(array).count++] = (value); \
+    } while(0)
+
+fude_result f_create_frame_graph(fude_frame_graph** graph)
+{
+    if(!graph) return FUDE_INVALID_ARGUMENTS_ERROR;
+    fude_frame_graph* result = f_malloc(sizeof(fude_frame_graph));
+    if(!result) return FUDE_ERROR;
+    f_memzero(result, sizeof(fude_frame_graph));
+    f_reset_frame_graph(result);
+    *graph = result;
+    return FUDE_OK;
+}
+
+void f_destroy_frame_graph(fude_frame_graph* graph)
+{
+    if(!graph) return;
+    f_free(graph->resources.data);
+    f_free(graph->passes.data);
+    f_free(graph->reads.data);
+    f_free(graph->edges.data);
+    f_free(graph->order.data);
+    f_free(graph->indegree.data);
+    f_free(graph->targets.data);
+    f_free(graph);
+}
+
+// forgets every pass and resource, the storage is kept for the next frame's declarations
+void f_reset_frame_graph(fude_frame_graph* graph)
+{
+    if(!graph) return;
+    graph->resources.count = 0;
+    graph->passes.count = 0;
+    graph->reads.count = 0;
+    _FUDE_GRAPH_PUSH(graph->resources, ((_fude_graph_resource){ .name = "backbuffer",
+                .kind = _FUDE_GRAPH_BACKBUFFER }));
+}
+
+// writing it is drawing to the screen, those passes are never culled
+fude_graph_resource f_graph_backbuffer(fude_frame_graph* graph)
+{
+    (void)graph;
+    return 1;
+}
+
+// contents are undefined when the first pass writing it starts, clear it there. A relative size
+// (width and height 0) is resolved against the default framebuffer when the texture comes to life
+fude_graph_resource f_graph_create_texture(fude_frame_graph* graph, const char* name,
+        const fude_render_target_config* config)
+{
+    if(!graph || !config) return 0;
+    _FUDE_GRAPH_PUSH(graph->resources, ((_fude_graph_resource){ .name = name, .kind = _FUDE_GRAPH_TRANSIENT,
+                .config = *config }));
+    return graph->resources.count;
+}
+
+// a target that lives outside the graph, passes writing it count as output and are never culled
+fude_graph_resource f_graph_import_target(fude_frame_graph* graph, const char* name, fude_render_target* target)
+{
+    if(!graph || !target) return 0;
+    _FUDE_GRAPH_PUSH(graph->resources, ((_fude_graph_resource){ .name = name, .kind = _FUDE_GRAPH_IMPORTED,
+                .target = target }));
+    return graph->resources.count;
+}
+
+// execute runs between f_begin_target on what the pass writes and f_flush, returns the pass index
+uint32_t f_graph_add_pass(fude_frame_graph* graph, const char* name, fude_graph_pass_proc execute, void* user_data)
+{
+    if(!graph) return UINT32_MAX;
+    _FUDE_GRAPH_PUSH(graph->passes, ((_fude_graph_pass){ .name = name, .execute = execute,
+                .user_data = user_data }));
+    return graph->passes.count - 1;
+}
+
+static bool _fude_graph_valid(const fude_frame_graph* graph, uint32_t pass, fude_graph_resource resource)
+{
+    if(pass < graph->passes.count && resource > 0 && resource <= graph->resources.count) return true;
+    f_trace_log(FUDE_LOG_WARNING, "Frame graph pass %u or resource %u doesn't exist", pass, resource);
+    return false;
+}
+
+// the pass samples resource, so it runs after everything writing it
+void f_graph_read(fude_frame_graph* graph, uint32_t pass, fude_graph_resource resource)
+{
+    if(!graph || !_fude_graph_valid(graph, pass, resource)) return;
+    _FUDE_GRAPH_PUSH(graph->reads, ((_fude_graph_read){ .pass = pass, .resource = resource }));
+}
+
+// the pass draws into resource, one per pass. A pass that writes nothing is always culled
+void f_graph_write(fude_frame_graph* graph, uint32_t pass, fude_graph_resource resource)
+{
+    if(!graph || !_fude_graph_valid(graph, pass, resource)) return;
+    _fude_graph_pass* declared = graph->passes.data + pass;
+    if(declared->write && declared->write != resource) {
+        f_trace_log(FUDE_LOG_WARNING, "Frame graph pass '%s' already writes '%s', ignoring '%s'",
+                declared->name, graph->resources.data[declared->write - 1].name,
+                graph->resources.data[resource - 1].name);
+        return;
+    }
+    declared->write = resource;
+}
+
+// reads depend on every writer of the resource, a writer on the writers declared before it
+static void _fude_graph_build_edges(fude_frame_graph* graph)
+{
+    graph->edges.count = 0;
+    for(uint32_t i = 0; i < graph->reads.count; ++i) {
+        const _fude_graph_read* read = graph->reads.data + i;
+        for(uint32_t writer = 0; writer < graph->passes.count; ++writer) {
+            if(writer != read->pass && graph->passes.data[writer].write == read->resource)
+                _FUDE_GRAPH_PUSH(graph->edges, ((_fude_graph_edge){ .from = writer, .to = read->pass }));
+        }
+    }
+    for(uint32_t pass = 0; pass < graph->passes.count; ++pass) {
+        fude_graph_resource write = graph->passes.data[pass].write;
+        if(!write) continue;
+        for(uint32_t earlier = 0; earlier < pass; ++earlier) {
+            if(graph->passes.data[earlier].write == write)
+                _FUDE_GRAPH_PUSH(graph->edges, ((_fude_graph_edge){ .from = earlier, .to = pass }));
+        }
+    }
+}
+
+// Kahn's algorithm taking the lowest ready index first, false on a cycle
+static bool _fude_graph_sort(fude_frame_graph* graph)
+{
+    const uint32_t pass_count = graph->passes.count;
+    graph->order.data = _fude_grow_array(graph->order.data, 0, &graph->order.capacity, pass_count, sizeof(uint32_t));
+    graph->indegree.data = _fude_grow_array(graph->indegree.data, 0, &graph->indegree.capacity, pass_count,
+            sizeof(uint32_t));
+    uint32_t* indegree = graph->indegree.data;
+    f_memzero(indegree, pass_count*sizeof(uint32_t));
+    for(uint32_t i = 0; i < graph->edges.count; ++i)
+        indegree[graph->edges.data[i].to] += 1;
+
+    graph->order.count = 0;
+    while(graph->order.count < pass_count) {
+        uint32_t ready = 0;
+        while(ready < pass_count && indegree[ready] != 0)
+            ready += 1;
+        if(ready == pass_count) return false;
+        indegree[ready] = UINT32_MAX; // emitted
+        graph->order.data[graph->order.count++] = ready;
+        for(uint32_t i = 0; i < graph->edges.count; ++i) {
+            if(graph->edges.data[i].from == ready)
+                indegree[graph->edges.data[i].to] -= 1;
+        }
+    }
+    return true;
+}
+
+// back to front, so every reader's fate is known before its writers'
+static void _fude_graph_cull(fude_frame_graph* graph)
+{
+    for(uint32_t position = graph->order.count; position-- > 0;) {
+        const uint32_t index = graph->order.data[position];
+        _fude_graph_pass* pass = graph->passes.data + index;
+        pass->alive = false;
+        if(!pass->write) continue;
+        if(graph->resources.data[pass->write - 1].kind != _FUDE_GRAPH_TRANSIENT) {
+            pass->alive = true;
+            continue;
+        }
+        for(uint32_t i = 0; i < graph->reads.count && !pass->alive; ++i) {
+            const _fude_graph_read* read = graph->reads.data + i;
+            pass->alive = read->resource == pass->write && read->pass != index && graph->passes.data[read->pass].alive;
+        }
+    }
+}
+
+static void _fude_graph_touch(fude_frame_graph* graph, fude_graph_resource handle, uint32_t position)
+{
+    _fude_graph_resource* resource = graph->resources.data + handle - 1;
+    if(!resource->used) resource->first = position;
+    resource->last = position;
+    resource->used = true;
+}
+
+static void _fude_graph_lifetimes(fude_frame_graph* graph)
+{
+    for(uint32_t i = 0; i < graph->resources.count; ++i)
+        graph->resources.data[i].used = false;
+    for(uint32_t position = 0; position < graph->order.count; ++position) {
+        const uint32_t index = graph->order.data[position];
+        const _fude_graph_pass* pass = graph->passes.data + index;
+        if(!pass->alive) continue;
+        _fude_graph_touch(graph, pass->write, position);
+        for(uint32_t i = 0; i < graph->reads.count; ++i) {
+            if(graph->reads.data[i].pass == index)
+                _fude_graph_touch(graph, graph->reads.data[i].resource, position);
+        }
+    }
+}
+
+static void _fude_graph_acquire(fude* app, fude_frame_graph* graph, _fude_graph_resource* resource)
+{
+    resource->target = f_acquire_render_target(app, &resource->config);
+    if(!resource->target) {
+        f_trace_log(FUDE_LOG_WARNING, "Frame graph couldn't get a render target for '%s'", resource->name);
+        return;
+    }
+    graph->stats.textures += 1;
+    for(uint32_t i = 0; i < graph->targets.count; ++i) {
+        if(graph->targets.data[i] == resource->target) return;
+    }
+    _FUDE_GRAPH_PUSH(graph->targets, resource->target);
+}
+
+// sorts, culls and runs what was declared since f_reset_frame_graph, then leaves the default framebuffer
+// bound. Nothing runs when the passes depend on each other in a cycle
+fude_result f_execute_frame_graph(fude* app, fude_frame_graph* graph)
+{
+    if(!app || !graph) return FUDE_INVALID_ARGUMENTS_ERROR;
+    F_PROFILE_SCOPE("f_execute_frame_graph");
+    f_memzero(&graph->stats, sizeof(fude_frame_graph_stats));
+    graph->stats.passes = graph->passes.count;
+    graph->targets.count = 0;
+
+    _fude_graph_build_edges(graph);
+    if(!_fude_graph_sort(graph)) {
+        for(uint32_t i = 0; i < graph->passes.count; ++i) {
+            if(graph->indegree.data[i] != UINT32_MAX) {
+                f_trace_log(FUDE_LOG_ERROR, "Frame graph has a cycle through pass '%s'", graph->passes.data[i].name);
+                break;
+            }
+        }
+        return FUDE_ERROR;
+    }
+    _fude_graph_cull(graph);
+    _fude_graph_lifetimes(graph);
+
+    for(uint32_t position = 0; position < graph->order.count; ++position) {
+        _fude_graph_pass* pass = graph->passes.data + graph->order.data[position];
+        if(!pass->alive) {
+            graph->stats.culled_passes += 1;
+            continue;
+        }
+
+        // acquire before releasing, what a pass reads and what it writes must not share a target
+        for(uint32_t i = 0; i < graph->resources.count; ++i) {
+            _fude_graph_resource* resource = graph->resources.data + i;
+            if(resource->kind == _FUDE_GRAPH_TRANSIENT && resource->used && resource->first == position)
+                _fude_graph_acquire(app, graph, resource);
+        }
+
+        const _fude_graph_resource* output = graph->resources.data + pass->write - 1;
+        if(output->kind == _FUDE_GRAPH_BACKBUFFER) {
+            f_end_target(app);
+        } else if(output->target) {
+            f_begin_target(app, output->target);
+        }
+        if(pass->execute && (output->kind == _FUDE_GRAPH_BACKBUFFER || output->target)) {
+            F_PROFILE_BEGIN(pass->name ? pass->name : "frame_graph_pass");
+            pass->execute(app, graph, pass->user_data);
+            F_PROFILE_END();
+        }
+        f_flush(app);
+
+        for(uint32_t i = 0; i < graph->resources.count; ++i) {
+            _fude_graph_resource* resource = graph->resources.data + i;
+            if(resource->kind == _FUDE_GRAPH_TRANSIENT && resource->used && resource->last == position &&
+                    resource->target) {
+                f_release_render_target(app, resource->target);
+                resource->target = NULL;
+            }
+        }
+    }
+    f_end_target(app);
+    graph->stats.targets = graph->targets.count;
+    return FUDE_OK;
+}
+
+// what a resource is drawn into or read from, only while f_execute_frame_graph runs the passes using it.
+// NULL for the backbuffer
+fude_render_target* f_graph_get_target(const fude_frame_graph* graph, fude_graph_resource resource)
+{
+    if(!graph || resource == 0 || resource > graph->resources.count) return NULL;
+    return graph->resources.data[resource - 1].target;
+}
+
+// of the last f_execute_frame_graph
+void f_get_frame_graph_stats(const fude_frame_graph* graph, fude_frame_graph_stats* stats)
+{
+    if(!graph || !stats) return;
+    *stats = graph->stats;
+}
@@ -18,7 +18,7 @@ fude_result _fude_init_window(fude* app, const fude_config* config)
         return FUDE_WINDOW_CREATION_ERROR;
     }
 
-    glfwSetWindowUserPointer(app->window, (void*)&app->event_queue);
+    glfwSetWindowUserPointer(app->window, (void*)app);
     glfwSetWindowPosCallback(app->window, _fude_window_pos_callback);
     glfwSetWindowSizeCallback(app->window, _fude_window_size_callback);
     glfwSetWindowCloseCallback(app->window, _fude_window_close_callback);
@@ -31,12 +31,32 @@ fude_result _fude_init_window(fude* app, const fude_config* config)
     glfwSetKeyCallback(app->window, _fude_key_callback);
     glfwSetCharCallback(app->window, _fude_char_callback);
 
+    double cursor_x, cursor_y;
+    glfwGetCursorPos(app->window, &cursor_x, &cursor_y);
+    app->input.cursor.x = (float)cursor_x;
+    app->input.cursor.y = (float)cursor_y;
+
     glfwMakeContextCurrent(app->window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
     return FUDE_OK;
 }
 
-static fude_event* _fude_new_event(fude_event_queue* eq, int type)
+void _fude_set_swap_interval(const fude_config* config)
+{
+    // must be called with the window's context current
+    int interval = config->swap_interval;
+    if(config->adaptive_vsync && interval > 0) {
+        if(glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            interval = -interval;
+        } else {
+            f_trace_log(FUDE_LOG_WARNING, "Adaptive vsync is not supported, falling back to regular vsync");
+        }
+    }
+    glfwSwapInterval(interval);
+}
+
+fude_event* _fude_new_event(fude_event_queue* eq, int type)
 {
     fude_event* event = eq->events + eq->head;
     eq->head = (eq->head + 1) % FUDE_EVENT_QUEUE_MAXIMUM_EVENTS;
@@ -46,50 +66,66 @@ static fude_event* _fude_new_event(fude_event_queue* eq, int type)
     return event;
 }
 
+void _fude_begin_input_frame(fude_input* input)
+{
+    f_memzero(input->keyboard.pressed, sizeof(input->keyboard.pressed));
+    f_memzero(input->keyboard.released, sizeof(input->keyboard.released));
+    input->mouse.pressed = 0;
+    input->mouse.released = 0;
+    input->cursor.dx = 0.0f;
+    input->cursor.dy = 0.0f;
+    input->scroll.x = 0.0f;
+    input->scroll.y = 0.0f;
+}
 
 void _fude_window_pos_callback(GLFWwindow* window, int x, int y)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event = _fude_new_event(eq, FUDE_EVENT_WINDOW_MOVED);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_WINDOW_MOVED);
     event->window.x = x;
     event->window.y = y;
 }
 
 void _fude_window_size_callback(GLFWwindow* window, int width, int height)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event = _fude_new_event(eq, FUDE_EVENT_WINDOW_MOVED);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_WINDOW_MOVED);
     event->window.width = width;
     event->window.height = height;
 }
 
 void _fude_window_close_callback(GLFWwindow* window)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    _fude_new_event(eq, FUDE_EVENT_QUIT);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    _fude_new_event(&app->event_queue, FUDE_EVENT_QUIT);
 }
 
 void _fude_window_focus_callback(GLFWwindow* window, int focused)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
     if(focused)
-        _fude_new_event(eq, FUDE_EVENT_WINDOW_GAIN_FOCUS);
+        _fude_new_event(&app->event_queue, FUDE_EVENT_WINDOW_GAIN_FOCUS);
     else
-        _fude_new_event(eq, FUDE_EVENT_WINDOW_LOST_FOCUS);
+        _fude_new_event(&app->event_queue, FUDE_EVENT_WINDOW_LOST_FOCUS);
 }
 
 void _fude_framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_FRAMEBUFFER_RESIZED);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_FRAMEBUFFER_RESIZED);
     event->framebuffer.width = width;
     event->framebuffer.height = height;
+    // the software backend keeps drawing at its configured size and stretches it when presenting
+    if(!app->software) {
+        app->renderer.framebuffer.width = width;
+        app->renderer.framebuffer.height = height;
+    }
 }
 
 void _fude_mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_NONE);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_NONE);
     event->mouse.button = button;
     event->mouse.mods = mods;
 
@@ -97,37 +133,55 @@ void _fude_mouse_button_callback(GLFWwindow* window, int button, int action, int
         event->type = FUDE_EVENT_MOUSE_BUTTON_PRESSED;
     else if (action == GLFW_RELEASE)
         event->type = FUDE_EVENT_MOUSE_BUTTON_RELEASED;
+
+    if(button < 0 || button >= FUDE_INPUT_MAXIMUM_MOUSE_BUTTONS) return;
+    uint8_t bit = (uint8_t)(1u << button);
+    if(action == GLFW_PRESS) {
+        app->input.mouse.down |= bit;
+        app->input.mouse.pressed |= bit;
+    } else if(action == GLFW_RELEASE) {
+        app->input.mouse.down &= (uint8_t)~bit;
+        app->input.mouse.released |= bit;
+    }
 }
 
 void _fude_cursor_pos_callback(GLFWwindow* window, double x, double y)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_CURSOR_MOVED);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_CURSOR_MOVED);
     event->cursor.x = (int)x;
     event->cursor.y = (int)y;
+
+    app->input.cursor.dx += (float)x - app->input.cursor.x;
+    app->input.cursor.dy += (float)y - app->input.cursor.y;
+    app->input.cursor.x = (float)x;
+    app->input.cursor.y = (float)y;
 }
 
 void _fude_cursor_enter_callback(GLFWwindow* window, int entered)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
     if(entered)
-        _fude_new_event(eq, FUDE_EVENT_CURSOR_ENTERED);
+        _fude_new_event(&app->event_queue, FUDE_EVENT_CURSOR_ENTERED);
     else
-        _fude_new_event(eq, FUDE_EVENT_CURSOR_LEFT);
+        _fude_new_event(&app->event_queue, FUDE_EVENT_CURSOR_LEFT);
 }
 
 void _fude_scroll_callback(GLFWwindow* window, double x, double y)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_SCROLL);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_SCROLL);
     event->scroll.x = x;
     event->scroll.y = y;
+
+    app->input.scroll.x += (float)x;
+    app->input.scroll.y += (float)y;
 }
 
 void _fude_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_NONE);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_NONE);
     event->keyboard.key = key;
     event->keyboard.scancode = scancode;
     event->keyboard.mods = mods;
@@ -138,11 +192,20 @@ void _fude_key_callback(GLFWwindow* window, int key, int scancode, int action, i
         event->type = FUDE_EVENT_KEY_RELEASED;
     else if (action == GLFW_REPEAT)
         event->type = FUDE_EVENT_KEY_REPEATED;
+
+    if(key < 0 || key >= FUDE_INPUT_MAXIMUM_KEYS) return;
+    if(action == GLFW_PRESS) {
+        _FUDE_BIT_SET(app->input.keyboard.down, key);
+        _FUDE_BIT_SET(app->input.keyboard.pressed, key);
+    } else if(action == GLFW_RELEASE) {
+        _FUDE_BIT_CLEAR(app->input.keyboard.down, key);
+        _FUDE_BIT_SET(app->input.keyboard.released, key);
+    }
 }
 
 void _fude_char_callback(GLFWwindow* window, unsigned int codepoint)
 {
-    fude_event_queue* eq = (fude_event_queue*)glfwGetWindowUserPointer(window);
-    fude_event* event =_fude_new_event(eq, FUDE_EVENT_CODEPOINT);
+    fude* app = (fude*)glfwGetWindowUserPointer(window);
+    fude_event* event = _fude_new_event(&app->event_queue, FUDE_EVENT_CODEPOINT);
     event->codepoint = codepoint;
 }
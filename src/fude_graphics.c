@@ -1,7 +1,18 @@
+#include "gm.h"
 #include "fude.h"
+#include "fude_internal.h"
 
 #include "glad/glad.h"
 #include <stddef.h>
+#include <stdatomic.h>
+#include <string.h> // strcmp()
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define FUDE_CULL_SSE 1
+#else
+    #define FUDE_CULL_SSE 0
+#endif
 
 void CheckOpenGLError(void)
 {
@@ -31,20 +42,9 @@ void CheckOpenGLError(void)
 }
 
 
-fude_result _fude_init_renderer(fude* app, const fude_config* config)
+// fude_vertex attributes sourced from whatever is bound to GL_ARRAY_BUFFER
+static void _fude_vertex_layout(void)
 {
-    (void)config;
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    glGenVertexArrays(1, &app->renderer.id);
-    glBindVertexArray(app->renderer.id);
-
-    glGenBuffers(1, &app->renderer.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, app->renderer.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(fude_vertex)*FUDE_RENDERER_MAXIMUM_VERTICES, 
-            app->renderer.vertices.data, GL_DYNAMIC_DRAW);
-
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 
             sizeof(fude_vertex), (GLvoid*)offsetof(fude_vertex, position));
@@ -57,18 +57,41 @@ fude_result _fude_init_renderer(fude* app, const fude_config* config)
     glEnableVertexAttribArray(3);
     glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 
             sizeof(fude_vertex), (GLvoid*)offsetof(fude_vertex, tex_index));
+}
+
+fude_result _fude_init_renderer(fude* app, const fude_config* config)
+{
+    (void)config;
+    _fude_set_blend_mode_gl(FUDE_BLEND_ALPHA, true);
+
+    glGenVertexArrays(1, &app->renderer.mesh_vao);
+    glGenVertexArrays(1, &app->renderer.id);
+    glBindVertexArray(app->renderer.id);
+
+    glGenBuffers(1, &app->renderer.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, app->renderer.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(fude_vertex)*FUDE_RENDERER_MAXIMUM_VERTICES, 
+            app->renderer.vertices.data, GL_DYNAMIC_DRAW);
+    _fude_vertex_layout();
 
     glGenBuffers(1, &app->renderer.ibo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t)*FUDE_RENDERER_MAXIMUM_INDICIES, 
             app->renderer.indices.data, GL_DYNAMIC_DRAW);
 
-    // TODO: Setup the default shader and the default texture
+    _fude_init_gpu_timer(&app->renderer.gpu_timer);
     return FUDE_OK;
 }
 
+static void _fude_flush_batch(fude* app, fude_batch_break reason);
+static void _fude_queue_layers(fude_renderer* renderer, uint32_t first_vertex, uint32_t first_index);
+static void _fude_draw_layer_queue(fude* app, fude_batch_break reason);
+
 void f_begin(fude* f, fude_draw_mode mode, fude_shader shader)
 {
+    if(f->renderer.indices.count > 0 && f->renderer.shader.id != shader.id)
+        _fude_flush_batch(f, FUDE_BATCH_BREAK_SHADER);
+
     f->renderer.working.count = 0;
     f->renderer.working.mode = mode;
     f->renderer.shader = shader;
@@ -82,35 +105,316 @@ void f_dump_vertex(const fude_vertex* vertex)
     f_trace_log(FUDE_LOG_INFO, "object_id=%f", vertex->object_id);
 }
 
-void f_end(fude* app)
+// one bit per primitive (up to 64) that lies entirely outside the bounds on some axis,
+// primitives are tested four at a time, one per SIMD lane
+static uint64_t _fude_cull_mask(const fude_vertex* vertices, uint32_t per_primitive, uint32_t count,
+        V3f min, V3f max)
 {
-    if(app->renderer.working.mode == FUDE_MODE_QUADS && app->renderer.working.count >= 4) {
-        uint32_t nquads = app->renderer.working.count / 4;
-        for(uint32_t i = 0; i < 6*nquads; i+=6) {
-            app->renderer.indices.data[i + 0] = app->renderer.vertices.count + 0;
-            app->renderer.indices.data[i + 1] = app->renderer.vertices.count + 1;
-            app->renderer.indices.data[i + 2] = app->renderer.vertices.count + 2;
-            app->renderer.indices.data[i + 3] = app->renderer.vertices.count + 2;
-            app->renderer.indices.data[i + 4] = app->renderer.vertices.count + 3;
-            app->renderer.indices.data[i + 5] = app->renderer.vertices.count + 0;
-            app->renderer.indices.count += 6;
-            app->renderer.vertices.count += 4;
-            app->renderer.working.count -= 4;
+    uint64_t mask = 0;
+    uint32_t i = 0;
+#if FUDE_CULL_SSE
+    const __m128 min_x = _mm_set1_ps(min.x), min_y = _mm_set1_ps(min.y), min_z = _mm_set1_ps(min.z);
+    const __m128 max_x = _mm_set1_ps(max.x), max_y = _mm_set1_ps(max.y), max_z = _mm_set1_ps(max.z);
+    for(; i + 4 <= count; i += 4) {
+        const fude_vertex* p0 = vertices + (i + 0)*per_primitive;
+        const fude_vertex* p1 = vertices + (i + 1)*per_primitive;
+        const fude_vertex* p2 = vertices + (i + 2)*per_primitive;
+        const fude_vertex* p3 = vertices + (i + 3)*per_primitive;
+        __m128 lo_x = _mm_set_ps(p3->position.x, p2->position.x, p1->position.x, p0->position.x);
+        __m128 lo_y = _mm_set_ps(p3->position.y, p2->position.y, p1->position.y, p0->position.y);
+        __m128 lo_z = _mm_set_ps(p3->position.z, p2->position.z, p1->position.z, p0->position.z);
+        __m128 hi_x = lo_x, hi_y = lo_y, hi_z = lo_z;
+        for(uint32_t k = 1; k < per_primitive; ++k) {
+            __m128 x = _mm_set_ps(p3[k].position.x, p2[k].position.x, p1[k].position.x, p0[k].position.x);
+            __m128 y = _mm_set_ps(p3[k].position.y, p2[k].position.y, p1[k].position.y, p0[k].position.y);
+            __m128 z = _mm_set_ps(p3[k].position.z, p2[k].position.z, p1[k].position.z, p0[k].position.z);
+            lo_x = _mm_min_ps(lo_x, x); hi_x = _mm_max_ps(hi_x, x);
+            lo_y = _mm_min_ps(lo_y, y); hi_y = _mm_max_ps(hi_y, y);
+            lo_z = _mm_min_ps(lo_z, z); hi_z = _mm_max_ps(hi_z, z);
         }
+        __m128 outside = _mm_or_ps(_mm_cmplt_ps(hi_x, min_x), _mm_cmpgt_ps(lo_x, max_x));
+        outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(hi_y, min_y), _mm_cmpgt_ps(lo_y, max_y)));
+        outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmplt_ps(hi_z, min_z), _mm_cmpgt_ps(lo_z, max_z)));
+        mask |= (uint64_t)_mm_movemask_ps(outside) << i;
+    }
+#endif
+    for(; i < count; ++i) {
+        const fude_vertex* p = vertices + i*per_primitive;
+        V3f lo = p->position, hi = p->position;
+        for(uint32_t k = 1; k < per_primitive; ++k) {
+            V3f v = p[k].position;
+            if(v.x < lo.x) lo.x = v.x;
+            if(v.x > hi.x) hi.x = v.x;
+            if(v.y < lo.y) lo.y = v.y;
+            if(v.y > hi.y) hi.y = v.y;
+            if(v.z < lo.z) lo.z = v.z;
+            if(v.z > hi.z) hi.z = v.z;
+        }
+        if(hi.x < min.x || lo.x > max.x || hi.y < min.y || lo.y > max.y || hi.z < min.z || lo.z > max.z)
+            mask |= (uint64_t)1 << i;
+    }
+    return mask;
+}
+
+static void _fude_write_primitive_indices(uint32_t* indices, uint32_t base, fude_draw_mode mode)
+{
+    if(mode == FUDE_MODE_QUADS) {
+        indices[0] = base + 0;
+        indices[1] = base + 1;
+        indices[2] = base + 2;
+        indices[3] = base + 2;
+        indices[4] = base + 3;
+        indices[5] = base + 0;
+    } else {
+        indices[0] = base + 0;
+        indices[1] = base + 1;
+        indices[2] = base + 2;
     }
+}
+
+// FUDE_ADDITIVE_FLAG set on a slot or shape code, see FUDE_DEFAULT_FRAGMENT_SHADER
+static float _fude_additive_index(float tex_index)
+{
+    if(tex_index < 0.0f)
+        return -1.0f - (float)((uint32_t)(-1.0f - tex_index) | FUDE_ADDITIVE_FLAG);
+    return (float)((uint32_t)tex_index | FUDE_ADDITIVE_FLAG);
+}
+
+// the slot a default shader vertex samples, glyphs included, 0 for vertex color and shapes
+static uint32_t _fude_vertex_slot(float tex_index)
+{
+    return tex_index > 0.0f ? (uint32_t)tex_index & (FUDE_GLYPH_FLAG - 1) : 0;
+}
+
+static bool _fude_same_textures(const fude_texture* a, const fude_texture* b)
+{
+    for(uint32_t i = 0; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i) {
+        if(a[i].id != b[i].id) return false;
+    }
+    return true;
+}
+
+// copies the first nprimitives complete primitives of the working vertices into the display list
+// being recorded, before culling so the list can be replayed under any camera
+static void _fude_capture_primitives(fude_renderer* renderer, uint32_t nprimitives)
+{
+    fude_display_list* list = renderer->recording;
+    const fude_draw_mode mode = renderer->working.mode;
+    const uint32_t per_primitive = mode == FUDE_MODE_QUADS ? 4 : 3;
+    const uint32_t indices_per_primitive = mode == FUDE_MODE_QUADS ? 6 : 3;
+    const fude_vertex* src = renderer->vertices.data + renderer->vertices.count;
+
+    list->vertices.data = _fude_grow_array(list->vertices.data, list->vertices.count, &list->vertices.capacity,
+            list->vertices.count + nprimitives*per_primitive, sizeof(fude_vertex));
+    list->indices.data = _fude_grow_array(list->indices.data, list->indices.count, &list->indices.capacity,
+            list->indices.count + nprimitives*indices_per_primitive, sizeof(uint32_t));
+
+    const fude_blend_mode blend = _fude_batch_blend(renderer, renderer->shader);
+    fude_display_segment* segment = list->segments.count ? list->segments.data + list->segments.count - 1 : NULL;
+    if(segment && (segment->shader.id != renderer->shader.id || segment->blend != blend || segment->mode != mode ||
+                !_fude_same_textures(segment->textures, renderer->textures.data)))
+        segment = NULL;
+
+    for(uint32_t i = 0; i < nprimitives; ++i, src += per_primitive) {
+        // a segment has to fit into one batch when it's replayed
+        if(!segment || segment->vertex_count + per_primitive > FUDE_RENDERER_MAXIMUM_VERTICES ||
+                segment->index_count + indices_per_primitive > FUDE_RENDERER_MAXIMUM_INDICIES) {
+            list->segments.data = _fude_grow_array(list->segments.data, list->segments.count, &list->segments.capacity,
+                    list->segments.count + 1, sizeof(fude_display_segment));
+            segment = list->segments.data + list->segments.count++;
+            f_memzero(segment, sizeof(fude_display_segment));
+            segment->shader = renderer->shader;
+            segment->blend = blend;
+            segment->mode = mode;
+            f_memcpy(segment->textures, renderer->textures.data, sizeof(segment->textures));
+            segment->first_vertex = list->vertices.count;
+            segment->first_index = list->indices.count;
+            segment->bounds.min = src->position;
+            segment->bounds.max = src->position;
+        }
 
-    if(app->renderer.working.count >= 3) {
-        for(uint32_t i = 0 ; i < app->renderer.working.count; i += 3) {
-            app->renderer.indices.data[i + 0] = app->renderer.vertices.count + 0;
-            app->renderer.indices.data[i + 1] = app->renderer.vertices.count + 1;
-            app->renderer.indices.data[i + 2] = app->renderer.vertices.count + 2;
-            app->renderer.vertices.count += 3;
-            app->renderer.indices.count += 3;
-            app->renderer.working.count -= 3;
+        f_memcpy(list->vertices.data + list->vertices.count, src, per_primitive*sizeof(fude_vertex));
+        _fude_write_primitive_indices(list->indices.data + list->indices.count, segment->vertex_count, mode);
+        for(uint32_t k = 0; k < per_primitive; ++k) {
+            V3f p = src[k].position;
+            if(p.x < segment->bounds.min.x) segment->bounds.min.x = p.x;
+            if(p.y < segment->bounds.min.y) segment->bounds.min.y = p.y;
+            if(p.z < segment->bounds.min.z) segment->bounds.min.z = p.z;
+            if(p.x > segment->bounds.max.x) segment->bounds.max.x = p.x;
+            if(p.y > segment->bounds.max.y) segment->bounds.max.y = p.y;
+            if(p.z > segment->bounds.max.z) segment->bounds.max.z = p.z;
         }
+        list->vertices.count += per_primitive;
+        list->indices.count += indices_per_primitive;
+        segment->vertex_count += per_primitive;
+        segment->index_count += indices_per_primitive;
     }
 }
 
+// default shader vertices of the blend modes that share its batches: ADDITIVE ones are flagged so the
+// shader writes alpha 0, PREMULTIPLIED colors go back to straight alpha and alpha 0 turns into ADDITIVE.
+// Only complete primitives come through here, so nothing is converted twice
+static void _fude_apply_blend_mode(const fude_renderer* renderer, fude_vertex* vertices, uint32_t count)
+{
+    if(renderer->blend_mode == FUDE_BLEND_ADDITIVE) {
+        for(uint32_t i = 0; i < count; ++i)
+            vertices[i].tex_index = _fude_additive_index(vertices[i].tex_index);
+    } else if(renderer->blend_mode == FUDE_BLEND_PREMULTIPLIED) {
+        for(uint32_t i = 0; i < count; ++i) {
+            V4f* color = &vertices[i].color;
+            if(color->a > 0.0f) {
+                color->r /= color->a;
+                color->g /= color->a;
+                color->b /= color->a;
+            } else {
+                color->a = 1.0f;
+                vertices[i].tex_index = _fude_additive_index(vertices[i].tex_index);
+            }
+        }
+    }
+}
+
+// turns every complete primitive of the working vertices into indices,
+// leftover vertices of an unfinished primitive stay in working.
+// Geometry of the shader f_use_camera set up is culled against the camera's bounds first,
+// the survivors are compacted in place
+static void _fude_commit_working(fude_renderer* renderer)
+{
+    const uint32_t per_primitive = renderer->working.mode == FUDE_MODE_QUADS ? 4 : 3;
+    const uint32_t indices_per_primitive = renderer->working.mode == FUDE_MODE_QUADS ? 6 : 3;
+    const uint32_t nprimitives = renderer->working.count / per_primitive;
+    const uint32_t first_vertex = renderer->vertices.count, first_index = renderer->indices.count;
+    uint32_t* indices = renderer->indices.data + renderer->indices.count;
+    uint32_t base = renderer->vertices.count;
+    if(renderer->shader.id == renderer->default_shader.id && nprimitives > 0)
+        _fude_apply_blend_mode(renderer, renderer->vertices.data + base, per_primitive*nprimitives);
+    if(renderer->recording && nprimitives > 0)
+        _fude_capture_primitives(renderer, nprimitives);
+
+    if(!renderer->camera.active || renderer->camera.shader != renderer->shader.id) {
+        for(uint32_t i = 0; i < nprimitives; ++i, base += per_primitive, indices += indices_per_primitive)
+            _fude_write_primitive_indices(indices, base, renderer->working.mode);
+        renderer->indices.count += indices_per_primitive*nprimitives;
+        renderer->vertices.count += per_primitive*nprimitives;
+        renderer->working.count -= per_primitive*nprimitives;
+        if(renderer->layers.active && nprimitives > 0)
+            _fude_queue_layers(renderer, first_vertex, first_index);
+        return;
+    }
+
+    fude_vertex* vertices = renderer->vertices.data;
+    uint32_t src = base, kept = 0;
+    for(uint32_t first = 0; first < nprimitives; first += 64) {
+        uint32_t count = nprimitives - first < 64 ? nprimitives - first : 64;
+        uint64_t culled = _fude_cull_mask(vertices + src, per_primitive, count,
+                renderer->camera.bounds.min, renderer->camera.bounds.max);
+        for(uint32_t i = 0; i < count; ++i, src += per_primitive) {
+            if(culled >> i & 1) continue;
+            if(base != src)
+                f_memcpy(vertices + base, vertices + src, per_primitive*sizeof(fude_vertex));
+            _fude_write_primitive_indices(indices, base, renderer->working.mode);
+            base += per_primitive;
+            indices += indices_per_primitive;
+            kept += 1;
+        }
+    }
+
+    uint32_t leftover = renderer->working.count - per_primitive*nprimitives;
+    if(base != src && leftover > 0)
+        f_memcpy(vertices + base, vertices + src, leftover*sizeof(fude_vertex));
+    renderer->indices.count += indices_per_primitive*kept;
+    renderer->vertices.count = base;
+    renderer->working.count = leftover;
+    renderer->stats.current.culled_primitives += nprimitives - kept;
+    if(renderer->layers.active && kept > 0)
+        _fude_queue_layers(renderer, first_vertex, first_index);
+}
+
+// flushes what's been committed so far while keeping the current shader,
+// textures and any half-submitted primitive
+void _fude_break_batch(fude* app, fude_batch_break reason)
+{
+    fude_renderer* renderer = &app->renderer;
+    _fude_commit_working(renderer);
+
+    uint32_t carry_count = renderer->working.count;
+    fude_vertex carry[4];
+    f_memcpy(carry, renderer->vertices.data + renderer->vertices.count, carry_count*sizeof(fude_vertex));
+    // meshes, instances and target switches come after the held back layers too
+    if(renderer->layers.active && reason != FUDE_BATCH_BREAK_CAPACITY && reason != FUDE_BATCH_BREAK_TEXTURE &&
+            reason != FUDE_BATCH_BREAK_BLEND)
+        _fude_draw_layer_queue(app, reason);
+    _fude_flush_batch(app, reason);
+    f_memcpy(renderer->vertices.data, carry, carry_count*sizeof(fude_vertex));
+}
+
+void f_end(fude* app)
+{
+    F_PROFILE_BEGIN("f_end");
+    _fude_commit_working(&app->renderer);
+    app->renderer.working.count = 0;
+    F_PROFILE_END();
+}
+
+// room for up to *count quads written straight into the batch with shader and texture in slot,
+// breaking the batch first with the same rules f_begin and f_texture apply. *count is clamped to
+// what fits in an empty batch, the caller writes that many quads and calls _fude_end_quads
+fude_vertex* _fude_begin_quads(fude* app, fude_shader shader, fude_texture texture, uint32_t slot, uint32_t* count)
+{
+    fude_renderer* renderer = &app->renderer;
+    const uint32_t maximum = FUDE_RENDERER_MAXIMUM_VERTICES/4 < FUDE_RENDERER_MAXIMUM_INDICIES/6 ?
+        FUDE_RENDERER_MAXIMUM_VERTICES/4 : FUDE_RENDERER_MAXIMUM_INDICIES/6;
+    if(*count > maximum) *count = maximum;
+
+    fude_texture bound = renderer->textures.data[slot];
+    if(renderer->indices.count > 0 && renderer->shader.id != shader.id)
+        _fude_flush_batch(app, FUDE_BATCH_BREAK_SHADER);
+    else if(bound.id != 0 && bound.id != texture.id && renderer->vertices.count > 0)
+        _fude_flush_batch(app, FUDE_BATCH_BREAK_TEXTURE);
+    else if(renderer->vertices.count + *count*4 > FUDE_RENDERER_MAXIMUM_VERTICES ||
+            renderer->indices.count + *count*6 > FUDE_RENDERER_MAXIMUM_INDICIES)
+        _fude_flush_batch(app, FUDE_BATCH_BREAK_CAPACITY);
+
+    renderer->shader = shader;
+    renderer->textures.data[slot] = texture;
+    renderer->textures.samplers[slot] = slot;
+    renderer->working.mode = FUDE_MODE_QUADS;
+    renderer->working.count = 0;
+    return renderer->vertices.data + renderer->vertices.count;
+}
+
+// count quads were written, they go through the matrix stack, culling and recording like f_end
+void _fude_end_quads(fude* app, uint32_t count)
+{
+    fude_renderer* renderer = &app->renderer;
+    const fude_transform* transform = &renderer->transform.current;
+    fude_vertex* vertices = renderer->vertices.data + renderer->vertices.count;
+    if(renderer->layers.depth != 0.0f) {
+        for(uint32_t i = 0; i < count*4; ++i)
+            vertices[i].position.z += renderer->layers.depth;
+    }
+    if(transform->kind == FUDE_TRANSFORM_TRANSLATION) {
+        const float* m = transform->matrix.elements;
+        for(uint32_t i = 0; i < count*4; ++i) {
+            vertices[i].position.x += m[12];
+            vertices[i].position.y += m[13];
+            vertices[i].position.z += m[14];
+        }
+    } else if(transform->kind == FUDE_TRANSFORM_GENERAL) {
+        const float* m = transform->matrix.elements;
+        for(uint32_t i = 0; i < count*4; ++i) {
+            float x = vertices[i].position.x, y = vertices[i].position.y, z = vertices[i].position.z;
+            vertices[i].position.x = m[0]*x + m[4]*y + m[8]*z + m[12];
+            vertices[i].position.y = m[1]*x + m[5]*y + m[9]*z + m[13];
+            vertices[i].position.z = m[2]*x + m[6]*y + m[10]*z + m[14];
+        }
+    }
+
+    renderer->working.count = count*4;
+    _fude_commit_working(renderer);
+    renderer->working.count = 0;
+}
+
 void f_color4f(fude* app, float r, float g, float b, float a)
 {
     app->renderer.working.vertex.color.r = r;
@@ -126,23 +430,157 @@ void f_color(fude* app, fude_color color)
 
 void f_vertex3f(fude* app, float x, float y, float z)
 {
+    if(app->renderer.vertices.count + app->renderer.working.count >= FUDE_RENDERER_MAXIMUM_VERTICES)
+        _fude_break_batch(app, FUDE_BATCH_BREAK_CAPACITY);
+
+    const fude_transform* transform = &app->renderer.transform.current;
+    if(transform->kind == FUDE_TRANSFORM_TRANSLATION) {
+        x += transform->matrix.elements[12];
+        y += transform->matrix.elements[13];
+        z += transform->matrix.elements[14];
+    } else if(transform->kind == FUDE_TRANSFORM_GENERAL) {
+        const float* m = transform->matrix.elements;
+        float tx = m[0]*x + m[4]*y + m[8]*z + m[12];
+        float ty = m[1]*x + m[5]*y + m[9]*z + m[13];
+        float tz = m[2]*x + m[6]*y + m[10]*z + m[14];
+        x = tx; y = ty; z = tz;
+    }
+
     app->renderer.working.vertex.position.x = x;
     app->renderer.working.vertex.position.y = y;
     app->renderer.working.vertex.position.z = z;
 
-    app->renderer.vertices.data[app->renderer.working.count] = app->renderer.working.vertex;
+    app->renderer.vertices.data[app->renderer.vertices.count + app->renderer.working.count] = app->renderer.working.vertex;
     app->renderer.working.count += 1;
     app->renderer.working.vertex.tex_index = 0;
 }
 
 void f_vertex2f(fude* app, float x, float y)
 {
-    f_vertex3f(app, x, y, 0.0f); // TODO: Make the Z coordinate dynamic
+    f_vertex3f(app, x, y, app->renderer.layers.depth);
+}
+
+// z of f_vertex2f and of every shape, sprite and glyph quad, before the matrix stack. With
+// f_create_camera2d larger is nearer and it has to stay within the camera's -1..1
+void f_set_depth(fude* app, float depth)
+{
+    app->renderer.layers.depth = depth;
+}
+
+// applies to what's submitted from here on. Changing between modes that blend the batch's shader the same
+// way doesn't break it, so the default shader's ALPHA, ADDITIVE and PREMULTIPLIED geometry shares batches
+void f_set_blend_mode(fude* app, fude_blend_mode mode)
+{
+    fude_renderer* renderer = &app->renderer;
+    if(renderer->blend_mode == mode) return;
+    _fude_commit_working(renderer);
+    const fude_blend_mode previous = renderer->blend_mode, batch = _fude_batch_blend(renderer, renderer->shader);
+    renderer->blend_mode = mode;
+    if(renderer->indices.count > 0 && _fude_batch_blend(renderer, renderer->shader) != batch) {
+        renderer->blend_mode = previous;
+        _fude_break_batch(app, FUDE_BATCH_BREAK_BLEND);
+        renderer->blend_mode = mode;
+    }
+}
+
+// matrix stack, applied on the CPU in f_vertex3f so transformed geometry stays in one batch
+void f_push_matrix(fude* app)
+{
+    if(app->renderer.transform.depth >= FUDE_MATRIX_STACK_DEPTH) {
+        f_trace_log(FUDE_LOG_ERROR, "Matrix stack overflow, FUDE_MATRIX_STACK_DEPTH is %d", FUDE_MATRIX_STACK_DEPTH);
+        return;
+    }
+    app->renderer.transform.stack[app->renderer.transform.depth++] = app->renderer.transform.current;
+}
+
+void f_pop_matrix(fude* app)
+{
+    if(app->renderer.transform.depth == 0) {
+        f_trace_log(FUDE_LOG_WARNING, "f_pop_matrix without a matching f_push_matrix");
+        return;
+    }
+    app->renderer.transform.current = app->renderer.transform.stack[--app->renderer.transform.depth];
+}
+
+void f_load_identity(fude* app)
+{
+    app->renderer.transform.current.kind = FUDE_TRANSFORM_IDENTITY;
+}
+
+// the matrix is only valid once the kind is not identity
+static M4f* _fude_current_matrix(fude_transform* transform)
+{
+    if(transform->kind == FUDE_TRANSFORM_IDENTITY)
+        transform->matrix = m4f_identity();
+    return &transform->matrix;
+}
+
+void f_translate(fude* app, float x, float y, float z)
+{
+    fude_transform* transform = &app->renderer.transform.current;
+    float* m = _fude_current_matrix(transform)->elements;
+    if(transform->kind == FUDE_TRANSFORM_GENERAL) {
+        m[12] += m[0]*x + m[4]*y + m[8]*z;
+        m[13] += m[1]*x + m[5]*y + m[9]*z;
+        m[14] += m[2]*x + m[6]*y + m[10]*z;
+        m[15] += m[3]*x + m[7]*y + m[11]*z;
+    } else {
+        m[12] += x;
+        m[13] += y;
+        m[14] += z;
+        transform->kind = FUDE_TRANSFORM_TRANSLATION;
+    }
+}
+
+// angle in degrees around the (x, y, z) axis
+void f_rotate(fude* app, float angle, float x, float y, float z)
+{
+    float length = sqrtf(x*x + y*y + z*z);
+    if(angle == 0.0f || length == 0.0f) return;
+    x /= length; y /= length; z /= length;
+
+    float radians = angle*GM_DEG2RAD_MULTIPLIER;
+    float c = cosf(radians), s = sinf(radians), t = 1.0f - c;
+    M4f rotation = m4f_identity();
+    rotation.elements[0] = x*x*t + c;
+    rotation.elements[1] = y*x*t + z*s;
+    rotation.elements[2] = z*x*t - y*s;
+    rotation.elements[4] = x*y*t - z*s;
+    rotation.elements[5] = y*y*t + c;
+    rotation.elements[6] = z*y*t + x*s;
+    rotation.elements[8] = x*z*t + y*s;
+    rotation.elements[9] = y*z*t - x*s;
+    rotation.elements[10] = z*z*t + c;
+
+    fude_transform* transform = &app->renderer.transform.current;
+    M4f* m = _fude_current_matrix(transform);
+    *m = m4f_dot(*m, rotation);
+    transform->kind = FUDE_TRANSFORM_GENERAL;
+}
+
+void f_scale(fude* app, float x, float y, float z)
+{
+    if(x == 1.0f && y == 1.0f && z == 1.0f) return;
+    fude_transform* transform = &app->renderer.transform.current;
+    float* m = _fude_current_matrix(transform)->elements;
+    for(int i = 0; i < 4; ++i) {
+        m[0 + i] *= x;
+        m[4 + i] *= y;
+        m[8 + i] *= z;
+    }
+    transform->kind = FUDE_TRANSFORM_GENERAL;
 }
 
 void f_texture(fude* app, fude_texture texture, float u, float v, uint32_t index)
 {
-    if(index > FUDE_RENDERER_MAXIMUM_TEXTURES) return;
+    if(index >= FUDE_RENDERER_MAXIMUM_TEXTURES) return;
+
+    // the slot is taken by another texture in the pending batch
+    fude_texture bound = app->renderer.textures.data[index];
+    bool pending = app->renderer.vertices.count > 0 || app->renderer.working.count > 0;
+    if(bound.id != 0 && bound.id != texture.id && pending)
+        _fude_break_batch(app, FUDE_BATCH_BREAK_TEXTURE);
+
     app->renderer.working.vertex.tex_coords.u = u;
     app->renderer.working.vertex.tex_coords.v = v;
     app->renderer.working.vertex.tex_index = index;
@@ -150,33 +588,144 @@ void f_texture(fude* app, fude_texture texture, float u, float v, uint32_t index
     app->renderer.textures.samplers[index] = index;
 }
 
-void f_flush(fude* app)
+void _fude_bind_batch_state(fude_shader shader, const fude_texture* textures, const int* samplers)
 {
-    // sync the data
-    glBindBuffer(GL_ARRAY_BUFFER, app->renderer.vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, app->renderer.vertices.count*sizeof(fude_vertex), 
-            app->renderer.vertices.data);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, app->renderer.indices.count*sizeof(uint32_t), 
-            app->renderer.indices.data);
-
     for(size_t i = 0; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i) {
-        if(app->renderer.textures.data[i].id != 0) {
-            glActiveTexture(GL_TEXTURE0 + app->renderer.textures.samplers[i]);
-            glBindTexture(GL_TEXTURE_2D, app->renderer.textures.data[i].id);
+        if(textures[i].id != 0) {
+            glActiveTexture(GL_TEXTURE0 + samplers[i]);
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
     }
 
-    f_set_shader_uniform(app->renderer.shader, 
-            app->renderer.shader.uniform_loc[FUDE_UNIFORM_TEXTURE_SAMPLERS_LOC],
-            FUDE_SHADERDT_INT, FUDE_RENDERER_MAXIMUM_TEXTURES, 
-            app->renderer.textures.samplers, false);
+    _fude_upload_shader_uniform(shader, shader.uniform_loc[FUDE_UNIFORM_TEXTURE_SAMPLERS_LOC],
+            FUDE_SHADERDT_INT, FUDE_RENDERER_MAXIMUM_TEXTURES, samplers, false);
+    glUseProgram(shader.id);
+}
 
-    // make draw call
-    glUseProgram(app->renderer.shader.id);
-    glBindVertexArray(app->renderer.id);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
-    glDrawElements(GL_TRIANGLES, app->renderer.indices.count, GL_UNSIGNED_INT, NULL);
+// GL_LEQUAL so coplanar geometry drawn later still wins like it does without the depth test.
+// The depth mask goes back on with the test off, glClear respects it
+void _fude_set_depth_mode_gl(fude_depth_mode mode)
+{
+    if(mode == FUDE_DEPTH_OFF) {
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        return;
+    }
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(mode == FUDE_DEPTH_OPAQUE ? GL_TRUE : GL_FALSE);
+}
+
+// what a batch of shader's immediate geometry blends with. The default shader's ADDITIVE and
+// PREMULTIPLIED vertices were made to blend like ALPHA ones by _fude_commit_working
+fude_blend_mode _fude_batch_blend(const fude_renderer* renderer, fude_shader shader)
+{
+    fude_blend_mode mode = renderer->blend_mode;
+    if(shader.id == renderer->default_shader.id && (mode == FUDE_BLEND_ADDITIVE || mode == FUDE_BLEND_PREMULTIPLIED))
+        return FUDE_BLEND_ALPHA;
+    return mode;
+}
+
+// the default shader writes premultiplied color. Other shaders are taken to write straight alpha unless
+// they sample a FUDE_TEXTURE_PREMULTIPLIED texture, whose texels would get multiplied by alpha twice
+bool _fude_shader_premultiplied(const fude_renderer* renderer, fude_shader shader, const fude_texture* textures)
+{
+    if(shader.id == renderer->default_shader.id) return true;
+    for(uint32_t i = 0; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i) {
+        if(textures[i].flags & FUDE_TEXTURE_PREMULTIPLIED) return true;
+    }
+    return false;
+}
+
+// premultiplied is _fude_shader_premultiplied's, other shaders write straight alpha unless they're
+// drawn with FUDE_BLEND_PREMULTIPLIED
+void _fude_set_blend_mode_gl(fude_blend_mode mode, bool premultiplied)
+{
+    if(mode == FUDE_BLEND_OPAQUE) {
+        glDisable(GL_BLEND);
+        return;
+    }
+    glEnable(GL_BLEND);
+    switch(mode) {
+    case FUDE_BLEND_ADDITIVE:
+        glBlendFunc(premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE);
+        break;
+    case FUDE_BLEND_MULTIPLY:
+        glBlendFunc(GL_DST_COLOR, premultiplied ? GL_ONE_MINUS_SRC_ALPHA : GL_ZERO);
+        break;
+    case FUDE_BLEND_PREMULTIPLIED:
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    default:
+        glBlendFunc(premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    }
+}
+
+// only slots whose texture differs from the previous draw's this frame, the others stay bound
+void _fude_count_texture_binds(fude_renderer* renderer, const fude_texture* textures)
+{
+    for(uint32_t i = 0; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i) {
+        if(textures[i].id == 0 || textures[i].id == renderer->stats.last_textures[i]) continue;
+        renderer->stats.current.texture_binds += 1;
+        renderer->stats.last_textures[i] = textures[i].id;
+    }
+}
+
+static void _fude_count_batch(fude_renderer* renderer, fude_batch_break reason)
+{
+    fude_render_stats* stats = &renderer->stats.current;
+    stats->batches += 1;
+    stats->draw_calls += 1;
+    stats->batch_breaks[reason] += 1;
+    stats->vertices += renderer->vertices.count;
+    stats->indices += renderer->indices.count;
+    stats->bytes_uploaded += renderer->vertices.count*sizeof(fude_vertex) + renderer->indices.count*sizeof(uint32_t);
+    stats->uniform_uploads += 1; // the sampler array _fude_bind_batch_state sets
+    _fude_count_texture_binds(renderer, renderer->textures.data);
+    if(renderer->shader.id != renderer->stats.last_program) {
+        stats->program_switches += 1;
+        renderer->stats.last_program = renderer->shader.id;
+    }
+}
+
+static void _fude_flush_batch(fude* app, fude_batch_break reason)
+{
+    if(app->renderer.indices.count == 0) return;
+    _fude_count_batch(&app->renderer, reason);
+
+    if(app->render_thread) {
+        // the render thread owns the context, hand the batch over instead
+        _fude_record_flush(app);
+    } else if(app->software) {
+        _fude_software_draw(app);
+    } else {
+        _fude_gpu_timer_begin_pass(&app->renderer.gpu_timer, FUDE_GPU_PASS_FLUSH);
+
+        // sync the data
+        glBindBuffer(GL_ARRAY_BUFFER, app->renderer.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, app->renderer.vertices.count*sizeof(fude_vertex), 
+                app->renderer.vertices.data);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, app->renderer.indices.count*sizeof(uint32_t), 
+                app->renderer.indices.data);
+
+        _fude_bind_batch_state(app->renderer.shader, app->renderer.textures.data,
+                app->renderer.textures.samplers);
+
+        // make draw call
+        glBindVertexArray(app->renderer.id);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
+        _fude_set_blend_mode_gl(_fude_batch_blend(&app->renderer, app->renderer.shader),
+                _fude_shader_premultiplied(&app->renderer, app->renderer.shader, app->renderer.textures.data));
+        if(app->renderer.layers.mode != FUDE_DEPTH_OFF)
+            _fude_set_depth_mode_gl(app->renderer.layers.mode);
+        glDrawElements(GL_TRIANGLES, app->renderer.indices.count, GL_UNSIGNED_INT, NULL);
+        if(app->renderer.layers.mode != FUDE_DEPTH_OFF)
+            _fude_set_depth_mode_gl(FUDE_DEPTH_OFF);
+
+        _fude_gpu_timer_end_pass(&app->renderer.gpu_timer);
+    }
 
     // clear the data
     f_memzero(app->renderer.vertices.data, sizeof(fude_vertex)*app->renderer.vertices.count);
@@ -184,18 +733,41 @@ void f_flush(fude* app)
 
     app->renderer.vertices.count = 0;
     app->renderer.indices.count = 0;
-    app->renderer.shader = app->renderer.default_shader;
+}
 
+void f_flush(fude* app)
+{
+    F_PROFILE_BEGIN("f_flush");
+    if(app->renderer.layers.active)
+        _fude_draw_layer_queue(app, FUDE_BATCH_BREAK_FLUSH);
+    _fude_flush_batch(app, FUDE_BATCH_BREAK_FLUSH);
+
+    app->renderer.shader = app->renderer.default_shader;
     for(uint32_t i = 0; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i)
         app->renderer.textures.data[i] = app->renderer.default_texture;
+    F_PROFILE_END();
 }
 
-fude_result f_create_shader(fude_shader* shader, const char* vert_src, const char* frag_src)
+fude_result _fude_create_default_shader(fude* app)
 {
-    if(!shader) return FUDE_INVALID_ARGUMENTS_ERROR;
-    if(!vert_src) return FUDE_INVALID_ARGUMENTS_ERROR;
-    if(!frag_src) return FUDE_INVALID_ARGUMENTS_ERROR;
+    fude_shader* shader = &app->renderer.default_shader;
+    fude_result result = f_create_shader(app, shader, FUDE_DEFAULT_VERTEX_SHADER, FUDE_DEFAULT_FRAGMENT_SHADER);
+    if(result != FUDE_OK) return result;
+    M4f identity = m4f_identity();
+    _fude_push_shader_uniform(app, *shader, shader->uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC],
+            FUDE_SHADERDT_MAT4, 1, identity.elements, false);
+    app->renderer.shader = *shader;
+    return result;
+}
 
+fude_shader f_get_default_shader(fude* app)
+{
+    return app->renderer.default_shader;
+}
+
+// GL only, for programs that don't follow the u_texture_samplers/u_mvp convention f_create_shader expects
+fude_result _fude_link_program(uint32_t* program, const char* vert_src, const char* frag_src)
+{
     uint32_t vert_module, frag_module;
     GLchar info_log[512] = {0};
     int success;
@@ -219,50 +791,64 @@ fude_result f_create_shader(fude_shader* shader, const char* vert_src, const cha
         return FUDE_SHADER_CREATION_ERROR;
     }
 
-    shader->id = glCreateProgram();
-    glAttachShader(shader->id, vert_module);
-    glAttachShader(shader->id, frag_module);
-    glLinkProgram(shader->id);
-    glGetProgramiv(shader->id, GL_LINK_STATUS, &success);
+    *program = glCreateProgram();
+    glAttachShader(*program, vert_module);
+    glAttachShader(*program, frag_module);
+    glLinkProgram(*program);
+    glGetProgramiv(*program, GL_LINK_STATUS, &success);
     if(!success) {
-        glGetProgramInfoLog(shader->id, sizeof(info_log), NULL, info_log);
+        glGetProgramInfoLog(*program, sizeof(info_log), NULL, info_log);
         f_trace_log(FUDE_LOG_ERROR, "SHADER PROGRAM: %s\n", info_log);
         return FUDE_SHADER_CREATION_ERROR;
     }
 
     glDeleteShader(vert_module);
     glDeleteShader(frag_module);
+    return FUDE_OK;
+}
 
-    glUseProgram(shader->id);
+fude_result f_create_shader(fude* app, fude_shader* shader, const char* vert_src, const char* frag_src)
+{
+    F_PROFILE_SCOPE("f_create_shader");
+    if(!app || !shader) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(!vert_src) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(!frag_src) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(app->software) return _fude_software_create_shader(app, shader);
 
-    fude_result result = FUDE_OK;
+    fude_result result = _fude_link_program(&shader->id, vert_src, frag_src);
+    if(result != FUDE_OK) return result;
 
-    result = f_get_shader_uniform_location(*shader, &shader->uniform_loc[FUDE_UNIFORM_TEXTURE_SAMPLERS_LOC],
+    glUseProgram(shader->id);
+
+    result = f_get_shader_uniform_location(app, *shader, &shader->uniform_loc[FUDE_UNIFORM_TEXTURE_SAMPLERS_LOC],
                 FUDE_TEXTURE_SAMPLER_UNIFORM_NAME);
     if(result != FUDE_OK) {
         return result;
     }
 
-    result = f_get_shader_uniform_location(*shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC],
+    result = f_get_shader_uniform_location(app, *shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC],
                 FUDE_MATRIX_MVP_UNIFORM_NAME);
     if(result != FUDE_OK) {
         return result;
     }
+    // GL starts uniforms at zero, the software backend and _fude_shader_mvp start u_mvp at the identity
+    M4f identity = m4f_identity();
+    glUniformMatrix4fv(shader->uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC], 1, GL_FALSE, identity.elements);
 
 #if FUDE_SHADER_RETRIEVE_ALL_LOCATIONS
-    result = f_get_shader_uniform_location(*shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_PROJECTION_LOC],
+    result = f_get_shader_uniform_location(app, *shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_PROJECTION_LOC],
                 FUDE_MATRIX_PROJECTION_UNIFORM_NAME);
     if(result != FUDE_OK) {
         return result;
     }
 
-    result = f_get_shader_uniform_location(*shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_VIEW_LOC],
+    result = f_get_shader_uniform_location(app, *shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_VIEW_LOC],
                 FUDE_MATRIX_VIEW_UNIFORM_NAME);
     if(result != FUDE_OK) {
         return result;
     }
 
-    result = f_get_shader_uniform_location(*shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_MODEL_LOC],
+    result = f_get_shader_uniform_location(app, *shader, &shader->uniform_loc[FUDE_UNIFORM_MATRIX_MODEL_LOC],
                 FUDE_MATRIX_MODEL_UNIFORM_NAME);
     if(result != FUDE_OK) {
         return result;
@@ -273,40 +859,148 @@ fude_result f_create_shader(fude_shader* shader, const char* vert_src, const cha
     return FUDE_OK;
 }
 
-fude_result f_create_texture(fude_texture* texture, const void* data, int width, int height, int channels)
+// textures hold premultiplied color, RGBA data with any alpha below 255 is converted into a copy the
+// caller frees. NULL when the data can go up as it is
+static uint8_t* _fude_premultiply_texels(const void* data, int width, int height, int channels)
+{
+    if(channels != 4 || !data) return NULL;
+    const uint8_t* src = (const uint8_t*)data;
+    const size_t count = (size_t)width*height;
+    size_t first = 0;
+    while(first < count && src[first*4 + 3] == 255)
+        first += 1;
+    if(first == count) return NULL;
+
+    uint8_t* texels = f_malloc(count*4);
+    f_expect(texels != NULL, "Failed to allocate %zu texels to premultiply at %s (%d)", count, __FILE__, __LINE__);
+    f_memcpy(texels, src, first*4);
+    for(size_t i = first; i < count; ++i) {
+        const uint32_t a = src[i*4 + 3];
+        texels[i*4 + 0] = (uint8_t)((src[i*4 + 0]*a + 127)/255);
+        texels[i*4 + 1] = (uint8_t)((src[i*4 + 1]*a + 127)/255);
+        texels[i*4 + 2] = (uint8_t)((src[i*4 + 2]*a + 127)/255);
+        texels[i*4 + 3] = (uint8_t)a;
+    }
+    return texels;
+}
+
+// FUDE_TEXTURE_OPAQUE lets f_begin_layers draw the texture's sprites as opaque geometry,
+// FUDE_TEXTURE_PREMULTIPLIED is everything _fude_premultiply_texels converts
+static uint32_t _fude_texture_flags(const void* data, int width, int height, int channels)
 {
-    if(!texture) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(!data || channels == 1) return 0;
+    if(channels == 3) return FUDE_TEXTURE_OPAQUE;
+    const uint8_t* texels = (const uint8_t*)data;
+    size_t i = 0, count = (size_t)width*height;
+    while(i < count && texels[i*4 + 3] == 255)
+        i += 1;
+    return i == count ? FUDE_TEXTURE_OPAQUE : FUDE_TEXTURE_PREMULTIPLIED;
+}
+
+fude_result f_create_texture(fude* app, fude_texture* texture, const void* data, int width, int height, int channels)
+{
+    F_PROFILE_SCOPE("f_create_texture");
+    if(!app || !texture) return FUDE_INVALID_ARGUMENTS_ERROR;
+
+    texture->flags = _fude_texture_flags(data, width, height, channels);
+    uint8_t* premultiplied = texture->flags & FUDE_TEXTURE_OPAQUE ? NULL :
+        _fude_premultiply_texels(data, width, height, channels);
+    if(premultiplied) data = premultiplied;
+
+    if(app->software) {
+        fude_result result = _fude_software_create_texture(app, texture, data, width, height, channels);
+        if(premultiplied) f_free(premultiplied);
+        return result;
+    }
     glGenTextures(1, &texture->id);
     glBindTexture(GL_TEXTURE_2D, texture->id);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    GLenum internal_format = GL_RGBA8;
-    GLenum data_format = channels == 4 ? GL_RGBA : GL_RGB;
+    GLenum internal_format = channels == 1 ? GL_R8 : GL_RGBA8;
+    GLenum data_format = channels == 4 ? GL_RGBA : (channels == 1 ? GL_RED : GL_RGB);
+    if(channels == 1) {
+        // single channel textures read as premultiplied white with the value in alpha, like the software backend
+        GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_RED };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    }
     glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, 
             height, 0, data_format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glGenerateMipmap(GL_TEXTURE_2D);
+    if(premultiplied) f_free(premultiplied);
     return FUDE_OK;
 }
 
-void f_destroy_texture_(fude_texture texture)
+// single channel, linearly filtered without mipmaps so it can be updated a few rows at a time
+fude_result _fude_create_distance_field_texture(fude* app, fude_texture* texture, int width, int height)
 {
-    glDeleteTextures(1, &texture.id);
+    fude_result result = f_create_texture(app, texture, NULL, width, height, 1);
+    if(result != FUDE_OK) return result;
+    // the software rasterizer filters glyphs bilinearly whatever the texture
+    if(app->software) return FUDE_OK;
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return FUDE_OK;
 }
 
-void f_update_texture(fude_texture texture, const void* data, int width, int height, int channels)
+// rows [y, y + rows) of a texture that's width texels wide, pixels points at row y
+void _fude_update_texture_rows(fude* app, fude_texture texture, const void* pixels, int width, int y, int rows,
+        int channels)
 {
-    GLenum data_format = channels == 4 ? GL_RGBA : GL_RGB;
+    if(app->software) {
+        _fude_software_update_texture_rows(app, texture, pixels, width, y, rows, channels);
+        return;
+    }
+    GLenum data_format = channels == 4 ? GL_RGBA : (channels == 1 ? GL_RED : GL_RGB);
     glBindTexture(GL_TEXTURE_2D, texture.id);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)width, (GLsizei)height, data_format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, (GLsizei)width, (GLsizei)rows, data_format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void f_destroy_texture(fude* app, fude_texture texture)
+{
+    if(!app) return;
+    if(app->software) {
+        _fude_software_destroy_texture(app, texture);
+        return;
+    }
+    glDeleteTextures(1, &texture.id);
+}
+
+// the new texels decide FUDE_TEXTURE_OPAQUE again, sprites submitted before keep the flag they were drawn with
+void f_update_texture(fude* app, fude_texture* texture, const void* data, int width, int height, int channels)
+{
+    if(!app || !texture) return;
+    F_PROFILE_BEGIN("f_update_texture");
+    texture->flags = _fude_texture_flags(data, width, height, channels);
+    uint8_t* premultiplied = texture->flags & FUDE_TEXTURE_OPAQUE ? NULL :
+        _fude_premultiply_texels(data, width, height, channels);
+    if(premultiplied) data = premultiplied;
+    if(app->software) {
+        _fude_software_update_texture(app, *texture, data, width, height, channels);
+    } else {
+        GLenum data_format = channels == 4 ? GL_RGBA : (channels == 1 ? GL_RED : GL_RGB);
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        if(channels == 1) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)width, (GLsizei)height, data_format, GL_UNSIGNED_BYTE, data);
+        if(channels == 1) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    if(premultiplied) f_free(premultiplied);
+    F_PROFILE_END();
 }
 
-fude_result f_create_shader_from_file(fude_shader* shader, const char* vert_path, const char* frag_path)
+fude_result f_create_shader_from_file(fude* app, fude_shader* shader, const char* vert_path, const char* frag_path)
 {
     char* vert_src = f_load_file_data(vert_path, NULL);
     char* frag_src = f_load_file_data(frag_path, NULL);
-    fude_result result = f_create_shader(shader, vert_src, frag_src);
+    fude_result result = f_create_shader(app, shader, vert_src, frag_src);
 
     if(result != FUDE_OK) {
         return result;
@@ -317,14 +1011,21 @@ fude_result f_create_shader_from_file(fude_shader* shader, const char* vert_path
     return FUDE_OK;
 }
 
-void f_destroy_shader(fude_shader shader)
+void f_destroy_shader(fude* app, fude_shader shader)
 {
+    if(!app || app->software) return; // software shaders only hold a matrix
     glDeleteProgram(shader.id);
 }
 
-fude_result f_get_shader_uniform_location(fude_shader shader, int* location, const char* name)
+fude_result f_get_shader_uniform_location(fude* app, fude_shader shader, int* location, const char* name)
 {
-    if(!location || !name) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(!app || !location || !name) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(app->software) {
+        // the software pipeline only knows the default shader's u_mvp
+        if(strcmp(name, "u_mvp") != 0) return FUDE_UNIFORM_LOCATION_NOT_FOUND_ERROR;
+        *location = shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC];
+        return FUDE_OK;
+    }
 
     glUseProgram(shader.id);
     int _location = glGetUniformLocation(shader.id, name);
@@ -332,13 +1033,13 @@ fude_result f_get_shader_uniform_location(fude_shader shader, int* location, con
         f_trace_log(FUDE_LOG_ERROR, "Uniform with name %s not found in shader program", name);
         return FUDE_UNIFORM_LOCATION_NOT_FOUND_ERROR;
     }
+    *location = _location;
     return FUDE_OK;
 }
 
-fude_result f_set_shader_uniform(fude_shader shader, int location, int type, int count, const void* data, bool transponse)
+// the GL upload itself, on whichever thread has the context current
+void _fude_upload_shader_uniform(fude_shader shader, int location, int type, int count, const void* data, bool transponse)
 {
-    if(!data) return FUDE_INVALID_ARGUMENTS_ERROR;
-
     glUseProgram(shader.id);
     switch(type) {
         case FUDE_SHADERDT_FLOAT: glUniform1fv(location, count, (float*)data); break;
@@ -351,5 +1052,876 @@ fude_result f_set_shader_uniform(fude_shader shader, int location, int type, int
         case FUDE_SHADERDT_IVEC4: glUniform4iv(location, count, (int*)data); break;
         case FUDE_SHADERDT_MAT4: glUniformMatrix4fv(location, count, transponse, (float*)data); break;
     }
+}
+
+static M4f _fude_shader_mvp(const fude_renderer* renderer, uint32_t shader)
+{
+    for(uint32_t i = 0; i < renderer->mvps.count; ++i) {
+        if(renderer->mvps.data[i].shader == shader) return renderer->mvps.data[i].matrix;
+    }
+    return m4f_identity();
+}
+
+static void _fude_set_shader_mvp(fude_renderer* renderer, uint32_t shader, M4f matrix)
+{
+    for(uint32_t i = 0; i < renderer->mvps.count; ++i) {
+        if(renderer->mvps.data[i].shader != shader) continue;
+        renderer->mvps.data[i].matrix = matrix;
+        return;
+    }
+    renderer->mvps.data = _fude_grow_array(renderer->mvps.data, renderer->mvps.count, &renderer->mvps.capacity,
+            renderer->mvps.count + 1, sizeof(fude_shader_mvp));
+    renderer->mvps.data[renderer->mvps.count++] = (fude_shader_mvp){ .shader = shader, .matrix = matrix };
+}
+
+// with a render thread the upload is recorded in order with the draws, the GL state is its to touch
+void _fude_push_shader_uniform(fude* app, fude_shader shader, int location, int type, int count, const void* data,
+        bool transpose)
+{
+    app->renderer.stats.current.uniform_uploads += 1;
+    if(app->software)
+        _fude_software_set_shader_uniform(app, shader, location, type, data, transpose);
+    else if(app->render_thread)
+        _fude_record_uniform(app, shader, location, type, count, data, transpose);
+    else
+        _fude_upload_shader_uniform(shader, location, type, count, data, transpose);
+}
+
+// pending geometry of this shader was submitted for the old value
+fude_result f_set_shader_uniform(fude* app, fude_shader shader, int location, int type, int count, const void* data,
+        bool transpose)
+{
+    if(!app || !data || count <= 0 || type < FUDE_SHADERDT_FLOAT || type > FUDE_SHADERDT_MAT4)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+
+    if(app->renderer.layers.active)
+        _fude_draw_layer_queue(app, FUDE_BATCH_BREAK_UNIFORM);
+    if(app->renderer.shader.id == shader.id)
+        _fude_flush_batch(app, FUDE_BATCH_BREAK_UNIFORM);
+    if(location >= 0 && location == shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC] && type == FUDE_SHADERDT_MAT4) {
+        M4f matrix;
+        f_memcpy(matrix.elements, data, sizeof(matrix.elements));
+        _fude_set_shader_mvp(&app->renderer, shader.id, transpose ? m4f_transpose(matrix) : matrix);
+    }
+    _fude_push_shader_uniform(app, shader, location, type, count, data, transpose);
+    return FUDE_OK;
+}
+
+//======================================================================
+// Cameras
+//======================================================================
+// versions are global so two cameras never share one
+static _Atomic uint64_t _fude_camera_versions = 0;
+
+static void _fude_init_camera(fude_camera* camera, fude_camera_type type)
+{
+    f_memzero(camera, sizeof(fude_camera));
+    camera->type = type;
+    camera->up = (V3f){ .x = 0.0f, .y = 1.0f, .z = 0.0f };
+    camera->zoom = 1.0f;
+    camera->dirty = true;
+}
+
+fude_result f_create_camera2d(fude_camera* camera, uint32_t width, uint32_t height)
+{
+    if(!camera || width == 0 || height == 0) return FUDE_INVALID_ARGUMENTS_ERROR;
+    _fude_init_camera(camera, FUDE_CAMERA_2D);
+    camera->near = -1.0f;
+    camera->far = 1.0f;
+    camera->width = width;
+    camera->height = height;
+    f_update_camera(camera);
     return FUDE_OK;
 }
+
+// looks from (0, 0, 10) at the origin, the aspect ratio comes from f_set_camera_viewport
+fude_result f_create_camera3d(fude_camera* camera)
+{
+    if(!camera) return FUDE_INVALID_ARGUMENTS_ERROR;
+    _fude_init_camera(camera, FUDE_CAMERA_3D);
+    camera->position = (V3f){ .x = 0.0f, .y = 0.0f, .z = 10.0f };
+    camera->fov = 45.0f;
+    camera->near = 0.1f;
+    camera->far = 1000.0f;
+    camera->width = 1;
+    camera->height = 1;
+    f_update_camera(camera);
+    return FUDE_OK;
+}
+
+void f_set_camera_position(fude_camera* camera, float x, float y, float z)
+{
+    if(camera->position.x == x && camera->position.y == y && camera->position.z == z) return;
+    camera->position = (V3f){ .x = x, .y = y, .z = z };
+    camera->dirty = true;
+}
+
+void f_set_camera_target(fude_camera* camera, float x, float y, float z)
+{
+    if(camera->target.x == x && camera->target.y == y && camera->target.z == z) return;
+    camera->target = (V3f){ .x = x, .y = y, .z = z };
+    camera->dirty = true;
+}
+
+void f_set_camera_zoom(fude_camera* camera, float zoom)
+{
+    if(camera->zoom == zoom || zoom <= 0.0f) return;
+    camera->zoom = zoom;
+    camera->dirty = true;
+}
+
+void f_set_camera_rotation(fude_camera* camera, float degrees)
+{
+    if(camera->rotation == degrees) return;
+    camera->rotation = degrees;
+    camera->dirty = true;
+}
+
+void f_set_camera_viewport(fude_camera* camera, uint32_t width, uint32_t height)
+{
+    if((camera->width == width && camera->height == height) || width == 0 || height == 0) return;
+    camera->width = width;
+    camera->height = height;
+    camera->dirty = true;
+}
+
+static M4f _fude_roll(float degrees)
+{
+    M4f res = m4f_identity();
+    float radians = degrees*GM_DEG2RAD_MULTIPLIER;
+    float c = cosf(radians), s = sinf(radians);
+    res.elements[0] = c;
+    res.elements[1] = s;
+    res.elements[4] = -s;
+    res.elements[5] = c;
+    return res;
+}
+
+static M4f _fude_look_at(V3f eye, V3f target, V3f up)
+{
+    V3f f = v3f_normalize(v3f_sub(target, eye));
+    V3f s = v3f_normalize(v3f_cross(f, up));
+    V3f u = v3f_cross(s, f);
+    M4f res = m4f_identity();
+    res.elements[0] = s.x; res.elements[4] = s.y; res.elements[8] = s.z;
+    res.elements[1] = u.x; res.elements[5] = u.y; res.elements[9] = u.z;
+    res.elements[2] = -f.x; res.elements[6] = -f.y; res.elements[10] = -f.z;
+    res.elements[12] = -v3f_dot(s, eye);
+    res.elements[13] = -v3f_dot(u, eye);
+    res.elements[14] = v3f_dot(f, eye);
+    return res;
+}
+
+// true when the cached matrices were recomputed
+bool f_update_camera(fude_camera* camera)
+{
+    if(!camera->dirty) return false;
+
+    float width = (float)camera->width, height = (float)camera->height;
+    if(camera->type == FUDE_CAMERA_2D) {
+        // screen space with y down like m4f_ortho(0, w, h, 0), zoom and rotation pivot on the viewport center
+        camera->projection_matrix = m4f_ortho(0.0f, width, height, 0.0f, camera->near, camera->far);
+        M4f view = m4f_identity();
+        view.elements[12] = width*0.5f;
+        view.elements[13] = height*0.5f;
+        view = m4f_dot(view, _fude_roll(camera->rotation));
+        M4f zoom = m4f_identity();
+        zoom.elements[0] = camera->zoom;
+        zoom.elements[5] = camera->zoom;
+        view = m4f_dot(view, zoom);
+        M4f origin = m4f_identity();
+        origin.elements[12] = -camera->position.x - width*0.5f;
+        origin.elements[13] = -camera->position.y - height*0.5f;
+        camera->view_matrix = m4f_dot(view, origin);
+    } else {
+        float fov = 2.0f*atanf(tanf(camera->fov*GM_DEG2RAD_MULTIPLIER*0.5f)/camera->zoom);
+        camera->projection_matrix = m4f_perspective(fov, width/height, camera->near, camera->far);
+        camera->view_matrix = m4f_dot(_fude_roll(camera->rotation),
+                _fude_look_at(camera->position, camera->target, camera->up));
+    }
+    camera->view_projection = m4f_dot(camera->projection_matrix, camera->view_matrix);
+    camera->inverse_view_projection = m4f_inverse(camera->view_projection);
+
+    // the clip-space cube's corners in world space
+    V4f corners[8];
+    for(int i = 0; i < 8; ++i)
+        corners[i] = v4f(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+    m4f_mul_v4f_batch(&camera->inverse_view_projection, corners, corners, 8);
+    for(int i = 0; i < 8; ++i) {
+        V3f p = { .x = corners[i].x/corners[i].w, .y = corners[i].y/corners[i].w, .z = corners[i].z/corners[i].w };
+        if(i == 0 || p.x < camera->bounds.min.x) camera->bounds.min.x = p.x;
+        if(i == 0 || p.y < camera->bounds.min.y) camera->bounds.min.y = p.y;
+        if(i == 0 || p.z < camera->bounds.min.z) camera->bounds.min.z = p.z;
+        if(i == 0 || p.x > camera->bounds.max.x) camera->bounds.max.x = p.x;
+        if(i == 0 || p.y > camera->bounds.max.y) camera->bounds.max.y = p.y;
+        if(i == 0 || p.z > camera->bounds.max.z) camera->bounds.max.z = p.z;
+    }
+
+    camera->version = atomic_fetch_add(&_fude_camera_versions, 1) + 1;
+    camera->dirty = false;
+    return true;
+}
+
+// uploads the view-projection as the shader's u_mvp, only when it actually changed
+void f_use_camera(fude* app, fude_camera* camera, fude_shader shader)
+{
+    fude_renderer* renderer = &app->renderer;
+    f_update_camera(camera);
+    renderer->camera.active = true;
+    renderer->camera.bounds.min = camera->bounds.min;
+    renderer->camera.bounds.max = camera->bounds.max;
+    if(renderer->camera.shader == shader.id && renderer->camera.version == camera->version) return;
+
+    // world units per pixel along x, shapes grow their quads by that much for the antialiased edge
+    renderer->camera.pixel_size = 0.0f;
+    if(camera->type == FUDE_CAMERA_2D) {
+        const float* m = camera->view_projection.elements;
+        float x = m[0]*(float)camera->width*0.5f, y = m[1]*(float)camera->height*0.5f;
+        float pixels = sqrtf(x*x + y*y);
+        renderer->camera.pixel_size = pixels > 0.0f ? 1.0f/pixels : 0.0f;
+    }
+
+    // pending geometry of this shader was submitted for the old matrix
+    if(renderer->layers.active)
+        _fude_draw_layer_queue(app, FUDE_BATCH_BREAK_CAMERA);
+    if(renderer->shader.id == shader.id)
+        _fude_flush_batch(app, FUDE_BATCH_BREAK_CAMERA);
+
+    _fude_push_shader_uniform(app, shader, shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC], FUDE_SHADERDT_MAT4, 1,
+            camera->view_projection.elements, false);
+    _fude_set_shader_mvp(renderer, shader.id, camera->view_projection);
+    renderer->camera.shader = shader.id;
+    renderer->camera.version = camera->version;
+    renderer->camera.view_projection = camera->view_projection;
+}
+
+//======================================================================
+// Meshes
+//======================================================================
+static void _fude_mesh_bounds(fude_mesh* mesh, const fude_vertex* vertices, uint32_t vertex_count)
+{
+    mesh->bounds.min = vertices[0].position;
+    mesh->bounds.max = vertices[0].position;
+    for(uint32_t i = 1; i < vertex_count; ++i) {
+        V3f p = vertices[i].position;
+        if(p.x < mesh->bounds.min.x) mesh->bounds.min.x = p.x;
+        if(p.y < mesh->bounds.min.y) mesh->bounds.min.y = p.y;
+        if(p.z < mesh->bounds.min.z) mesh->bounds.min.z = p.z;
+        if(p.x > mesh->bounds.max.x) mesh->bounds.max.x = p.x;
+        if(p.y > mesh->bounds.max.y) mesh->bounds.max.y = p.y;
+        if(p.z > mesh->bounds.max.z) mesh->bounds.max.z = p.z;
+    }
+}
+
+fude_result f_create_mesh(fude* app, fude_mesh* mesh, const fude_vertex* vertices, uint32_t vertex_count,
+        const uint32_t* indices, uint32_t index_count)
+{
+    F_PROFILE_SCOPE("f_create_mesh");
+    if(!app || !mesh) return FUDE_INVALID_ARGUMENTS_ERROR;
+    f_memzero(mesh, sizeof(fude_mesh));
+    fude_result result = f_update_mesh(app, mesh, vertices, vertex_count, indices, index_count);
+    if(result != FUDE_OK)
+        f_destroy_mesh(app, mesh);
+    return result;
+}
+
+// re-specifies the whole storage, so draws still in flight keep the old contents. With a render thread
+// draws recorded this frame only name the buffers, the contents go into new ones instead
+fude_result f_update_mesh(fude* app, fude_mesh* mesh, const fude_vertex* vertices, uint32_t vertex_count,
+        const uint32_t* indices, uint32_t index_count)
+{
+    if(!app || !mesh || !vertices || !indices || vertex_count == 0 || index_count == 0 || index_count % 3 != 0)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+    for(uint32_t i = 0; i < index_count; ++i) {
+        if(indices[i] >= vertex_count) return FUDE_INVALID_ARGUMENTS_ERROR;
+    }
+
+    mesh->vertex_count = vertex_count;
+    mesh->index_count = index_count;
+    _fude_mesh_bounds(mesh, vertices, vertex_count);
+    if(app->software) return _fude_software_update_mesh(app, mesh, vertices, indices);
+
+    if(mesh->vbo && app->render_thread) {
+        _fude_record_delete_buffers(app, mesh->vbo, mesh->ibo);
+        mesh->vbo = 0;
+        mesh->ibo = 0;
+    }
+    if(!mesh->vbo) {
+        glGenBuffers(1, &mesh->vbo);
+        glGenBuffers(1, &mesh->ibo);
+    }
+    // GL_COPY_WRITE_BUFFER leaves the element binding of the bound VAO alone
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count*sizeof(fude_vertex), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mesh->ibo);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_count*sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    return FUDE_OK;
+}
+
+void f_destroy_mesh(fude* app, fude_mesh* mesh)
+{
+    if(!app || !mesh) return;
+    if(app->software) {
+        _fude_software_destroy_mesh(app, mesh);
+    } else if(app->render_thread) {
+        _fude_record_delete_buffers(app, mesh->vbo, mesh->ibo);
+    } else {
+        if(mesh->vbo) glDeleteBuffers(1, &mesh->vbo);
+        if(mesh->ibo) glDeleteBuffers(1, &mesh->ibo);
+    }
+    f_memzero(mesh, sizeof(fude_mesh));
+}
+
+// mesh vertices never go through _fude_commit_working, so the mode applies as it is
+void _fude_draw_mesh_gl(fude_renderer* renderer, uint32_t vbo, uint32_t ibo, uint32_t index_count,
+        fude_shader shader, const fude_texture* textures, fude_blend_mode blend)
+{
+    static const int samplers[FUDE_RENDERER_MAXIMUM_TEXTURES] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    _fude_gpu_timer_begin_pass(&renderer->gpu_timer, FUDE_GPU_PASS_FLUSH);
+    _fude_bind_batch_state(shader, textures, samplers);
+    glBindVertexArray(renderer->mesh_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    _fude_vertex_layout();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    _fude_set_blend_mode_gl(blend, _fude_shader_premultiplied(renderer, shader, textures));
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, NULL);
+    _fude_gpu_timer_end_pass(&renderer->gpu_timer);
+}
+
+// transformed bounding box against the camera's bounds
+static bool _fude_box_visible(const fude_renderer* renderer, V3f box_min, V3f box_max, const M4f* transform)
+{
+    float min[3] = { box_min.x, box_min.y, box_min.z };
+    float max[3] = { box_max.x, box_max.y, box_max.z };
+    if(transform) {
+        // every axis of the result is the translation plus the extremes of each column's contribution
+        const float* m = transform->elements;
+        float lo[3] = { m[12], m[13], m[14] };
+        float hi[3] = { m[12], m[13], m[14] };
+        for(int column = 0; column < 3; ++column) {
+            for(int row = 0; row < 3; ++row) {
+                float a = m[column*4 + row]*min[column];
+                float b = m[column*4 + row]*max[column];
+                lo[row] += a < b ? a : b;
+                hi[row] += a < b ? b : a;
+            }
+        }
+        f_memcpy(min, lo, sizeof(min));
+        f_memcpy(max, hi, sizeof(max));
+    }
+    return !(max[0] < renderer->camera.bounds.min.x || min[0] > renderer->camera.bounds.max.x ||
+             max[1] < renderer->camera.bounds.min.y || min[1] > renderer->camera.bounds.max.y ||
+             max[2] < renderer->camera.bounds.min.z || min[2] > renderer->camera.bounds.max.z);
+}
+
+static void _fude_upload_mvp(fude* app, fude_shader shader, const M4f* mvp)
+{
+    _fude_push_shader_uniform(app, shader, shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC], FUDE_SHADERDT_MAT4, 1,
+            mvp->elements, false);
+}
+
+// like immediate geometry the mesh goes through the matrix stack, then the transform, then whatever u_mvp
+// the shader holds (the camera f_use_camera set up for it, or the identity). That u_mvp is put back afterwards
+void f_draw_mesh(fude* app, const fude_mesh* mesh, fude_shader shader, const M4f* transform)
+{
+    fude_renderer* renderer = &app->renderer;
+    if(!mesh || mesh->index_count == 0) return;
+
+    bool moved = renderer->transform.current.kind != FUDE_TRANSFORM_IDENTITY;
+    M4f model = moved ? renderer->transform.current.matrix : m4f_identity();
+    if(transform) {
+        model = moved ? m4f_dot(model, *transform) : *transform;
+        moved = true;
+    }
+
+    bool camera = renderer->camera.active && renderer->camera.shader == shader.id;
+    if(camera && !_fude_box_visible(renderer, mesh->bounds.min, mesh->bounds.max, moved ? &model : NULL)) {
+        renderer->stats.current.culled_primitives += mesh->index_count/3;
+        return;
+    }
+
+    // immediate geometry submitted before has to be drawn first
+    _fude_break_batch(app, FUDE_BATCH_BREAK_MESH);
+
+    const M4f base = _fude_shader_mvp(renderer, shader.id);
+    if(moved) {
+        M4f mvp = m4f_dot(base, model);
+        _fude_upload_mvp(app, shader, &mvp);
+    }
+
+    if(app->render_thread)
+        _fude_record_draw_mesh(app, mesh, shader);
+    else if(app->software)
+        _fude_software_draw_mesh(app, mesh, shader);
+    else
+        _fude_draw_mesh_gl(renderer, mesh->vbo, mesh->ibo, mesh->index_count, shader, mesh->textures,
+                renderer->blend_mode);
+
+    if(moved)
+        _fude_upload_mvp(app, shader, &base);
+
+    fude_render_stats* stats = &renderer->stats.current;
+    stats->draw_calls += 1;
+    stats->mesh_draws += 1;
+    stats->vertices += mesh->vertex_count;
+    stats->indices += mesh->index_count;
+    stats->uniform_uploads += 1; // samplers
+    _fude_count_texture_binds(renderer, mesh->textures);
+    if(shader.id != renderer->stats.last_program) {
+        stats->program_switches += 1;
+        renderer->stats.last_program = shader.id;
+    }
+}
+
+//======================================================================
+// Display lists
+//======================================================================
+// recording doesn't stop drawing, the first frame draws and records at the same time
+void f_record_begin(fude* app, fude_display_list* list)
+{
+    if(!list) return;
+    list->vertices.count = 0;
+    list->indices.count = 0;
+    list->segments.count = 0;
+    list->hash = 0;
+    _fude_unpin_glyphs(list);
+    app->renderer.recording = list;
+}
+
+void f_record_end(fude* app)
+{
+    fude_display_list* list = app->renderer.recording;
+    if(!list) return;
+    app->renderer.recording = NULL;
+
+    uint64_t hash = FUDE_HASH_SEED;
+    hash = _fude_hash(hash, list->vertices.data, list->vertices.count*sizeof(fude_vertex));
+    hash = _fude_hash(hash, list->indices.data, list->indices.count*sizeof(uint32_t));
+    for(uint32_t i = 0; i < list->segments.count; ++i) {
+        const fude_display_segment* segment = list->segments.data + i;
+        hash = _fude_hash(hash, &segment->shader.id, sizeof(segment->shader.id));
+        hash = _fude_hash(hash, segment->textures, sizeof(segment->textures));
+        hash = _fude_hash(hash, &segment->blend, sizeof(segment->blend));
+        hash = _fude_hash(hash, &segment->mode, sizeof(segment->mode));
+        hash = _fude_hash(hash, &segment->vertex_count, sizeof(segment->vertex_count));
+    }
+    list->hash = hash ? hash : 1; // 0 is "never uploaded"
+}
+
+// one mesh per segment, only redone when the recorded content actually changed
+static void _fude_upload_display_list(fude* app, fude_display_list* list)
+{
+    for(uint32_t i = 0; i < list->segments.count; ++i) {
+        const fude_display_segment* segment = list->segments.data + i;
+        const fude_vertex* vertices = list->vertices.data + segment->first_vertex;
+        const uint32_t* indices = list->indices.data + segment->first_index;
+        if(i < list->meshes.count) {
+            f_update_mesh(app, list->meshes.data + i, vertices, segment->vertex_count, indices, segment->index_count);
+        } else {
+            list->meshes.data = _fude_grow_array(list->meshes.data, list->meshes.count, &list->meshes.capacity,
+                    list->meshes.count + 1, sizeof(fude_mesh));
+            f_create_mesh(app, list->meshes.data + list->meshes.count++, vertices, segment->vertex_count,
+                    indices, segment->index_count);
+        }
+        f_memcpy(list->meshes.data[i].textures, segment->textures, sizeof(segment->textures));
+    }
+    while(list->meshes.count > list->segments.count)
+        f_destroy_mesh(app, list->meshes.data + --list->meshes.count);
+    list->resident_hash = list->hash;
+}
+
+// call it outside of f_begin/f_end, the list doesn't go through the matrix stack again.
+// Segments draw with the blend mode they were recorded with, the caller's is back afterwards.
+// Between f_begin_layers and f_end_layers copied segments go on to the layer queue like committed
+// geometry does, resident lists are meshes and draw the queue first instead
+void f_replay(fude* app, fude_display_list* list)
+{
+    fude_renderer* renderer = &app->renderer;
+    if(!list || list == renderer->recording) return;
+    const fude_blend_mode blend = renderer->blend_mode;
+
+    if(list->resident) {
+        if(list->resident_hash != list->hash)
+            _fude_upload_display_list(app, list);
+        for(uint32_t i = 0; i < list->segments.count; ++i) {
+            f_set_blend_mode(app, list->segments.data[i].blend);
+            f_draw_mesh(app, list->meshes.data + i, list->segments.data[i].shader, NULL);
+        }
+        f_set_blend_mode(app, blend);
+        return;
+    }
+
+    for(uint32_t i = 0; i < list->segments.count; ++i) {
+        const fude_display_segment* segment = list->segments.data + i;
+        if(renderer->camera.active && renderer->camera.shader == segment->shader.id &&
+                !_fude_box_visible(renderer, segment->bounds.min, segment->bounds.max, NULL)) {
+            renderer->stats.current.culled_primitives += segment->index_count/3;
+            continue;
+        }
+
+        // the same rules f_set_blend_mode, f_begin, f_texture and f_vertex3f apply one vertex at a time
+        f_set_blend_mode(app, segment->blend);
+        bool texture_clash = false;
+        for(uint32_t slot = 0; slot < FUDE_RENDERER_MAXIMUM_TEXTURES; ++slot) {
+            uint32_t bound = renderer->textures.data[slot].id, wanted = segment->textures[slot].id;
+            if(wanted != 0 && bound != 0 && bound != wanted)
+                texture_clash = true;
+        }
+        if(renderer->shader.id != segment->shader.id)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_SHADER);
+        else if(texture_clash)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_TEXTURE);
+        else if(renderer->vertices.count + segment->vertex_count > FUDE_RENDERER_MAXIMUM_VERTICES ||
+                renderer->indices.count + segment->index_count > FUDE_RENDERER_MAXIMUM_INDICIES)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_CAPACITY);
+
+        renderer->shader = segment->shader;
+        for(uint32_t slot = 0; slot < FUDE_RENDERER_MAXIMUM_TEXTURES; ++slot) {
+            if(segment->textures[slot].id == 0) continue;
+            renderer->textures.data[slot] = segment->textures[slot];
+            renderer->textures.samplers[slot] = slot;
+        }
+
+        // whole vertices instead of f_memcpy's bytes, this copy is all a replay costs
+        uint32_t base = renderer->vertices.count;
+        fude_vertex* dst_vertices = renderer->vertices.data + base;
+        const fude_vertex* src_vertices = list->vertices.data + segment->first_vertex;
+        for(uint32_t j = 0; j < segment->vertex_count; ++j)
+            dst_vertices[j] = src_vertices[j];
+        uint32_t* dst = renderer->indices.data + renderer->indices.count;
+        const uint32_t* src = list->indices.data + segment->first_index;
+        for(uint32_t j = 0; j < segment->index_count; ++j)
+            dst[j] = src[j] + base;
+        renderer->vertices.count += segment->vertex_count;
+        renderer->indices.count += segment->index_count;
+
+        if(renderer->layers.active) {
+            // _fude_queue_layers splits the run by the working mode, nothing is left in working out here
+            const fude_draw_mode mode = renderer->working.mode;
+            renderer->working.mode = segment->mode;
+            _fude_queue_layers(renderer, base, renderer->indices.count - segment->index_count);
+            renderer->working.mode = mode;
+        }
+    }
+    f_set_blend_mode(app, blend);
+}
+
+void f_destroy_display_list(fude* app, fude_display_list* list)
+{
+    if(!app || !list) return;
+    for(uint32_t i = 0; i < list->meshes.count; ++i)
+        f_destroy_mesh(app, list->meshes.data + i);
+    _fude_unpin_glyphs(list);
+    if(list->vertices.data) f_free(list->vertices.data);
+    if(list->indices.data) f_free(list->indices.data);
+    if(list->segments.data) f_free(list->segments.data);
+    if(list->meshes.data) f_free(list->meshes.data);
+    if(list->glyphs.data) f_free(list->glyphs.data);
+    f_memzero(list, sizeof(fude_display_list));
+}
+
+//======================================================================
+// Depth layers
+//======================================================================
+// between f_begin_layers and f_end_layers committed primitives are held back instead of batched.
+// Opaque ones are drawn first, grouped by batch state and front to back within a group, writing depth,
+// so sprites of one texture share a batch whatever layer they're on and hidden pixels fail the depth
+// test. Translucent ones follow back to front, tested against that depth without writing it
+typedef struct {
+    fude_shader shader;
+    fude_texture textures[FUDE_RENDERER_MAXIMUM_TEXTURES]; // only the sampled slot with the default shader
+    fude_blend_mode blend; // _fude_batch_blend's, the vertices are converted already
+} _fude_layer_state;
+
+typedef struct {
+    uint64_t key;          // state and depth for opaque primitives, depth alone for translucent ones
+    uint32_t first_vertex; // into the queue's vertices
+    uint32_t vertex_count; // 4 for quads, 3 for triangles
+    uint32_t state;
+} _fude_layer_primitive;
+
+typedef struct {
+    _fude_layer_primitive* data;
+    uint32_t count, capacity;
+} _fude_layer_list;
+
+struct fude_layer_queue {
+    struct {
+        fude_vertex* data;
+        uint32_t count, capacity;
+    } vertices;
+    struct {
+        _fude_layer_state* data;
+        uint32_t count, capacity;
+    } states;
+    _fude_layer_list opaque, translucent;
+    _fude_layer_list scratch;
+    uint32_t last_state;
+};
+
+// the same order as the floats, negative values have their magnitude bits reversed
+static uint32_t _fude_depth_key(float depth)
+{
+    uint32_t bits;
+    f_memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 31 ? ~bits : bits | 0x80000000u;
+}
+
+// NDC z of the primitive's center under the matrix f_use_camera gave its shader, smaller is nearer
+static float _fude_primitive_depth(const fude_renderer* renderer, const fude_vertex* vertices, uint32_t count)
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for(uint32_t i = 0; i < count; ++i) {
+        x += vertices[i].position.x;
+        y += vertices[i].position.y;
+        z += vertices[i].position.z;
+    }
+    x /= (float)count; y /= (float)count; z /= (float)count;
+    if(!renderer->camera.active || renderer->camera.shader != renderer->shader.id) return z;
+
+    const float* m = renderer->camera.view_projection.elements;
+    float cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+    float cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+    return cw != 0.0f ? cz/cw : cz;
+}
+
+// default shader geometry that covers what it touches with alpha 1: flat colors at full alpha and
+// sprites of FUDE_TEXTURE_OPAQUE textures, or anything drawn with FUDE_BLEND_OPAQUE. Shapes antialias
+// their edges and additive geometry adds to what's behind it, so they never are
+static bool _fude_primitive_opaque(const fude_renderer* renderer, const fude_vertex* vertices, uint32_t count)
+{
+    if(renderer->blend_mode == FUDE_BLEND_OPAQUE) return true;
+    if(renderer->blend_mode == FUDE_BLEND_ADDITIVE || renderer->blend_mode == FUDE_BLEND_MULTIPLY) return false;
+    if(renderer->shader.id != renderer->default_shader.id || vertices->tex_index < 0.0f ||
+            vertices->tex_index >= (float)FUDE_ADDITIVE_FLAG)
+        return false;
+    uint32_t slot = (uint32_t)vertices->tex_index;
+    if(slot > 0)
+        return slot < FUDE_RENDERER_MAXIMUM_TEXTURES && (renderer->textures.data[slot].flags & FUDE_TEXTURE_OPAQUE);
+    for(uint32_t i = 0; i < count; ++i) {
+        if(vertices[i].color.a < 1.0f) return false;
+    }
+    return true;
+}
+
+static uint32_t _fude_find_layer_state(fude_layer_queue* queue, const fude_renderer* renderer, float tex_index)
+{
+    _fude_layer_state state;
+    f_memzero(&state, sizeof(state));
+    state.shader = renderer->shader;
+    state.blend = _fude_batch_blend(renderer, renderer->shader);
+    const uint32_t slot = _fude_vertex_slot(tex_index);
+    if(renderer->shader.id != renderer->default_shader.id) {
+        f_memcpy(state.textures, renderer->textures.data, sizeof(state.textures));
+    } else if(slot > 0 && slot < FUDE_RENDERER_MAXIMUM_TEXTURES) {
+        // other slots may hold whatever earlier sprites left there, they'd only cause texture breaks
+        state.textures[slot] = renderer->textures.data[slot];
+    }
+
+    // runs of primitives share a state, the rest is a short linear search
+    for(uint32_t n = 0; n < queue->states.count; ++n) {
+        uint32_t i = (queue->last_state + n) % queue->states.count;
+        const _fude_layer_state* other = queue->states.data + i;
+        if(other->shader.id == state.shader.id && other->blend == state.blend &&
+                _fude_same_textures(other->textures, state.textures)) {
+            queue->last_state = i;
+            return i;
+        }
+    }
+    queue->states.data = _fude_grow_array(queue->states.data, queue->states.count, &queue->states.capacity,
+            queue->states.count + 1, sizeof(_fude_layer_state));
+    queue->states.data[queue->states.count] = state;
+    queue->last_state = queue->states.count;
+    return queue->states.count++;
+}
+
+static void _fude_push_layer_primitive(_fude_layer_list* list, uint64_t key, uint32_t first_vertex,
+        uint32_t vertex_count, uint32_t state)
+{
+    list->data = _fude_grow_array(list->data, list->count, &list->capacity, list->count + 1,
+            sizeof(_fude_layer_primitive));
+    list->data[list->count++] = (_fude_layer_primitive){ .key = key, .first_vertex = first_vertex,
+        .vertex_count = vertex_count, .state = state };
+}
+
+// moves what _fude_commit_working just put into the batch over to the queue,
+// the unfinished primitive after it moves down to first_vertex
+static void _fude_queue_layers(fude_renderer* renderer, uint32_t first_vertex, uint32_t first_index)
+{
+    fude_layer_queue* queue = renderer->layers.queue;
+    const uint32_t per_primitive = renderer->working.mode == FUDE_MODE_QUADS ? 4 : 3;
+    const uint32_t count = renderer->vertices.count - first_vertex;
+    const fude_vertex* vertices = renderer->vertices.data + first_vertex;
+
+    queue->vertices.data = _fude_grow_array(queue->vertices.data, queue->vertices.count, &queue->vertices.capacity,
+            queue->vertices.count + count, sizeof(fude_vertex));
+    f_memcpy(queue->vertices.data + queue->vertices.count, vertices, count*sizeof(fude_vertex));
+
+    for(uint32_t i = 0; i < count; i += per_primitive) {
+        const fude_vertex* primitive = vertices + i;
+        uint32_t state = _fude_find_layer_state(queue, renderer, primitive->tex_index);
+        uint32_t depth = _fude_depth_key(_fude_primitive_depth(renderer, primitive, per_primitive));
+        if(renderer->layers.depth_buffer && _fude_primitive_opaque(renderer, primitive, per_primitive))
+            _fude_push_layer_primitive(&queue->opaque, (uint64_t)state << 32 | depth,
+                    queue->vertices.count + i, per_primitive, state);
+        else
+            _fude_push_layer_primitive(&queue->translucent, ~depth, queue->vertices.count + i, per_primitive, state);
+    }
+    queue->vertices.count += count;
+
+    if(renderer->working.count > 0)
+        f_memcpy(renderer->vertices.data + first_vertex, renderer->vertices.data + renderer->vertices.count,
+                renderer->working.count*sizeof(fude_vertex));
+    renderer->vertices.count = first_vertex;
+    renderer->indices.count = first_index;
+}
+
+// stable, equal keys keep their submission order so coplanar translucent geometry draws in order
+static void _fude_sort_layer_list(_fude_layer_list* list, _fude_layer_list* scratch)
+{
+    const uint32_t count = list->count;
+    if(count < 64) {
+        for(uint32_t i = 1; i < count; ++i) {
+            _fude_layer_primitive value = list->data[i];
+            uint32_t j = i;
+            for(; j > 0 && list->data[j - 1].key > value.key; --j)
+                list->data[j] = list->data[j - 1];
+            list->data[j] = value;
+        }
+        return;
+    }
+
+    scratch->data = _fude_grow_array(scratch->data, 0, &scratch->capacity, count, sizeof(_fude_layer_primitive));
+    uint64_t max_key = 0;
+    for(uint32_t i = 0; i < count; ++i)
+        max_key |= list->data[i].key;
+
+    _fude_layer_primitive* src = list->data;
+    _fude_layer_primitive* dst = scratch->data;
+    for(uint32_t shift = 0; shift < 64 && (max_key >> shift) != 0; shift += 8) {
+        uint32_t offsets[256] = {0};
+        for(uint32_t i = 0; i < count; ++i)
+            offsets[src[i].key >> shift & 255] += 1;
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i < 256; ++i) {
+            uint32_t bucket = offsets[i];
+            offsets[i] = sum;
+            sum += bucket;
+        }
+        for(uint32_t i = 0; i < count; ++i)
+            dst[offsets[src[i].key >> shift & 255]++] = src[i];
+        _fude_layer_primitive* swap = src; src = dst; dst = swap;
+    }
+    if(src != list->data)
+        f_memcpy(list->data, src, count*sizeof(_fude_layer_primitive));
+}
+
+// into the batch with the same rules as f_replay, plus a break whenever the depth mode changes.
+// blend_mode holds the state's while the list is drawn
+static void _fude_draw_layer_list(fude* app, const _fude_layer_list* list, fude_depth_mode mode)
+{
+    fude_renderer* renderer = &app->renderer;
+    const fude_layer_queue* queue = renderer->layers.queue;
+    for(uint32_t i = 0; i < list->count; ++i) {
+        const _fude_layer_primitive* primitive = list->data + i;
+        const _fude_layer_state* state = queue->states.data + primitive->state;
+        const uint32_t index_count = primitive->vertex_count == 4 ? 6 : 3;
+
+        bool texture_clash = false;
+        for(uint32_t slot = 0; slot < FUDE_RENDERER_MAXIMUM_TEXTURES; ++slot) {
+            uint32_t bound = renderer->textures.data[slot].id, wanted = state->textures[slot].id;
+            if(wanted != 0 && bound != 0 && bound != wanted)
+                texture_clash = true;
+        }
+        if(renderer->layers.mode != mode)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_DEPTH);
+        else if(renderer->shader.id != state->shader.id)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_SHADER);
+        else if(_fude_batch_blend(renderer, renderer->shader) != state->blend)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_BLEND);
+        else if(texture_clash)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_TEXTURE);
+        else if(renderer->vertices.count + primitive->vertex_count > FUDE_RENDERER_MAXIMUM_VERTICES ||
+                renderer->indices.count + index_count > FUDE_RENDERER_MAXIMUM_INDICIES)
+            _fude_flush_batch(app, FUDE_BATCH_BREAK_CAPACITY);
+
+        renderer->layers.mode = mode;
+        renderer->shader = state->shader;
+        renderer->blend_mode = state->blend;
+        for(uint32_t slot = 0; slot < FUDE_RENDERER_MAXIMUM_TEXTURES; ++slot) {
+            if(state->textures[slot].id == 0) continue;
+            renderer->textures.data[slot] = state->textures[slot];
+            renderer->textures.samplers[slot] = slot;
+        }
+
+        uint32_t base = renderer->vertices.count;
+        const fude_vertex* src = queue->vertices.data + primitive->first_vertex;
+        for(uint32_t j = 0; j < primitive->vertex_count; ++j)
+            renderer->vertices.data[base + j] = src[j];
+        _fude_write_primitive_indices(renderer->indices.data + renderer->indices.count, base,
+                primitive->vertex_count == 4 ? FUDE_MODE_QUADS : FUDE_MODE_TRIANGLES);
+        renderer->vertices.count += primitive->vertex_count;
+        renderer->indices.count += index_count;
+    }
+}
+
+// draws and empties the queue, what's batched after it is back to FUDE_DEPTH_OFF
+static void _fude_draw_layer_queue(fude* app, fude_batch_break reason)
+{
+    fude_renderer* renderer = &app->renderer;
+    fude_layer_queue* queue = renderer->layers.queue;
+    if(!queue || queue->vertices.count == 0) return;
+
+    const fude_blend_mode blend = renderer->blend_mode;
+    _fude_sort_layer_list(&queue->opaque, &queue->scratch);
+    _fude_sort_layer_list(&queue->translucent, &queue->scratch);
+    _fude_draw_layer_list(app, &queue->opaque, FUDE_DEPTH_OPAQUE);
+    _fude_draw_layer_list(app, &queue->translucent, FUDE_DEPTH_TRANSLUCENT);
+    _fude_flush_batch(app, reason);
+    renderer->layers.mode = FUDE_DEPTH_OFF;
+    renderer->blend_mode = blend;
+
+    queue->vertices.count = 0;
+    queue->states.count = 0;
+    queue->opaque.count = 0;
+    queue->translucent.count = 0;
+    queue->last_state = 0;
+}
+
+// what's pending is drawn first. The queue is drawn by f_end_layers, f_flush, a camera change,
+// f_draw_mesh, instanced particles and target switches, meshes themselves are never held back
+void f_begin_layers(fude* app)
+{
+    fude_renderer* renderer = &app->renderer;
+    if(renderer->layers.active) return;
+    if(!renderer->layers.queue) {
+        renderer->layers.queue = f_malloc(sizeof(fude_layer_queue));
+        if(!renderer->layers.queue) {
+            f_trace_log(FUDE_LOG_ERROR, "Failed to allocate the layer queue, drawing in submission order");
+            return;
+        }
+        f_memzero(renderer->layers.queue, sizeof(fude_layer_queue));
+    }
+    _fude_flush_batch(app, FUDE_BATCH_BREAK_DEPTH);
+    renderer->layers.active = true;
+}
+
+void f_end_layers(fude* app)
+{
+    if(!app->renderer.layers.active) return;
+    _fude_draw_layer_queue(app, FUDE_BATCH_BREAK_DEPTH);
+    app->renderer.layers.active = false;
+}
+
+void _fude_destroy_layer_queue(fude* app)
+{
+    fude_layer_queue* queue = app->renderer.layers.queue;
+    if(!queue) return;
+    if(queue->vertices.data) f_free(queue->vertices.data);
+    if(queue->states.data) f_free(queue->states.data);
+    if(queue->opaque.data) f_free(queue->opaque.data);
+    if(queue->translucent.data) f_free(queue->translucent.data);
+    if(queue->scratch.data) f_free(queue->scratch.data);
+    f_free(queue);
+    app->renderer.layers.queue = NULL;
+}
@@ -0,0 +1,176 @@
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#if FUDE_PLATFORM_LINUX
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+struct fude_headless {
+#if FUDE_PLATFORM_LINUX
+    EGLDisplay display;
+    EGLContext context;
+#endif
+    uint32_t fbo, color, depth;
+    int width, height;
+};
+
+#if FUDE_PLATFORM_LINUX
+// surfaceless EGL context, works without an X server (e.g. Mesa llvmpipe)
+static fude_result _fude_create_headless_context(fude* app, const fude_config* config)
+{
+    (void)config;
+    fude_headless* headless = app->headless;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    headless->display = EGL_NO_DISPLAY;
+    if(get_platform_display)
+        headless->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(headless->display == EGL_NO_DISPLAY)
+        headless->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(headless->display == EGL_NO_DISPLAY) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to get an EGL display");
+        return FUDE_INITIALIZATION_ERROR;
+    }
+
+    EGLint major, minor;
+    if(!eglInitialize(headless->display, &major, &minor)) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to initialize EGL");
+        return FUDE_INITIALIZATION_ERROR;
+    }
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        f_trace_log(FUDE_LOG_ERROR, "EGL %d.%d has no desktop OpenGL support", major, minor);
+        return FUDE_INITIALIZATION_ERROR;
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE,
+    };
+    EGLConfig egl_config;
+    EGLint config_count = 0;
+    if(!eglChooseConfig(headless->display, config_attribs, &egl_config, 1, &config_count) || config_count == 0) {
+        f_trace_log(FUDE_LOG_ERROR, "No suitable EGL config found");
+        return FUDE_INITIALIZATION_ERROR;
+    }
+
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    headless->context = eglCreateContext(headless->display, egl_config, EGL_NO_CONTEXT, context_attribs);
+    if(headless->context == EGL_NO_CONTEXT) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to create an OpenGL 3.3 core EGL context");
+        return FUDE_INITIALIZATION_ERROR;
+    }
+    if(!eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless->context)) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to make the surfaceless EGL context current");
+        return FUDE_INITIALIZATION_ERROR;
+    }
+
+    gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+    return FUDE_OK;
+}
+
+static void _fude_destroy_headless_context(fude* app)
+{
+    fude_headless* headless = app->headless;
+    if(headless->display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(headless->context != EGL_NO_CONTEXT)
+        eglDestroyContext(headless->display, headless->context);
+    eglTerminate(headless->display);
+}
+#else
+// no surfaceless path here, fall back to a window that is never shown
+static fude_result _fude_create_headless_context(fude* app, const fude_config* config)
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    fude_result result = _fude_init_window(app, config);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    return result;
+}
+
+static void _fude_destroy_headless_context(fude* app)
+{
+    (void)app; // f_deinit destroys app->window
+}
+#endif
+
+fude_result _fude_init_headless(fude* app, const fude_config* config)
+{
+    fude_headless* headless = f_malloc(sizeof(fude_headless));
+    if(!headless) return FUDE_INITIALIZATION_ERROR;
+    f_memzero(headless, sizeof(fude_headless));
+#if FUDE_PLATFORM_LINUX
+    headless->display = EGL_NO_DISPLAY;
+    headless->context = EGL_NO_CONTEXT;
+#endif
+    headless->width = (int)config->width;
+    headless->height = (int)config->height;
+    app->headless = headless;
+
+    fude_result result = _fude_create_headless_context(app, config);
+    if(result != FUDE_OK) {
+        _fude_deinit_headless(app);
+        return result;
+    }
+
+    // everything renders into this instead of a default framebuffer
+    glGenRenderbuffers(1, &headless->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, headless->width, headless->height);
+    glGenRenderbuffers(1, &headless->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, headless->width, headless->height);
+
+    glGenFramebuffers(1, &headless->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, headless->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headless->depth);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        f_trace_log(FUDE_LOG_ERROR, "Headless framebuffer is incomplete");
+        _fude_deinit_headless(app);
+        return FUDE_INITIALIZATION_ERROR;
+    }
+    glViewport(0, 0, headless->width, headless->height);
+    app->renderer.default_framebuffer = headless->fbo;
+
+    return FUDE_OK;
+}
+
+void _fude_deinit_headless(fude* app)
+{
+    fude_headless* headless = app->headless;
+    if(headless->fbo) glDeleteFramebuffers(1, &headless->fbo);
+    if(headless->color) glDeleteRenderbuffers(1, &headless->color);
+    if(headless->depth) glDeleteRenderbuffers(1, &headless->depth);
+    _fude_destroy_headless_context(app);
+    f_free(headless);
+    app->headless = NULL;
+    app->renderer.default_framebuffer = 0;
+}
+
+fude_result f_read_pixels(fude* app, int x, int y, int width, int height, void* rgba8)
+{
+    if(!app || !rgba8 || width <= 0 || height <= 0) return FUDE_INVALID_ARGUMENTS_ERROR;
+    if(app->render_thread) {
+        f_trace_log(FUDE_LOG_ERROR, "f_read_pixels is not supported with threaded rendering");
+        return FUDE_ERROR;
+    }
+    if(app->software)
+        return _fude_software_read_pixels(app, x, y, width, height, rgba8);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, app->renderer.default_framebuffer);
+    if(!app->headless)
+        glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba8);
+    return FUDE_OK;
+}
@@ -3,6 +3,10 @@
 
 #include "fude.h"
 
+#if !FUDE_PLATFORM_WINDOWS
+#include <pthread.h>
+#endif
+
 void _fude_window_pos_callback(GLFWwindow* window, int x, int y);
 void _fude_window_size_callback(GLFWwindow* window, int width, int height);
 void _fude_window_close_callback(GLFWwindow* window);
@@ -16,8 +20,168 @@ void _fude_key_callback(GLFWwindow* window, int key, int scancode, int action, i
 void _fude_char_callback(GLFWwindow* window, unsigned int codepoint);
 
 fude_result _fude_init_window(fude* app, const fude_config* config);
+fude_event* _fude_new_event(fude_event_queue* eq, int type);
+void _fude_begin_input_frame(fude_input* input);
+void _fude_set_swap_interval(const fude_config* config);
 fude_result _fude_init_renderer(fude* app, const fude_config* config);
+void _fude_bind_batch_state(fude_shader shader, const fude_texture* textures, const int* samplers);
+void _fude_upload_shader_uniform(fude_shader shader, int location, int type, int count, const void* data, bool transponse);
+void _fude_push_shader_uniform(fude* app, fude_shader shader, int location, int type, int count, const void* data,
+        bool transpose);
+void _fude_draw_mesh_gl(fude_renderer* renderer, uint32_t vbo, uint32_t ibo, uint32_t index_count,
+        fude_shader shader, const fude_texture* textures, fude_blend_mode blend);
+void _fude_count_texture_binds(fude_renderer* renderer, const fude_texture* textures);
+fude_result _fude_create_distance_field_texture(fude* app, fude_texture* texture, int width, int height);
+void _fude_update_texture_rows(fude* app, fude_texture texture, const void* pixels, int width, int y, int rows,
+        int channels);
+fude_vertex* _fude_begin_quads(fude* app, fude_shader shader, fude_texture texture, uint32_t slot, uint32_t* count);
+void _fude_end_quads(fude* app, uint32_t count);
+fude_result _fude_create_default_shader(fude* app);
+fude_result _fude_link_program(uint32_t* program, const char* vert_src, const char* frag_src);
+void _fude_break_batch(fude* app, fude_batch_break reason);
+void _fude_set_depth_mode_gl(fude_depth_mode mode);
+fude_blend_mode _fude_batch_blend(const fude_renderer* renderer, fude_shader shader);
+bool _fude_shader_premultiplied(const fude_renderer* renderer, fude_shader shader, const fude_texture* textures);
+void _fude_set_blend_mode_gl(fude_blend_mode mode, bool premultiplied);
+void _fude_destroy_layer_queue(fude* app);
+
+// fude_shapes.c
+V4f _fude_unpack_color(uint32_t color);
+uint32_t _fude_sprite_slot(const fude_renderer* renderer, fude_texture texture);
+
+// fude_path.c
+void _fude_destroy_path_cache(fude* app);
+void _fude_clear_path_cache(fude_path_cache* cache);
+
+// fude_text.c
+void _fude_unpin_glyphs(fude_display_list* list);
+
+// fude_particles.c
+typedef struct {
+    uint8_t start[4], end[4]; // RGBA bytes, read by the shader as normalized vec4s
+} _fude_particle_colors;
+
+void _fude_destroy_particle_stream(fude* app);
+void _fude_draw_particles_gl(fude_renderer* renderer, const V4f* instances, const _fude_particle_colors* colors,
+        uint32_t count, fude_blend_mode blend);
+
+// fude_target.c
+void _fude_bind_target_gl(fude_renderer* renderer, uint32_t fbo, uint32_t color, uint32_t depth, int width, int height);
+void _fude_recycle_render_targets(fude* app);
+void _fude_destroy_target_pool(fude* app);
+
+// fude_headless.c
+fude_result _fude_init_headless(fude* app, const fude_config* config);
+void _fude_deinit_headless(fude* app);
+
+// fude_software.c
+fude_result _fude_init_software(fude* app, const fude_config* config);
+void _fude_deinit_software(fude* app);
+void _fude_software_draw(fude* app);
+void _fude_software_clear(fude* app);
+void _fude_software_present(fude* app);
+fude_result _fude_software_read_pixels(fude* app, int x, int y, int width, int height, void* rgba8);
+fude_result _fude_software_create_texture(fude* app, fude_texture* texture, const void* data, int width, int height,
+        int channels);
+void _fude_software_update_texture(fude* app, fude_texture texture, const void* data, int width, int height, int channels);
+void _fude_software_destroy_texture(fude* app, fude_texture texture);
+void _fude_software_update_texture_rows(fude* app, fude_texture texture, const void* pixels, int width, int y,
+        int rows, int channels);
+fude_result _fude_software_create_shader(fude* app, fude_shader* shader);
+void _fude_software_set_shader_uniform(fude* app, fude_shader shader, int location, int type, const void* data,
+        bool transpose);
+fude_result _fude_software_update_mesh(fude* app, fude_mesh* mesh, const fude_vertex* vertices, const uint32_t* indices);
+void _fude_software_destroy_mesh(fude* app, fude_mesh* mesh);
+void _fude_software_draw_mesh(fude* app, const fude_mesh* mesh, fude_shader shader);
+void _fude_software_bind_target(fude* app, fude_texture color);
+
+// fude_profiler.c
+void _fude_init_gpu_timer(fude_gpu_timer* timer);
+void _fude_gpu_timer_begin_pass(fude_gpu_timer* timer, fude_gpu_pass pass);
+void _fude_gpu_timer_end_pass(fude_gpu_timer* timer);
+void _fude_gpu_timer_end_frame(fude_gpu_timer* timer);
+void _fude_end_render_stats_frame(fude_renderer* renderer);
+
+// fude_utils.c
+#define FUDE_HASH_SEED 0xcbf29ce484222325ull
+void* _fude_grow_array(void* data, uint32_t count, uint32_t* capacity, uint32_t needed, size_t stride);
+uint64_t _fude_hash(uint64_t hash, const void* data, size_t nbytes);
+void _fude_sleep_ms(uint32_t milliseconds);
+bool _fude_begin_sleep_resolution(void);
+void _fude_end_sleep_resolution(void);
+uint64_t _fude_timer_value(void);
+uint64_t _fude_timer_frequency(void);
+uint32_t _fude_cpu_count(void);
+static inline double _fude_get_seconds(void) { return (double)_fude_timer_value()/(double)_fude_timer_frequency(); }
+
+// fude_thread.c
+#if FUDE_PLATFORM_WINDOWS
+typedef struct { void* handle; void (*proc)(void*); void* user_data; } _fude_thread;
+typedef struct { void* srwlock; } _fude_mutex;
+typedef struct { void* cv; } _fude_cond;
+#else
+typedef struct { pthread_t handle; void (*proc)(void*); void* user_data; } _fude_thread;
+typedef struct { pthread_mutex_t handle; } _fude_mutex;
+typedef struct { pthread_cond_t handle; } _fude_cond;
+#endif
+typedef void (*_fude_thread_proc)(void* user_data);
+
+bool _fude_thread_create(_fude_thread* thread, _fude_thread_proc proc, void* user_data);
+void _fude_thread_join(_fude_thread* thread);
+void _fude_mutex_init(_fude_mutex* mutex);
+void _fude_mutex_destroy(_fude_mutex* mutex);
+void _fude_mutex_lock(_fude_mutex* mutex);
+void _fude_mutex_unlock(_fude_mutex* mutex);
+void _fude_cond_init(_fude_cond* cond);
+void _fude_cond_destroy(_fude_cond* cond);
+void _fude_cond_wait(_fude_cond* cond, _fude_mutex* mutex);
+void _fude_cond_broadcast(_fude_cond* cond);
+
+// work-sharing pool, the calling thread helps out and returns when every index ran
+#define FUDE_THREAD_POOL_MAXIMUM_THREADS 64
+typedef void (*_fude_parallel_proc)(void* user_data, uint32_t index);
+typedef struct _fude_thread_pool _fude_thread_pool;
+
+_fude_thread_pool* _fude_create_thread_pool(uint32_t thread_count);
+void _fude_destroy_thread_pool(_fude_thread_pool* pool);
+uint32_t _fude_thread_pool_size(const _fude_thread_pool* pool);
+void _fude_parallel_for(_fude_thread_pool* pool, uint32_t count, _fude_parallel_proc proc, void* user_data);
+
+fude_result _fude_init_render_thread(fude* app, const fude_config* config);
+void _fude_deinit_render_thread(fude* app);
+void _fude_record_clear(fude* app);
+void _fude_record_flush(fude* app);
+void _fude_record_uniform(fude* app, fude_shader shader, int location, int data_type, int count, const void* data,
+        bool transpose);
+void _fude_record_draw_mesh(fude* app, const fude_mesh* mesh, fude_shader shader);
+void _fude_record_bind_target(fude* app, const fude_render_target* target);
+void _fude_record_delete_buffers(fude* app, uint32_t vbo, uint32_t ibo);
+void _fude_record_draw_instances(fude* app, const V4f* instances, const _fude_particle_colors* colors, uint32_t count);
+void _fude_submit_frame(fude* app);
+void _fude_lock_render_thread(fude* app);
+void _fude_unlock_render_thread(fude* app);
+
+#define _FUDE_BIT_GET(bits, i)   (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+#define _FUDE_BIT_SET(bits, i)   ((bits)[(i) >> 6] |= (uint64_t)1 << ((i) & 63))
+#define _FUDE_BIT_CLEAR(bits, i) ((bits)[(i) >> 6] &= ~((uint64_t)1 << ((i) & 63)))
+
+#define _FUDE_STRINGIFY2(x) #x
+#define _FUDE_STRINGIFY(x) _FUDE_STRINGIFY2(x)
 
+// shapes (fude_shapes.c) carry their signed distance parameters in a negative tex_index,
+// -1 - (kind | radius << 1 | thickness << 12) with radius and thickness in 1/2047ths of the
+// shorter half extent. Boxes put position/half extent in tex_coords, triangles two barycentrics
+#define FUDE_SHAPE_BOX      0
+#define FUDE_SHAPE_TRIANGLE 1
+#define FUDE_SHAPE_FRACTION_BITS 11
+
+// set above the slot or shape code of default shader vertices that add instead of blending over,
+// the fragment shader writes alpha 0 for them. Still exact in the float tex_index
+#define FUDE_ADDITIVE_FLAG (1 << 23)
+// set above the slot of default shader vertices that sample it as a glyph's signed distance field (fude_text.c)
+#define FUDE_GLYPH_FLAG (1 << 22)
+
+// until f_use_camera says otherwise u_mvp is the identity and positions are in clip space
 #define FUDE_DEFAULT_VERTEX_SHADER \
     "#version 330 core\n" \
     "layout(location=0) in vec3 a_position;\n" \
@@ -26,42 +190,111 @@ fude_result _fude_init_renderer(fude* app, const fude_config* config);
     "layout(location=3) in float a_tex_index;\n" \
     "out vec4 v_color;\n" \
     "out vec2 v_tex_coords;\n" \
-    "out float v_tex_index;\n" \
+    "flat out float v_tex_index;\n" \
     "uniform mat4 u_mvp;\n" \
-    "uniform mat4 u_projection;\n" \
-    "uniform mat4 u_view;\n" \
-    "uniform mat4 u_model;\n" \
     "void main()\n" \
     "{\n" \
-    "    gl_Position = vec4(a_position, 1.0);\n" \
+    "    gl_Position = u_mvp*vec4(a_position, 1.0);\n" \
     "    v_color = a_color;\n" \
     "    v_tex_coords = a_tex_coords;\n" \
     "    v_tex_index = a_tex_index;\n" \
-    "    u_projection;\n" \
-    "    u_view;\n" \
-    "    u_model;\n" \
-    "    u_mvp;\n" \
     "}"
 
+// vertex color, a texture slot, a glyph or a shape's coverage from its signed distance in pixels, as
+// premultiplied color since textures are premultiplied at upload. Glyphs read their slot's alpha as a signed
+// distance (0.5 on the outline) and antialias over about a pixel. Derivatives are taken up front, they're
+// undefined inside the per-primitive branches
 #define FUDE_DEFAULT_FRAGMENT_SHADER \
     "#version 330 core\n" \
     "layout(location=0) out vec4 o_color;\n" \
     "uniform sampler2D u_texture_samplers[8];\n" \
     "in vec4 v_color;\n" \
     "in vec2 v_tex_coords;\n" \
-    "in float v_tex_index;\n" \
+    "flat in float v_tex_index;\n" \
+    "const float spread = " _FUDE_STRINGIFY(FUDE_FONT_SDF_SPREAD) ".0;\n" \
+    "vec4 slot_texel(int slot, out vec2 size)\n" \
+    "{\n" \
+    "    switch(slot) {\n" \
+    "    case 1: size = vec2(textureSize(u_texture_samplers[1], 0)); return texture(u_texture_samplers[1], v_tex_coords);\n" \
+    "    case 2: size = vec2(textureSize(u_texture_samplers[2], 0)); return texture(u_texture_samplers[2], v_tex_coords);\n" \
+    "    case 3: size = vec2(textureSize(u_texture_samplers[3], 0)); return texture(u_texture_samplers[3], v_tex_coords);\n" \
+    "    case 4: size = vec2(textureSize(u_texture_samplers[4], 0)); return texture(u_texture_samplers[4], v_tex_coords);\n" \
+    "    case 5: size = vec2(textureSize(u_texture_samplers[5], 0)); return texture(u_texture_samplers[5], v_tex_coords);\n" \
+    "    case 6: size = vec2(textureSize(u_texture_samplers[6], 0)); return texture(u_texture_samplers[6], v_tex_coords);\n" \
+    "    case 7: size = vec2(textureSize(u_texture_samplers[7], 0)); return texture(u_texture_samplers[7], v_tex_coords);\n" \
+    "    }\n" \
+    "    size = vec2(1.0);\n" \
+    "    return vec4(v_color.rgb*v_color.a, v_color.a);\n" \
+    "}\n" \
+    "float shape_coverage(int code, vec2 dx, vec2 dy)\n" \
+    "{\n" \
+    "    vec2 uv = v_tex_coords;\n" \
+    "    if((code & 1) == " _FUDE_STRINGIFY(FUDE_SHAPE_TRIANGLE) ") {\n" \
+    "        vec3 b = vec3(uv, 1.0 - uv.x - uv.y);\n" \
+    "        vec3 bx = vec3(dx, -dx.x - dx.y), by = vec3(dy, -dy.x - dy.y);\n" \
+    "        vec3 d = b/max(sqrt(bx*bx + by*by), 1e-6);\n" \
+    "        return clamp(min(d.x, min(d.y, d.z)) + 0.5, 0.0, 1.0);\n" \
+    "    }\n" \
+    "    vec2 h = 1.0/max(vec2(length(vec2(dx.x, dy.x)), length(vec2(dx.y, dy.y))), 1e-6);\n" \
+    "    float m = min(h.x, h.y);\n" \
+    "    float r = float((code >> 1) & 2047)/2047.0*m;\n" \
+    "    float t = float(code >> 12)/2047.0*m;\n" \
+    "    vec2 q = abs(uv*h) - h + r;\n" \
+    "    float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;\n" \
+    "    if(t > 0.0) d = abs(d + 0.5*t) - 0.5*t;\n" \
+    "    return clamp(0.5 - d, 0.0, 1.0);\n" \
+    "}\n" \
+    "void main()\n" \
+    "{\n" \
+    "    vec2 dx = dFdx(v_tex_coords), dy = dFdy(v_tex_coords);\n" \
+    "    int index = int(v_tex_index);\n" \
+    "    int code = index < 0 ? -1 - index : index;\n" \
+    "    bool additive = code >= " _FUDE_STRINGIFY(FUDE_ADDITIVE_FLAG) ";\n" \
+    "    code &= " _FUDE_STRINGIFY(FUDE_ADDITIVE_FLAG) " - 1;\n" \
+    "    vec2 size;\n" \
+    "    if(index < 0) {\n" \
+    "        float a = v_color.a*shape_coverage(code, dx, dy);\n" \
+    "        o_color = vec4(v_color.rgb*a, a);\n" \
+    "    } else if(code >= " _FUDE_STRINGIFY(FUDE_GLYPH_FLAG) ") {\n" \
+    "        float d = slot_texel(code - " _FUDE_STRINGIFY(FUDE_GLYPH_FLAG) ", size).a;\n" \
+    "        vec2 texels = abs(dx) + abs(dy);\n" \
+    "        float w = max(max(texels.x*size.x, texels.y*size.y)/(2.0*spread), 0.0001);\n" \
+    "        float a = v_color.a*smoothstep(0.5 - w, 0.5 + w, d);\n" \
+    "        o_color = vec4(v_color.rgb*a, a);\n" \
+    "    } else {\n" \
+    "        o_color = slot_texel(code, size);\n" \
+    "    }\n" \
+    "    if(additive) o_color.a = 0.0;\n" \
+    "}"
+
+// particles are one instance each of a 4 vertex triangle strip, the corner comes from gl_VertexID.
+// a_instance is (x, y, radius, fraction of the lifetime), the colors are blended over the lifetime
+#define FUDE_PARTICLE_VERTEX_SHADER \
+    "#version 330 core\n" \
+    "layout(location=0) in vec4 a_instance;\n" \
+    "layout(location=1) in vec4 a_color_start;\n" \
+    "layout(location=2) in vec4 a_color_end;\n" \
+    "out vec4 v_color;\n" \
+    "out vec2 v_corner;\n" \
+    "uniform mat4 u_mvp;\n" \
+    "void main()\n" \
+    "{\n" \
+    "    v_corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1))*2.0 - 1.0;\n" \
+    "    gl_Position = u_mvp*vec4(a_instance.xy + v_corner*a_instance.z, 0.0, 1.0);\n" \
+    "    v_color = mix(a_color_start, a_color_end, a_instance.w);\n" \
+    "}"
+
+// a disc antialiased over the last pixel inside its radius
+#define FUDE_PARTICLE_FRAGMENT_SHADER \
+    "#version 330 core\n" \
+    "layout(location=0) out vec4 o_color;\n" \
+    "in vec4 v_color;\n" \
+    "in vec2 v_corner;\n" \
     "void main()\n" \
     "{\n" \
-    "    switch(int(v_tex_index)) {\n" \
-    "    case 1: o_color = texture(u_texture_samplers[1], v_tex_coords); break;\n" \
-    "    case 2: o_color = texture(u_texture_samplers[2], v_tex_coords); break;\n" \
-    "    case 3: o_color = texture(u_texture_samplers[3], v_tex_coords); break;\n" \
-    "    case 4: o_color = texture(u_texture_samplers[4], v_tex_coords); break;\n" \
-    "    case 5: o_color = texture(u_texture_samplers[5], v_tex_coords); break;\n" \
-    "    case 6: o_color = texture(u_texture_samplers[6], v_tex_coords); break;\n" \
-    "    case 7: o_color = texture(u_texture_samplers[7], v_tex_coords); break;\n" \
-    "    default: o_color = v_color; break;\n" \
-    "    }\n"\
+    "    float d = length(v_corner);\n" \
+    "    float w = max(fwidth(d), 1e-6);\n" \
+    "    o_color = vec4(v_color.rgb, v_color.a*clamp((1.0 - d)/w, 0.0, 1.0));\n" \
     "}"
 
 #endif // FUDE_INTERNAL_H
@@ -0,0 +1,415 @@
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+
+#include <math.h>   // powf()
+#include <stddef.h> // offsetof()
+
+// particles are kept in structure-of-arrays pools so f_update_particles integrates four at a time,
+// and the same pass writes the instance stream f_draw_particles uploads: (x, y, radius, fraction of
+// the lifetime) per particle plus the start/end colors, which never change and are uploaded as stored.
+// Dead particles are replaced by the last live one, so the draw order isn't stable
+#define FUDE_PARTICLE_CHUNK 16384 // particles per job of a parallel update, a multiple of 4
+
+struct fude_particles {
+    uint32_t count, capacity;
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    float* age;        // seconds
+    float* inv_life;   // 1/lifetime
+    float* size;       // radius at birth
+    float* size_delta; // size_end - size_start
+    _fude_particle_colors* colors;
+    V4f* instances;
+    uint32_t* dead;        // indices that died in the last update, FUDE_PARTICLE_CHUNK per chunk
+    uint32_t* dead_counts; // per chunk
+    V2f gravity;
+    float drag;
+    uint32_t random;       // xorshift32 state
+    _fude_thread_pool* pool;
+    void* memory;          // every array above
+};
+
+// the program is linked by the first f_draw_particles, the buffers are made by the first draw on the
+// thread with the context, VAOs aren't shared with the render thread
+struct fude_particle_stream {
+    fude_shader shader; // only uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC] is set
+    uint32_t vao, vbo;
+    uint32_t capacity;  // particles that fit in vbo
+    bool failed;        // the program didn't build, draw shapes instead
+};
+
+//======================================================================
+// Pools
+//======================================================================
+fude_result f_create_particles(fude_particles** particles, const fude_particles_config* config)
+{
+    if(!particles || !config || config->capacity == 0 || config->capacity > 0xFFFFFFFFu - 4)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+
+    fude_particles* result = f_malloc(sizeof(fude_particles));
+    if(!result) return FUDE_ERROR;
+    f_memzero(result, sizeof(fude_particles));
+
+    // rounded up to whole SIMD groups so the last one never needs a scalar tail
+    const uint64_t padded = ((uint64_t)config->capacity + 3) & ~(uint64_t)3;
+    const uint64_t chunks = (padded + FUDE_PARTICLE_CHUNK - 1)/FUDE_PARTICLE_CHUNK;
+    const uint64_t nbytes = padded*(8*sizeof(float) + sizeof(_fude_particle_colors) + sizeof(V4f) + sizeof(uint32_t)) +
+        chunks*sizeof(uint32_t);
+    result->memory = f_malloc(nbytes);
+    if(!result->memory) {
+        f_free(result);
+        return FUDE_ERROR;
+    }
+    float* floats = (float*)result->memory;
+    result->x          = floats + 0*padded;
+    result->y          = floats + 1*padded;
+    result->vx         = floats + 2*padded;
+    result->vy         = floats + 3*padded;
+    result->age        = floats + 4*padded;
+    result->inv_life   = floats + 5*padded;
+    result->size       = floats + 6*padded;
+    result->size_delta = floats + 7*padded;
+    result->instances = (V4f*)(floats + 8*padded);
+    result->colors = (_fude_particle_colors*)(result->instances + padded);
+    result->dead = (uint32_t*)(result->colors + padded);
+    result->dead_counts = result->dead + padded;
+    f_memzero(result->memory, nbytes);
+
+    result->capacity = config->capacity;
+    result->gravity = config->gravity;
+    result->drag = config->drag;
+    result->random = config->seed ? config->seed : 0x9E3779B9u;
+    if(config->threads != 1)
+        result->pool = _fude_create_thread_pool(config->threads);
+
+    *particles = result;
+    return FUDE_OK;
+}
+
+void f_destroy_particles(fude_particles* particles)
+{
+    if(!particles) return;
+    _fude_destroy_thread_pool(particles->pool);
+    f_free(particles->memory);
+    f_free(particles);
+}
+
+void f_clear_particles(fude_particles* particles)
+{
+    if(particles) particles->count = 0;
+}
+
+uint32_t f_particle_count(const fude_particles* particles)
+{
+    return particles ? particles->count : 0;
+}
+
+// uniform in [-1, 1)
+static float _fude_particle_random(fude_particles* particles)
+{
+    uint32_t x = particles->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    particles->random = x;
+    return (float)(int32_t)x*(1.0f/2147483648.0f);
+}
+
+static void _fude_particle_bytes(uint8_t bytes[4], uint32_t color)
+{
+    bytes[0] = (uint8_t)(color >> 24);
+    bytes[1] = (uint8_t)(color >> 16);
+    bytes[2] = (uint8_t)(color >> 8);
+    bytes[3] = (uint8_t)color;
+}
+
+// returns how many fit
+uint32_t f_emit_particles(fude_particles* particles, const fude_particle_emitter* emitter, uint32_t count)
+{
+    if(!particles || !emitter) return 0;
+    if(count > particles->capacity - particles->count)
+        count = particles->capacity - particles->count;
+
+    _fude_particle_colors colors;
+    _fude_particle_bytes(colors.start, emitter->color_start);
+    _fude_particle_bytes(colors.end, emitter->color_end);
+    const float size_delta = emitter->size_end - emitter->size_start;
+
+    for(uint32_t k = 0; k < count; ++k) {
+        const uint32_t i = particles->count + k;
+        const float x = emitter->position.x + emitter->position_spread.x*_fude_particle_random(particles);
+        const float y = emitter->position.y + emitter->position_spread.y*_fude_particle_random(particles);
+        const float life = emitter->life + emitter->life_spread*_fude_particle_random(particles);
+        particles->x[i] = x;
+        particles->y[i] = y;
+        particles->vx[i] = emitter->velocity.x + emitter->velocity_spread.x*_fude_particle_random(particles);
+        particles->vy[i] = emitter->velocity.y + emitter->velocity_spread.y*_fude_particle_random(particles);
+        particles->age[i] = 0.0f;
+        particles->inv_life[i] = life > 0.0f ? 1.0f/life : 1e30f; // dies in the next update
+        particles->size[i] = emitter->size_start;
+        particles->size_delta[i] = size_delta;
+        particles->colors[i] = colors;
+        particles->instances[i] = (V4f){ .x = x, .y = y, .z = emitter->size_start, .w = 0.0f };
+    }
+    particles->count += count;
+    return count;
+}
+
+//======================================================================
+// Update
+//======================================================================
+typedef struct {
+    fude_particles* particles;
+    float dt;
+    float damping; // velocity kept over dt
+} _fude_particle_job;
+
+static void _fude_particle_died(fude_particles* particles, uint32_t chunk, uint32_t index)
+{
+    particles->dead[chunk*FUDE_PARTICLE_CHUNK + particles->dead_counts[chunk]++] = index;
+}
+
+// semi-implicit Euler, then the instance of every particle is rewritten in place
+static void _fude_update_particle_chunk(void* user_data, uint32_t chunk)
+{
+    const _fude_particle_job* job = (const _fude_particle_job*)user_data;
+    fude_particles* p = job->particles;
+    const uint32_t begin = chunk*FUDE_PARTICLE_CHUNK;
+    const uint32_t end = p->count - begin < FUDE_PARTICLE_CHUNK ? p->count : begin + FUDE_PARTICLE_CHUNK;
+    p->dead_counts[chunk] = 0;
+
+    uint32_t i = begin;
+#if GM_SIMD_SSE
+    const __m128 dt = _mm_set1_ps(job->dt), damping = _mm_set1_ps(job->damping), one = _mm_set1_ps(1.0f);
+    const __m128 gx = _mm_set1_ps(p->gravity.x*job->dt), gy = _mm_set1_ps(p->gravity.y*job->dt);
+    for(; i < end; i += 4) {
+        __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(p->vx + i), gx), damping);
+        __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(p->vy + i), gy), damping);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(p->x + i), _mm_mul_ps(vx, dt));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(p->y + i), _mm_mul_ps(vy, dt));
+        __m128 age = _mm_add_ps(_mm_loadu_ps(p->age + i), dt);
+        __m128 t = _mm_mul_ps(age, _mm_loadu_ps(p->inv_life + i));
+        __m128 r = _mm_add_ps(_mm_loadu_ps(p->size + i), _mm_mul_ps(_mm_loadu_ps(p->size_delta + i), t));
+        _mm_storeu_ps(p->vx + i, vx);
+        _mm_storeu_ps(p->vy + i, vy);
+        _mm_storeu_ps(p->x + i, x);
+        _mm_storeu_ps(p->y + i, y);
+        _mm_storeu_ps(p->age + i, age);
+
+        int died = _mm_movemask_ps(_mm_cmpge_ps(t, one));
+        _MM_TRANSPOSE4_PS(x, y, r, t);
+        _mm_storeu_ps(p->instances[i + 0].elements, x);
+        _mm_storeu_ps(p->instances[i + 1].elements, y);
+        _mm_storeu_ps(p->instances[i + 2].elements, r);
+        _mm_storeu_ps(p->instances[i + 3].elements, t);
+        for(uint32_t lane = 0; died; ++lane, died >>= 1)
+            if((died & 1) && i + lane < end) _fude_particle_died(p, chunk, i + lane);
+    }
+#elif GM_SIMD_NEON
+    const float32x4_t dt = vdupq_n_f32(job->dt), damping = vdupq_n_f32(job->damping), one = vdupq_n_f32(1.0f);
+    const float32x4_t gx = vdupq_n_f32(p->gravity.x*job->dt), gy = vdupq_n_f32(p->gravity.y*job->dt);
+    for(; i < end; i += 4) {
+        float32x4_t vx = vmulq_f32(vaddq_f32(vld1q_f32(p->vx + i), gx), damping);
+        float32x4_t vy = vmulq_f32(vaddq_f32(vld1q_f32(p->vy + i), gy), damping);
+        float32x4x4_t instance;
+        instance.val[0] = vaddq_f32(vld1q_f32(p->x + i), vmulq_f32(vx, dt));
+        instance.val[1] = vaddq_f32(vld1q_f32(p->y + i), vmulq_f32(vy, dt));
+        float32x4_t age = vaddq_f32(vld1q_f32(p->age + i), dt);
+        instance.val[3] = vmulq_f32(age, vld1q_f32(p->inv_life + i));
+        instance.val[2] = vaddq_f32(vld1q_f32(p->size + i), vmulq_f32(vld1q_f32(p->size_delta + i), instance.val[3]));
+        vst1q_f32(p->vx + i, vx);
+        vst1q_f32(p->vy + i, vy);
+        vst1q_f32(p->x + i, instance.val[0]);
+        vst1q_f32(p->y + i, instance.val[1]);
+        vst1q_f32(p->age + i, age);
+        vst4q_f32(p->instances[i].elements, instance); // interleaves into 4 instances
+
+        uint32x4_t died = vcgeq_f32(instance.val[3], one);
+        if(vmaxvq_u32(died)) {
+            uint32_t lanes[4];
+            vst1q_u32(lanes, died);
+            for(uint32_t lane = 0; lane < 4; ++lane)
+                if(lanes[lane] && i + lane < end) _fude_particle_died(p, chunk, i + lane);
+        }
+    }
+#else
+    const float gx = p->gravity.x*job->dt, gy = p->gravity.y*job->dt;
+    for(; i < end; ++i) {
+        const float vx = (p->vx[i] + gx)*job->damping, vy = (p->vy[i] + gy)*job->damping;
+        const float x = p->x[i] + vx*job->dt, y = p->y[i] + vy*job->dt;
+        const float age = p->age[i] + job->dt;
+        const float t = age*p->inv_life[i];
+        p->vx[i] = vx;
+        p->vy[i] = vy;
+        p->x[i] = x;
+        p->y[i] = y;
+        p->age[i] = age;
+        p->instances[i] = (V4f){ .x = x, .y = y, .z = p->size[i] + p->size_delta[i]*t, .w = t };
+        if(t >= 1.0f) _fude_particle_died(p, chunk, i);
+    }
+#endif
+}
+
+static void _fude_move_particle(fude_particles* p, uint32_t from, uint32_t to)
+{
+    p->x[to] = p->x[from];
+    p->y[to] = p->y[from];
+    p->vx[to] = p->vx[from];
+    p->vy[to] = p->vy[from];
+    p->age[to] = p->age[from];
+    p->inv_life[to] = p->inv_life[from];
+    p->size[to] = p->size[from];
+    p->size_delta[to] = p->size_delta[from];
+    p->colors[to] = p->colors[from];
+    p->instances[to] = p->instances[from];
+}
+
+// chunks run on the pool, then the dead are filled from the end. Going from the highest dead index
+// down, everything past the current one is already alive, so the last particle always is
+void f_update_particles(fude_particles* particles, float dt)
+{
+    if(!particles || particles->count == 0) return;
+    F_PROFILE_BEGIN("f_update_particles");
+    _fude_particle_job job = { particles, dt, 1.0f };
+    if(particles->drag > 0.0f)
+        job.damping = particles->drag < 1.0f ? powf(1.0f - particles->drag, dt) : 0.0f;
+
+    const uint32_t chunks = (particles->count + FUDE_PARTICLE_CHUNK - 1)/FUDE_PARTICLE_CHUNK;
+    _fude_parallel_for(particles->pool, chunks, _fude_update_particle_chunk, &job);
+
+    uint32_t count = particles->count;
+    for(uint32_t chunk = chunks; chunk-- > 0;) {
+        const uint32_t* dead = particles->dead + chunk*FUDE_PARTICLE_CHUNK;
+        for(uint32_t k = particles->dead_counts[chunk]; k-- > 0;) {
+            count -= 1;
+            if(dead[k] != count) _fude_move_particle(particles, count, dead[k]);
+        }
+    }
+    particles->count = count;
+    F_PROFILE_END();
+}
+
+//======================================================================
+// Drawing
+//======================================================================
+void _fude_destroy_particle_stream(fude* app)
+{
+    fude_particle_stream* stream = app->renderer.particles;
+    if(!stream) return;
+    if(stream->shader.id) glDeleteProgram(stream->shader.id);
+    if(stream->vbo) glDeleteBuffers(1, &stream->vbo);
+    if(stream->vao) glDeleteVertexArrays(1, &stream->vao);
+    f_free(stream);
+    app->renderer.particles = NULL;
+}
+
+static fude_particle_stream* _fude_get_particle_stream(fude* app)
+{
+    if(app->renderer.particles) return app->renderer.particles;
+    fude_particle_stream* stream = f_malloc(sizeof(fude_particle_stream));
+    f_expect(stream != NULL, "Failed to allocate the particle stream at %s (%d)", __FILE__, __LINE__);
+    f_memzero(stream, sizeof(fude_particle_stream));
+    app->renderer.particles = stream;
+
+    if(_fude_link_program(&stream->shader.id, FUDE_PARTICLE_VERTEX_SHADER, FUDE_PARTICLE_FRAGMENT_SHADER) != FUDE_OK) {
+        f_trace_log(FUDE_LOG_WARNING, "Particles are drawn as shapes, the instancing program didn't build");
+        stream->failed = true;
+        return stream;
+    }
+    stream->shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC] = glGetUniformLocation(stream->shader.id,
+            FUDE_MATRIX_MVP_UNIFORM_NAME);
+    return stream;
+}
+
+// both streams go into one buffer that's orphaned every draw: instances first, colors after capacity of them.
+// Called by f_draw_particles, or by the render thread with the copies it was handed
+void _fude_draw_particles_gl(fude_renderer* renderer, const V4f* instances, const _fude_particle_colors* colors,
+        uint32_t count, fude_blend_mode blend)
+{
+    fude_particle_stream* stream = renderer->particles;
+    if(!stream->vao) {
+        glGenVertexArrays(1, &stream->vao);
+        glGenBuffers(1, &stream->vbo);
+        glBindVertexArray(stream->vao);
+        for(uint32_t i = 0; i < 3; ++i) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribDivisor(i, 1);
+        }
+    }
+
+    _fude_gpu_timer_begin_pass(&renderer->gpu_timer, FUDE_GPU_PASS_FLUSH);
+    glUseProgram(stream->shader.id);
+    glBindVertexArray(stream->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->vbo);
+    if(stream->capacity < count)
+        stream->capacity = count > 1024 ? count + count/2 : 1024;
+    const size_t colors_offset = (size_t)stream->capacity*sizeof(V4f);
+    glBufferData(GL_ARRAY_BUFFER, colors_offset + (size_t)stream->capacity*sizeof(_fude_particle_colors), NULL,
+            GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count*sizeof(V4f), instances);
+    glBufferSubData(GL_ARRAY_BUFFER, colors_offset, count*sizeof(_fude_particle_colors), colors);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(V4f), (GLvoid*)0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(_fude_particle_colors),
+            (GLvoid*)(colors_offset + offsetof(_fude_particle_colors, start)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(_fude_particle_colors),
+            (GLvoid*)(colors_offset + offsetof(_fude_particle_colors, end)));
+    _fude_set_blend_mode_gl(blend, false);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    _fude_gpu_timer_end_pass(&renderer->gpu_timer);
+}
+
+// the software backend gets one f_circle per particle, it has no instanced path
+static void _fude_draw_particle_shapes(fude* app, const fude_particles* particles)
+{
+    for(uint32_t i = 0; i < particles->count; ++i) {
+        const V4f instance = particles->instances[i];
+        const _fude_particle_colors* colors = particles->colors + i;
+        const float t = instance.w < 1.0f ? instance.w : 1.0f;
+        uint32_t color = 0;
+        for(int c = 0; c < 4; ++c) {
+            float value = (float)colors->start[c] + ((float)colors->end[c] - (float)colors->start[c])*t;
+            color = color << 8 | (uint32_t)(value + 0.5f);
+        }
+        f_circle(app, instance.x, instance.y, instance.z, color);
+    }
+}
+
+// like the default shader: the 2D or 3D camera f_use_camera set up for it, then the matrix stack
+void f_draw_particles(fude* app, const fude_particles* particles)
+{
+    if(!particles || particles->count == 0) return;
+    fude_renderer* renderer = &app->renderer;
+    fude_particle_stream* stream = app->software ? NULL : _fude_get_particle_stream(app);
+    if(!stream || stream->failed) {
+        _fude_draw_particle_shapes(app, particles);
+        return;
+    }
+    _fude_break_batch(app, FUDE_BATCH_BREAK_INSTANCES);
+
+    M4f mvp = renderer->camera.active && renderer->camera.shader == renderer->default_shader.id ?
+        renderer->camera.view_projection : m4f_identity();
+    if(renderer->transform.current.kind != FUDE_TRANSFORM_IDENTITY)
+        mvp = m4f_dot(mvp, renderer->transform.current.matrix);
+    _fude_push_shader_uniform(app, stream->shader, stream->shader.uniform_loc[FUDE_UNIFORM_MATRIX_MVP_LOC],
+            FUDE_SHADERDT_MAT4, 1, mvp.elements, false);
+
+    // the render thread gets copies, the pools change with the next f_update_particles
+    const uint32_t count = particles->count;
+    if(app->render_thread)
+        _fude_record_draw_instances(app, particles->instances, particles->colors, count);
+    else
+        _fude_draw_particles_gl(renderer, particles->instances, particles->colors, count, renderer->blend_mode);
+
+    fude_render_stats* stats = &renderer->stats.current;
+    stats->draw_calls += 1;
+    stats->instances += count;
+    stats->bytes_uploaded += (uint64_t)count*(sizeof(V4f) + sizeof(_fude_particle_colors));
+    if(stream->shader.id != renderer->stats.last_program) {
+        stats->program_switches += 1;
+        renderer->stats.last_program = stream->shader.id;
+    }
+}
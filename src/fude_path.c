@@ -0,0 +1,718 @@
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+
+#include <math.h> // sqrtf(), fabsf(), ceilf(), floorf(), log2f(), exp2f(), acosf(), atan2f(), cosf(), sinf()
+
+// paths are flattened for the scale they're drawn at, triangulated and cached per fude instance by
+// path hash, operation and scale bucket. Everything is emptied at once when one part is full
+#define FUDE_PATH_CACHE_SLOTS 4096 // power of two, at most half of them are used
+#define FUDE_PATH_CACHE_VERTICES (1024*1024)
+#define FUDE_PATH_SCALE_STEPS 4    // buckets per doubling of the scale
+#define FUDE_PATH_MAXIMUM_SEGMENTS 256 // per curve, round join or cap
+#define FUDE_PATH_NO_NODE 0xFFFFFFFFu
+
+#define FUDE_PATH_FILL   0
+#define FUDE_PATH_STROKE 1
+
+typedef struct {
+    uint64_t hash;         // the path's, 0 = empty slot
+    uint32_t key;          // operation, join, cap and scale bucket
+    float width;           // strokes only
+    uint32_t point_count;  // two paths with the same hash also need the same size
+    uint32_t first, count; // triangle vertices in the cache
+} _fude_path_entry;
+
+typedef struct {
+    uint32_t first, count; // flattened points
+    float area;            // signed, positive is counter-clockwise with y up
+    bool closed;
+} _fude_contour;
+
+// circular doubly linked polygon for ear clipping, bridged holes visit some points twice
+typedef struct {
+    uint32_t point;
+    uint32_t prev, next;
+} _fude_ring_node;
+
+struct fude_path_cache {
+    _fude_path_entry* slots;
+    uint32_t used;
+    struct {
+        V2f* data; // triangles
+        uint32_t count, capacity;
+    } vertices;
+
+    // scratch of the tessellation in progress
+    struct {
+        V2f* data;
+        uint32_t count, capacity;
+    } points;
+    struct {
+        _fude_contour* data;
+        uint32_t count, capacity;
+    } contours;
+    struct {
+        _fude_ring_node* data;
+        uint32_t count, capacity;
+    } nodes;
+    struct {
+        uint32_t* data; // hole rings of the outer contour being filled
+        uint32_t count, capacity;
+    } holes;
+};
+
+//======================================================================
+// Building
+//======================================================================
+// _fude_hash like display lists, kept up to date as commands are added
+static void _fude_path_hash(fude_path* path, const void* data, size_t nbytes)
+{
+    uint64_t hash = _fude_hash(path->hash ? path->hash : FUDE_HASH_SEED, data, nbytes);
+    path->hash = hash ? hash : 1;
+}
+
+static void _fude_path_push(fude_path* path, fude_path_command command, const V2f* points, uint32_t count)
+{
+    if(!path) return;
+    path->commands.data = _fude_grow_array(path->commands.data, path->commands.count, &path->commands.capacity,
+            path->commands.count + 1, sizeof(uint8_t));
+    path->points.data = _fude_grow_array(path->points.data, path->points.count, &path->points.capacity,
+            path->points.count + count, sizeof(V2f));
+    path->commands.data[path->commands.count++] = (uint8_t)command;
+    for(uint32_t i = 0; i < count; ++i)
+        path->points.data[path->points.count++] = points[i];
+
+    uint32_t word = (uint32_t)command;
+    _fude_path_hash(path, &word, sizeof(word));
+    _fude_path_hash(path, points, count*sizeof(V2f));
+}
+
+void f_path_move_to(fude_path* path, float x, float y)
+{
+    V2f points[1] = { v2f(x, y) };
+    _fude_path_push(path, FUDE_PATH_MOVE, points, 1);
+}
+
+void f_path_line_to(fude_path* path, float x, float y)
+{
+    V2f points[1] = { v2f(x, y) };
+    _fude_path_push(path, FUDE_PATH_LINE, points, 1);
+}
+
+void f_path_quadratic_to(fude_path* path, float cx, float cy, float x, float y)
+{
+    V2f points[2] = { v2f(cx, cy), v2f(x, y) };
+    _fude_path_push(path, FUDE_PATH_QUADRATIC, points, 2);
+}
+
+void f_path_cubic_to(fude_path* path, float c0x, float c0y, float c1x, float c1y, float x, float y)
+{
+    V2f points[3] = { v2f(c0x, c0y), v2f(c1x, c1y), v2f(x, y) };
+    _fude_path_push(path, FUDE_PATH_CUBIC, points, 3);
+}
+
+void f_path_close(fude_path* path)
+{
+    _fude_path_push(path, FUDE_PATH_CLOSE, NULL, 0);
+}
+
+// keeps the storage for the next path
+void f_path_clear(fude_path* path)
+{
+    if(!path) return;
+    path->commands.count = 0;
+    path->points.count = 0;
+    path->hash = 0;
+}
+
+void f_destroy_path(fude_path* path)
+{
+    if(!path) return;
+    f_free(path->commands.data);
+    f_free(path->points.data);
+    f_memzero(path, sizeof(fude_path));
+}
+
+//======================================================================
+// Flattening
+//======================================================================
+static void _fude_end_contour(fude_path_cache* cache)
+{
+    if(cache->contours.count == 0) return;
+    _fude_contour* contour = cache->contours.data + cache->contours.count - 1;
+    contour->count = cache->points.count - contour->first;
+    // closing back onto the first point adds nothing
+    if(contour->closed && contour->count > 1) {
+        V2f first = cache->points.data[contour->first], last = cache->points.data[cache->points.count - 1];
+        if(first.x == last.x && first.y == last.y) {
+            contour->count -= 1;
+            cache->points.count -= 1;
+        }
+    }
+}
+
+static void _fude_add_point(fude_path_cache* cache, V2f point)
+{
+    _fude_contour* contour = cache->contours.data + cache->contours.count - 1;
+    if(cache->points.count > contour->first) {
+        V2f last = cache->points.data[cache->points.count - 1];
+        if(last.x == point.x && last.y == point.y) return;
+    }
+    cache->points.data = _fude_grow_array(cache->points.data, cache->points.count, &cache->points.capacity,
+            cache->points.count + 1, sizeof(V2f));
+    cache->points.data[cache->points.count++] = point;
+}
+
+static void _fude_begin_contour(fude_path_cache* cache, V2f point)
+{
+    _fude_end_contour(cache);
+    cache->contours.data = _fude_grow_array(cache->contours.data, cache->contours.count, &cache->contours.capacity,
+            cache->contours.count + 1, sizeof(_fude_contour));
+    cache->contours.data[cache->contours.count++] = (_fude_contour){ .first = cache->points.count };
+    _fude_add_point(cache, point);
+}
+
+// Wang's formula: segments for a flattened Bezier of degree n to stay within the tolerance is
+// sqrt(n*(n - 1)/8*|largest second difference|/tolerance), in pixels
+static uint32_t _fude_curve_segments(float second_difference, float degree_factor, float scale)
+{
+    float n = ceilf(sqrtf(degree_factor*second_difference*scale/FUDE_PATH_TOLERANCE));
+    if(!(n >= 1.0f)) return 1;
+    return n > (float)FUDE_PATH_MAXIMUM_SEGMENTS ? FUDE_PATH_MAXIMUM_SEGMENTS : (uint32_t)n;
+}
+
+static void _fude_flatten_path(fude_path_cache* cache, const fude_path* path, float scale)
+{
+    cache->points.count = 0;
+    cache->contours.count = 0;
+    const V2f* points = path->points.data;
+    V2f pen = v2f(0.0f, 0.0f), start = pen;
+    bool open = false; // a contour takes the next points
+    uint32_t k = 0;
+    for(uint32_t i = 0; i < path->commands.count; ++i) {
+        fude_path_command command = (fude_path_command)path->commands.data[i];
+        if(command == FUDE_PATH_MOVE) {
+            pen = start = points[k++];
+            _fude_begin_contour(cache, pen);
+            open = true;
+            continue;
+        }
+        if(command == FUDE_PATH_CLOSE) {
+            if(open) cache->contours.data[cache->contours.count - 1].closed = true;
+            pen = start;
+            open = false;
+            continue;
+        }
+
+        // drawing after a close starts over from where the closed contour began
+        if(!open) {
+            start = pen;
+            _fude_begin_contour(cache, pen);
+            open = true;
+        }
+        if(command == FUDE_PATH_LINE) {
+            pen = points[k++];
+            _fude_add_point(cache, pen);
+        } else if(command == FUDE_PATH_QUADRATIC) {
+            V2f c = points[k], e = points[k + 1];
+            k += 2;
+            float dx = pen.x - 2.0f*c.x + e.x, dy = pen.y - 2.0f*c.y + e.y;
+            uint32_t n = _fude_curve_segments(sqrtf(dx*dx + dy*dy), 0.25f, scale);
+            for(uint32_t s = 1; s <= n; ++s) {
+                float t = (float)s/(float)n, u = 1.0f - t;
+                _fude_add_point(cache, v2f(u*u*pen.x + 2.0f*u*t*c.x + t*t*e.x, u*u*pen.y + 2.0f*u*t*c.y + t*t*e.y));
+            }
+            pen = e;
+        } else if(command == FUDE_PATH_CUBIC) {
+            V2f c0 = points[k], c1 = points[k + 1], e = points[k + 2];
+            k += 3;
+            float ax = pen.x - 2.0f*c0.x + c1.x, ay = pen.y - 2.0f*c0.y + c1.y;
+            float bx = c0.x - 2.0f*c1.x + e.x, by = c0.y - 2.0f*c1.y + e.y;
+            float a = sqrtf(ax*ax + ay*ay), b = sqrtf(bx*bx + by*by);
+            uint32_t n = _fude_curve_segments(a > b ? a : b, 0.75f, scale);
+            for(uint32_t s = 1; s <= n; ++s) {
+                float t = (float)s/(float)n, u = 1.0f - t;
+                float w0 = u*u*u, w1 = 3.0f*u*u*t, w2 = 3.0f*u*t*t, w3 = t*t*t;
+                _fude_add_point(cache, v2f(w0*pen.x + w1*c0.x + w2*c1.x + w3*e.x, w0*pen.y + w1*c0.y + w2*c1.y + w3*e.y));
+            }
+            pen = e;
+        }
+    }
+    _fude_end_contour(cache);
+
+    for(uint32_t i = 0; i < cache->contours.count; ++i) {
+        _fude_contour* contour = cache->contours.data + i;
+        const V2f* p = cache->points.data + contour->first;
+        float area = 0.0f;
+        for(uint32_t j = 0, prev = contour->count - 1; j < contour->count; prev = j++)
+            area += p[prev].x*p[j].y - p[j].x*p[prev].y;
+        contour->area = 0.5f*area;
+    }
+}
+
+//======================================================================
+// Fills
+//======================================================================
+static void _fude_emit_triangle(fude_path_cache* cache, V2f a, V2f b, V2f c)
+{
+    cache->vertices.data = _fude_grow_array(cache->vertices.data, cache->vertices.count, &cache->vertices.capacity,
+            cache->vertices.count + 3, sizeof(V2f));
+    V2f* v = cache->vertices.data + cache->vertices.count;
+    v[0] = a; v[1] = b; v[2] = c;
+    cache->vertices.count += 3;
+}
+
+static float _fude_cross(V2f a, V2f b, V2f c)
+{
+    return (b.x - a.x)*(c.y - a.y) - (b.y - a.y)*(c.x - a.x);
+}
+
+static bool _fude_contour_contains(const fude_path_cache* cache, const _fude_contour* contour, V2f point)
+{
+    const V2f* p = cache->points.data + contour->first;
+    bool inside = false;
+    for(uint32_t j = 0, prev = contour->count - 1; j < contour->count; prev = j++) {
+        if((p[j].y > point.y) != (p[prev].y > point.y) &&
+                point.x < (p[prev].x - p[j].x)*(point.y - p[j].y)/(p[prev].y - p[j].y) + p[j].x)
+            inside = !inside;
+    }
+    return inside;
+}
+
+// a ring over the contour's points, counter-clockwise when ccw is set and clockwise otherwise
+static uint32_t _fude_make_ring(fude_path_cache* cache, const _fude_contour* contour, bool ccw)
+{
+    const uint32_t first = cache->nodes.count, count = contour->count;
+    const bool reverse = (contour->area > 0.0f) != ccw;
+    cache->nodes.data = _fude_grow_array(cache->nodes.data, cache->nodes.count, &cache->nodes.capacity,
+            first + count, sizeof(_fude_ring_node));
+    for(uint32_t i = 0; i < count; ++i) {
+        cache->nodes.data[first + i] = (_fude_ring_node){
+            .point = contour->first + (reverse ? count - 1 - i : i),
+            .prev = first + (i + count - 1)%count,
+            .next = first + (i + 1)%count,
+        };
+    }
+    cache->nodes.count += count;
+    return first;
+}
+
+#define _FUDE_NODE(i) (cache->nodes.data[(i)])
+#define _FUDE_POINT(i) (cache->points.data[cache->nodes.data[(i)].point])
+
+static bool _fude_in_triangle(V2f a, V2f b, V2f c, V2f p)
+{
+    float d0 = _fude_cross(a, b, p), d1 = _fude_cross(b, c, p), d2 = _fude_cross(c, a, p);
+    return (d0 >= 0.0f && d1 >= 0.0f && d2 >= 0.0f) || (d0 <= 0.0f && d1 <= 0.0f && d2 <= 0.0f);
+}
+
+// a vertex of the outer ring that the hole's leftmost point sees: cast a ray to the left, take the
+// closest edge it hits and its left end (never right of the hole), unless another vertex inside the
+// triangle between the point, the hit and that end blocks it, then the one at the smallest angle
+// to the ray. Eberly's algorithm like earcut does it
+static uint32_t _fude_find_bridge(fude_path_cache* cache, uint32_t hole, uint32_t outer)
+{
+    const V2f h = _FUDE_POINT(hole);
+    float hit_x = -INFINITY;
+    uint32_t bridge = FUDE_PATH_NO_NODE, node = outer;
+    do {
+        V2f a = _FUDE_POINT(node), b = _FUDE_POINT(_FUDE_NODE(node).next);
+        if(a.y != b.y && ((a.y <= h.y && h.y <= b.y) || (b.y <= h.y && h.y <= a.y))) {
+            float x = a.x + (h.y - a.y)*(b.x - a.x)/(b.y - a.y);
+            if(x <= h.x && x > hit_x) {
+                hit_x = x;
+                bridge = a.x < b.x ? node : _FUDE_NODE(node).next;
+                if(x == h.x && (h.y == a.y || h.y == b.y))
+                    return h.y == a.y ? node : _FUDE_NODE(node).next;
+            }
+        }
+        node = _FUDE_NODE(node).next;
+    } while(node != outer);
+    if(bridge == FUDE_PATH_NO_NODE) return bridge;
+
+    const V2f m = _FUDE_POINT(bridge);
+    const V2f hit = v2f(hit_x, h.y);
+    float best = INFINITY;
+    uint32_t candidate = bridge;
+    node = outer;
+    do {
+        V2f p = _FUDE_POINT(node);
+        if(node != bridge && p.x >= m.x && p.x < h.x && _fude_in_triangle(h, hit, m, p)) {
+            float tangent = fabsf(h.y - p.y)/(h.x - p.x);
+            if(tangent < best || (tangent == best && p.x > _FUDE_POINT(candidate).x)) {
+                best = tangent;
+                candidate = node;
+            }
+        }
+        node = _FUDE_NODE(node).next;
+    } while(node != outer);
+    return candidate;
+}
+
+// outer ... a -> b ... hole ... b' -> a' ... outer, two zero width edges join the rings
+static void _fude_splice_rings(fude_path_cache* cache, uint32_t a, uint32_t b)
+{
+    cache->nodes.data = _fude_grow_array(cache->nodes.data, cache->nodes.count, &cache->nodes.capacity,
+            cache->nodes.count + 2, sizeof(_fude_ring_node));
+    const uint32_t a2 = cache->nodes.count++, b2 = cache->nodes.count++;
+    const uint32_t an = _FUDE_NODE(a).next, bp = _FUDE_NODE(b).prev;
+    _FUDE_NODE(a2).point = _FUDE_NODE(a).point;
+    _FUDE_NODE(b2).point = _FUDE_NODE(b).point;
+    _FUDE_NODE(a).next = b;   _FUDE_NODE(b).prev = a;
+    _FUDE_NODE(a2).next = an; _FUDE_NODE(an).prev = a2;
+    _FUDE_NODE(b2).next = a2; _FUDE_NODE(a2).prev = b2;
+    _FUDE_NODE(bp).next = b2; _FUDE_NODE(b2).prev = bp;
+}
+
+// convex, and no reflex vertex of the ring inside. Vertices on the corners are bridge copies
+static bool _fude_is_ear(fude_path_cache* cache, uint32_t ear)
+{
+    const uint32_t prev = _FUDE_NODE(ear).prev, next = _FUDE_NODE(ear).next;
+    const V2f a = _FUDE_POINT(prev), b = _FUDE_POINT(ear), c = _FUDE_POINT(next);
+    if(_fude_cross(a, b, c) <= 0.0f) return false;
+
+    const float min_x = a.x < b.x ? (a.x < c.x ? a.x : c.x) : (b.x < c.x ? b.x : c.x);
+    const float max_x = a.x > b.x ? (a.x > c.x ? a.x : c.x) : (b.x > c.x ? b.x : c.x);
+    const float min_y = a.y < b.y ? (a.y < c.y ? a.y : c.y) : (b.y < c.y ? b.y : c.y);
+    const float max_y = a.y > b.y ? (a.y > c.y ? a.y : c.y) : (b.y > c.y ? b.y : c.y);
+    for(uint32_t node = _FUDE_NODE(next).next; node != prev; node = _FUDE_NODE(node).next) {
+        V2f p = _FUDE_POINT(node);
+        if(p.x < min_x || p.x > max_x || p.y < min_y || p.y > max_y) continue;
+        if((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == c.x && p.y == c.y)) continue;
+        if(_fude_cross(_FUDE_POINT(_FUDE_NODE(node).prev), p, _FUDE_POINT(_FUDE_NODE(node).next)) > 0.0f) continue;
+        if(_fude_cross(a, b, p) >= 0.0f && _fude_cross(b, c, p) >= 0.0f && _fude_cross(c, a, p) >= 0.0f)
+            return false;
+    }
+    return true;
+}
+
+static void _fude_clip_ears(fude_path_cache* cache, uint32_t ear, uint32_t count)
+{
+    uint32_t misses = 0;
+    while(count > 3) {
+        const uint32_t prev = _FUDE_NODE(ear).prev, next = _FUDE_NODE(ear).next;
+        const bool flat = _fude_cross(_FUDE_POINT(prev), _FUDE_POINT(ear), _FUDE_POINT(next)) == 0.0f;
+        // a whole lap without an ear only happens with self-intersections, clip anyway to finish
+        const bool forced = misses > count;
+        if(flat || forced || _fude_is_ear(cache, ear)) {
+            if(!flat)
+                _fude_emit_triangle(cache, _FUDE_POINT(prev), _FUDE_POINT(ear), _FUDE_POINT(next));
+            _FUDE_NODE(prev).next = next;
+            _FUDE_NODE(next).prev = prev;
+            count -= 1;
+            misses = 0;
+            ear = next;
+            continue;
+        }
+        ear = next;
+        misses += 1;
+    }
+    const uint32_t prev = _FUDE_NODE(ear).prev, next = _FUDE_NODE(ear).next;
+    if(_fude_cross(_FUDE_POINT(prev), _FUDE_POINT(ear), _FUDE_POINT(next)) != 0.0f)
+        _fude_emit_triangle(cache, _FUDE_POINT(prev), _FUDE_POINT(ear), _FUDE_POINT(next));
+}
+
+// contours winding like the largest one are filled, the others are holes in the smallest
+// filled contour around them. Holes are bridged into their outer ring, then ears are clipped
+static void _fude_fill_contours(fude_path_cache* cache)
+{
+    float largest = 0.0f;
+    for(uint32_t i = 0; i < cache->contours.count; ++i) {
+        float area = cache->contours.data[i].area;
+        if(cache->contours.data[i].count >= 3 && fabsf(area) > fabsf(largest)) largest = area;
+    }
+    if(largest == 0.0f) return;
+
+    for(uint32_t o = 0; o < cache->contours.count; ++o) {
+        const _fude_contour* outer = cache->contours.data + o;
+        if(outer->count < 3 || outer->area == 0.0f || (outer->area > 0.0f) != (largest > 0.0f)) continue;
+
+        cache->nodes.count = 0;
+        cache->holes.count = 0;
+        uint32_t ring = _fude_make_ring(cache, outer, true);
+        uint32_t count = outer->count;
+        for(uint32_t h = 0; h < cache->contours.count; ++h) {
+            const _fude_contour* hole = cache->contours.data + h;
+            if(hole->count < 3 || hole->area == 0.0f || (hole->area > 0.0f) == (largest > 0.0f)) continue;
+            V2f point = cache->points.data[hole->first];
+            uint32_t parent = FUDE_PATH_NO_NODE;
+            for(uint32_t c = 0; c < cache->contours.count; ++c) {
+                const _fude_contour* candidate = cache->contours.data + c;
+                if(candidate->count < 3 || (candidate->area > 0.0f) != (largest > 0.0f)) continue;
+                if(parent != FUDE_PATH_NO_NODE && fabsf(candidate->area) >= fabsf(cache->contours.data[parent].area)) continue;
+                if(_fude_contour_contains(cache, candidate, point)) parent = c;
+            }
+            if(parent != o) continue;
+
+            // the leftmost point of each hole, holes get bridged from left to right
+            uint32_t hole_ring = _fude_make_ring(cache, hole, false), leftmost = hole_ring;
+            for(uint32_t node = _FUDE_NODE(hole_ring).next; node != hole_ring; node = _FUDE_NODE(node).next) {
+                V2f p = _FUDE_POINT(node), l = _FUDE_POINT(leftmost);
+                if(p.x < l.x || (p.x == l.x && p.y < l.y)) leftmost = node;
+            }
+            cache->holes.data = _fude_grow_array(cache->holes.data, cache->holes.count, &cache->holes.capacity,
+                    cache->holes.count + 1, sizeof(uint32_t));
+            uint32_t i = cache->holes.count++;
+            for(; i > 0 && _FUDE_POINT(cache->holes.data[i - 1]).x > _FUDE_POINT(leftmost).x; --i)
+                cache->holes.data[i] = cache->holes.data[i - 1];
+            cache->holes.data[i] = leftmost;
+            count += hole->count;
+        }
+
+        for(uint32_t i = 0; i < cache->holes.count; ++i) {
+            uint32_t hole = cache->holes.data[i];
+            uint32_t bridge = _fude_find_bridge(cache, hole, ring);
+            if(bridge == FUDE_PATH_NO_NODE) {
+                // touches nothing to its left, it can't be inside after all
+                uint32_t node = hole;
+                do { count -= 1; node = _FUDE_NODE(node).next; } while(node != hole);
+                continue;
+            }
+            _fude_splice_rings(cache, bridge, hole);
+            count += 2;
+        }
+        _fude_clip_ears(cache, ring, count);
+    }
+}
+
+//======================================================================
+// Strokes
+//======================================================================
+// rotates offset around center by angle in steps that stay within the tolerance
+static void _fude_stroke_fan(fude_path_cache* cache, V2f center, V2f offset, float angle, float radius, float scale)
+{
+    float pixels = radius*scale;
+    float step = pixels > FUDE_PATH_TOLERANCE ? 2.0f*acosf(1.0f - FUDE_PATH_TOLERANCE/pixels) : 3.14159265f;
+    float n = ceilf(fabsf(angle)/step);
+    uint32_t segments = !(n >= 1.0f) ? 1 : (n > (float)FUDE_PATH_MAXIMUM_SEGMENTS ? FUDE_PATH_MAXIMUM_SEGMENTS : (uint32_t)n);
+    const float c = cosf(angle/(float)segments), s = sinf(angle/(float)segments);
+    for(uint32_t i = 0; i < segments; ++i) {
+        V2f next = v2f(offset.x*c - offset.y*s, offset.x*s + offset.y*c);
+        _fude_emit_triangle(cache, center, v2f(center.x + offset.x, center.y + offset.y),
+                v2f(center.x + next.x, center.y + next.y));
+        offset = next;
+    }
+}
+
+// fills the gap on the outside of the turn from direction d0 to d1, the segment quads cover the inside
+static void _fude_stroke_join(fude_path_cache* cache, V2f p, V2f d0, V2f d1, float half_width,
+        fude_line_join join, float scale)
+{
+    const float cross = d0.x*d1.y - d0.y*d1.x, dot = d0.x*d1.x + d0.y*d1.y;
+    if(cross == 0.0f && dot > 0.0f) return;
+    const float side = cross > 0.0f ? -1.0f : 1.0f;
+    const V2f n0 = v2f(-d0.y*half_width*side, d0.x*half_width*side);
+    const V2f n1 = v2f(-d1.y*half_width*side, d1.x*half_width*side);
+
+    if(join == FUDE_JOIN_ROUND) {
+        float angle = atan2f(cross, dot);
+        if(side > 0.0f && angle > 0.0f) angle = -angle;
+        _fude_stroke_fan(cache, p, n0, angle, half_width, scale);
+        return;
+    }
+    const V2f o0 = v2f(p.x + n0.x, p.y + n0.y), o1 = v2f(p.x + n1.x, p.y + n1.y);
+    if(join == FUDE_JOIN_MITER) {
+        // the tip is half_width/cos(half the angle between the normals) out along their bisector
+        V2f bisector = v2f(n0.x + n1.x, n0.y + n1.y);
+        float length = sqrtf(bisector.x*bisector.x + bisector.y*bisector.y);
+        float cos_half = length/(2.0f*half_width);
+        if(cos_half*FUDE_PATH_MITER_LIMIT >= 1.0f) {
+            float reach = half_width/(cos_half*length);
+            V2f tip = v2f(p.x + bisector.x*reach, p.y + bisector.y*reach);
+            _fude_emit_triangle(cache, p, o0, tip);
+            _fude_emit_triangle(cache, p, tip, o1);
+            return;
+        }
+    }
+    _fude_emit_triangle(cache, p, o0, o1);
+}
+
+// d points away from the stroke
+static void _fude_stroke_cap(fude_path_cache* cache, V2f p, V2f d, float half_width, fude_line_cap cap, float scale)
+{
+    const V2f n = v2f(-d.y*half_width, d.x*half_width);
+    if(cap == FUDE_CAP_ROUND) {
+        _fude_stroke_fan(cache, p, n, -3.14159265f, half_width, scale);
+    } else if(cap == FUDE_CAP_SQUARE) {
+        const V2f e = v2f(d.x*half_width, d.y*half_width);
+        const V2f a = v2f(p.x + n.x, p.y + n.y), b = v2f(p.x - n.x, p.y - n.y);
+        const V2f c = v2f(b.x + e.x, b.y + e.y), f = v2f(a.x + e.x, a.y + e.y);
+        _fude_emit_triangle(cache, a, b, c);
+        _fude_emit_triangle(cache, a, c, f);
+    }
+}
+
+static V2f _fude_direction(V2f a, V2f b)
+{
+    float dx = b.x - a.x, dy = b.y - a.y;
+    float length = sqrtf(dx*dx + dy*dy);
+    return v2f(dx/length, dy/length);
+}
+
+// a quad per segment, then joins and caps. Overlaps blend twice with translucent colors
+static void _fude_stroke_contours(fude_path_cache* cache, float width, fude_line_join join, fude_line_cap cap, float scale)
+{
+    const float half_width = 0.5f*width;
+    for(uint32_t i = 0; i < cache->contours.count; ++i) {
+        const _fude_contour* contour = cache->contours.data + i;
+        const V2f* p = cache->points.data + contour->first;
+        const uint32_t n = contour->count;
+        if(n < 2) continue;
+        const bool closed = contour->closed && n >= 3;
+        const uint32_t segments = closed ? n : n - 1;
+
+        for(uint32_t s = 0; s < segments; ++s) {
+            V2f a = p[s], b = p[(s + 1)%n];
+            V2f d = _fude_direction(a, b);
+            V2f normal = v2f(-d.y*half_width, d.x*half_width);
+            V2f a0 = v2f(a.x + normal.x, a.y + normal.y), a1 = v2f(a.x - normal.x, a.y - normal.y);
+            V2f b0 = v2f(b.x + normal.x, b.y + normal.y), b1 = v2f(b.x - normal.x, b.y - normal.y);
+            _fude_emit_triangle(cache, a0, a1, b1);
+            _fude_emit_triangle(cache, a0, b1, b0);
+        }
+        for(uint32_t j = closed ? 0 : 1; j < (closed ? n : n - 1); ++j) {
+            V2f d0 = _fude_direction(p[(j + n - 1)%n], p[j]), d1 = _fude_direction(p[j], p[(j + 1)%n]);
+            _fude_stroke_join(cache, p[j], d0, d1, half_width, join, scale);
+        }
+        if(!closed) {
+            V2f d = _fude_direction(p[1], p[0]);
+            _fude_stroke_cap(cache, p[0], d, half_width, cap, scale);
+            d = _fude_direction(p[n - 2], p[n - 1]);
+            _fude_stroke_cap(cache, p[n - 1], d, half_width, cap, scale);
+        }
+    }
+}
+
+#undef _FUDE_NODE
+#undef _FUDE_POINT
+
+//======================================================================
+// Cache and drawing
+//======================================================================
+void _fude_clear_path_cache(fude_path_cache* cache)
+{
+    f_memzero(cache->slots, FUDE_PATH_CACHE_SLOTS*sizeof(_fude_path_entry));
+    cache->used = 0;
+    cache->vertices.count = 0;
+}
+
+void _fude_destroy_path_cache(fude* app)
+{
+    fude_path_cache* cache = app->renderer.paths;
+    if(!cache) return;
+    f_free(cache->slots);
+    f_free(cache->vertices.data);
+    f_free(cache->points.data);
+    f_free(cache->contours.data);
+    f_free(cache->nodes.data);
+    f_free(cache->holes.data);
+    f_free(cache);
+    app->renderer.paths = NULL;
+}
+
+static fude_path_cache* _fude_get_path_cache(fude* app)
+{
+    if(app->renderer.paths) return app->renderer.paths;
+    fude_path_cache* cache = f_malloc(sizeof(fude_path_cache));
+    f_expect(cache != NULL, "Failed to allocate the path cache at %s (%d)", __FILE__, __LINE__);
+    f_memzero(cache, sizeof(fude_path_cache));
+    cache->slots = f_malloc(FUDE_PATH_CACHE_SLOTS*sizeof(_fude_path_entry));
+    f_expect(cache->slots != NULL, "Failed to allocate the path cache at %s (%d)", __FILE__, __LINE__);
+    _fude_clear_path_cache(cache);
+    app->renderer.paths = cache;
+    return cache;
+}
+
+// pixels per path unit: the default shader's 2D camera times the longest axis of the matrix stack
+static float _fude_path_scale(const fude_renderer* renderer)
+{
+    float scale = 1.0f;
+    if(renderer->camera.active && renderer->camera.shader == renderer->default_shader.id &&
+            renderer->camera.pixel_size > 0.0f)
+        scale = 1.0f/renderer->camera.pixel_size;
+    const fude_transform* transform = &renderer->transform.current;
+    if(transform->kind == FUDE_TRANSFORM_GENERAL) {
+        const float* m = transform->matrix.elements;
+        float x = m[0]*m[0] + m[1]*m[1], y = m[4]*m[4] + m[5]*m[5];
+        scale *= sqrtf(x > y ? x : y);
+    }
+    return scale;
+}
+
+static _fude_path_entry* _fude_find_path_entry(fude_path_cache* cache, const fude_path* path, uint32_t key, float width)
+{
+    uint32_t slot = (uint32_t)((path->hash ^ (uint64_t)key*0x9e3779b97f4a7c15ull) >> 20) & (FUDE_PATH_CACHE_SLOTS - 1);
+    for(;; slot = (slot + 1) & (FUDE_PATH_CACHE_SLOTS - 1)) {
+        _fude_path_entry* entry = cache->slots + slot;
+        if(entry->hash == 0) return entry;
+        if(entry->hash == path->hash && entry->key == key && entry->width == width &&
+                entry->point_count == path->points.count)
+            return entry;
+    }
+}
+
+static void _fude_draw_path(fude* app, const fude_path* path, uint32_t operation, float width,
+        fude_line_join join, fude_line_cap cap, uint32_t color)
+{
+    if(!path || path->commands.count == 0) return;
+    fude_path_cache* cache = _fude_get_path_cache(app);
+
+    // tessellated for the top of the bucket, so it's never coarser than the tolerance
+    const float scale = _fude_path_scale(&app->renderer);
+    int bucket = scale > 0.0f ? (int)floorf(log2f(scale)*FUDE_PATH_SCALE_STEPS) : 0;
+    bucket = bucket < -512 ? -512 : (bucket > 511 ? 511 : bucket);
+    const uint32_t key = operation | (uint32_t)join << 1 | (uint32_t)cap << 3 | (uint32_t)(bucket + 512) << 5;
+
+    _fude_path_entry* entry = _fude_find_path_entry(cache, path, key, width);
+    uint32_t first = entry->first, count = entry->count;
+    bool cached = entry->hash != 0;
+    if(!cached) {
+        if(cache->used >= FUDE_PATH_CACHE_SLOTS/2 || cache->vertices.count >= FUDE_PATH_CACHE_VERTICES) {
+            _fude_clear_path_cache(cache);
+            entry = _fude_find_path_entry(cache, path, key, width);
+        }
+        const float bucket_scale = exp2f((float)(bucket + 1)/FUDE_PATH_SCALE_STEPS);
+        first = cache->vertices.count;
+        _fude_flatten_path(cache, path, bucket_scale);
+        if(operation == FUDE_PATH_FILL)
+            _fude_fill_contours(cache);
+        else
+            _fude_stroke_contours(cache, width, join, cap, bucket_scale);
+        count = cache->vertices.count - first;
+        // too big to keep, drawn once and dropped
+        cached = count <= FUDE_PATH_CACHE_VERTICES;
+        if(cached) {
+            *entry = (_fude_path_entry){ .hash = path->hash, .key = key, .width = width,
+                .point_count = path->points.count, .first = first, .count = count };
+            cache->used += 1;
+        }
+    }
+
+    fude_renderer* renderer = &app->renderer;
+    const V4f previous = renderer->working.vertex.color;
+    const float previous_index = renderer->working.vertex.tex_index;
+    f_begin(app, FUDE_MODE_TRIANGLES, renderer->default_shader);
+    renderer->working.vertex.color = _fude_unpack_color(color);
+    renderer->working.vertex.tex_index = 0;
+    const V2f* vertices = cache->vertices.data + first;
+    for(uint32_t i = 0; i < count; ++i)
+        f_vertex2f(app, vertices[i].x, vertices[i].y);
+    f_end(app);
+    renderer->working.vertex.color = previous;
+    renderer->working.vertex.tex_index = previous_index;
+
+    if(!cached) cache->vertices.count = first;
+}
+
+void f_fill_path(fude* app, const fude_path* path, uint32_t color)
+{
+    _fude_draw_path(app, path, FUDE_PATH_FILL, 0.0f, FUDE_JOIN_MITER, FUDE_CAP_BUTT, color);
+}
+
+void f_stroke_path(fude* app, const fude_path* path, float width, fude_line_join join, fude_line_cap cap,
+        uint32_t color)
+{
+    if(!(width > 0.0f)) return;
+    _fude_draw_path(app, path, FUDE_PATH_STROKE, width, join, cap, color);
+}
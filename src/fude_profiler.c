@@ -0,0 +1,256 @@
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+
+#include <stdatomic.h>
+#include <stdio.h> // fopen(), fprintf()
+
+//======================================================================
+// GPU timers
+//======================================================================
+void _fude_init_gpu_timer(fude_gpu_timer* timer)
+{
+    f_memzero(timer, sizeof(fude_gpu_timer));
+    for(uint32_t i = 0; i < FUDE_GPU_TIMER_LATENCY; ++i) {
+        glGenQueries(FUDE_GPU_TIMER_MAXIMUM_PASSES, timer->frames[i].elapsed);
+        glGenQueries(2, timer->frames[i].timestamps);
+    }
+}
+
+void _fude_gpu_timer_begin_pass(fude_gpu_timer* timer, fude_gpu_pass pass)
+{
+    // GL_TIME_ELAPSED queries can't nest, extra passes just go untimed
+    fude_gpu_timer_frame* frame = timer->frames + timer->current;
+    if(timer->pass_active) return;
+    if(frame->elapsed[0] == 0) return; // queries not created yet
+    if(frame->pass_count >= FUDE_GPU_TIMER_MAXIMUM_PASSES) return;
+
+    if(frame->pass_count == 0)
+        glQueryCounter(frame->timestamps[0], GL_TIMESTAMP);
+    glBeginQuery(GL_TIME_ELAPSED, frame->elapsed[frame->pass_count]);
+    frame->types[frame->pass_count] = pass;
+    timer->pass_active = true;
+}
+
+void _fude_gpu_timer_end_pass(fude_gpu_timer* timer)
+{
+    if(!timer->pass_active) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->frames[timer->current].pass_count += 1;
+    timer->pass_active = false;
+}
+
+static bool _fude_query_available(uint32_t query)
+{
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+void _fude_gpu_timer_end_frame(fude_gpu_timer* timer)
+{
+    fude_gpu_timer_frame* frame = timer->frames + timer->current;
+    if(frame->pass_count > 0) {
+        glQueryCounter(frame->timestamps[1], GL_TIMESTAMP);
+        frame->frame = timer->frame_count;
+        frame->issued = true;
+    }
+    timer->frame_count += 1;
+    timer->current = (timer->current + 1) % FUDE_GPU_TIMER_LATENCY;
+
+    // the slot we're about to reuse was issued FUDE_GPU_TIMER_LATENCY-1 frames ago,
+    // read it only if the GPU is done with it, never wait
+    frame = timer->frames + timer->current;
+    bool ready = frame->issued && _fude_query_available(frame->timestamps[1]);
+    for(uint32_t i = 0; ready && i < frame->pass_count; ++i)
+        ready = _fude_query_available(frame->elapsed[i]);
+
+    if(ready) {
+        fude_gpu_timings* timings = &timer->latest;
+        f_memzero(timings, sizeof(fude_gpu_timings));
+        timings->frame = frame->frame;
+        timings->pass_count = frame->pass_count;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame->timestamps[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame->timestamps[1], GL_QUERY_RESULT, &end);
+        timings->frame_ms = (float)((double)(end - begin)/1e6);
+
+        for(uint32_t i = 0; i < frame->pass_count; ++i) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame->elapsed[i], GL_QUERY_RESULT, &elapsed);
+            timings->passes[i].type = frame->types[i];
+            timings->passes[i].ms = (float)((double)elapsed/1e6);
+            timings->pass_total_ms[frame->types[i]] += timings->passes[i].ms;
+        }
+        timer->valid = true;
+    }
+
+    frame->issued = false;
+    frame->pass_count = 0;
+}
+
+bool f_get_gpu_timings(fude* app, fude_gpu_timings* timings)
+{
+    if(!app || !timings) return false;
+
+    if(app->render_thread)
+        _fude_lock_render_thread(app);
+    bool valid = app->renderer.gpu_timer.valid;
+    if(valid)
+        *timings = app->renderer.gpu_timer.latest;
+    if(app->render_thread)
+        _fude_unlock_render_thread(app);
+
+    return valid;
+}
+
+//======================================================================
+// Renderer statistics
+//======================================================================
+void _fude_end_render_stats_frame(fude_renderer* renderer)
+{
+    uint64_t frame = renderer->stats.current.frame;
+
+    renderer->stats.history[renderer->stats.head] = renderer->stats.current;
+    renderer->stats.head = (renderer->stats.head + 1) % FUDE_RENDER_STATS_HISTORY;
+    if(renderer->stats.count < FUDE_RENDER_STATS_HISTORY)
+        renderer->stats.count += 1;
+
+    f_memzero(&renderer->stats.current, sizeof(fude_render_stats));
+    renderer->stats.current.frame = frame + 1;
+    renderer->stats.last_program = 0;
+    f_memzero(renderer->stats.last_textures, sizeof(renderer->stats.last_textures));
+}
+
+bool f_get_render_stats(fude* app, fude_render_stats* stats, uint32_t frames_ago)
+{
+    if(!app || !stats) return false;
+    if(frames_ago >= app->renderer.stats.count) return false;
+
+    uint32_t index = (app->renderer.stats.head + FUDE_RENDER_STATS_HISTORY - 1 - frames_ago) % FUDE_RENDER_STATS_HISTORY;
+    *stats = app->renderer.stats.history[index];
+    return true;
+}
+
+//======================================================================
+// CPU zones
+//======================================================================
+typedef struct {
+    const char* name;
+    uint64_t start, end; // _fude_timer_value() ticks
+    uint32_t depth;
+} _fude_profile_event;
+
+// one ring per thread, only the owning thread writes and only the exporter
+// reads, so publishing the head with release/acquire is all the syncing needed
+typedef struct _fude_profile_thread {
+    _fude_profile_event events[FUDE_PROFILER_THREAD_EVENTS];
+    _Atomic uint64_t head;
+    struct {
+        const char* name;
+        uint64_t start;
+    } stack[FUDE_PROFILER_MAXIMUM_DEPTH];
+    uint32_t depth;
+    uint32_t id;
+    struct _fude_profile_thread* next;
+} _fude_profile_thread;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define _FUDE_THREAD_LOCAL __declspec(thread)
+#else
+    #define _FUDE_THREAD_LOCAL _Thread_local
+#endif
+
+static _Atomic(_fude_profile_thread*) _fude_profile_threads = NULL;
+static atomic_uint _fude_profile_thread_count = 0;
+static _FUDE_THREAD_LOCAL _fude_profile_thread* _fude_profile_this_thread = NULL;
+
+static _fude_profile_thread* _fude_profile_get_thread(void)
+{
+    if(_fude_profile_this_thread) return _fude_profile_this_thread;
+
+    _fude_profile_thread* thread = f_malloc(sizeof(_fude_profile_thread));
+    if(!thread) return NULL;
+    f_memzero(thread, sizeof(_fude_profile_thread));
+    thread->id = atomic_fetch_add(&_fude_profile_thread_count, 1);
+
+    // lock-free push onto the global list, threads are never removed
+    thread->next = atomic_load(&_fude_profile_threads);
+    while(!atomic_compare_exchange_weak(&_fude_profile_threads, &thread->next, thread)) {}
+
+    _fude_profile_this_thread = thread;
+    return thread;
+}
+
+void f_profile_begin(const char* name)
+{
+    _fude_profile_thread* thread = _fude_profile_get_thread();
+    if(!thread) return;
+    if(thread->depth < FUDE_PROFILER_MAXIMUM_DEPTH) {
+        thread->stack[thread->depth].name = name;
+        thread->stack[thread->depth].start = _fude_timer_value();
+    }
+    thread->depth += 1;
+}
+
+void f_profile_end(void)
+{
+    _fude_profile_thread* thread = _fude_profile_this_thread;
+    if(!thread || thread->depth == 0) return;
+    thread->depth -= 1;
+    if(thread->depth >= FUDE_PROFILER_MAXIMUM_DEPTH) return;
+
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+    _fude_profile_event* event = thread->events + (head & (FUDE_PROFILER_THREAD_EVENTS - 1));
+    event->name = thread->stack[thread->depth].name;
+    event->start = thread->stack[thread->depth].start;
+    event->end = _fude_timer_value();
+    event->depth = thread->depth;
+    atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+}
+
+static void _fude_write_json_string(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for(; str && *str; ++str) {
+        if(*str == '"' || *str == '\\') fputc('\\', file);
+        if((unsigned char)*str < 0x20) continue;
+        fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+fude_result f_profile_export_chrome_trace(const char* file_path)
+{
+    if(!file_path) return FUDE_INVALID_ARGUMENTS_ERROR;
+    FILE* file = fopen(file_path, "wb");
+    if(!file) return FUDE_ERROR;
+
+    double us_per_tick = 1e6/(double)_fude_timer_frequency();
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(_fude_profile_thread* thread = atomic_load(&_fude_profile_threads); thread; thread = thread->next) {
+        uint64_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+        uint64_t begin = head > FUDE_PROFILER_THREAD_EVENTS ? head - FUDE_PROFILER_THREAD_EVENTS : 0;
+
+        for(uint64_t i = begin; i < head; ++i) {
+            _fude_profile_event event = thread->events[i & (FUDE_PROFILER_THREAD_EVENTS - 1)];
+
+            // the owner may have lapped us while we were reading
+            uint64_t now_head = atomic_load_explicit(&thread->head, memory_order_acquire);
+            if(now_head > FUDE_PROFILER_THREAD_EVENTS && i < now_head - FUDE_PROFILER_THREAD_EVENTS)
+                continue;
+
+            fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+            _fude_write_json_string(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+                    thread->id, (double)event.start*us_per_tick,
+                    (double)(event.end - event.start)*us_per_tick, event.depth);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return FUDE_OK;
+}
@@ -0,0 +1,190 @@
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+
+#include <math.h> // sqrtf()
+
+// every shape is one quad in the default shader's batch, nothing is tessellated: the fragment shader
+// turns the signed distance to the outline into coverage, so edges are antialiased analytically and
+// shapes share batches with sprites drawn with f_get_default_shader()
+
+// colors are 0xRRGGBBAA
+V4f _fude_unpack_color(uint32_t color)
+{
+    return (V4f){ .r = (float)(color >> 24)/255.0f, .g = (float)(color >> 16 & 0xFF)/255.0f,
+        .b = (float)(color >> 8 & 0xFF)/255.0f, .a = (float)(color & 0xFF)/255.0f };
+}
+
+// how far quads grow past the outline so the edge can fade out completely: a pixel under a 2D camera
+// used with the default shader, nothing otherwise (the outer half of the fade is then cut off)
+static float _fude_shape_padding(const fude_renderer* renderer)
+{
+    if(renderer->camera.active && renderer->camera.shader == renderer->default_shader.id)
+        return renderer->camera.pixel_size;
+    return 0.0f;
+}
+
+// see FUDE_SHAPE_BOX, radius and thickness are fractions of the shorter half extent
+static float _fude_shape_index(uint32_t kind, float radius, float thickness)
+{
+    const float scale = (float)((1u << FUDE_SHAPE_FRACTION_BITS) - 1);
+    radius = radius < 0.0f ? 0.0f : (radius > 1.0f ? 1.0f : radius);
+    thickness = thickness < 0.0f ? 0.0f : (thickness > 1.0f ? 1.0f : thickness);
+    uint32_t code = kind | (uint32_t)(radius*scale + 0.5f) << 1 |
+        (uint32_t)(thickness*scale + 0.5f) << (1 + FUDE_SHAPE_FRACTION_BITS);
+    return -1.0f - (float)code;
+}
+
+// rounded box of half extents (hx, hy) around (cx, cy) with its x axis along the unit vector (dx, dy).
+// thickness 0 fills it, otherwise only a band of that width inside the outline is drawn
+static void _fude_draw_box(fude* app, float cx, float cy, float dx, float dy, float hx, float hy,
+        float radius, float thickness, uint32_t color)
+{
+    if(!(hx > 0.0f) || !(hy > 0.0f)) return;
+    fude_renderer* renderer = &app->renderer;
+    const float shorter = hx < hy ? hx : hy;
+    const float tex_index = _fude_shape_index(FUDE_SHAPE_BOX, radius/shorter, thickness/shorter);
+    const float pad = _fude_shape_padding(renderer);
+    const float u = (hx + pad)/hx, v = (hy + pad)/hy;
+    const float ax = dx*(hx + pad), ay = dy*(hx + pad);  // along
+    const float nx = -dy*(hy + pad), ny = dx*(hy + pad); // across
+    const V4f rgba = _fude_unpack_color(color);
+    const float object_id = renderer->working.vertex.object_id;
+
+    uint32_t count = 1;
+    fude_vertex* vertices = _fude_begin_quads(app, renderer->default_shader, renderer->default_texture, 0, &count);
+    vertices[0] = (fude_vertex){ .position.x = cx - ax - nx, .position.y = cy - ay - ny, .color = rgba,
+        .tex_coords.u = -u, .tex_coords.v = -v, .tex_index = tex_index, .object_id = object_id };
+    vertices[1] = (fude_vertex){ .position.x = cx + ax - nx, .position.y = cy + ay - ny, .color = rgba,
+        .tex_coords.u = u, .tex_coords.v = -v, .tex_index = tex_index, .object_id = object_id };
+    vertices[2] = (fude_vertex){ .position.x = cx + ax + nx, .position.y = cy + ay + ny, .color = rgba,
+        .tex_coords.u = u, .tex_coords.v = v, .tex_index = tex_index, .object_id = object_id };
+    vertices[3] = (fude_vertex){ .position.x = cx - ax + nx, .position.y = cy - ay + ny, .color = rgba,
+        .tex_coords.u = -u, .tex_coords.v = v, .tex_index = tex_index, .object_id = object_id };
+    _fude_end_quads(app, 1);
+}
+
+// a quad whose last two corners are the same point. It's scaled around the incenter so every edge
+// moves out by the padding, the barycentrics stay those of the original triangle
+void f_triangle(fude* app, fude_triangle triangle, uint32_t color)
+{
+    const float x[3] = { (float)triangle.x0, (float)triangle.x1, (float)triangle.x2 };
+    const float y[3] = { (float)triangle.y0, (float)triangle.y1, (float)triangle.y2 };
+    float area2 = (x[1] - x[0])*(y[2] - y[0]) - (y[1] - y[0])*(x[2] - x[0]);
+    if(area2 < 0.0f) area2 = -area2;
+    if(area2 == 0.0f) return;
+
+    // side lengths opposite each vertex weigh it in the incenter
+    float side[3];
+    for(int i = 0; i < 3; ++i) {
+        float ex = x[(i + 2)%3] - x[(i + 1)%3], ey = y[(i + 2)%3] - y[(i + 1)%3];
+        side[i] = sqrtf(ex*ex + ey*ey);
+    }
+    const float perimeter = side[0] + side[1] + side[2];
+    const float inradius = area2/perimeter;
+    const float scale = (inradius + _fude_shape_padding(&app->renderer))/inradius;
+    const float center[3] = { side[0]/perimeter, side[1]/perimeter, side[2]/perimeter };
+    const float cx = center[0]*x[0] + center[1]*x[1] + center[2]*x[2];
+    const float cy = center[0]*y[0] + center[1]*y[1] + center[2]*y[2];
+    const float tex_index = _fude_shape_index(FUDE_SHAPE_TRIANGLE, 0.0f, 0.0f);
+    const V4f rgba = _fude_unpack_color(color);
+    const float object_id = app->renderer.working.vertex.object_id;
+
+    uint32_t count = 1;
+    fude_vertex* vertices = _fude_begin_quads(app, app->renderer.default_shader,
+            app->renderer.default_texture, 0, &count);
+    for(int i = 0; i < 3; ++i) {
+        vertices[i] = (fude_vertex){ .position.x = cx + (x[i] - cx)*scale, .position.y = cy + (y[i] - cy)*scale,
+            .color = rgba, .tex_coords.u = center[0] + ((i == 0) - center[0])*scale,
+            .tex_coords.v = center[1] + ((i == 1) - center[1])*scale, .tex_index = tex_index, .object_id = object_id };
+    }
+    vertices[3] = vertices[2];
+    _fude_end_quads(app, 1);
+}
+
+void f_rectangle(fude* app, fude_rect rect, uint32_t color)
+{
+    const float hx = 0.5f*(float)rect.width, hy = 0.5f*(float)rect.height;
+    _fude_draw_box(app, (float)rect.x + hx, (float)rect.y + hy, 1.0f, 0.0f, hx, hy, 0.0f, 0.0f, color);
+}
+
+// a slot that already holds texture, else a free one, else slot 1 and _fude_begin_quads breaks the batch
+uint32_t _fude_sprite_slot(const fude_renderer* renderer, fude_texture texture)
+{
+    uint32_t free_slot = 0;
+    for(uint32_t i = 1; i < FUDE_RENDERER_MAXIMUM_TEXTURES; ++i) {
+        if(renderer->textures.data[i].id == texture.id) return i;
+        if(!free_slot && renderer->textures.data[i].id == 0) free_slot = i;
+    }
+    return free_slot ? free_slot : 1;
+}
+
+// the whole texture, slots are shared between sprites so up to 7 textures go in one batch
+void f_rectangle_tex(fude* app, fude_rect rect, fude_texture texture)
+{
+    fude_renderer* renderer = &app->renderer;
+    const float x0 = (float)rect.x, y0 = (float)rect.y;
+    const float x1 = x0 + (float)rect.width, y1 = y0 + (float)rect.height;
+    const V4f rgba = renderer->working.vertex.color;
+    const float object_id = renderer->working.vertex.object_id;
+    const uint32_t slot = _fude_sprite_slot(renderer, texture);
+    const float tex_index = (float)slot;
+
+    uint32_t count = 1;
+    fude_vertex* vertices = _fude_begin_quads(app, renderer->default_shader, texture, slot, &count);
+    vertices[0] = (fude_vertex){ .position.x = x0, .position.y = y0, .color = rgba,
+        .tex_coords.u = 0.0f, .tex_coords.v = 0.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[1] = (fude_vertex){ .position.x = x1, .position.y = y0, .color = rgba,
+        .tex_coords.u = 1.0f, .tex_coords.v = 0.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[2] = (fude_vertex){ .position.x = x1, .position.y = y1, .color = rgba,
+        .tex_coords.u = 1.0f, .tex_coords.v = 1.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[3] = (fude_vertex){ .position.x = x0, .position.y = y1, .color = rgba,
+        .tex_coords.u = 0.0f, .tex_coords.v = 1.0f, .tex_index = tex_index, .object_id = object_id };
+    _fude_end_quads(app, 1);
+}
+
+void f_rounded_rectangle(fude* app, fude_rectf rect, float radius, uint32_t color)
+{
+    const float hx = 0.5f*rect.width, hy = 0.5f*rect.height;
+    _fude_draw_box(app, rect.x + hx, rect.y + hy, 1.0f, 0.0f, hx, hy, radius, 0.0f, color);
+}
+
+// the outline is drawn inside rect
+void f_rounded_rectangle_lines(fude* app, fude_rectf rect, float radius, float thickness, uint32_t color)
+{
+    if(!(thickness > 0.0f)) return;
+    const float hx = 0.5f*rect.width, hy = 0.5f*rect.height;
+    _fude_draw_box(app, rect.x + hx, rect.y + hy, 1.0f, 0.0f, hx, hy, radius, thickness, color);
+}
+
+void f_circle(fude* app, float x, float y, float radius, uint32_t color)
+{
+    _fude_draw_box(app, x, y, 1.0f, 0.0f, radius, radius, radius, 0.0f, color);
+}
+
+// thickness goes inwards from radius
+void f_ring(fude* app, float x, float y, float radius, float thickness, uint32_t color)
+{
+    if(!(thickness > 0.0f)) return;
+    _fude_draw_box(app, x, y, 1.0f, 0.0f, radius, radius, radius, thickness, color);
+}
+
+// a line with round caps of radius, a circle when both ends are the same
+void f_capsule(fude* app, float x0, float y0, float x1, float y1, float radius, uint32_t color)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    float length = sqrtf(dx*dx + dy*dy);
+    if(length > 0.0f) { dx /= length; dy /= length; }
+    else { dx = 1.0f; dy = 0.0f; }
+    _fude_draw_box(app, 0.5f*(x0 + x1), 0.5f*(y0 + y1), dx, dy, 0.5f*length + radius, radius, radius, 0.0f, color);
+}
+
+// butt caps, use f_capsule for round ones
+void f_line(fude* app, float x0, float y0, float x1, float y1, float thickness, uint32_t color)
+{
+    float dx = x1 - x0, dy = y1 - y0;
+    float length = sqrtf(dx*dx + dy*dy);
+    if(!(length > 0.0f)) return;
+    _fude_draw_box(app, 0.5f*(x0 + x1), 0.5f*(y0 + y1), dx/length, dy/length,
+            0.5f*length, 0.5f*thickness, 0.0f, 0.0f, color);
+}
@@ -0,0 +1,734 @@
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#include <math.h> // floorf(), fabsf(), sqrtf()
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define FUDE_SOFTWARE_SSE2 1
+#else
+    #define FUDE_SOFTWARE_SSE2 0
+#endif
+
+#define FUDE_SOFTWARE_TILE_SIZE 64
+
+typedef struct {
+    uint8_t* pixels; // RGBA8, rows in upload order
+    int width, height;
+} _fude_sw_texture;
+
+typedef struct {
+    M4f mvp; // column-major like the u_mvp uniform
+} _fude_sw_shader;
+
+typedef struct {
+    fude_vertex* vertices;
+    uint32_t* indices;
+    bool used; // destroyed slots are handed out again
+} _fude_sw_mesh;
+
+// triangle after setup, everything a tile needs to shade it
+typedef struct {
+    float a[3], b[3], c[3]; // edge functions E(x, y) = a*x + b*y + c, edge i is opposite vertex i
+    bool top_left[3];
+    float inv_area;
+    int min_x, min_y, max_x, max_y; // inclusive pixel bounds
+    V4f color[3];
+    V2f uv[3];
+    float z[3];                 // window depth, 0 near and 1 far like glDepthRange's default
+    fude_depth_mode depth_mode; // of the batch it came from
+    fude_blend_mode blend;      // _fude_batch_blend's for the batch it came from
+    bool additive;              // FUDE_ADDITIVE_FLAG was set, alpha is written as 0
+    bool glyph;                 // FUDE_GLYPH_FLAG was set, the texture's alpha is a signed distance
+    const _fude_sw_texture* texture;
+    float distance_width; // half the smoothstep range for distance field textures
+    int shape;            // -1 - tex_index of a shape (see FUDE_SHAPE_BOX), -1 otherwise
+    float shape_scale[3]; // pixels per unit of u and v for boxes, per barycentric for triangles
+} _fude_sw_triangle;
+
+typedef struct {
+    uint32_t* data;
+    uint32_t count, capacity;
+} _fude_sw_bin;
+
+struct fude_software {
+    _fude_thread_pool* pool;
+    int width, height;
+    uint8_t* color; // RGBA8, bottom row first like glReadPixels, the screen's or a bound target's
+    float* depth;   // the screen's while it's bound, targets have none
+    struct {
+        uint8_t* color;
+        float* depth;
+        int width, height;
+    } screen; // what f_present shows and f_read_pixels reads
+
+    uint32_t tiles_x, tiles_y;
+    uint32_t tile_capacity; // bins allocated, a target larger than the screen grows them
+    _fude_sw_bin* bins;
+    uint32_t* active_tiles;
+    uint32_t active_tile_count;
+    struct {
+        _fude_sw_triangle* data;
+        uint32_t count, capacity;
+    } triangles;
+
+    // window presentation goes through a texture blit, nothing else touches GL
+    uint32_t present_texture, present_fbo;
+
+    // CPU-side resources of this instance, ids are 1 + the index
+    struct {
+        _fude_sw_texture* data;
+        uint32_t count, capacity;
+    } textures;
+    struct {
+        _fude_sw_shader* data;
+        uint32_t count, capacity;
+    } shaders;
+    struct {
+        _fude_sw_mesh* data;
+        uint32_t count, capacity;
+    } meshes;
+};
+
+//======================================================================
+// Resources
+//======================================================================
+static void _fude_sw_copy_pixels(_fude_sw_texture* texture, const void* data, int width, int height, int channels)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    if(channels == 1) {
+        // premultiplied white with the value in alpha, the GL backend swizzles the same way
+        for(int i = 0; i < width*height; ++i) {
+            const uint8_t value = src ? src[i] : 0;
+            texture->pixels[i*4 + 0] = value;
+            texture->pixels[i*4 + 1] = value;
+            texture->pixels[i*4 + 2] = value;
+            texture->pixels[i*4 + 3] = value;
+        }
+        return;
+    }
+    for(int i = 0; i < width*height; ++i) {
+        texture->pixels[i*4 + 0] = src ? src[i*channels + 0] : 0;
+        texture->pixels[i*4 + 1] = src ? src[i*channels + 1] : 0;
+        texture->pixels[i*4 + 2] = src ? src[i*channels + 2] : 0;
+        texture->pixels[i*4 + 3] = src && channels == 4 ? src[i*channels + 3] : 0xFF;
+    }
+}
+
+fude_result _fude_software_create_texture(fude* app, fude_texture* texture, const void* data, int width, int height,
+        int channels)
+{
+    fude_software* sw = app->software;
+    if(width <= 0 || height <= 0) return FUDE_INVALID_ARGUMENTS_ERROR;
+    sw->textures.data = _fude_grow_array(sw->textures.data, sw->textures.count,
+            &sw->textures.capacity, sw->textures.count + 1, sizeof(_fude_sw_texture));
+    _fude_sw_texture* sw_texture = sw->textures.data + sw->textures.count;
+    sw_texture->pixels = f_malloc((size_t)width*height*4);
+    if(!sw_texture->pixels) return FUDE_ERROR;
+    sw_texture->width = width;
+    sw_texture->height = height;
+    _fude_sw_copy_pixels(sw_texture, data, width, height, channels);
+
+    sw->textures.count += 1;
+    texture->id = sw->textures.count; // 0 stays "no texture"
+    return FUDE_OK;
+}
+
+void _fude_software_update_texture(fude* app, fude_texture texture, const void* data, int width, int height,
+        int channels)
+{
+    fude_software* sw = app->software;
+    if(texture.id == 0 || texture.id > sw->textures.count) return;
+    _fude_sw_texture* sw_texture = sw->textures.data + texture.id - 1;
+    if(!sw_texture->pixels || width != sw_texture->width || height != sw_texture->height) return;
+    _fude_sw_copy_pixels(sw_texture, data, width, height, channels);
+}
+
+void _fude_software_update_texture_rows(fude* app, fude_texture texture, const void* pixels, int width, int y,
+        int rows, int channels)
+{
+    fude_software* sw = app->software;
+    if(texture.id == 0 || texture.id > sw->textures.count) return;
+    _fude_sw_texture* sw_texture = sw->textures.data + texture.id - 1;
+    if(!sw_texture->pixels || width != sw_texture->width || y < 0 || y + rows > sw_texture->height) return;
+    _fude_sw_texture band = *sw_texture;
+    band.pixels += (size_t)y*width*4;
+    _fude_sw_copy_pixels(&band, pixels, width, rows, channels);
+}
+
+void _fude_software_destroy_texture(fude* app, fude_texture texture)
+{
+    fude_software* sw = app->software;
+    if(texture.id == 0 || texture.id > sw->textures.count) return;
+    _fude_sw_texture* sw_texture = sw->textures.data + texture.id - 1;
+    f_free(sw_texture->pixels);
+    f_memzero(sw_texture, sizeof(_fude_sw_texture));
+}
+
+// GLSL is ignored, the software pipeline always shades like the default shader
+fude_result _fude_software_create_shader(fude* app, fude_shader* shader)
+{
+    fude_software* sw = app->software;
+    sw->shaders.data = _fude_grow_array(sw->shaders.data, sw->shaders.count,
+            &sw->shaders.capacity, sw->shaders.count + 1, sizeof(_fude_sw_shader));
+    _fude_sw_shader* sw_shader = sw->shaders.data + sw->shaders.count;
+    f_memzero(sw_shader, sizeof(_fude_sw_shader));
+    for(int i = 0; i < 4; ++i)
+        sw_shader->mvp.elements[i*5] = 1.0f;
+
+    sw->shaders.count += 1;
+    f_memzero(shader, sizeof(fude_shader));
+    shader->id = sw->shaders.count;
+    for(int i = 0; i < FUDE_COUNT_UNIFORM_LOC; ++i)
+        shader->uniform_loc[i] = i;
+    return FUDE_OK;
+}
+
+void _fude_software_set_shader_uniform(fude* app, fude_shader shader, int location, int type, const void* data,
+        bool transpose)
+{
+    fude_software* sw = app->software;
+    if(shader.id == 0 || shader.id > sw->shaders.count) return;
+    if(location != FUDE_UNIFORM_MATRIX_MVP_LOC || type != FUDE_SHADERDT_MAT4) return;
+
+    const float* m = (const float*)data;
+    _fude_sw_shader* sw_shader = sw->shaders.data + shader.id - 1;
+    for(int col = 0; col < 4; ++col) {
+        for(int row = 0; row < 4; ++row)
+            sw_shader->mvp.elements[col*4 + row] = transpose ? m[row*4 + col] : m[col*4 + row];
+    }
+}
+
+// a mesh is just a CPU copy here, mesh->vbo is its id
+fude_result _fude_software_update_mesh(fude* app, fude_mesh* mesh, const fude_vertex* vertices, const uint32_t* indices)
+{
+    fude_software* sw = app->software;
+    for(uint32_t i = 0; mesh->vbo == 0 && i < sw->meshes.count; ++i) {
+        if(!sw->meshes.data[i].used)
+            mesh->vbo = i + 1;
+    }
+    if(mesh->vbo == 0) {
+        sw->meshes.data = _fude_grow_array(sw->meshes.data, sw->meshes.count,
+                &sw->meshes.capacity, sw->meshes.count + 1, sizeof(_fude_sw_mesh));
+        f_memzero(sw->meshes.data + sw->meshes.count, sizeof(_fude_sw_mesh));
+        mesh->vbo = ++sw->meshes.count;
+    }
+    _fude_sw_mesh* sw_mesh = sw->meshes.data + mesh->vbo - 1;
+    sw_mesh->used = true;
+    if(sw_mesh->vertices) f_free(sw_mesh->vertices);
+    if(sw_mesh->indices) f_free(sw_mesh->indices);
+    sw_mesh->vertices = f_malloc(mesh->vertex_count*sizeof(fude_vertex));
+    sw_mesh->indices = f_malloc(mesh->index_count*sizeof(uint32_t));
+    if(!sw_mesh->vertices || !sw_mesh->indices) return FUDE_ERROR;
+    f_memcpy(sw_mesh->vertices, vertices, mesh->vertex_count*sizeof(fude_vertex));
+    f_memcpy(sw_mesh->indices, indices, mesh->index_count*sizeof(uint32_t));
+    return FUDE_OK;
+}
+
+void _fude_software_destroy_mesh(fude* app, fude_mesh* mesh)
+{
+    fude_software* sw = app->software;
+    if(mesh->vbo == 0 || mesh->vbo > sw->meshes.count) return;
+    _fude_sw_mesh* sw_mesh = sw->meshes.data + mesh->vbo - 1;
+    if(sw_mesh->vertices) f_free(sw_mesh->vertices);
+    if(sw_mesh->indices) f_free(sw_mesh->indices);
+    f_memzero(sw_mesh, sizeof(_fude_sw_mesh));
+}
+
+//======================================================================
+// Rasterizer
+//======================================================================
+static void _fude_sw_setup_edge(_fude_sw_triangle* tri, int i, float ax, float ay, float bx, float by)
+{
+    tri->a[i] = ay - by;
+    tri->b[i] = bx - ax;
+    tri->c[i] = -(tri->a[i]*ax + tri->b[i]*ay);
+    // counter-clockwise in y-up screen space: left edges go down, top edges go left
+    tri->top_left[i] = tri->a[i] > 0.0f || (tri->a[i] == 0.0f && tri->b[i] < 0.0f);
+}
+
+static void _fude_sw_transform(const M4f* mvp, const fude_vertex* vertex, int width, int height,
+        float* x, float* y, float* z)
+{
+    const float* m = mvp->elements;
+    float px = vertex->position.x, py = vertex->position.y, pz = vertex->position.z;
+    float cx = m[0]*px + m[4]*py + m[8]*pz + m[12];
+    float cy = m[1]*px + m[5]*py + m[9]*pz + m[13];
+    float cz = m[2]*px + m[6]*py + m[10]*pz + m[14];
+    float cw = m[3]*px + m[7]*py + m[11]*pz + m[15];
+    if(cw == 0.0f) cw = 1.0f;
+    *z = cz/cw*0.5f + 0.5f;
+    // snap to 1/256 of a pixel like GL rasterizers do, keeps shared edges watertight
+    *x = floorf((cx/cw*0.5f + 0.5f)*(float)width*256.0f + 0.5f)/256.0f;
+    *y = floorf((cy/cw*0.5f + 0.5f)*(float)height*256.0f + 0.5f)/256.0f;
+}
+
+static bool _fude_sw_setup_triangle(fude_software* sw, _fude_sw_triangle* tri, const M4f* mvp,
+        const fude_vertex* v0, const fude_vertex* v1, const fude_vertex* v2, const fude_texture* textures)
+{
+    const fude_vertex* v[3] = { v0, v1, v2 };
+    float x[3], y[3];
+    for(int i = 0; i < 3; ++i)
+        _fude_sw_transform(mvp, v[i], sw->width, sw->height, x + i, y + i, tri->z + i);
+
+    float area = (x[1] - x[0])*(y[2] - y[0]) - (y[1] - y[0])*(x[2] - x[0]);
+    if(area == 0.0f) return false;
+    if(area < 0.0f) {
+        // no face culling, just make it counter-clockwise
+        const fude_vertex* tv = v[1]; v[1] = v[2]; v[2] = tv;
+        float t = x[1]; x[1] = x[2]; x[2] = t;
+        t = y[1]; y[1] = y[2]; y[2] = t;
+        t = tri->z[1]; tri->z[1] = tri->z[2]; tri->z[2] = t;
+        area = -area;
+    }
+
+    float min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+    for(int i = 1; i < 3; ++i) {
+        if(x[i] < min_x) min_x = x[i];
+        if(x[i] > max_x) max_x = x[i];
+        if(y[i] < min_y) min_y = y[i];
+        if(y[i] > max_y) max_y = y[i];
+    }
+    tri->min_x = min_x < 0.0f ? 0 : (int)min_x;
+    tri->min_y = min_y < 0.0f ? 0 : (int)min_y;
+    tri->max_x = max_x >= (float)sw->width ? sw->width - 1 : (int)max_x;
+    tri->max_y = max_y >= (float)sw->height ? sw->height - 1 : (int)max_y;
+    if(tri->min_x > tri->max_x || tri->min_y > tri->max_y) return false;
+
+    _fude_sw_setup_edge(tri, 0, x[1], y[1], x[2], y[2]);
+    _fude_sw_setup_edge(tri, 1, x[2], y[2], x[0], y[0]);
+    _fude_sw_setup_edge(tri, 2, x[0], y[0], x[1], y[1]);
+    tri->inv_area = 1.0f/area;
+
+    for(int i = 0; i < 3; ++i) {
+        tri->color[i] = v[i]->color;
+        tri->uv[i] = v[i]->tex_coords;
+    }
+
+    // matches the default fragment shader: slot 0 means vertex color
+    const float tex_index = v[0]->tex_index;
+    const int code = tex_index < 0.0f ? (int)(-1.0f - tex_index) : (int)tex_index;
+    tri->additive = (code & FUDE_ADDITIVE_FLAG) != 0;
+    tri->glyph = tex_index > 0.0f && (code & FUDE_GLYPH_FLAG) != 0;
+    int slot = tex_index > 0.0f ? code & (FUDE_GLYPH_FLAG - 1) : 0;
+    tri->texture = NULL;
+    if(slot > 0 && slot < FUDE_RENDERER_MAXIMUM_TEXTURES) {
+        uint32_t id = textures[slot].id;
+        if(id > 0 && id <= sw->textures.count && sw->textures.data[id - 1].pixels)
+            tri->texture = sw->textures.data + id - 1;
+    }
+
+    // stands in for fwidth(): texels covered per pixel, from the uv area against the screen area
+    tri->distance_width = 0.0f;
+    if(tri->texture && tri->glyph) {
+        float du1 = tri->uv[1].u - tri->uv[0].u, dv1 = tri->uv[1].v - tri->uv[0].v;
+        float du2 = tri->uv[2].u - tri->uv[0].u, dv2 = tri->uv[2].v - tri->uv[0].v;
+        float texel_area = fabsf(du1*dv2 - du2*dv1)*(float)tri->texture->width*(float)tri->texture->height;
+        float width = sqrtf(texel_area/area)/(2.0f*FUDE_FONT_SDF_SPREAD);
+        tri->distance_width = width > 1e-4f ? width : 1e-4f;
+    }
+
+    // stands in for the derivatives the default shader takes, uv is affine in screen space
+    tri->shape = tex_index < 0.0f ? code & (FUDE_ADDITIVE_FLAG - 1) : -1;
+    if(tri->shape >= 0) {
+        float du_dx = 0.0f, du_dy = 0.0f, dv_dx = 0.0f, dv_dy = 0.0f;
+        for(int i = 0; i < 3; ++i) {
+            du_dx += tri->a[i]*tri->inv_area*tri->uv[i].u; du_dy += tri->b[i]*tri->inv_area*tri->uv[i].u;
+            dv_dx += tri->a[i]*tri->inv_area*tri->uv[i].v; dv_dy += tri->b[i]*tri->inv_area*tri->uv[i].v;
+        }
+        float gradients[3][2] = { { du_dx, du_dy }, { dv_dx, dv_dy }, { -du_dx - dv_dx, -du_dy - dv_dy } };
+        for(int i = 0; i < 3; ++i) {
+            float length = sqrtf(gradients[i][0]*gradients[i][0] + gradients[i][1]*gradients[i][1]);
+            tri->shape_scale[i] = 1.0f/(length > 1e-6f ? length : 1e-6f);
+        }
+    }
+    return true;
+}
+
+// FUDE_DEFAULT_FRAGMENT_SHADER's shape_coverage()
+static float _fude_sw_shape_coverage(const _fude_sw_triangle* tri, float u, float v)
+{
+    float d;
+    if((tri->shape & 1) == FUDE_SHAPE_TRIANGLE) {
+        float b0 = u*tri->shape_scale[0], b1 = v*tri->shape_scale[1], b2 = (1.0f - u - v)*tri->shape_scale[2];
+        d = -(b0 < b1 ? (b0 < b2 ? b0 : b2) : (b1 < b2 ? b1 : b2));
+    } else {
+        const int mask = (1 << FUDE_SHAPE_FRACTION_BITS) - 1;
+        const float hx = tri->shape_scale[0], hy = tri->shape_scale[1];
+        const float shorter = hx < hy ? hx : hy;
+        float r = (float)(tri->shape >> 1 & mask)/(float)mask*shorter;
+        float t = (float)(tri->shape >> (1 + FUDE_SHAPE_FRACTION_BITS))/(float)mask*shorter;
+        float qx = fabsf(u*hx) - hx + r, qy = fabsf(v*hy) - hy + r;
+        float ox = qx > 0.0f ? qx : 0.0f, oy = qy > 0.0f ? qy : 0.0f;
+        float inside = qx > qy ? qx : qy;
+        d = sqrtf(ox*ox + oy*oy) + (inside < 0.0f ? inside : 0.0f) - r;
+        if(t > 0.0f) d = fabsf(d + 0.5f*t) - 0.5f*t;
+    }
+    float coverage = 0.5f - d;
+    return coverage < 0.0f ? 0.0f : (coverage > 1.0f ? 1.0f : coverage);
+}
+
+static void _fude_sw_shade_pixel(const _fude_sw_triangle* tri, uint8_t* dst, float e0, float e1, float e2)
+{
+    float w0 = e0*tri->inv_area, w1 = e1*tri->inv_area, w2 = e2*tri->inv_area;
+    float r, g, b, a;
+    if(tri->shape >= 0) {
+        float u = w0*tri->uv[0].u + w1*tri->uv[1].u + w2*tri->uv[2].u;
+        float v = w0*tri->uv[0].v + w1*tri->uv[1].v + w2*tri->uv[2].v;
+        r = w0*tri->color[0].r + w1*tri->color[1].r + w2*tri->color[2].r;
+        g = w0*tri->color[0].g + w1*tri->color[1].g + w2*tri->color[2].g;
+        b = w0*tri->color[0].b + w1*tri->color[1].b + w2*tri->color[2].b;
+        a = (w0*tri->color[0].a + w1*tri->color[1].a + w2*tri->color[2].a)*_fude_sw_shape_coverage(tri, u, v);
+        r *= a; g *= a; b *= a;
+    } else if(tri->texture && tri->glyph) {
+        // bilinear like the GL_LINEAR atlas, then the default shader's smoothstep around 0.5
+        const _fude_sw_texture* texture = tri->texture;
+        float u = (w0*tri->uv[0].u + w1*tri->uv[1].u + w2*tri->uv[2].u)*texture->width - 0.5f;
+        float v = (w0*tri->uv[0].v + w1*tri->uv[1].v + w2*tri->uv[2].v)*texture->height - 0.5f;
+        float fu = floorf(u), fv = floorf(v);
+        int tx0 = (int)fu, ty0 = (int)fv;
+        float su = u - fu, sv = v - fv;
+        int tx1 = tx0 + 1 < texture->width ? tx0 + 1 : texture->width - 1;
+        int ty1 = ty0 + 1 < texture->height ? ty0 + 1 : texture->height - 1;
+        tx0 = tx0 < 0 ? 0 : (tx0 >= texture->width ? texture->width - 1 : tx0);
+        ty0 = ty0 < 0 ? 0 : (ty0 >= texture->height ? texture->height - 1 : ty0);
+        if(tx1 < 0) tx1 = 0;
+        if(ty1 < 0) ty1 = 0;
+        const uint8_t* p = texture->pixels;
+        float d00 = p[((size_t)ty0*texture->width + tx0)*4 + 3], d10 = p[((size_t)ty0*texture->width + tx1)*4 + 3];
+        float d01 = p[((size_t)ty1*texture->width + tx0)*4 + 3], d11 = p[((size_t)ty1*texture->width + tx1)*4 + 3];
+        float d = ((d00*(1.0f - su) + d10*su)*(1.0f - sv) + (d01*(1.0f - su) + d11*su)*sv)/255.0f;
+        float t = (d - 0.5f + tri->distance_width)/(2.0f*tri->distance_width);
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        r = w0*tri->color[0].r + w1*tri->color[1].r + w2*tri->color[2].r;
+        g = w0*tri->color[0].g + w1*tri->color[1].g + w2*tri->color[2].g;
+        b = w0*tri->color[0].b + w1*tri->color[1].b + w2*tri->color[2].b;
+        a = (w0*tri->color[0].a + w1*tri->color[1].a + w2*tri->color[2].a)*t*t*(3.0f - 2.0f*t);
+        r *= a; g *= a; b *= a;
+    } else if(tri->texture) {
+        const _fude_sw_texture* texture = tri->texture;
+        float u = w0*tri->uv[0].u + w1*tri->uv[1].u + w2*tri->uv[2].u;
+        float v = w0*tri->uv[0].v + w1*tri->uv[1].v + w2*tri->uv[2].v;
+        // GL_NEAREST with GL_REPEAT
+        int tx = (int)floorf(u*texture->width) % texture->width;
+        int ty = (int)floorf(v*texture->height) % texture->height;
+        if(tx < 0) tx += texture->width;
+        if(ty < 0) ty += texture->height;
+        const uint8_t* texel = texture->pixels + ((size_t)ty*texture->width + tx)*4;
+        r = texel[0]/255.0f; g = texel[1]/255.0f; b = texel[2]/255.0f; a = texel[3]/255.0f;
+    } else {
+        r = w0*tri->color[0].r + w1*tri->color[1].r + w2*tri->color[2].r;
+        g = w0*tri->color[0].g + w1*tri->color[1].g + w2*tri->color[2].g;
+        b = w0*tri->color[0].b + w1*tri->color[1].b + w2*tri->color[2].b;
+        a = w0*tri->color[0].a + w1*tri->color[1].a + w2*tri->color[2].a;
+        r *= a; g *= a; b *= a;
+    }
+    if(a < 0.0f) a = 0.0f;
+    if(a > 1.0f) a = 1.0f;
+    if(tri->additive) a = 0.0f;
+
+    // _fude_set_blend_mode_gl's functions for the premultiplied color every shader writes here
+    float src[4] = { r, g, b, a };
+    for(int i = 0; i < 4; ++i) {
+        float d = dst[i]/255.0f, value;
+        switch(tri->blend) {
+        case FUDE_BLEND_ADDITIVE:       value = src[i] + d; break;
+        case FUDE_BLEND_MULTIPLY:       value = src[i]*d + d*(1.0f - a); break;
+        case FUDE_BLEND_OPAQUE:         value = src[i]; break;
+        default:                        value = src[i] + d*(1.0f - a); break;
+        }
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        dst[i] = (uint8_t)(value*255.0f + 0.5f);
+    }
+}
+
+// glDepthFunc(GL_LEQUAL), z is affine in screen space so the barycentrics interpolate it directly
+static bool _fude_sw_depth_test(const _fude_sw_triangle* tri, float* depth, float e0, float e1, float e2)
+{
+    float z = (e0*tri->z[0] + e1*tri->z[1] + e2*tri->z[2])*tri->inv_area;
+    if(z > *depth) return false;
+    if(tri->depth_mode == FUDE_DEPTH_OPAQUE) *depth = z;
+    return true;
+}
+
+static void _fude_sw_raster_triangle(fude_software* sw, const _fude_sw_triangle* tri,
+        int tile_x0, int tile_y0, int tile_x1, int tile_y1)
+{
+    int x0 = tri->min_x > tile_x0 ? tri->min_x : tile_x0;
+    int y0 = tri->min_y > tile_y0 ? tri->min_y : tile_y0;
+    int x1 = tri->max_x < tile_x1 ? tri->max_x : tile_x1;
+    int y1 = tri->max_y < tile_y1 ? tri->max_y : tile_y1;
+
+    for(int y = y0; y <= y1; ++y) {
+        float py = (float)y + 0.5f;
+        uint8_t* row = sw->color + (size_t)y*sw->width*4;
+        float* depth_row = tri->depth_mode != FUDE_DEPTH_OFF && sw->depth ? sw->depth + (size_t)y*sw->width : NULL;
+        int x = x0;
+#if FUDE_SOFTWARE_SSE2
+        // four pixels per step, edge functions are linear so each lane is base + step*lane
+        const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        for(; x + 3 <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+            __m128 e[3];
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for(int i = 0; i < 3; ++i) {
+                e[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri->a[i]), px),
+                        _mm_set1_ps(tri->b[i]*py + tri->c[i]));
+                __m128 edge_inside = tri->top_left[i] ? _mm_cmpge_ps(e[i], zero) : _mm_cmpgt_ps(e[i], zero);
+                inside = _mm_and_ps(inside, edge_inside);
+            }
+            int mask = _mm_movemask_ps(inside);
+            if(!mask) continue;
+
+            float e0[4], e1[4], e2[4];
+            _mm_storeu_ps(e0, e[0]);
+            _mm_storeu_ps(e1, e[1]);
+            _mm_storeu_ps(e2, e[2]);
+            for(int i = 0; i < 4; ++i) {
+                if(!(mask & (1 << i))) continue;
+                if(depth_row && !_fude_sw_depth_test(tri, depth_row + x + i, e0[i], e1[i], e2[i])) continue;
+                _fude_sw_shade_pixel(tri, row + (size_t)(x + i)*4, e0[i], e1[i], e2[i]);
+            }
+        }
+#endif
+        for(; x <= x1; ++x) {
+            float px = (float)x + 0.5f;
+            float e[3];
+            bool inside = true;
+            for(int i = 0; i < 3; ++i) {
+                e[i] = tri->a[i]*px + tri->b[i]*py + tri->c[i];
+                inside = inside && (tri->top_left[i] ? e[i] >= 0.0f : e[i] > 0.0f);
+            }
+            if(inside && (!depth_row || _fude_sw_depth_test(tri, depth_row + x, e[0], e[1], e[2])))
+                _fude_sw_shade_pixel(tri, row + (size_t)x*4, e[0], e[1], e[2]);
+        }
+    }
+}
+
+// each tile walks its bin in submission order, so blending order matches GL
+static void _fude_sw_shade_tile(void* user_data, uint32_t index)
+{
+    fude_software* sw = (fude_software*)user_data;
+    uint32_t tile = sw->active_tiles[index];
+    int tile_x0 = (int)(tile % sw->tiles_x)*FUDE_SOFTWARE_TILE_SIZE;
+    int tile_y0 = (int)(tile / sw->tiles_x)*FUDE_SOFTWARE_TILE_SIZE;
+    int tile_x1 = tile_x0 + FUDE_SOFTWARE_TILE_SIZE - 1;
+    int tile_y1 = tile_y0 + FUDE_SOFTWARE_TILE_SIZE - 1;
+    if(tile_x1 >= sw->width) tile_x1 = sw->width - 1;
+    if(tile_y1 >= sw->height) tile_y1 = sw->height - 1;
+
+    const _fude_sw_bin* bin = sw->bins + tile;
+    for(uint32_t i = 0; i < bin->count; ++i)
+        _fude_sw_raster_triangle(sw, sw->triangles.data + bin->data[i], tile_x0, tile_y0, tile_x1, tile_y1);
+}
+
+static const M4f* _fude_sw_shader_mvp(const fude_software* sw, fude_shader shader)
+{
+    static const M4f identity = { .elements = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+    if(shader.id > 0 && shader.id <= sw->shaders.count)
+        return &sw->shaders.data[shader.id - 1].mvp;
+    return &identity;
+}
+
+static void _fude_sw_draw_triangles(fude_software* sw, const M4f* mvp, const fude_vertex* vertices,
+        const uint32_t* indices, uint32_t index_count, const fude_texture* textures, fude_depth_mode depth_mode,
+        fude_blend_mode blend)
+{
+    // setup and binning are serial, shading is per tile on the pool
+    uint32_t triangle_count = index_count/3;
+    sw->triangles.data = _fude_grow_array(sw->triangles.data, 0, &sw->triangles.capacity,
+            triangle_count, sizeof(_fude_sw_triangle));
+    sw->triangles.count = 0;
+    sw->active_tile_count = 0;
+
+    for(uint32_t i = 0; i < triangle_count; ++i) {
+        const uint32_t* index = indices + i*3;
+        _fude_sw_triangle* tri = sw->triangles.data + sw->triangles.count;
+        if(!_fude_sw_setup_triangle(sw, tri, mvp, vertices + index[0], vertices + index[1],
+                    vertices + index[2], textures))
+            continue;
+        tri->depth_mode = depth_mode;
+        tri->blend = blend;
+
+        uint32_t tx0 = (uint32_t)tri->min_x/FUDE_SOFTWARE_TILE_SIZE, tx1 = (uint32_t)tri->max_x/FUDE_SOFTWARE_TILE_SIZE;
+        uint32_t ty0 = (uint32_t)tri->min_y/FUDE_SOFTWARE_TILE_SIZE, ty1 = (uint32_t)tri->max_y/FUDE_SOFTWARE_TILE_SIZE;
+        for(uint32_t ty = ty0; ty <= ty1; ++ty) {
+            for(uint32_t tx = tx0; tx <= tx1; ++tx) {
+                uint32_t tile = ty*sw->tiles_x + tx;
+                _fude_sw_bin* bin = sw->bins + tile;
+                if(bin->count == 0)
+                    sw->active_tiles[sw->active_tile_count++] = tile;
+                bin->data = _fude_grow_array(bin->data, bin->count, &bin->capacity, bin->count + 1, sizeof(uint32_t));
+                bin->data[bin->count++] = sw->triangles.count;
+            }
+        }
+        sw->triangles.count += 1;
+    }
+
+    _fude_parallel_for(sw->pool, sw->active_tile_count, _fude_sw_shade_tile, sw);
+
+    for(uint32_t i = 0; i < sw->active_tile_count; ++i)
+        sw->bins[sw->active_tiles[i]].count = 0;
+}
+
+void _fude_software_draw(fude* app)
+{
+    fude_renderer* renderer = &app->renderer;
+    _fude_sw_draw_triangles(app->software, _fude_sw_shader_mvp(app->software, renderer->shader), renderer->vertices.data,
+            renderer->indices.data, renderer->indices.count, renderer->textures.data, renderer->layers.mode,
+            _fude_batch_blend(renderer, renderer->shader));
+}
+
+void _fude_software_draw_mesh(fude* app, const fude_mesh* mesh, fude_shader shader)
+{
+    fude_software* sw = app->software;
+    if(mesh->vbo == 0 || mesh->vbo > sw->meshes.count) return;
+    const _fude_sw_mesh* sw_mesh = sw->meshes.data + mesh->vbo - 1;
+    if(!sw_mesh->vertices) return;
+    _fude_sw_draw_triangles(sw, _fude_sw_shader_mvp(sw, shader), sw_mesh->vertices,
+            sw_mesh->indices, mesh->index_count, mesh->textures, FUDE_DEPTH_OFF, app->renderer.blend_mode);
+}
+
+// texture 0 is the screen, a target's texture is drawn into in place so it can be sampled right after
+void _fude_software_bind_target(fude* app, fude_texture color)
+{
+    fude_software* sw = app->software;
+    uint8_t* pixels = sw->screen.color;
+    int width = sw->screen.width, height = sw->screen.height;
+    if(color.id) {
+        if(color.id > sw->textures.count || !sw->textures.data[color.id - 1].pixels) return;
+        const _fude_sw_texture* texture = sw->textures.data + color.id - 1;
+        pixels = texture->pixels;
+        width = texture->width;
+        height = texture->height;
+    }
+
+    sw->color = pixels;
+    sw->depth = color.id ? NULL : sw->screen.depth;
+    sw->width = width;
+    sw->height = height;
+    sw->tiles_x = ((uint32_t)width + FUDE_SOFTWARE_TILE_SIZE - 1)/FUDE_SOFTWARE_TILE_SIZE;
+    sw->tiles_y = ((uint32_t)height + FUDE_SOFTWARE_TILE_SIZE - 1)/FUDE_SOFTWARE_TILE_SIZE;
+    uint32_t tile_count = sw->tiles_x*sw->tiles_y;
+    if(tile_count > sw->tile_capacity) {
+        // bins are empty between draws, only their storage carries over
+        uint32_t old_capacity = sw->tile_capacity;
+        sw->bins = _fude_grow_array(sw->bins, old_capacity, &sw->tile_capacity, tile_count, sizeof(_fude_sw_bin));
+        f_memzero(sw->bins + old_capacity, (sw->tile_capacity - old_capacity)*sizeof(_fude_sw_bin));
+        f_free(sw->active_tiles);
+        sw->active_tiles = f_malloc(sizeof(uint32_t)*sw->tile_capacity);
+        f_expect(sw->active_tiles != NULL, "Software renderer ran out of memory at %s (%d)", __FILE__, __LINE__);
+    }
+}
+
+void _fude_software_clear(fude* app)
+{
+    fude_software* sw = app->software;
+    f_memzero(sw->color, (size_t)sw->width*sw->height*4);
+    if(sw->depth) {
+        for(size_t i = 0, count = (size_t)sw->width*sw->height; i < count; ++i)
+            sw->depth[i] = 1.0f;
+    }
+}
+
+void _fude_software_present(fude* app)
+{
+    fude_software* sw = app->software;
+    if(!app->window) return;
+
+    int width, height;
+    glfwGetFramebufferSize(app->window, &width, &height);
+    glBindTexture(GL_TEXTURE_2D, sw->present_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sw->screen.width, sw->screen.height, GL_RGBA, GL_UNSIGNED_BYTE,
+            sw->screen.color);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sw->present_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, sw->screen.width, sw->screen.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glfwSwapBuffers(app->window);
+}
+
+fude_result _fude_software_read_pixels(fude* app, int x, int y, int width, int height, void* rgba8)
+{
+    fude_software* sw = app->software;
+    if(x < 0 || y < 0 || x + width > sw->screen.width || y + height > sw->screen.height)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+    for(int row = 0; row < height; ++row) {
+        f_memcpy((uint8_t*)rgba8 + (size_t)row*width*4,
+                sw->screen.color + ((size_t)(y + row)*sw->screen.width + x)*4, (size_t)width*4);
+    }
+    return FUDE_OK;
+}
+
+fude_result _fude_init_software(fude* app, const fude_config* config)
+{
+    fude_software* sw = f_malloc(sizeof(fude_software));
+    if(!sw) return FUDE_INITIALIZATION_ERROR;
+    f_memzero(sw, sizeof(fude_software));
+    app->software = sw;
+    sw->width = (int)config->width;
+    sw->height = (int)config->height;
+    sw->tiles_x = (config->width + FUDE_SOFTWARE_TILE_SIZE - 1)/FUDE_SOFTWARE_TILE_SIZE;
+    sw->tiles_y = (config->height + FUDE_SOFTWARE_TILE_SIZE - 1)/FUDE_SOFTWARE_TILE_SIZE;
+
+    sw->color = f_malloc((size_t)sw->width*sw->height*4);
+    sw->depth = f_malloc(sizeof(float)*sw->width*sw->height);
+    sw->screen.color = sw->color;
+    sw->screen.depth = sw->depth;
+    sw->screen.width = sw->width;
+    sw->screen.height = sw->height;
+    sw->bins = f_malloc(sizeof(_fude_sw_bin)*sw->tiles_x*sw->tiles_y);
+    sw->active_tiles = f_malloc(sizeof(uint32_t)*sw->tiles_x*sw->tiles_y);
+    if(!sw->color || !sw->depth || !sw->bins || !sw->active_tiles) {
+        _fude_deinit_software(app);
+        return FUDE_INITIALIZATION_ERROR;
+    }
+    _fude_software_clear(app);
+    f_memzero(sw->bins, sizeof(_fude_sw_bin)*sw->tiles_x*sw->tiles_y);
+    sw->tile_capacity = sw->tiles_x*sw->tiles_y;
+    sw->pool = _fude_create_thread_pool(config->software_threads);
+
+    if(app->window) {
+        glGenTextures(1, &sw->present_texture);
+        glBindTexture(GL_TEXTURE_2D, sw->present_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sw->width, sw->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &sw->present_fbo);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sw->present_fbo);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sw->present_texture, 0);
+    }
+
+    return FUDE_OK;
+}
+
+void _fude_deinit_software(fude* app)
+{
+    fude_software* sw = app->software;
+    if(sw->present_fbo) glDeleteFramebuffers(1, &sw->present_fbo);
+    if(sw->present_texture) glDeleteTextures(1, &sw->present_texture);
+    _fude_destroy_thread_pool(sw->pool);
+
+    if(sw->bins) {
+        for(uint32_t i = 0; i < sw->tile_capacity; ++i)
+            f_free(sw->bins[i].data);
+    }
+    f_free(sw->bins);
+    f_free(sw->active_tiles);
+    f_free(sw->triangles.data);
+    f_free(sw->screen.color);
+    f_free(sw->screen.depth);
+
+    // whatever the caller didn't destroy goes with the instance
+    for(uint32_t i = 0; i < sw->textures.count; ++i)
+        f_free(sw->textures.data[i].pixels);
+    for(uint32_t i = 0; i < sw->meshes.count; ++i) {
+        f_free(sw->meshes.data[i].vertices);
+        f_free(sw->meshes.data[i].indices);
+    }
+    f_free(sw->textures.data);
+    f_free(sw->shaders.data);
+    f_free(sw->meshes.data);
+    f_free(sw);
+    app->software = NULL;
+}
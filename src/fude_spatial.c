@@ -0,0 +1,546 @@
+#include "fude.h"
+#include "fude_internal.h"
+
+#include <math.h> // floorf(), ceilf()
+
+#define FUDE_SPATIAL_NONE 0xFFFFFFFFu
+#define FUDE_SPATIAL_INITIAL_CELLS 1024
+
+typedef struct {
+    fude_rectf rect;
+    bool alive;
+    uint32_t stamp; // last query that reported it, so items spanning several cells come out once
+    uint32_t next;  // free list link, or the next item in the same quadtree node
+    uint32_t prev;  // previous item in the same quadtree node
+    uint32_t node, level;
+    int32_t cell_x0, cell_y0, cell_x1, cell_y1; // spatial hash cells it's registered in
+} _fude_spatial_item;
+
+// one registration of an item in a hash cell, chained per cell
+typedef struct {
+    uint32_t item;
+    uint32_t next;
+} _fude_spatial_entry;
+
+typedef struct {
+    int32_t x, y;
+    uint32_t head;
+    bool used;
+} _fude_spatial_cell;
+
+struct fude_spatial {
+    fude_spatial_type type;
+    struct {
+        _fude_spatial_item* data;
+        uint32_t count, capacity; // count is the high water mark, freed slots are reused first
+        uint32_t free, live;
+    } items;
+    uint32_t stamp;
+    struct {
+        uint32_t* data;
+        uint32_t* scratch;
+        uint32_t count, capacity;
+    } results;
+
+    // FUDE_SPATIAL_HASH, open addressing on the cell coordinates, cells are never removed
+    float cell_size, inv_cell_size;
+    struct {
+        _fude_spatial_cell* data;
+        uint32_t used, capacity;
+    } cells;
+    struct {
+        _fude_spatial_entry* data;
+        uint32_t count, capacity;
+        uint32_t free;
+    } entries;
+
+    // FUDE_SPATIAL_QUADTREE, a complete tree stored level by level, level L is a 2^L x 2^L grid
+    fude_rectf world;
+    uint32_t depth;
+    uint32_t* nodes; // first item of every node
+    uint32_t level_offset[FUDE_QUADTREE_MAXIMUM_DEPTH + 1];
+    uint32_t level_items[FUDE_QUADTREE_MAXIMUM_DEPTH + 1];
+};
+
+static inline bool _fude_rects_overlap(fude_rectf a, fude_rectf b)
+{
+    return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+           a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+//======================================================================
+// Spatial hash
+//======================================================================
+static inline int32_t _fude_cell_coord(const fude_spatial* spatial, float value)
+{
+    float cell = floorf(value*spatial->inv_cell_size);
+    if(cell < -1073741824.0f) return -1073741824;
+    if(cell > 1073741824.0f) return 1073741824;
+    return (int32_t)cell;
+}
+
+static inline uint32_t _fude_hash_cell(int32_t x, int32_t y)
+{
+    return ((uint32_t)x*73856093u) ^ ((uint32_t)y*19349663u);
+}
+
+static _fude_spatial_cell* _fude_probe_cell(_fude_spatial_cell* cells, uint32_t capacity, int32_t x, int32_t y)
+{
+    uint32_t mask = capacity - 1;
+    for(uint32_t i = _fude_hash_cell(x, y) & mask;; i = (i + 1) & mask) {
+        if(!cells[i].used || (cells[i].x == x && cells[i].y == y))
+            return cells + i;
+    }
+}
+
+static void _fude_grow_cells(fude_spatial* spatial)
+{
+    uint32_t capacity = spatial->cells.capacity*2;
+    _fude_spatial_cell* cells = f_malloc(capacity*sizeof(_fude_spatial_cell));
+    f_expect(cells != NULL, "Spatial index ran out of memory at %s (%d)", __FILE__, __LINE__);
+    f_memzero(cells, capacity*sizeof(_fude_spatial_cell));
+    for(uint32_t i = 0; i < spatial->cells.capacity; ++i) {
+        const _fude_spatial_cell* cell = spatial->cells.data + i;
+        if(cell->used)
+            *_fude_probe_cell(cells, capacity, cell->x, cell->y) = *cell;
+    }
+    f_free(spatial->cells.data);
+    spatial->cells.data = cells;
+    spatial->cells.capacity = capacity;
+}
+
+static _fude_spatial_cell* _fude_find_cell(fude_spatial* spatial, int32_t x, int32_t y, bool create)
+{
+    // keep the load factor at or below one half so probes stay short
+    if(create && (spatial->cells.used + 1)*2 > spatial->cells.capacity)
+        _fude_grow_cells(spatial);
+
+    _fude_spatial_cell* cell = _fude_probe_cell(spatial->cells.data, spatial->cells.capacity, x, y);
+    if(cell->used) return cell;
+    if(!create) return NULL;
+    cell->used = true;
+    cell->x = x;
+    cell->y = y;
+    cell->head = FUDE_SPATIAL_NONE;
+    spatial->cells.used += 1;
+    return cell;
+}
+
+static void _fude_hash_link(fude_spatial* spatial, uint32_t handle)
+{
+    _fude_spatial_item* item = spatial->items.data + handle;
+    for(int32_t y = item->cell_y0; y <= item->cell_y1; ++y) {
+        for(int32_t x = item->cell_x0; x <= item->cell_x1; ++x) {
+            uint32_t entry = spatial->entries.free;
+            if(entry != FUDE_SPATIAL_NONE) {
+                spatial->entries.free = spatial->entries.data[entry].next;
+            } else {
+                spatial->entries.data = _fude_grow_array(spatial->entries.data, spatial->entries.count,
+                        &spatial->entries.capacity, spatial->entries.count + 1, sizeof(_fude_spatial_entry));
+                entry = spatial->entries.count++;
+            }
+            _fude_spatial_cell* cell = _fude_find_cell(spatial, x, y, true);
+            spatial->entries.data[entry].item = handle;
+            spatial->entries.data[entry].next = cell->head;
+            cell->head = entry;
+        }
+    }
+}
+
+static void _fude_hash_unlink(fude_spatial* spatial, uint32_t handle)
+{
+    const _fude_spatial_item* item = spatial->items.data + handle;
+    for(int32_t y = item->cell_y0; y <= item->cell_y1; ++y) {
+        for(int32_t x = item->cell_x0; x <= item->cell_x1; ++x) {
+            _fude_spatial_cell* cell = _fude_find_cell(spatial, x, y, false);
+            if(!cell) continue;
+            uint32_t* link = &cell->head;
+            while(*link != FUDE_SPATIAL_NONE && spatial->entries.data[*link].item != handle)
+                link = &spatial->entries.data[*link].next;
+            if(*link == FUDE_SPATIAL_NONE) continue;
+            uint32_t entry = *link;
+            *link = spatial->entries.data[entry].next;
+            spatial->entries.data[entry].next = spatial->entries.free;
+            spatial->entries.free = entry;
+        }
+    }
+}
+
+static void _fude_hash_cells_of(const fude_spatial* spatial, fude_rectf rect,
+        int32_t* x0, int32_t* y0, int32_t* x1, int32_t* y1)
+{
+    *x0 = _fude_cell_coord(spatial, rect.x);
+    *y0 = _fude_cell_coord(spatial, rect.y);
+    *x1 = _fude_cell_coord(spatial, rect.x + rect.width);
+    *y1 = _fude_cell_coord(spatial, rect.y + rect.height);
+}
+
+static void _fude_hash_collect_cell(fude_spatial* spatial, const _fude_spatial_cell* cell, fude_rectf rect)
+{
+    for(uint32_t entry = cell->head; entry != FUDE_SPATIAL_NONE; entry = spatial->entries.data[entry].next) {
+        uint32_t handle = spatial->entries.data[entry].item;
+        _fude_spatial_item* item = spatial->items.data + handle;
+        if(item->stamp == spatial->stamp || !_fude_rects_overlap(item->rect, rect)) continue;
+        item->stamp = spatial->stamp;
+        spatial->results.data[spatial->results.count++] = handle;
+    }
+}
+
+static void _fude_hash_query(fude_spatial* spatial, fude_rectf rect)
+{
+    int32_t x0, y0, x1, y1;
+    _fude_hash_cells_of(spatial, rect, &x0, &y0, &x1, &y1);
+
+    // a query covering more cells than exist walks the table instead
+    uint64_t range = (uint64_t)((int64_t)x1 - x0 + 1)*(uint64_t)((int64_t)y1 - y0 + 1);
+    if(range > spatial->cells.used) {
+        for(uint32_t i = 0; i < spatial->cells.capacity; ++i) {
+            const _fude_spatial_cell* cell = spatial->cells.data + i;
+            if(cell->used && cell->x >= x0 && cell->x <= x1 && cell->y >= y0 && cell->y <= y1)
+                _fude_hash_collect_cell(spatial, cell, rect);
+        }
+        return;
+    }
+
+    for(int32_t y = y0; y <= y1; ++y) {
+        for(int32_t x = x0; x <= x1; ++x) {
+            const _fude_spatial_cell* cell = _fude_find_cell(spatial, x, y, false);
+            if(cell) _fude_hash_collect_cell(spatial, cell, rect);
+        }
+    }
+}
+
+//======================================================================
+// Loose quadtree
+//======================================================================
+// an item goes to the deepest level whose cells are at least as large as it is, into the cell holding
+// its center. Node bounds are loosened by half a cell on every side so the item always fits.
+// Items centered outside the world (and anything too large) live in the root.
+static void _fude_quadtree_place(const fude_spatial* spatial, fude_rectf rect, uint32_t* node, uint32_t* level)
+{
+    const fude_rectf world = spatial->world;
+    float cx = rect.x + rect.width*0.5f;
+    float cy = rect.y + rect.height*0.5f;
+    *node = 0;
+    *level = 0;
+    if(cx < world.x || cy < world.y || cx >= world.x + world.width || cy >= world.y + world.height)
+        return;
+
+    uint32_t l = 0;
+    while(l < spatial->depth &&
+            rect.width <= world.width/(float)(2u << l) && rect.height <= world.height/(float)(2u << l))
+        l += 1;
+
+    uint32_t n = 1u << l;
+    uint32_t ix = (uint32_t)((cx - world.x)/world.width*(float)n);
+    uint32_t iy = (uint32_t)((cy - world.y)/world.height*(float)n);
+    if(ix >= n) ix = n - 1;
+    if(iy >= n) iy = n - 1;
+    *node = spatial->level_offset[l] + iy*n + ix;
+    *level = l;
+}
+
+static void _fude_quadtree_link(fude_spatial* spatial, uint32_t handle)
+{
+    _fude_spatial_item* item = spatial->items.data + handle;
+    _fude_quadtree_place(spatial, item->rect, &item->node, &item->level);
+    item->prev = FUDE_SPATIAL_NONE;
+    item->next = spatial->nodes[item->node];
+    if(item->next != FUDE_SPATIAL_NONE)
+        spatial->items.data[item->next].prev = handle;
+    spatial->nodes[item->node] = handle;
+    spatial->level_items[item->level] += 1;
+}
+
+static void _fude_quadtree_unlink(fude_spatial* spatial, uint32_t handle)
+{
+    _fude_spatial_item* item = spatial->items.data + handle;
+    if(item->prev != FUDE_SPATIAL_NONE)
+        spatial->items.data[item->prev].next = item->next;
+    else
+        spatial->nodes[item->node] = item->next;
+    if(item->next != FUDE_SPATIAL_NONE)
+        spatial->items.data[item->next].prev = item->prev;
+    spatial->level_items[item->level] -= 1;
+}
+
+static void _fude_quadtree_collect_node(fude_spatial* spatial, uint32_t node, fude_rectf rect)
+{
+    for(uint32_t handle = spatial->nodes[node]; handle != FUDE_SPATIAL_NONE; handle = spatial->items.data[handle].next) {
+        if(_fude_rects_overlap(spatial->items.data[handle].rect, rect))
+            spatial->results.data[spatial->results.count++] = handle;
+    }
+}
+
+static void _fude_quadtree_query(fude_spatial* spatial, fude_rectf rect)
+{
+    const fude_rectf world = spatial->world;
+    if(spatial->level_items[0] > 0)
+        _fude_quadtree_collect_node(spatial, 0, rect);
+
+    for(uint32_t l = 1; l <= spatial->depth; ++l) {
+        if(spatial->level_items[l] == 0) continue;
+        int32_t n = 1 << l;
+        float cell_w = world.width/(float)n, cell_h = world.height/(float)n;
+
+        // node i spans [i - 0.5, i + 1.5] cells once loosened
+        float x0 = ceilf((rect.x - world.x)/cell_w - 1.5f);
+        float x1 = floorf((rect.x + rect.width - world.x)/cell_w + 0.5f);
+        float y0 = ceilf((rect.y - world.y)/cell_h - 1.5f);
+        float y1 = floorf((rect.y + rect.height - world.y)/cell_h + 0.5f);
+        if(x1 < 0.0f || y1 < 0.0f || x0 > (float)(n - 1) || y0 > (float)(n - 1)) continue;
+        int32_t ix0 = x0 < 0.0f ? 0 : (int32_t)x0, iy0 = y0 < 0.0f ? 0 : (int32_t)y0;
+        int32_t ix1 = x1 > (float)(n - 1) ? n - 1 : (int32_t)x1, iy1 = y1 > (float)(n - 1) ? n - 1 : (int32_t)y1;
+
+        for(int32_t iy = iy0; iy <= iy1; ++iy) {
+            const uint32_t row = spatial->level_offset[l] + (uint32_t)(iy*n);
+            for(int32_t ix = ix0; ix <= ix1; ++ix) {
+                if(spatial->nodes[row + (uint32_t)ix] != FUDE_SPATIAL_NONE)
+                    _fude_quadtree_collect_node(spatial, row + (uint32_t)ix, rect);
+            }
+        }
+    }
+}
+
+//======================================================================
+// Shared
+//======================================================================
+static fude_spatial* _fude_create_spatial(fude_spatial_type type)
+{
+    fude_spatial* spatial = f_malloc(sizeof(fude_spatial));
+    if(!spatial) return NULL;
+    f_memzero(spatial, sizeof(fude_spatial));
+    spatial->type = type;
+    spatial->items.free = FUDE_SPATIAL_NONE;
+    spatial->entries.free = FUDE_SPATIAL_NONE;
+    return spatial;
+}
+
+fude_result f_create_spatial_hash(fude_spatial** spatial, float cell_size)
+{
+    if(!spatial || !(cell_size > 0.0f)) return FUDE_INVALID_ARGUMENTS_ERROR;
+    fude_spatial* result = _fude_create_spatial(FUDE_SPATIAL_HASH);
+    if(!result) return FUDE_ERROR;
+    result->cell_size = cell_size;
+    result->inv_cell_size = 1.0f/cell_size;
+    result->cells.capacity = FUDE_SPATIAL_INITIAL_CELLS;
+    result->cells.data = f_malloc(result->cells.capacity*sizeof(_fude_spatial_cell));
+    if(!result->cells.data) {
+        f_free(result);
+        return FUDE_ERROR;
+    }
+    f_memzero(result->cells.data, result->cells.capacity*sizeof(_fude_spatial_cell));
+    *spatial = result;
+    return FUDE_OK;
+}
+
+fude_result f_create_quadtree(fude_spatial** spatial, fude_rectf world, uint32_t depth)
+{
+    if(!spatial || !(world.width > 0.0f) || !(world.height > 0.0f) || depth > FUDE_QUADTREE_MAXIMUM_DEPTH)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+    fude_spatial* result = _fude_create_spatial(FUDE_SPATIAL_QUADTREE);
+    if(!result) return FUDE_ERROR;
+    result->world = world;
+    result->depth = depth;
+
+    uint32_t node_count = 0;
+    for(uint32_t l = 0; l <= depth; ++l) {
+        result->level_offset[l] = node_count;
+        node_count += 1u << (2*l);
+    }
+    result->nodes = f_malloc(node_count*sizeof(uint32_t));
+    if(!result->nodes) {
+        f_free(result);
+        return FUDE_ERROR;
+    }
+    f_memset(result->nodes, 0xFF, node_count*sizeof(uint32_t));
+    *spatial = result;
+    return FUDE_OK;
+}
+
+void f_destroy_spatial(fude_spatial* spatial)
+{
+    if(!spatial) return;
+    if(spatial->items.data) f_free(spatial->items.data);
+    if(spatial->results.data) f_free(spatial->results.data);
+    if(spatial->results.scratch) f_free(spatial->results.scratch);
+    if(spatial->cells.data) f_free(spatial->cells.data);
+    if(spatial->entries.data) f_free(spatial->entries.data);
+    if(spatial->nodes) f_free(spatial->nodes);
+    f_free(spatial);
+}
+
+static void _fude_spatial_link(fude_spatial* spatial, uint32_t handle)
+{
+    _fude_spatial_item* item = spatial->items.data + handle;
+    if(spatial->type == FUDE_SPATIAL_HASH) {
+        _fude_hash_cells_of(spatial, item->rect, &item->cell_x0, &item->cell_y0, &item->cell_x1, &item->cell_y1);
+        _fude_hash_link(spatial, handle);
+    } else {
+        _fude_quadtree_link(spatial, handle);
+    }
+}
+
+static void _fude_spatial_unlink(fude_spatial* spatial, uint32_t handle)
+{
+    if(spatial->type == FUDE_SPATIAL_HASH)
+        _fude_hash_unlink(spatial, handle);
+    else
+        _fude_quadtree_unlink(spatial, handle);
+}
+
+fude_result f_spatial_insert(fude_spatial* spatial, const fude_rectf* rects, uint32_t count, uint32_t* handles)
+{
+    if(!spatial || (count > 0 && (!rects || !handles))) return FUDE_INVALID_ARGUMENTS_ERROR;
+
+    // make room for the whole batch up front, whatever the free list can't take
+    uint32_t reusable = 0;
+    for(uint32_t h = spatial->items.free; h != FUDE_SPATIAL_NONE && reusable < count; h = spatial->items.data[h].next)
+        reusable += 1;
+    spatial->items.data = _fude_grow_array(spatial->items.data, spatial->items.count, &spatial->items.capacity,
+            spatial->items.count + (count - reusable), sizeof(_fude_spatial_item));
+
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t handle = spatial->items.free;
+        if(handle != FUDE_SPATIAL_NONE)
+            spatial->items.free = spatial->items.data[handle].next;
+        else
+            handle = spatial->items.count++;
+
+        _fude_spatial_item* item = spatial->items.data + handle;
+        f_memzero(item, sizeof(_fude_spatial_item));
+        item->rect = rects[i];
+        item->alive = true;
+        item->stamp = spatial->stamp;
+        _fude_spatial_link(spatial, handle);
+        handles[i] = handle;
+    }
+    spatial->items.live += count;
+    return FUDE_OK;
+}
+
+void f_spatial_move(fude_spatial* spatial, const uint32_t* handles, const fude_rectf* rects, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t handle = handles[i];
+        if(handle >= spatial->items.count || !spatial->items.data[handle].alive) continue;
+        _fude_spatial_item* item = spatial->items.data + handle;
+
+        // most moves stay within the same cells or node, then only the rect changes
+        if(spatial->type == FUDE_SPATIAL_HASH) {
+            int32_t x0, y0, x1, y1;
+            _fude_hash_cells_of(spatial, rects[i], &x0, &y0, &x1, &y1);
+            if(x0 != item->cell_x0 || y0 != item->cell_y0 || x1 != item->cell_x1 || y1 != item->cell_y1) {
+                _fude_hash_unlink(spatial, handle);
+                item->cell_x0 = x0; item->cell_y0 = y0;
+                item->cell_x1 = x1; item->cell_y1 = y1;
+                _fude_hash_link(spatial, handle);
+            }
+            item->rect = rects[i];
+        } else {
+            uint32_t node, level;
+            _fude_quadtree_place(spatial, rects[i], &node, &level);
+            item->rect = rects[i];
+            if(node != item->node) {
+                _fude_quadtree_unlink(spatial, handle);
+                _fude_quadtree_link(spatial, handle);
+            }
+        }
+    }
+}
+
+void f_spatial_remove(fude_spatial* spatial, const uint32_t* handles, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t handle = handles[i];
+        if(handle >= spatial->items.count || !spatial->items.data[handle].alive) continue;
+        _fude_spatial_unlink(spatial, handle);
+        spatial->items.data[handle].alive = false;
+        spatial->items.data[handle].next = spatial->items.free;
+        spatial->items.free = handle;
+        spatial->items.live -= 1;
+    }
+}
+
+uint32_t f_spatial_count(const fude_spatial* spatial)
+{
+    return spatial->items.live;
+}
+
+// ascending handles, so the caller walks its own per-handle arrays front to back
+static void _fude_sort_handles(uint32_t* data, uint32_t* scratch, uint32_t count, uint32_t max_handle)
+{
+    if(count < 64) {
+        for(uint32_t i = 1; i < count; ++i) {
+            uint32_t value = data[i];
+            uint32_t j = i;
+            for(; j > 0 && data[j - 1] > value; --j)
+                data[j] = data[j - 1];
+            data[j] = value;
+        }
+        return;
+    }
+
+    uint32_t* src = data;
+    uint32_t* dst = scratch;
+    for(uint32_t shift = 0; shift < 32 && (max_handle >> shift) != 0; shift += 8) {
+        uint32_t offsets[256] = {0};
+        for(uint32_t i = 0; i < count; ++i)
+            offsets[src[i] >> shift & 255] += 1;
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i < 256; ++i) {
+            uint32_t bucket = offsets[i];
+            offsets[i] = sum;
+            sum += bucket;
+        }
+        for(uint32_t i = 0; i < count; ++i)
+            dst[offsets[src[i] >> shift & 255]++] = src[i];
+        uint32_t* swap = src; src = dst; dst = swap;
+    }
+    if(src != data)
+        f_memcpy(data, src, count*sizeof(uint32_t));
+}
+
+uint32_t f_spatial_query(fude_spatial* spatial, fude_rectf rect, uint32_t* handles, uint32_t max_count)
+{
+    // every live item could match, so the results never need to grow mid-query
+    if(spatial->items.live > spatial->results.capacity) {
+        uint32_t capacity = spatial->results.capacity;
+        spatial->results.data = _fude_grow_array(spatial->results.data, 0, &capacity,
+                spatial->items.live, sizeof(uint32_t));
+        spatial->results.scratch = _fude_grow_array(spatial->results.scratch, 0, &spatial->results.capacity,
+                spatial->items.live, sizeof(uint32_t));
+    }
+    spatial->results.count = 0;
+
+    if(spatial->type == FUDE_SPATIAL_HASH) {
+        spatial->stamp += 1;
+        if(spatial->stamp == 0) {
+            // wrapped around, forget every old stamp
+            for(uint32_t i = 0; i < spatial->items.count; ++i)
+                spatial->items.data[i].stamp = 0;
+            spatial->stamp = 1;
+        }
+        _fude_hash_query(spatial, rect);
+    } else {
+        _fude_quadtree_query(spatial, rect);
+    }
+
+    uint32_t count = spatial->results.count;
+    _fude_sort_handles(spatial->results.data, spatial->results.scratch, count, spatial->items.count);
+    uint32_t copied = count < max_count ? count : max_count;
+    if(handles && copied > 0)
+        f_memcpy(handles, spatial->results.data, copied*sizeof(uint32_t));
+    return count;
+}
+
+uint32_t f_spatial_query_camera(fude_spatial* spatial, fude_camera* camera, uint32_t* handles, uint32_t max_count)
+{
+    f_update_camera(camera);
+    fude_rectf rect;
+    rect.x = camera->bounds.min.x;
+    rect.y = camera->bounds.min.y;
+    rect.width = camera->bounds.max.x - camera->bounds.min.x;
+    rect.height = camera->bounds.max.y - camera->bounds.min.y;
+    return f_spatial_query(spatial, rect, handles, max_count);
+}
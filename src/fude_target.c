@@ -0,0 +1,297 @@
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+
+// a target is a color texture plus an optional depth/stencil renderbuffer attached to its own FBO.
+// Framebuffer objects aren't shared between contexts, so with threaded rendering only the texture and
+// renderbuffer are made here and the render thread attaches them to renderer.target_fbo when replaying.
+// Transient targets from f_acquire_render_target are matched by size, format and depth: releasing one
+// lets the next acquire in the same frame reuse it (a blur chain ping-pongs between two), f_present
+// releases all of them and frees the storage of those unused for FUDE_TARGET_POOL_IDLE_FRAMES
+
+typedef struct {
+    fude_render_target* target; // allocated on its own so pointers stay valid as the pool grows
+    uint64_t last_frame;        // app->timing.frame_count when it was last acquired
+    bool in_use;
+} _fude_pooled_target;
+
+struct fude_target_pool {
+    _fude_pooled_target* data;
+    uint32_t count, capacity;
+};
+
+static bool _fude_target_is_relative(const fude_render_target_config* config)
+{
+    return config->width == 0 || config->height == 0;
+}
+
+// never 0, a minimized window still gets a 1x1 target
+static void _fude_target_size(const fude* app, const fude_render_target_config* config,
+        uint32_t* width, uint32_t* height)
+{
+    if(!_fude_target_is_relative(config)) {
+        *width = config->width;
+        *height = config->height;
+        return;
+    }
+    const float scale = config->scale > 0.0f ? config->scale : 1.0f;
+    const float w = (float)app->renderer.framebuffer.width*scale + 0.5f;
+    const float h = (float)app->renderer.framebuffer.height*scale + 0.5f;
+    *width = w >= 1.0f ? (uint32_t)w : 1;
+    *height = h >= 1.0f ? (uint32_t)h : 1;
+}
+
+static void _fude_destroy_target_storage(fude* app, fude_render_target* target)
+{
+    if(!app->software) {
+        if(target->fbo) glDeleteFramebuffers(1, &target->fbo);
+        if(target->depth) glDeleteRenderbuffers(1, &target->depth);
+    }
+    if(target->color.id) f_destroy_texture(app, target->color);
+    target->color.id = 0;
+    target->fbo = 0;
+    target->depth = 0;
+}
+
+static fude_result _fude_create_target_storage(fude* app, fude_render_target* target)
+{
+    if(app->software)
+        return _fude_software_create_texture(app, &target->color, NULL, (int)target->width, (int)target->height, 4);
+
+    const bool hdr = target->config.format == FUDE_TARGET_RGBA16F;
+    glGenTextures(1, &target->color.id);
+    glBindTexture(GL_TEXTURE_2D, target->color.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, hdr ? GL_RGBA16F : GL_RGBA8, (GLsizei)target->width, (GLsizei)target->height,
+            0, GL_RGBA, hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, NULL);
+    if(target->config.depth) {
+        glGenRenderbuffers(1, &target->depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, (GLsizei)target->width, (GLsizei)target->height);
+    }
+    if(app->render_thread) return FUDE_OK;
+
+    glGenFramebuffers(1, &target->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->color.id, 0);
+    if(target->depth)
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->depth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    const fude_render_target* bound = app->renderer.target;
+    glBindFramebuffer(GL_FRAMEBUFFER, bound ? bound->fbo : app->renderer.default_framebuffer);
+    if(status != GL_FRAMEBUFFER_COMPLETE) {
+        f_trace_log(FUDE_LOG_ERROR, "Render target framebuffer is incomplete (0x%x)", status);
+        return FUDE_ERROR;
+    }
+    return FUDE_OK;
+}
+
+// width and height 0 make it follow the default framebuffer, f_begin_target reallocates it after a resize
+fude_result f_create_render_target(fude* app, fude_render_target* target, const fude_render_target_config* config)
+{
+    if(!app || !target || !config) return FUDE_INVALID_ARGUMENTS_ERROR;
+    f_memzero(target, sizeof(fude_render_target));
+    target->config = *config;
+    _fude_target_size(app, config, &target->width, &target->height);
+
+    fude_result result = _fude_create_target_storage(app, target);
+    if(result != FUDE_OK)
+        f_destroy_render_target(app, target);
+    return result;
+}
+
+void f_destroy_render_target(fude* app, fude_render_target* target)
+{
+    if(!app || !target) return;
+    _fude_destroy_target_storage(app, target);
+    f_memzero(target, sizeof(fude_render_target));
+}
+
+// fbo 0 with a color texture attaches it to renderer->target_fbo first, color 0 is the default framebuffer
+void _fude_bind_target_gl(fude_renderer* renderer, uint32_t fbo, uint32_t color, uint32_t depth, int width, int height)
+{
+    if(color == 0) {
+        fbo = renderer->default_framebuffer;
+    } else if(fbo == 0) {
+        if(!renderer->target_fbo) glGenFramebuffers(1, &renderer->target_fbo);
+        fbo = renderer->target_fbo;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+static void _fude_bind_target(fude* app, fude_render_target* target)
+{
+    fude_renderer* renderer = &app->renderer;
+    renderer->target = target;
+    // the software backend only has one for the screen
+    renderer->layers.depth_buffer = target ? target->config.depth && !app->software : true;
+    if(app->render_thread) {
+        _fude_record_bind_target(app, target);
+    } else if(app->software) {
+        _fude_software_bind_target(app, target ? target->color : (fude_texture){ 0 });
+    } else if(target) {
+        _fude_bind_target_gl(renderer, target->fbo, target->color.id, target->depth,
+                (int)target->width, (int)target->height);
+    } else {
+        _fude_bind_target_gl(renderer, 0, 0, 0, renderer->framebuffer.width, renderer->framebuffer.height);
+    }
+}
+
+// what's drawn after this goes into target until f_end_target or the next f_begin_target, they don't
+// nest. The viewport covers the target, cameras are the caller's (f_set_camera_viewport to its size)
+void f_begin_target(fude* app, fude_render_target* target)
+{
+    if(!target) {
+        f_end_target(app);
+        return;
+    }
+    _fude_break_batch(app, FUDE_BATCH_BREAK_TARGET);
+
+    if(_fude_target_is_relative(&target->config)) {
+        uint32_t width, height;
+        _fude_target_size(app, &target->config, &width, &height);
+        if(width != target->width || height != target->height || !target->color.id) {
+            if(app->renderer.target == target) _fude_bind_target(app, NULL);
+            _fude_destroy_target_storage(app, target);
+            target->width = width;
+            target->height = height;
+            if(_fude_create_target_storage(app, target) != FUDE_OK) {
+                f_trace_log(FUDE_LOG_WARNING, "Failed to resize a render target to %ux%u", width, height);
+                _fude_destroy_target_storage(app, target);
+                return;
+            }
+        }
+    }
+    if(!target->color.id) return;
+    _fude_bind_target(app, target);
+}
+
+// back to the default framebuffer with a viewport covering it
+void f_end_target(fude* app)
+{
+    if(!app->renderer.target) return;
+    _fude_break_batch(app, FUDE_BATCH_BREAK_TARGET);
+    _fude_bind_target(app, NULL);
+}
+
+// the whole target upright, its rows are bottom first so v is flipped compared to f_rectangle_tex
+void f_draw_render_target(fude* app, const fude_render_target* target, fude_rect rect)
+{
+    if(!target || !target->color.id) return;
+    fude_renderer* renderer = &app->renderer;
+    const float x0 = (float)rect.x, y0 = (float)rect.y;
+    const float x1 = x0 + (float)rect.width, y1 = y0 + (float)rect.height;
+    const V4f rgba = renderer->working.vertex.color;
+    const float object_id = renderer->working.vertex.object_id;
+    const uint32_t slot = _fude_sprite_slot(renderer, target->color);
+    const float tex_index = (float)slot;
+
+    uint32_t count = 1;
+    fude_vertex* vertices = _fude_begin_quads(app, renderer->default_shader, target->color, slot, &count);
+    vertices[0] = (fude_vertex){ .position.x = x0, .position.y = y0, .color = rgba,
+        .tex_coords.u = 0.0f, .tex_coords.v = 1.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[1] = (fude_vertex){ .position.x = x1, .position.y = y0, .color = rgba,
+        .tex_coords.u = 1.0f, .tex_coords.v = 1.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[2] = (fude_vertex){ .position.x = x1, .position.y = y1, .color = rgba,
+        .tex_coords.u = 1.0f, .tex_coords.v = 0.0f, .tex_index = tex_index, .object_id = object_id };
+    vertices[3] = (fude_vertex){ .position.x = x0, .position.y = y1, .color = rgba,
+        .tex_coords.u = 0.0f, .tex_coords.v = 0.0f, .tex_index = tex_index, .object_id = object_id };
+    _fude_end_quads(app, 1);
+}
+
+//======================================================================
+// Transient pool
+//======================================================================
+static fude_target_pool* _fude_get_target_pool(fude* app)
+{
+    if(app->renderer.targets) return app->renderer.targets;
+    fude_target_pool* pool = f_malloc(sizeof(fude_target_pool));
+    f_expect(pool != NULL, "Failed to allocate the render target pool at %s (%d)", __FILE__, __LINE__);
+    f_memzero(pool, sizeof(fude_target_pool));
+    app->renderer.targets = pool;
+    return pool;
+}
+
+// a free pooled target of the size config resolves to right now, or a new one. It stays this size
+// (window relative ones aren't resized by f_begin_target) and belongs to the pool, don't destroy it
+fude_render_target* f_acquire_render_target(fude* app, const fude_render_target_config* config)
+{
+    if(!app || !config) return NULL;
+    fude_target_pool* pool = _fude_get_target_pool(app);
+    fude_render_target_config resolved = *config;
+    _fude_target_size(app, config, &resolved.width, &resolved.height);
+
+    for(uint32_t i = 0; i < pool->count; ++i) {
+        _fude_pooled_target* entry = pool->data + i;
+        const fude_render_target* target = entry->target;
+        if(entry->in_use || target->width != resolved.width || target->height != resolved.height ||
+                target->config.format != resolved.format || target->config.depth != resolved.depth)
+            continue;
+        entry->in_use = true;
+        entry->last_frame = app->timing.frame_count;
+        return entry->target;
+    }
+
+    fude_render_target* target = f_malloc(sizeof(fude_render_target));
+    if(!target) return NULL;
+    if(f_create_render_target(app, target, &resolved) != FUDE_OK) {
+        f_free(target);
+        return NULL;
+    }
+    pool->data = _fude_grow_array(pool->data, pool->count, &pool->capacity, pool->count + 1,
+            sizeof(_fude_pooled_target));
+    pool->data[pool->count++] = (_fude_pooled_target){ .target = target,
+        .last_frame = app->timing.frame_count, .in_use = true };
+    return target;
+}
+
+// done with it for this frame, the next acquire of the same kind may return it
+void f_release_render_target(fude* app, fude_render_target* target)
+{
+    fude_target_pool* pool = app->renderer.targets;
+    if(!pool || !target) return;
+    for(uint32_t i = 0; i < pool->count; ++i) {
+        if(pool->data[i].target == target) {
+            pool->data[i].in_use = false;
+            return;
+        }
+    }
+}
+
+void _fude_recycle_render_targets(fude* app)
+{
+    fude_target_pool* pool = app->renderer.targets;
+    if(!pool) return;
+    for(uint32_t i = 0; i < pool->count;) {
+        _fude_pooled_target* entry = pool->data + i;
+        entry->in_use = false;
+        if(app->timing.frame_count - entry->last_frame > FUDE_TARGET_POOL_IDLE_FRAMES &&
+                entry->target != app->renderer.target) {
+            f_destroy_render_target(app, entry->target);
+            f_free(entry->target);
+            *entry = pool->data[--pool->count];
+            continue;
+        }
+        i += 1;
+    }
+}
+
+void _fude_destroy_target_pool(fude* app)
+{
+    fude_target_pool* pool = app->renderer.targets;
+    if(!pool) return;
+    for(uint32_t i = 0; i < pool->count; ++i) {
+        f_destroy_render_target(app, pool->data[i].target);
+        f_free(pool->data[i].target);
+    }
+    f_free(pool->data);
+    f_free(pool);
+    app->renderer.targets = NULL;
+}
@@ -0,0 +1,949 @@
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+
+#include <math.h>   // sqrtf(), ceilf()
+#include <string.h> // memcmp()
+
+// glyphs are kept as signed distance fields in fixed size cells of one atlas: a cell fits any glyph
+// at FUDE_FONT_SDF_SIZE plus the spread, bigger glyphs are rasterized at a lower scale
+#define FUDE_FONT_CELL_SIZE (FUDE_FONT_SDF_SIZE + 2*FUDE_FONT_SDF_SPREAD)
+#define FUDE_FONT_NO_CELL 0xFFFFFFFFu
+#define FUDE_TTF_MAXIMUM_COMPONENT_DEPTH 8
+
+// laid out strings are cached per font, everything is emptied at once when one part is full
+#define FUDE_TEXT_LAYOUT_SLOTS 8192 // power of two, at most half of them are used
+#define FUDE_TEXT_LAYOUT_GLYPHS (64*1024)
+#define FUDE_TEXT_LAYOUT_BYTES (256*1024)
+
+typedef struct {
+    uint32_t codepoint;
+    uint16_t index;         // TrueType glyph id
+    bool empty;             // no outline, nothing to draw
+    float advance;          // font units
+    float scale;            // atlas pixels per font unit
+    float x0, y0, x1, y1;   // quad around the outline in font units relative to the pen, y up
+    uint32_t width, height; // quad size in atlas pixels
+    float u0, v0, u1, v1;   // valid while cell != FUDE_FONT_NO_CELL
+    uint32_t cell;
+    uint64_t last_used;     // frame_count of the last f_draw_text that emitted it
+    uint32_t pins;          // display lists replaying its cell, it isn't evicted while any do
+} _fude_glyph;
+
+typedef struct { float x0, y0, x1, y1; } _fude_ttf_edge;
+typedef struct { float x, y; uint8_t flags; } _fude_ttf_point;
+
+typedef struct {
+    float x, y; // pen position in font units, y down from the top of the first line
+    uint32_t glyph;
+} _fude_text_glyph;
+
+typedef struct {
+    uint64_t hash;         // 0 marks a free slot
+    uint32_t length;       // bytes
+    uint32_t text;         // offset into layouts.bytes
+    uint32_t first, count; // range of layouts.glyphs, empty glyphs like spaces are left out
+    float width, height;   // font units
+} _fude_text_layout;
+
+struct fude_font {
+    uint8_t* data;
+    size_t size;
+    uint32_t glyf, loca, hmtx, cmap; // table offsets into data
+    uint32_t kern_pairs, kern_count; // format 0 'kern' pairs, kern_count is 0 without them
+    uint16_t cmap_format;            // 4 or 12
+    uint16_t glyph_count, metric_count;
+    bool long_loca;
+    float ascent, descent, line_gap; // font units, descent is negative
+    float scale;                     // atlas pixels per font unit
+
+    fude_texture texture;            // sampled by the default shader like a sprite's, see FUDE_GLYPH_FLAG
+    uint8_t* pixels;                 // CPU copy of the atlas
+    uint32_t* cells;                 // glyph in each used cell
+    uint32_t cell_count, used_cells, cells_per_row;
+    int dirty_y0, dirty_y1;          // atlas rows written since the last upload
+    bool warned_full;
+
+    struct { _fude_glyph* data; uint32_t count, capacity; } glyphs;
+    struct { uint32_t* slots; uint32_t capacity, count; } glyph_map; // codepoint -> glyph + 1, open addressing
+    uint32_t ascii[128];                                             // glyph + 1 for the common case
+
+    // outline scratch, reused by every rasterization
+    struct { _fude_ttf_edge* data; uint32_t count, capacity; } edges;
+    struct { _fude_ttf_point* data; uint32_t count, capacity; } points;
+
+    struct {
+        _fude_text_layout* slots;
+        _fude_text_glyph* glyphs;
+        char* bytes;
+        uint32_t count, glyph_count, byte_count;
+        _fude_text_layout uncached; // strings too long for the cache
+    } layouts;
+};
+
+//======================================================================
+// TrueType
+//======================================================================
+static uint16_t _fude_ttf_u16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static int16_t _fude_ttf_i16(const uint8_t* p) { return (int16_t)_fude_ttf_u16(p); }
+static uint32_t _fude_ttf_u32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+static float _fude_ttf_f2dot14(const uint8_t* p) { return (float)_fude_ttf_i16(p)/16384.0f; }
+
+static bool _fude_ttf_in_bounds(const fude_font* font, uint64_t offset, uint64_t size)
+{
+    return offset + size <= font->size;
+}
+
+static uint32_t _fude_ttf_table(const fude_font* font, const char* tag)
+{
+    if(!_fude_ttf_in_bounds(font, 0, 12)) return 0;
+    uint16_t count = _fude_ttf_u16(font->data + 4);
+    for(uint32_t i = 0; i < count && _fude_ttf_in_bounds(font, 12 + 16*i, 16); ++i) {
+        const uint8_t* record = font->data + 12 + 16*i;
+        if(record[0] != tag[0] || record[1] != tag[1] || record[2] != tag[2] || record[3] != tag[3]) continue;
+        uint32_t offset = _fude_ttf_u32(record + 8), length = _fude_ttf_u32(record + 12);
+        return _fude_ttf_in_bounds(font, offset, length) ? offset : 0;
+    }
+    return 0;
+}
+
+// only glyf outlines: CFF flavored OpenType and font collections are rejected
+static bool _fude_ttf_parse(fude_font* font)
+{
+    const uint8_t* data = font->data;
+    uint32_t version = font->size >= 4 ? _fude_ttf_u32(data) : 0;
+    if(version != 0x00010000 && version != 0x74727565) return false; // 'true'
+
+    uint32_t head = _fude_ttf_table(font, "head"), maxp = _fude_ttf_table(font, "maxp");
+    uint32_t hhea = _fude_ttf_table(font, "hhea"), kern = _fude_ttf_table(font, "kern");
+    font->cmap = _fude_ttf_table(font, "cmap");
+    font->loca = _fude_ttf_table(font, "loca");
+    font->glyf = _fude_ttf_table(font, "glyf");
+    font->hmtx = _fude_ttf_table(font, "hmtx");
+    if(!head || !maxp || !hhea || !font->cmap || !font->loca || !font->glyf || !font->hmtx) return false;
+    if(!_fude_ttf_in_bounds(font, head, 54) || !_fude_ttf_in_bounds(font, maxp, 6) ||
+            !_fude_ttf_in_bounds(font, hhea, 36) || !_fude_ttf_in_bounds(font, font->cmap, 4))
+        return false;
+
+    font->long_loca = _fude_ttf_i16(data + head + 50) != 0;
+    font->glyph_count = _fude_ttf_u16(data + maxp + 4);
+    font->ascent = _fude_ttf_i16(data + hhea + 4);
+    font->descent = _fude_ttf_i16(data + hhea + 6);
+    font->line_gap = _fude_ttf_i16(data + hhea + 8);
+    font->metric_count = _fude_ttf_u16(data + hhea + 34);
+    if(font->metric_count == 0 || font->ascent - font->descent <= 0.0f) return false;
+    if(!_fude_ttf_in_bounds(font, font->loca, (uint64_t)(font->glyph_count + 1)*(font->long_loca ? 4 : 2))) return false;
+    if(!_fude_ttf_in_bounds(font, font->hmtx, (uint64_t)font->metric_count*4)) return false;
+    font->scale = FUDE_FONT_SDF_SIZE/(font->ascent - font->descent);
+
+    // a Unicode subtable, the full repertoire of format 12 over the BMP only format 4
+    uint32_t subtable = 0;
+    uint16_t subtable_count = _fude_ttf_u16(data + font->cmap + 2);
+    for(uint32_t i = 0; i < subtable_count && _fude_ttf_in_bounds(font, font->cmap + 4 + 8*i, 8); ++i) {
+        const uint8_t* record = data + font->cmap + 4 + 8*i;
+        uint16_t platform = _fude_ttf_u16(record), encoding = _fude_ttf_u16(record + 2);
+        uint32_t offset = font->cmap + _fude_ttf_u32(record + 4);
+        bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        if(!unicode || !_fude_ttf_in_bounds(font, offset, 16)) continue;
+        uint16_t format = _fude_ttf_u16(data + offset);
+        if(format == 12) {
+            subtable = offset;
+            font->cmap_format = 12;
+            break;
+        }
+        if(format == 4 && !subtable) {
+            subtable = offset;
+            font->cmap_format = 4;
+        }
+    }
+    if(!subtable) return false;
+    font->cmap = subtable;
+
+    // the first horizontal format 0 subtable, GPOS kerning isn't read
+    if(kern && _fude_ttf_in_bounds(font, kern, 18) && _fude_ttf_u16(data + kern) == 0 && _fude_ttf_u16(data + kern + 2) > 0) {
+        uint32_t sub = kern + 4;
+        if((_fude_ttf_u16(data + sub + 4) & 0xFF07) == 0x0001) {
+            uint32_t count = _fude_ttf_u16(data + sub + 6);
+            if(_fude_ttf_in_bounds(font, sub + 14, (uint64_t)count*6)) {
+                font->kern_pairs = sub + 14;
+                font->kern_count = count;
+            }
+        }
+    }
+    return true;
+}
+
+static uint16_t _fude_ttf_glyph_index(const fude_font* font, uint32_t codepoint)
+{
+    const uint8_t* table = font->data + font->cmap;
+    uint32_t glyph = 0;
+    if(font->cmap_format == 12) {
+        uint32_t groups = _fude_ttf_u32(table + 12);
+        if(!_fude_ttf_in_bounds(font, font->cmap + 16, (uint64_t)groups*12)) return 0;
+        uint32_t lo = 0, hi = groups;
+        while(lo < hi) {
+            uint32_t mid = (lo + hi)/2;
+            const uint8_t* group = table + 16 + 12*mid;
+            if(codepoint < _fude_ttf_u32(group)) hi = mid;
+            else if(codepoint > _fude_ttf_u32(group + 4)) lo = mid + 1;
+            else {
+                glyph = _fude_ttf_u32(group + 8) + codepoint - _fude_ttf_u32(group);
+                break;
+            }
+        }
+    } else if(codepoint <= 0xFFFF) {
+        uint32_t segments = _fude_ttf_u16(table + 6)/2;
+        if(!_fude_ttf_in_bounds(font, font->cmap + 16, (uint64_t)segments*8)) return 0;
+        const uint8_t* ends = table + 14;
+        const uint8_t* starts = ends + 2*segments + 2;
+        const uint8_t* deltas = starts + 2*segments;
+        const uint8_t* ranges = deltas + 2*segments;
+        uint32_t lo = 0, hi = segments;
+        while(lo < hi) {
+            uint32_t mid = (lo + hi)/2;
+            if(_fude_ttf_u16(ends + 2*mid) < codepoint) lo = mid + 1;
+            else hi = mid;
+        }
+        if(lo == segments) return 0;
+        uint16_t start = _fude_ttf_u16(starts + 2*lo), delta = _fude_ttf_u16(deltas + 2*lo);
+        uint16_t range = _fude_ttf_u16(ranges + 2*lo);
+        if(codepoint < start) return 0;
+        if(range == 0) {
+            glyph = (uint16_t)(codepoint + delta);
+        } else {
+            const uint8_t* p = ranges + 2*lo + range + 2*(codepoint - start);
+            if(p + 2 > font->data + font->size) return 0;
+            glyph = _fude_ttf_u16(p);
+            if(glyph) glyph = (uint16_t)(glyph + delta);
+        }
+    }
+    return glyph < font->glyph_count ? (uint16_t)glyph : 0;
+}
+
+// false for glyphs without an outline
+static bool _fude_ttf_glyph_range(const fude_font* font, uint16_t glyph, uint32_t* offset, uint32_t* length)
+{
+    if(glyph >= font->glyph_count) return false;
+    const uint8_t* loca = font->data + font->loca;
+    uint32_t start, end;
+    if(font->long_loca) {
+        start = _fude_ttf_u32(loca + 4*glyph);
+        end = _fude_ttf_u32(loca + 4*glyph + 4);
+    } else {
+        start = 2*(uint32_t)_fude_ttf_u16(loca + 2*glyph);
+        end = 2*(uint32_t)_fude_ttf_u16(loca + 2*glyph + 2);
+    }
+    if(end <= start + 10 || !_fude_ttf_in_bounds(font, (uint64_t)font->glyf + start, end - start)) return false;
+    *offset = font->glyf + start;
+    *length = end - start;
+    return true;
+}
+
+static float _fude_ttf_kerning(const fude_font* font, uint16_t left, uint16_t right)
+{
+    uint32_t key = (uint32_t)left << 16 | right;
+    uint32_t lo = 0, hi = font->kern_count;
+    while(lo < hi) {
+        uint32_t mid = (lo + hi)/2;
+        const uint8_t* pair = font->data + font->kern_pairs + 6*mid;
+        uint32_t pair_key = _fude_ttf_u32(pair);
+        if(pair_key < key) lo = mid + 1;
+        else if(pair_key > key) hi = mid;
+        else return _fude_ttf_i16(pair + 4);
+    }
+    return 0.0f;
+}
+
+static void _fude_ttf_push_edge(fude_font* font, float x0, float y0, float x1, float y1)
+{
+    if(x0 == x1 && y0 == y1) return;
+    font->edges.data = _fude_grow_array(font->edges.data, font->edges.count, &font->edges.capacity,
+            font->edges.count + 1, sizeof(_fude_ttf_edge));
+    font->edges.data[font->edges.count++] = (_fude_ttf_edge){ x0, y0, x1, y1 };
+}
+
+// flattened to about one line per two atlas pixels of the control polygon
+static void _fude_ttf_push_curve(fude_font* font, float x0, float y0, float cx, float cy, float x1, float y1)
+{
+    float length = (sqrtf((cx - x0)*(cx - x0) + (cy - y0)*(cy - y0)) +
+            sqrtf((x1 - cx)*(x1 - cx) + (y1 - cy)*(y1 - cy)))*font->scale;
+    uint32_t steps = 1 + (uint32_t)(length*0.5f);
+    if(steps > 16) steps = 16;
+    float px = x0, py = y0;
+    for(uint32_t i = 1; i <= steps; ++i) {
+        float t = (float)i/(float)steps, mt = 1.0f - t;
+        float x = mt*mt*x0 + 2.0f*mt*t*cx + t*t*x1;
+        float y = mt*mt*y0 + 2.0f*mt*t*cy + t*t*y1;
+        _fude_ttf_push_edge(font, px, py, x, y);
+        px = x;
+        py = y;
+    }
+}
+
+// two off-curve points in a row imply an on-curve point halfway between them
+static void _fude_ttf_contour(fude_font* font, const _fude_ttf_point* points, uint32_t count)
+{
+    if(count < 2) return;
+    uint32_t first = 0;
+    while(first < count && !(points[first].flags & 1))
+        ++first;
+    bool start_on = first < count;
+    float sx, sy;
+    if(start_on) {
+        sx = points[first].x;
+        sy = points[first].y;
+    } else {
+        first = count - 1;
+        sx = (points[count - 1].x + points[0].x)*0.5f;
+        sy = (points[count - 1].y + points[0].y)*0.5f;
+    }
+
+    float x = sx, y = sy, cx = 0.0f, cy = 0.0f;
+    bool control = false;
+    for(uint32_t k = 1; k <= count; ++k) {
+        const _fude_ttf_point* p = points + (first + k) % count;
+        if(p->flags & 1) {
+            if(control) _fude_ttf_push_curve(font, x, y, cx, cy, p->x, p->y);
+            else _fude_ttf_push_edge(font, x, y, p->x, p->y);
+            x = p->x;
+            y = p->y;
+            control = false;
+        } else {
+            if(control) {
+                float mx = (cx + p->x)*0.5f, my = (cy + p->y)*0.5f;
+                _fude_ttf_push_curve(font, x, y, cx, cy, mx, my);
+                x = mx;
+                y = my;
+            }
+            cx = p->x;
+            cy = p->y;
+            control = true;
+        }
+    }
+    if(!start_on) {
+        if(control) _fude_ttf_push_curve(font, x, y, cx, cy, sx, sy);
+        else _fude_ttf_push_edge(font, x, y, sx, sy);
+    }
+}
+
+// m is the 2x3 component transform, x' = m[0]*x + m[2]*y + m[4], y' = m[1]*x + m[3]*y + m[5]
+static bool _fude_ttf_simple_glyph(fude_font* font, const uint8_t* glyph, const uint8_t* end, uint32_t contours, const float* m)
+{
+    const uint8_t* ends = glyph + 10;
+    if(ends + 2*contours + 2 > end) return false;
+    uint32_t point_count = (uint32_t)_fude_ttf_u16(ends + 2*(contours - 1)) + 1;
+    const uint8_t* cursor = ends + 2*contours + 2 + _fude_ttf_u16(ends + 2*contours);
+    font->points.data = _fude_grow_array(font->points.data, 0, &font->points.capacity, point_count, sizeof(_fude_ttf_point));
+    _fude_ttf_point* points = font->points.data;
+
+    for(uint32_t i = 0; i < point_count;) {
+        if(cursor >= end) return false;
+        uint8_t flags = *cursor++;
+        uint32_t repeat = 0;
+        if(flags & 8) {
+            if(cursor >= end) return false;
+            repeat = *cursor++;
+        }
+        for(uint32_t r = 0; r <= repeat && i < point_count; ++r)
+            points[i++].flags = flags;
+    }
+
+    // coordinates are deltas: a byte with the sign in the flags, the previous value, or an int16
+    int32_t value = 0;
+    for(uint32_t i = 0; i < point_count; ++i) {
+        uint8_t flags = points[i].flags;
+        if(flags & 2) {
+            if(cursor >= end) return false;
+            value += flags & 16 ? *cursor : -*cursor;
+            cursor += 1;
+        } else if(!(flags & 16)) {
+            if(cursor + 2 > end) return false;
+            value += _fude_ttf_i16(cursor);
+            cursor += 2;
+        }
+        points[i].x = (float)value;
+    }
+    value = 0;
+    for(uint32_t i = 0; i < point_count; ++i) {
+        uint8_t flags = points[i].flags;
+        if(flags & 4) {
+            if(cursor >= end) return false;
+            value += flags & 32 ? *cursor : -*cursor;
+            cursor += 1;
+        } else if(!(flags & 32)) {
+            if(cursor + 2 > end) return false;
+            value += _fude_ttf_i16(cursor);
+            cursor += 2;
+        }
+        points[i].y = (float)value;
+    }
+
+    for(uint32_t i = 0; i < point_count; ++i) {
+        float x = points[i].x, y = points[i].y;
+        points[i].x = m[0]*x + m[2]*y + m[4];
+        points[i].y = m[1]*x + m[3]*y + m[5];
+    }
+
+    uint32_t start = 0;
+    for(uint32_t c = 0; c < contours; ++c) {
+        uint32_t last = _fude_ttf_u16(ends + 2*c);
+        if(last < start || last >= point_count) return false;
+        _fude_ttf_contour(font, points + start, last - start + 1);
+        start = last + 1;
+    }
+    return true;
+}
+
+// appends the outline of glyph to font->edges, composite glyphs recurse into their components
+static bool _fude_ttf_outline(fude_font* font, uint16_t glyph, const float* m, uint32_t depth)
+{
+    uint32_t offset, length;
+    if(!_fude_ttf_glyph_range(font, glyph, &offset, &length)) return true;
+    const uint8_t* data = font->data + offset;
+    const uint8_t* end = data + length;
+    int16_t contours = _fude_ttf_i16(data);
+    if(contours >= 0)
+        return contours == 0 || _fude_ttf_simple_glyph(font, data, end, (uint32_t)contours, m);
+    if(depth >= FUDE_TTF_MAXIMUM_COMPONENT_DEPTH) return false;
+
+    const uint8_t* p = data + 10;
+    uint16_t flags;
+    do {
+        if(p + 4 > end) return false;
+        flags = _fude_ttf_u16(p);
+        uint16_t component = _fude_ttf_u16(p + 2);
+        p += 4;
+
+        float dx, dy;
+        if(flags & 1) {
+            if(p + 4 > end) return false;
+            dx = _fude_ttf_i16(p);
+            dy = _fude_ttf_i16(p + 2);
+            p += 4;
+        } else {
+            if(p + 2 > end) return false;
+            dx = (int8_t)p[0];
+            dy = (int8_t)p[1];
+            p += 2;
+        }
+        if(!(flags & 2)) dx = dy = 0.0f; // anchoring by matching points isn't supported
+
+        float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+        if(flags & 8) {
+            if(p + 2 > end) return false;
+            a = d = _fude_ttf_f2dot14(p);
+            p += 2;
+        } else if(flags & 0x40) {
+            if(p + 4 > end) return false;
+            a = _fude_ttf_f2dot14(p);
+            d = _fude_ttf_f2dot14(p + 2);
+            p += 4;
+        } else if(flags & 0x80) {
+            if(p + 8 > end) return false;
+            a = _fude_ttf_f2dot14(p);
+            b = _fude_ttf_f2dot14(p + 2);
+            c = _fude_ttf_f2dot14(p + 4);
+            d = _fude_ttf_f2dot14(p + 6);
+            p += 8;
+        }
+
+        float n[6] = {
+            m[0]*a + m[2]*b, m[1]*a + m[3]*b,
+            m[0]*c + m[2]*d, m[1]*c + m[3]*d,
+            m[0]*dx + m[2]*dy + m[4], m[1]*dx + m[3]*dy + m[5],
+        };
+        if(!_fude_ttf_outline(font, component, n, depth + 1)) return false;
+    } while(flags & 0x20);
+    return true;
+}
+
+//======================================================================
+// Glyphs and the atlas
+//======================================================================
+static uint32_t _fude_hash_codepoint(uint32_t codepoint)
+{
+    codepoint ^= codepoint >> 16;
+    codepoint *= 0x7feb352d;
+    codepoint ^= codepoint >> 15;
+    return codepoint;
+}
+
+static void _fude_map_glyph(fude_font* font, uint32_t codepoint, uint32_t glyph)
+{
+    if(codepoint < 128) {
+        font->ascii[codepoint] = glyph + 1;
+        return;
+    }
+    if((font->glyph_map.count + 1)*2 > font->glyph_map.capacity) {
+        uint32_t* old_slots = font->glyph_map.slots;
+        uint32_t old_capacity = font->glyph_map.capacity;
+        font->glyph_map.capacity = old_capacity ? old_capacity*2 : 256;
+        font->glyph_map.slots = f_malloc(font->glyph_map.capacity*sizeof(uint32_t));
+        f_expect(font->glyph_map.slots != NULL, "Font ran out of memory at %s (%d)", __FILE__, __LINE__);
+        f_memzero(font->glyph_map.slots, font->glyph_map.capacity*sizeof(uint32_t));
+        font->glyph_map.count = 0;
+        for(uint32_t i = 0; i < old_capacity; ++i) {
+            if(old_slots[i])
+                _fude_map_glyph(font, font->glyphs.data[old_slots[i] - 1].codepoint, old_slots[i] - 1);
+        }
+        if(old_slots) f_free(old_slots);
+    }
+    uint32_t mask = font->glyph_map.capacity - 1;
+    uint32_t slot = _fude_hash_codepoint(codepoint) & mask;
+    while(font->glyph_map.slots[slot])
+        slot = (slot + 1) & mask;
+    font->glyph_map.slots[slot] = glyph + 1;
+    font->glyph_map.count += 1;
+}
+
+// metrics only, the outline is rasterized the first time the glyph is drawn
+static uint32_t _fude_add_glyph(fude_font* font, uint32_t codepoint)
+{
+    font->glyphs.data = _fude_grow_array(font->glyphs.data, font->glyphs.count, &font->glyphs.capacity,
+            font->glyphs.count + 1, sizeof(_fude_glyph));
+    uint32_t id = font->glyphs.count++;
+    _fude_glyph* glyph = font->glyphs.data + id;
+    f_memzero(glyph, sizeof(_fude_glyph));
+    glyph->codepoint = codepoint;
+    glyph->index = _fude_ttf_glyph_index(font, codepoint);
+    glyph->cell = FUDE_FONT_NO_CELL;
+
+    uint32_t metric = glyph->index < font->metric_count ? glyph->index : font->metric_count - 1u;
+    glyph->advance = _fude_ttf_u16(font->data + font->hmtx + 4*metric);
+
+    uint32_t offset, length;
+    if(!_fude_ttf_glyph_range(font, glyph->index, &offset, &length)) {
+        glyph->empty = true;
+    } else {
+        // the outline's box plus the spread, scaled down when that doesn't fit in a cell
+        const uint8_t* data = font->data + offset;
+        float x_min = _fude_ttf_i16(data + 2), y_min = _fude_ttf_i16(data + 4);
+        float x_max = _fude_ttf_i16(data + 6), y_max = _fude_ttf_i16(data + 8);
+        const float inner = (float)(FUDE_FONT_CELL_SIZE - 2*FUDE_FONT_SDF_SPREAD);
+        float scale = font->scale;
+        if((x_max - x_min)*scale > inner) scale = inner/(x_max - x_min);
+        if((y_max - y_min)*scale > inner) scale = inner/(y_max - y_min);
+        glyph->scale = scale;
+        glyph->width = (uint32_t)ceilf((x_max - x_min)*scale) + 2*FUDE_FONT_SDF_SPREAD;
+        glyph->height = (uint32_t)ceilf((y_max - y_min)*scale) + 2*FUDE_FONT_SDF_SPREAD;
+        if(glyph->width > FUDE_FONT_CELL_SIZE) glyph->width = FUDE_FONT_CELL_SIZE;
+        if(glyph->height > FUDE_FONT_CELL_SIZE) glyph->height = FUDE_FONT_CELL_SIZE;
+        glyph->x0 = x_min - FUDE_FONT_SDF_SPREAD/scale;
+        glyph->y1 = y_max + FUDE_FONT_SDF_SPREAD/scale;
+        glyph->x1 = glyph->x0 + (float)glyph->width/scale;
+        glyph->y0 = glyph->y1 - (float)glyph->height/scale;
+    }
+
+    _fude_map_glyph(font, codepoint, id);
+    return id;
+}
+
+static uint32_t _fude_find_glyph(fude_font* font, uint32_t codepoint)
+{
+    if(codepoint < 128) {
+        if(font->ascii[codepoint]) return font->ascii[codepoint] - 1;
+    } else if(font->glyph_map.capacity) {
+        uint32_t mask = font->glyph_map.capacity - 1;
+        for(uint32_t slot = _fude_hash_codepoint(codepoint) & mask; font->glyph_map.slots[slot]; slot = (slot + 1) & mask) {
+            uint32_t glyph = font->glyph_map.slots[slot] - 1;
+            if(font->glyphs.data[glyph].codepoint == codepoint) return glyph;
+        }
+    }
+    return _fude_add_glyph(font, codepoint);
+}
+
+// a free cell, or the least recently drawn glyph's. Glyphs drawn this frame are in the pending
+// batch and last frame's may still be drawn by the render thread, those are never evicted,
+// and neither are pinned ones since a display list may replay them in any later frame
+static uint32_t _fude_acquire_cell(fude_font* font, uint64_t frame)
+{
+    if(font->used_cells < font->cell_count) return font->used_cells++;
+
+    uint32_t victim = FUDE_FONT_NO_CELL;
+    uint64_t oldest = 0;
+    for(uint32_t i = 0; i < font->cell_count; ++i) {
+        const _fude_glyph* glyph = font->glyphs.data + font->cells[i];
+        uint64_t used = glyph->last_used;
+        if(glyph->pins == 0 && used + 2 <= frame && (victim == FUDE_FONT_NO_CELL || used < oldest)) {
+            victim = i;
+            oldest = used;
+        }
+    }
+    if(victim != FUDE_FONT_NO_CELL)
+        font->glyphs.data[font->cells[victim]].cell = FUDE_FONT_NO_CELL;
+    return victim;
+}
+
+static bool _fude_rasterize_glyph(fude_font* font, uint32_t id, uint64_t frame)
+{
+    _fude_glyph* glyph = font->glyphs.data + id;
+    uint32_t cell = _fude_acquire_cell(font, frame);
+    if(cell == FUDE_FONT_NO_CELL) {
+        if(!font->warned_full)
+            f_trace_log(FUDE_LOG_WARNING, "Glyph atlas is full of glyphs drawn in the last two frames or pinned by display lists, skipping glyphs");
+        font->warned_full = true;
+        return false;
+    }
+    font->cells[cell] = id;
+    glyph->cell = cell;
+
+    const uint32_t cell_x = cell % font->cells_per_row*FUDE_FONT_CELL_SIZE;
+    const uint32_t cell_y = cell / font->cells_per_row*FUDE_FONT_CELL_SIZE;
+    glyph->u0 = (float)cell_x/FUDE_FONT_ATLAS_SIZE;
+    glyph->v0 = (float)cell_y/FUDE_FONT_ATLAS_SIZE;
+    glyph->u1 = (float)(cell_x + glyph->width)/FUDE_FONT_ATLAS_SIZE;
+    glyph->v1 = (float)(cell_y + glyph->height)/FUDE_FONT_ATLAS_SIZE;
+
+    // a malformed outline just ends up with fewer edges
+    static const float identity[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+    font->edges.count = 0;
+    _fude_ttf_outline(font, glyph->index, identity, 0);
+
+    // distance to the closest edge at every texel center, positive inside by the nonzero rule,
+    // mapped so the outline is 0.5 and FUDE_FONT_SDF_SPREAD pixels away is 0 or 1.
+    // The whole cell is written so bilinear filtering never picks up the previous glyph
+    const float inverse = 1.0f/glyph->scale;
+    const float range = FUDE_FONT_SDF_SPREAD*inverse;
+    const _fude_ttf_edge* edges = font->edges.data;
+    for(uint32_t py = 0; py < FUDE_FONT_CELL_SIZE; ++py) {
+        uint8_t* row = font->pixels + (size_t)(cell_y + py)*FUDE_FONT_ATLAS_SIZE + cell_x;
+        float fy = glyph->y1 - ((float)py + 0.5f)*inverse;
+        for(uint32_t px = 0; px < FUDE_FONT_CELL_SIZE; ++px) {
+            if(px >= glyph->width || py >= glyph->height) {
+                row[px] = 0;
+                continue;
+            }
+            float fx = glyph->x0 + ((float)px + 0.5f)*inverse;
+            float best = range*range;
+            int winding = 0;
+            for(uint32_t i = 0; i < font->edges.count; ++i) {
+                const _fude_ttf_edge* e = edges + i;
+                if((e->y0 <= fy) != (e->y1 <= fy)) {
+                    float x = e->x0 + (fy - e->y0)*(e->x1 - e->x0)/(e->y1 - e->y0);
+                    if(x > fx) winding += e->y1 > e->y0 ? 1 : -1;
+                }
+                float ex = e->x1 - e->x0, ey = e->y1 - e->y0;
+                float wx = fx - e->x0, wy = fy - e->y0;
+                float t = (wx*ex + wy*ey)/(ex*ex + ey*ey);
+                t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                float dx = wx - t*ex, dy = wy - t*ey;
+                float distance = dx*dx + dy*dy;
+                if(distance < best) best = distance;
+            }
+            float distance = sqrtf(best)/range;
+            float value = 0.5f + 0.5f*(winding ? distance : -distance);
+            row[px] = (uint8_t)(value*255.0f + 0.5f);
+        }
+    }
+
+    if((int)cell_y < font->dirty_y0) font->dirty_y0 = (int)cell_y;
+    if((int)(cell_y + FUDE_FONT_CELL_SIZE) > font->dirty_y1) font->dirty_y1 = (int)(cell_y + FUDE_FONT_CELL_SIZE);
+    return true;
+}
+
+// one band of rows covering every cell rasterized since the last upload
+static void _fude_upload_atlas(fude* app, fude_font* font)
+{
+    if(font->dirty_y1 <= font->dirty_y0) return;
+    _fude_update_texture_rows(app, font->texture, font->pixels + (size_t)font->dirty_y0*FUDE_FONT_ATLAS_SIZE,
+            FUDE_FONT_ATLAS_SIZE, font->dirty_y0, font->dirty_y1 - font->dirty_y0, 1);
+    font->dirty_y0 = FUDE_FONT_ATLAS_SIZE;
+    font->dirty_y1 = 0;
+}
+
+//======================================================================
+// Layout
+//======================================================================
+// invalid sequences decode to U+FFFD one byte at a time
+static uint32_t _fude_decode_utf8(const uint8_t** cursor)
+{
+    static const uint32_t minimum[4] = { 0, 0x80, 0x800, 0x10000 };
+    const uint8_t* s = *cursor;
+    uint32_t codepoint, extra;
+    if(s[0] < 0x80) {
+        *cursor = s + 1;
+        return s[0];
+    } else if((s[0] & 0xE0) == 0xC0) {
+        codepoint = s[0] & 0x1F;
+        extra = 1;
+    } else if((s[0] & 0xF0) == 0xE0) {
+        codepoint = s[0] & 0x0F;
+        extra = 2;
+    } else if((s[0] & 0xF8) == 0xF0) {
+        codepoint = s[0] & 0x07;
+        extra = 3;
+    } else {
+        *cursor = s + 1;
+        return 0xFFFD;
+    }
+    for(uint32_t i = 1; i <= extra; ++i) {
+        if((s[i] & 0xC0) != 0x80) { // also stops at the terminator
+            *cursor = s + i;
+            return 0xFFFD;
+        }
+        codepoint = codepoint << 6 | (s[i] & 0x3F);
+    }
+    *cursor = s + extra + 1;
+    if(codepoint < minimum[extra] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+        return 0xFFFD;
+    return codepoint;
+}
+
+// pen positions in font units, '\n' starts a new line
+static void _fude_layout_text(fude_font* font, const char* text, _fude_text_layout* layout)
+{
+    const float line_height = font->ascent - font->descent + font->line_gap;
+    float x = 0.0f, baseline = font->ascent, width = 0.0f;
+    uint32_t lines = 1, count = 0;
+    int32_t previous = -1;
+    layout->first = font->layouts.glyph_count;
+
+    for(const uint8_t* cursor = (const uint8_t*)text; *cursor;) {
+        uint32_t codepoint = _fude_decode_utf8(&cursor);
+        if(codepoint == '\n') {
+            if(x > width) width = x;
+            x = 0.0f;
+            baseline += line_height;
+            lines += 1;
+            previous = -1;
+            continue;
+        }
+        uint32_t id = _fude_find_glyph(font, codepoint);
+        const _fude_glyph* glyph = font->glyphs.data + id;
+        if(previous >= 0 && font->kern_count)
+            x += _fude_ttf_kerning(font, (uint16_t)previous, glyph->index);
+        if(!glyph->empty && layout->first + count < FUDE_TEXT_LAYOUT_GLYPHS) {
+            _fude_text_glyph* out = font->layouts.glyphs + layout->first + count++;
+            out->x = x;
+            out->y = baseline;
+            out->glyph = id;
+        }
+        x += glyph->advance;
+        previous = glyph->index;
+    }
+
+    layout->count = count;
+    layout->width = x > width ? x : width;
+    layout->height = font->ascent - font->descent + (float)(lines - 1)*line_height;
+}
+
+static void _fude_clear_layouts(fude_font* font)
+{
+    f_memzero(font->layouts.slots, FUDE_TEXT_LAYOUT_SLOTS*sizeof(_fude_text_layout));
+    font->layouts.count = 0;
+    font->layouts.glyph_count = 0;
+    font->layouts.byte_count = 0;
+}
+
+// static labels are laid out once, later draws only hash and compare the string
+static const _fude_text_layout* _fude_get_layout(fude_font* font, const char* text)
+{
+    uint32_t length = 0;
+    while(text[length])
+        length += 1;
+    uint64_t hash = _fude_hash(FUDE_HASH_SEED, text, length);
+    if(!hash) hash = 1;
+
+    const uint32_t mask = FUDE_TEXT_LAYOUT_SLOTS - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+    for(; font->layouts.slots[slot].hash; slot = (slot + 1) & mask) {
+        const _fude_text_layout* layout = font->layouts.slots + slot;
+        if(layout->hash == hash && layout->length == length &&
+                memcmp(font->layouts.bytes + layout->text, text, length) == 0)
+            return layout;
+    }
+
+    // a string never has more glyphs than bytes, so length reserves enough of both
+    if((font->layouts.count + 1)*2 > FUDE_TEXT_LAYOUT_SLOTS ||
+            font->layouts.byte_count + length > FUDE_TEXT_LAYOUT_BYTES ||
+            font->layouts.glyph_count + length > FUDE_TEXT_LAYOUT_GLYPHS) {
+        _fude_clear_layouts(font);
+        slot = (uint32_t)hash & mask;
+    }
+    if(length > FUDE_TEXT_LAYOUT_BYTES || length > FUDE_TEXT_LAYOUT_GLYPHS) {
+        _fude_layout_text(font, text, &font->layouts.uncached);
+        return &font->layouts.uncached;
+    }
+
+    _fude_text_layout* layout = font->layouts.slots + slot;
+    layout->hash = hash;
+    layout->length = length;
+    layout->text = font->layouts.byte_count;
+    f_memcpy(font->layouts.bytes + layout->text, text, length);
+    _fude_layout_text(font, text, layout);
+    font->layouts.byte_count += length;
+    font->layouts.glyph_count += layout->count;
+    font->layouts.count += 1;
+    return layout;
+}
+
+//======================================================================
+// Fonts
+//======================================================================
+fude_result f_create_font(fude* app, fude_font** result, const void* ttf_data, size_t size)
+{
+    F_PROFILE_SCOPE("f_create_font");
+    if(!app || !result || !ttf_data || size == 0) return FUDE_INVALID_ARGUMENTS_ERROR;
+    *result = NULL;
+
+    fude_font* font = f_malloc(sizeof(fude_font));
+    if(!font) return FUDE_ERROR;
+    f_memzero(font, sizeof(fude_font));
+    font->data = f_malloc(size);
+    if(!font->data) {
+        f_destroy_font(app, font);
+        return FUDE_ERROR;
+    }
+    f_memcpy(font->data, ttf_data, size);
+    font->size = size;
+    if(!_fude_ttf_parse(font)) {
+        f_trace_log(FUDE_LOG_ERROR, "Not a TrueType font with glyf outlines and a Unicode cmap");
+        f_destroy_font(app, font);
+        return FUDE_FONT_LOADING_ERROR;
+    }
+
+    font->cells_per_row = FUDE_FONT_ATLAS_SIZE/FUDE_FONT_CELL_SIZE;
+    font->cell_count = font->cells_per_row*font->cells_per_row;
+    font->pixels = f_malloc((size_t)FUDE_FONT_ATLAS_SIZE*FUDE_FONT_ATLAS_SIZE);
+    font->cells = f_malloc(font->cell_count*sizeof(uint32_t));
+    font->layouts.slots = f_malloc(FUDE_TEXT_LAYOUT_SLOTS*sizeof(_fude_text_layout));
+    font->layouts.glyphs = f_malloc(FUDE_TEXT_LAYOUT_GLYPHS*sizeof(_fude_text_glyph));
+    font->layouts.bytes = f_malloc(FUDE_TEXT_LAYOUT_BYTES);
+    if(!font->pixels || !font->cells || !font->layouts.slots || !font->layouts.glyphs || !font->layouts.bytes) {
+        f_destroy_font(app, font);
+        return FUDE_ERROR;
+    }
+    f_memzero(font->pixels, (size_t)FUDE_FONT_ATLAS_SIZE*FUDE_FONT_ATLAS_SIZE);
+    _fude_clear_layouts(font);
+    font->dirty_y0 = FUDE_FONT_ATLAS_SIZE;
+    font->dirty_y1 = 0;
+
+    fude_result status = _fude_create_distance_field_texture(app, &font->texture, FUDE_FONT_ATLAS_SIZE, FUDE_FONT_ATLAS_SIZE);
+    if(status != FUDE_OK) {
+        f_destroy_font(app, font);
+        return status;
+    }
+    _fude_update_texture_rows(app, font->texture, font->pixels, FUDE_FONT_ATLAS_SIZE, 0, FUDE_FONT_ATLAS_SIZE, 1);
+
+    *result = font;
+    return FUDE_OK;
+}
+
+fude_result f_load_font(fude* app, fude_font** font, const char* file_path)
+{
+    if(!app || !font || !file_path) return FUDE_INVALID_ARGUMENTS_ERROR;
+    size_t size = 0;
+    void* data = f_load_file_data(file_path, &size);
+    if(!data) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to read font %s", file_path);
+        return FUDE_FONT_LOADING_ERROR;
+    }
+    fude_result result = f_create_font(app, font, data, size);
+    f_unload_file_data(data);
+    return result;
+}
+
+void f_destroy_font(fude* app, fude_font* font)
+{
+    if(!app || !font) return;
+    if(font->texture.id) f_destroy_texture(app, font->texture);
+    if(font->data) f_free(font->data);
+    if(font->pixels) f_free(font->pixels);
+    if(font->cells) f_free(font->cells);
+    if(font->glyphs.data) f_free(font->glyphs.data);
+    if(font->glyph_map.slots) f_free(font->glyph_map.slots);
+    if(font->edges.data) f_free(font->edges.data);
+    if(font->points.data) f_free(font->points.data);
+    if(font->layouts.slots) f_free(font->layouts.slots);
+    if(font->layouts.glyphs) f_free(font->layouts.glyphs);
+    if(font->layouts.bytes) f_free(font->layouts.bytes);
+    f_free(font);
+}
+
+void f_set_font(fude* app, fude_font* font, float size)
+{
+    app->renderer.text.font = font;
+    app->renderer.text.size = size > 0.0f ? size : (float)FUDE_FONT_SDF_SIZE;
+}
+
+// the recorded vertices hold the cell's coordinates, so the cell stays until the list lets go
+static void _fude_pin_glyph(fude_display_list* list, fude_font* font, uint32_t id)
+{
+    list->glyphs.data = _fude_grow_array(list->glyphs.data, list->glyphs.count, &list->glyphs.capacity,
+            list->glyphs.count + 1, sizeof(fude_display_glyph));
+    list->glyphs.data[list->glyphs.count++] = (fude_display_glyph){ font, id };
+    font->glyphs.data[id].pins += 1;
+}
+
+// display lists have to go before the fonts they recorded text of
+void _fude_unpin_glyphs(fude_display_list* list)
+{
+    for(uint32_t i = 0; i < list->glyphs.count; ++i) {
+        const fude_display_glyph* pinned = list->glyphs.data + i;
+        pinned->font->glyphs.data[pinned->glyph].pins -= 1;
+    }
+    list->glyphs.count = 0;
+}
+
+// (x, y) is the top-left corner of the first line, y grows down like f_create_camera2d's pixels.
+// The color is the one f_color4f set. Glyphs are default shader quads whose atlas takes a sprite slot,
+// so labels share batches with sprites and shapes and follow the default shader's camera
+void f_draw_text(fude* app, const char* text, float x, float y)
+{
+    fude_renderer* renderer = &app->renderer;
+    fude_font* font = renderer->text.font;
+    if(!font || !text || !text[0]) return;
+
+    const _fude_text_layout* layout = _fude_get_layout(font, text);
+    const _fude_text_glyph* laid = font->layouts.glyphs + layout->first;
+    const float scale = renderer->text.size/(font->ascent - font->descent);
+    const uint64_t frame = app->timing.frame_count;
+    const V4f color = renderer->working.vertex.color;
+    const float object_id = renderer->working.vertex.object_id;
+
+    uint32_t remaining = layout->count;
+    while(remaining > 0) {
+        uint32_t count = remaining;
+        const uint32_t slot = _fude_sprite_slot(renderer, font->texture);
+        const float tex_index = (float)(slot | FUDE_GLYPH_FLAG);
+        fude_vertex* vertices = _fude_begin_quads(app, renderer->default_shader, font->texture, slot, &count);
+        uint32_t written = 0;
+        for(uint32_t i = 0; i < count; ++i, ++laid) {
+            _fude_glyph* glyph = font->glyphs.data + laid->glyph;
+            glyph->last_used = frame;
+            if(glyph->cell == FUDE_FONT_NO_CELL && !_fude_rasterize_glyph(font, laid->glyph, frame)) continue;
+            if(renderer->recording)
+                _fude_pin_glyph(renderer->recording, font, laid->glyph);
+
+            float x0 = x + (laid->x + glyph->x0)*scale, x1 = x + (laid->x + glyph->x1)*scale;
+            float y0 = y + (laid->y - glyph->y1)*scale, y1 = y + (laid->y - glyph->y0)*scale;
+            // built whole, copying a template vertex and patching it was about 2.5x slower
+            fude_vertex* v = vertices + written*4;
+            v[0] = (fude_vertex){ .position.x = x0, .position.y = y0, .color = color,
+                .tex_coords.u = glyph->u0, .tex_coords.v = glyph->v0, .tex_index = tex_index, .object_id = object_id };
+            v[1] = (fude_vertex){ .position.x = x1, .position.y = y0, .color = color,
+                .tex_coords.u = glyph->u1, .tex_coords.v = glyph->v0, .tex_index = tex_index, .object_id = object_id };
+            v[2] = (fude_vertex){ .position.x = x1, .position.y = y1, .color = color,
+                .tex_coords.u = glyph->u1, .tex_coords.v = glyph->v1, .tex_index = tex_index, .object_id = object_id };
+            v[3] = (fude_vertex){ .position.x = x0, .position.y = y1, .color = color,
+                .tex_coords.u = glyph->u0, .tex_coords.v = glyph->v1, .tex_index = tex_index, .object_id = object_id };
+            written += 1;
+        }
+        _fude_end_quads(app, written);
+        // before the next chunk can flush a batch that samples the new glyphs
+        _fude_upload_atlas(app, font);
+        remaining -= count;
+    }
+}
+
+V2f f_measure_text(fude* app, const char* text)
+{
+    V2f size = { .x = 0.0f, .y = 0.0f };
+    fude_font* font = app->renderer.text.font;
+    if(!font || !text || !text[0]) return size;
+    const _fude_text_layout* layout = _fude_get_layout(font, text);
+    const float scale = app->renderer.text.size/(font->ascent - font->descent);
+    size.x = layout->width*scale;
+    size.y = layout->height*scale;
+    return size;
+}
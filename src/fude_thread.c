@@ -0,0 +1,640 @@
+#include "fude.h"
+#include "fude_internal.h"
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#include <stdatomic.h>
+
+#define FUDE_RENDER_THREAD_FRAMES 2
+
+enum {
+    _FUDE_COMMAND_CLEAR = 0,
+    _FUDE_COMMAND_DRAW,
+    _FUDE_COMMAND_UNIFORM,
+    _FUDE_COMMAND_DRAW_MESH,
+    _FUDE_COMMAND_BIND_TARGET,
+    _FUDE_COMMAND_DELETE_BUFFERS,
+    _FUDE_COMMAND_DRAW_INSTANCES,
+};
+
+typedef struct {
+    int type;
+    fude_shader shader;
+    fude_texture textures[FUDE_RENDERER_MAXIMUM_TEXTURES];
+    int samplers[FUDE_RENDERER_MAXIMUM_TEXTURES];
+    uint32_t base_vertex, first_index, index_count; // _FUDE_COMMAND_DRAW_INSTANCES: first_index, index_count
+    fude_depth_mode depth_mode; // _FUDE_COMMAND_DRAW
+    fude_blend_mode blend_mode; bool premultiplied; // every draw
+    uint32_t vbo, ibo; // _FUDE_COMMAND_DRAW_MESH and _FUDE_COMMAND_DELETE_BUFFERS
+    uint32_t color, depth; int width, height; // _FUDE_COMMAND_BIND_TARGET, color 0 is the window
+    int location, data_type, data_count; bool transpose; uint32_t data_offset; // _FUDE_COMMAND_UNIFORM
+} _fude_command;
+
+// everything the render thread needs to replay one frame
+typedef struct {
+    struct {
+        _fude_command* data;
+        uint32_t count, capacity;
+    } commands;
+    struct {
+        fude_vertex* data;
+        uint32_t count, capacity;
+    } vertices;
+    struct {
+        uint32_t* data;
+        uint32_t count, capacity;
+    } indices;
+    struct {
+        uint32_t* data; // 4 byte components of every uniform command's values
+        uint32_t count, capacity;
+    } uniforms;
+    struct {
+        V4f* data;
+        _fude_particle_colors* colors;
+        uint32_t count, capacity, colors_capacity;
+    } instances;
+    GLsync fence;
+} _fude_frame;
+
+struct fude_render_thread {
+    _fude_thread thread;
+    _fude_mutex mutex;
+    _fude_cond cond;
+    fude_config config;
+
+    // hidden window whose context shares objects with app->window,
+    // it stays current on the main thread for shader and texture creation
+    GLFWwindow* resource_window;
+    uint32_t vbo_capacity, ibo_capacity;
+
+    _fude_frame frames[FUDE_RENDER_THREAD_FRAMES];
+    int recording; // frame the main thread writes into
+    int pending;   // frame handed to the render thread, -1 if none
+    bool executing;
+    bool initialized;
+    bool quit;
+    fude_result init_result;
+};
+
+static _fude_command* _fude_push_command(_fude_frame* frame, int type)
+{
+    frame->commands.data = _fude_grow_array(frame->commands.data, frame->commands.count,
+            &frame->commands.capacity, frame->commands.count + 1, sizeof(_fude_command));
+    _fude_command* command = frame->commands.data + frame->commands.count++;
+    f_memzero(command, sizeof(_fude_command));
+    command->type = type;
+    return command;
+}
+
+static void _fude_execute_frame(fude* app, _fude_frame* frame)
+{
+    fude_render_thread* rt = app->render_thread;
+
+    if(frame->fence) {
+        glWaitSync(frame->fence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(frame->fence);
+        frame->fence = NULL;
+    }
+
+    // upload the whole frame at once, orphaning the previous storage
+    _fude_gpu_timer_begin_pass(&app->renderer.gpu_timer, FUDE_GPU_PASS_FLUSH);
+    glBindVertexArray(app->renderer.id);
+    glBindBuffer(GL_ARRAY_BUFFER, app->renderer.vbo);
+    if(frame->vertices.count > rt->vbo_capacity)
+        rt->vbo_capacity = frame->vertices.capacity;
+    glBufferData(GL_ARRAY_BUFFER, rt->vbo_capacity*sizeof(fude_vertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, frame->vertices.count*sizeof(fude_vertex), frame->vertices.data);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, app->renderer.ibo);
+    if(frame->indices.count > rt->ibo_capacity)
+        rt->ibo_capacity = frame->indices.capacity;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, rt->ibo_capacity*sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, frame->indices.count*sizeof(uint32_t), frame->indices.data);
+    _fude_gpu_timer_end_pass(&app->renderer.gpu_timer);
+
+    for(uint32_t i = 0; i < frame->commands.count; ++i) {
+        const _fude_command* command = frame->commands.data + i;
+        switch(command->type) {
+        case _FUDE_COMMAND_CLEAR:
+            _fude_gpu_timer_begin_pass(&app->renderer.gpu_timer, FUDE_GPU_PASS_CLEAR);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            _fude_gpu_timer_end_pass(&app->renderer.gpu_timer);
+            break;
+        case _FUDE_COMMAND_DRAW:
+            _fude_gpu_timer_begin_pass(&app->renderer.gpu_timer, FUDE_GPU_PASS_FLUSH);
+            _fude_bind_batch_state(command->shader, command->textures, command->samplers);
+            glBindVertexArray(app->renderer.id);
+            _fude_set_blend_mode_gl(command->blend_mode, command->premultiplied);
+            if(command->depth_mode != FUDE_DEPTH_OFF)
+                _fude_set_depth_mode_gl(command->depth_mode);
+            glDrawElementsBaseVertex(GL_TRIANGLES, command->index_count, GL_UNSIGNED_INT,
+                    (const void*)(command->first_index*sizeof(uint32_t)), command->base_vertex);
+            if(command->depth_mode != FUDE_DEPTH_OFF)
+                _fude_set_depth_mode_gl(FUDE_DEPTH_OFF);
+            _fude_gpu_timer_end_pass(&app->renderer.gpu_timer);
+            break;
+        case _FUDE_COMMAND_UNIFORM:
+            _fude_upload_shader_uniform(command->shader, command->location, command->data_type, command->data_count,
+                    frame->uniforms.data + command->data_offset, command->transpose);
+            break;
+        case _FUDE_COMMAND_DRAW_MESH:
+            _fude_draw_mesh_gl(&app->renderer, command->vbo, command->ibo, command->index_count,
+                    command->shader, command->textures, command->blend_mode);
+            break;
+        case _FUDE_COMMAND_BIND_TARGET:
+            _fude_bind_target_gl(&app->renderer, 0, command->color, command->depth, command->width, command->height);
+            break;
+        case _FUDE_COMMAND_DRAW_INSTANCES:
+            _fude_draw_particles_gl(&app->renderer, frame->instances.data + command->first_index,
+                    frame->instances.colors + command->first_index, command->index_count, command->blend_mode);
+            break;
+        case _FUDE_COMMAND_DELETE_BUFFERS:
+            if(command->vbo) glDeleteBuffers(1, &command->vbo);
+            if(command->ibo) glDeleteBuffers(1, &command->ibo);
+            break;
+        }
+    }
+}
+
+static void _fude_render_thread_main(void* user_data)
+{
+    fude* app = (fude*)user_data;
+    fude_render_thread* rt = app->render_thread;
+
+    glfwMakeContextCurrent(app->window);
+    _fude_set_swap_interval(&rt->config);
+    fude_result result = _fude_init_renderer(app, &rt->config);
+    rt->vbo_capacity = FUDE_RENDERER_MAXIMUM_VERTICES;
+    rt->ibo_capacity = FUDE_RENDERER_MAXIMUM_INDICIES;
+
+    _fude_mutex_lock(&rt->mutex);
+    rt->init_result = result;
+    rt->initialized = true;
+    _fude_cond_broadcast(&rt->cond);
+    _fude_mutex_unlock(&rt->mutex);
+    if(result != FUDE_OK) return;
+
+    for(;;) {
+        _fude_mutex_lock(&rt->mutex);
+        while(rt->pending < 0 && !rt->quit)
+            _fude_cond_wait(&rt->cond, &rt->mutex);
+        if(rt->pending < 0) {
+            _fude_mutex_unlock(&rt->mutex);
+            break;
+        }
+        _fude_frame* frame = rt->frames + rt->pending;
+        rt->pending = -1;
+        rt->executing = true;
+        _fude_mutex_unlock(&rt->mutex);
+
+        F_PROFILE_BEGIN("render_thread_frame");
+        _fude_execute_frame(app, frame);
+
+        // f_get_gpu_timings reads the results from the main thread
+        _fude_mutex_lock(&rt->mutex);
+        _fude_gpu_timer_end_frame(&app->renderer.gpu_timer);
+        _fude_mutex_unlock(&rt->mutex);
+        glfwSwapBuffers(app->window);
+        F_PROFILE_END();
+
+        _fude_mutex_lock(&rt->mutex);
+        rt->executing = false;
+        _fude_cond_broadcast(&rt->cond);
+        _fude_mutex_unlock(&rt->mutex);
+    }
+
+    _fude_destroy_particle_stream(app);
+    glfwMakeContextCurrent(NULL);
+}
+
+fude_result _fude_init_render_thread(fude* app, const fude_config* config)
+{
+    fude_render_thread* rt = f_malloc(sizeof(fude_render_thread));
+    if(!rt) return FUDE_INITIALIZATION_ERROR;
+    f_memzero(rt, sizeof(fude_render_thread));
+    rt->config = *config;
+    rt->pending = -1;
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    rt->resource_window = glfwCreateWindow(1, 1, "", NULL, app->window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if(!rt->resource_window) {
+        f_free(rt);
+        return FUDE_WINDOW_CREATION_ERROR;
+    }
+    // releases app->window from the main thread so the render thread can take it
+    glfwMakeContextCurrent(rt->resource_window);
+
+    _fude_mutex_init(&rt->mutex);
+    _fude_cond_init(&rt->cond);
+    app->render_thread = rt;
+
+    if(!_fude_thread_create(&rt->thread, _fude_render_thread_main, app)) {
+        f_trace_log(FUDE_LOG_ERROR, "Failed to create the render thread");
+        glfwDestroyWindow(rt->resource_window);
+        _fude_cond_destroy(&rt->cond);
+        _fude_mutex_destroy(&rt->mutex);
+        f_free(rt);
+        app->render_thread = NULL;
+        return FUDE_INITIALIZATION_ERROR;
+    }
+
+    _fude_mutex_lock(&rt->mutex);
+    while(!rt->initialized)
+        _fude_cond_wait(&rt->cond, &rt->mutex);
+    _fude_mutex_unlock(&rt->mutex);
+
+    if(rt->init_result != FUDE_OK) {
+        fude_result result = rt->init_result;
+        _fude_deinit_render_thread(app);
+        return result;
+    }
+    return FUDE_OK;
+}
+
+void _fude_deinit_render_thread(fude* app)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_mutex_lock(&rt->mutex);
+    rt->quit = true;
+    _fude_cond_broadcast(&rt->cond);
+    _fude_mutex_unlock(&rt->mutex);
+    _fude_thread_join(&rt->thread);
+
+    for(int i = 0; i < FUDE_RENDER_THREAD_FRAMES; ++i) {
+        if(rt->frames[i].fence)
+            glDeleteSync(rt->frames[i].fence);
+        f_free(rt->frames[i].commands.data);
+        f_free(rt->frames[i].vertices.data);
+        f_free(rt->frames[i].indices.data);
+        f_free(rt->frames[i].uniforms.data);
+        f_free(rt->frames[i].instances.data);
+        f_free(rt->frames[i].instances.colors);
+    }
+
+    glfwMakeContextCurrent(NULL);
+    glfwDestroyWindow(rt->resource_window);
+    _fude_cond_destroy(&rt->cond);
+    _fude_mutex_destroy(&rt->mutex);
+    f_free(rt);
+    app->render_thread = NULL;
+}
+
+void _fude_record_clear(fude* app)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_push_command(rt->frames + rt->recording, _FUDE_COMMAND_CLEAR);
+}
+
+void _fude_record_flush(fude* app)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_frame* frame = rt->frames + rt->recording;
+    if(app->renderer.indices.count == 0) return;
+
+    _fude_command* command = _fude_push_command(frame, _FUDE_COMMAND_DRAW);
+    command->shader = app->renderer.shader;
+    f_memcpy(command->textures, app->renderer.textures.data, sizeof(command->textures));
+    f_memcpy(command->samplers, app->renderer.textures.samplers, sizeof(command->samplers));
+    command->base_vertex = frame->vertices.count;
+    command->first_index = frame->indices.count;
+    command->index_count = app->renderer.indices.count;
+    command->depth_mode = app->renderer.layers.mode;
+    command->blend_mode = _fude_batch_blend(&app->renderer, app->renderer.shader);
+    command->premultiplied = _fude_shader_premultiplied(&app->renderer, app->renderer.shader,
+            app->renderer.textures.data);
+
+    frame->vertices.data = _fude_grow_array(frame->vertices.data, frame->vertices.count,
+            &frame->vertices.capacity, frame->vertices.count + app->renderer.vertices.count, sizeof(fude_vertex));
+    f_memcpy(frame->vertices.data + frame->vertices.count, app->renderer.vertices.data,
+            app->renderer.vertices.count*sizeof(fude_vertex));
+    frame->vertices.count += app->renderer.vertices.count;
+
+    frame->indices.data = _fude_grow_array(frame->indices.data, frame->indices.count,
+            &frame->indices.capacity, frame->indices.count + app->renderer.indices.count, sizeof(uint32_t));
+    f_memcpy(frame->indices.data + frame->indices.count, app->renderer.indices.data,
+            app->renderer.indices.count*sizeof(uint32_t));
+    frame->indices.count += app->renderer.indices.count;
+}
+
+static uint32_t _fude_uniform_components(int data_type)
+{
+    switch(data_type) {
+    case FUDE_SHADERDT_VEC2: case FUDE_SHADERDT_IVEC2: return 2;
+    case FUDE_SHADERDT_VEC3: case FUDE_SHADERDT_IVEC3: return 3;
+    case FUDE_SHADERDT_VEC4: case FUDE_SHADERDT_IVEC4: return 4;
+    case FUDE_SHADERDT_MAT4: return 16;
+    default: return 1;
+    }
+}
+
+// replayed in order with the draws, so batches recorded before keep the old value.
+// The values are copied, the caller's memory may be gone by the time the render thread gets to them
+void _fude_record_uniform(fude* app, fude_shader shader, int location, int data_type, int count, const void* data,
+        bool transpose)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_frame* frame = rt->frames + rt->recording;
+    uint32_t components = _fude_uniform_components(data_type)*(uint32_t)count;
+    frame->uniforms.data = _fude_grow_array(frame->uniforms.data, frame->uniforms.count,
+            &frame->uniforms.capacity, frame->uniforms.count + components, sizeof(uint32_t));
+    f_memcpy(frame->uniforms.data + frame->uniforms.count, data, components*sizeof(uint32_t));
+
+    _fude_command* command = _fude_push_command(frame, _FUDE_COMMAND_UNIFORM);
+    command->shader = shader;
+    command->location = location;
+    command->data_type = data_type;
+    command->data_count = count;
+    command->transpose = transpose;
+    command->data_offset = frame->uniforms.count;
+    frame->uniforms.count += components;
+}
+
+// the buffers are shared with the resource context, only their names are recorded
+void _fude_record_draw_mesh(fude* app, const fude_mesh* mesh, fude_shader shader)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_command* command = _fude_push_command(rt->frames + rt->recording, _FUDE_COMMAND_DRAW_MESH);
+    command->shader = shader;
+    f_memcpy(command->textures, mesh->textures, sizeof(command->textures));
+    command->vbo = mesh->vbo;
+    command->ibo = mesh->ibo;
+    command->index_count = mesh->index_count;
+    command->blend_mode = app->renderer.blend_mode;
+}
+
+// the particle stream's program was linked on this thread, its buffers and VAO are made on the render thread
+void _fude_record_draw_instances(fude* app, const V4f* instances, const _fude_particle_colors* colors, uint32_t count)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_frame* frame = rt->frames + rt->recording;
+    uint32_t needed = frame->instances.count + count;
+    frame->instances.data = _fude_grow_array(frame->instances.data, frame->instances.count,
+            &frame->instances.capacity, needed, sizeof(V4f));
+    frame->instances.colors = _fude_grow_array(frame->instances.colors, frame->instances.count,
+            &frame->instances.colors_capacity, needed, sizeof(_fude_particle_colors));
+    f_memcpy(frame->instances.data + frame->instances.count, instances, count*sizeof(V4f));
+    f_memcpy(frame->instances.colors + frame->instances.count, colors, count*sizeof(_fude_particle_colors));
+
+    _fude_command* command = _fude_push_command(frame, _FUDE_COMMAND_DRAW_INSTANCES);
+    command->first_index = frame->instances.count;
+    command->index_count = count;
+    command->blend_mode = app->renderer.blend_mode;
+    frame->instances.count = needed;
+}
+
+// draws recorded before still name the buffers, they're deleted once the render thread is past them
+void _fude_record_delete_buffers(fude* app, uint32_t vbo, uint32_t ibo)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_command* command = _fude_push_command(rt->frames + rt->recording, _FUDE_COMMAND_DELETE_BUFFERS);
+    command->vbo = vbo;
+    command->ibo = ibo;
+}
+
+// textures and renderbuffers are shared with the resource context, the attachments are made on the render thread
+void _fude_record_bind_target(fude* app, const fude_render_target* target)
+{
+    fude_render_thread* rt = app->render_thread;
+    _fude_command* command = _fude_push_command(rt->frames + rt->recording, _FUDE_COMMAND_BIND_TARGET);
+    command->color = target ? target->color.id : 0;
+    command->depth = target ? target->depth : 0;
+    command->width = target ? (int)target->width : app->renderer.framebuffer.width;
+    command->height = target ? (int)target->height : app->renderer.framebuffer.height;
+}
+
+void _fude_submit_frame(fude* app)
+{
+    F_PROFILE_SCOPE("wait_render_thread");
+    fude_render_thread* rt = app->render_thread;
+    _fude_frame* frame = rt->frames + rt->recording;
+
+    // make shader/texture work issued on the resource context visible to the render context
+    frame->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    // wait until the render thread is done with the other frame before reusing it
+    _fude_mutex_lock(&rt->mutex);
+    while(rt->pending >= 0 || rt->executing)
+        _fude_cond_wait(&rt->cond, &rt->mutex);
+    rt->pending = rt->recording;
+    _fude_cond_broadcast(&rt->cond);
+    _fude_mutex_unlock(&rt->mutex);
+
+    rt->recording = (rt->recording + 1) % FUDE_RENDER_THREAD_FRAMES;
+    frame = rt->frames + rt->recording;
+    frame->commands.count = 0;
+    frame->vertices.count = 0;
+    frame->indices.count = 0;
+    frame->uniforms.count = 0;
+    frame->instances.count = 0;
+}
+
+void _fude_lock_render_thread(fude* app)
+{
+    _fude_mutex_lock(&app->render_thread->mutex);
+}
+
+void _fude_unlock_render_thread(fude* app)
+{
+    _fude_mutex_unlock(&app->render_thread->mutex);
+}
+
+//======================================================================
+// Thread pool
+//======================================================================
+struct _fude_thread_pool {
+    _fude_thread threads[FUDE_THREAD_POOL_MAXIMUM_THREADS];
+    uint32_t thread_count;
+    _fude_mutex mutex;
+    _fude_cond cond;
+    bool quit;
+
+    // current job, written by _fude_parallel_for before bumping generation
+    uint32_t generation;
+    _fude_parallel_proc proc;
+    void* user_data;
+    uint32_t count;
+    _Atomic uint64_t next; // generation << 32 | next index to claim
+    atomic_uint done;
+};
+
+typedef struct {
+    uint32_t generation;
+    _fude_parallel_proc proc;
+    void* user_data;
+    uint32_t count;
+} _fude_thread_pool_job;
+
+// claims indices of the given job until it runs out, a worker that wakes up
+// late sees a different generation in next and can't steal from a newer job
+static void _fude_thread_pool_work(_fude_thread_pool* pool, _fude_thread_pool_job job)
+{
+    for(;;) {
+        uint64_t next = atomic_load(&pool->next);
+        if((uint32_t)(next >> 32) != job.generation) break;
+        if((uint32_t)next >= job.count) break;
+        if(!atomic_compare_exchange_weak(&pool->next, &next, next + 1)) continue;
+
+        job.proc(job.user_data, (uint32_t)next);
+        if(atomic_fetch_add(&pool->done, 1) + 1 == job.count) {
+            _fude_mutex_lock(&pool->mutex);
+            _fude_cond_broadcast(&pool->cond);
+            _fude_mutex_unlock(&pool->mutex);
+        }
+    }
+}
+
+static void _fude_thread_pool_main(void* user_data)
+{
+    _fude_thread_pool* pool = (_fude_thread_pool*)user_data;
+    uint32_t seen = 0;
+    for(;;) {
+        _fude_mutex_lock(&pool->mutex);
+        while(pool->generation == seen && !pool->quit)
+            _fude_cond_wait(&pool->cond, &pool->mutex);
+        if(pool->quit) {
+            _fude_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->generation;
+        _fude_thread_pool_job job = { pool->generation, pool->proc, pool->user_data, pool->count };
+        _fude_mutex_unlock(&pool->mutex);
+
+        _fude_thread_pool_work(pool, job);
+    }
+}
+
+_fude_thread_pool* _fude_create_thread_pool(uint32_t thread_count)
+{
+    _fude_thread_pool* pool = f_malloc(sizeof(_fude_thread_pool));
+    if(!pool) return NULL;
+    f_memzero(pool, sizeof(_fude_thread_pool));
+    _fude_mutex_init(&pool->mutex);
+    _fude_cond_init(&pool->cond);
+    atomic_init(&pool->next, 0);
+    atomic_init(&pool->done, 0);
+
+    // the thread calling _fude_parallel_for is a worker too
+    if(thread_count == 0) thread_count = _fude_cpu_count();
+    if(thread_count > FUDE_THREAD_POOL_MAXIMUM_THREADS) thread_count = FUDE_THREAD_POOL_MAXIMUM_THREADS;
+    for(uint32_t i = 0; i + 1 < thread_count; ++i) {
+        if(!_fude_thread_create(pool->threads + i, _fude_thread_pool_main, pool))
+            break;
+        pool->thread_count += 1;
+    }
+    return pool;
+}
+
+void _fude_destroy_thread_pool(_fude_thread_pool* pool)
+{
+    if(!pool) return;
+    _fude_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    _fude_cond_broadcast(&pool->cond);
+    _fude_mutex_unlock(&pool->mutex);
+    for(uint32_t i = 0; i < pool->thread_count; ++i)
+        _fude_thread_join(pool->threads + i);
+    _fude_cond_destroy(&pool->cond);
+    _fude_mutex_destroy(&pool->mutex);
+    f_free(pool);
+}
+
+uint32_t _fude_thread_pool_size(const _fude_thread_pool* pool)
+{
+    return pool ? pool->thread_count + 1 : 1;
+}
+
+void _fude_parallel_for(_fude_thread_pool* pool, uint32_t count, _fude_parallel_proc proc, void* user_data)
+{
+    if(count == 0) return;
+    if(!pool || pool->thread_count == 0 || count == 1) {
+        for(uint32_t i = 0; i < count; ++i)
+            proc(user_data, i);
+        return;
+    }
+
+    _fude_mutex_lock(&pool->mutex);
+    pool->generation += 1;
+    pool->proc = proc;
+    pool->user_data = user_data;
+    pool->count = count;
+    atomic_store(&pool->done, 0);
+    atomic_store(&pool->next, (uint64_t)pool->generation << 32);
+    _fude_thread_pool_job job = { pool->generation, proc, user_data, count };
+    _fude_cond_broadcast(&pool->cond);
+    _fude_mutex_unlock(&pool->mutex);
+
+    _fude_thread_pool_work(pool, job);
+
+    _fude_mutex_lock(&pool->mutex);
+    while(atomic_load(&pool->done) < count)
+        _fude_cond_wait(&pool->cond, &pool->mutex);
+    _fude_mutex_unlock(&pool->mutex);
+}
+
+#if FUDE_PLATFORM_WINDOWS
+#include <windows.h> // CreateThread(), WaitForSingleObject(), SRWLOCK, CONDITION_VARIABLE
+
+static DWORD WINAPI _fude_thread_start(LPVOID param)
+{
+    _fude_thread* thread = (_fude_thread*)param;
+    thread->proc(thread->user_data);
+    return 0;
+}
+
+bool _fude_thread_create(_fude_thread* thread, _fude_thread_proc proc, void* user_data)
+{
+    thread->proc = proc;
+    thread->user_data = user_data;
+    thread->handle = CreateThread(NULL, 0, _fude_thread_start, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void _fude_thread_join(_fude_thread* thread)
+{
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+}
+
+void _fude_mutex_init(_fude_mutex* mutex) { InitializeSRWLock((PSRWLOCK)&mutex->srwlock); }
+void _fude_mutex_destroy(_fude_mutex* mutex) { (void)mutex; }
+void _fude_mutex_lock(_fude_mutex* mutex) { AcquireSRWLockExclusive((PSRWLOCK)&mutex->srwlock); }
+void _fude_mutex_unlock(_fude_mutex* mutex) { ReleaseSRWLockExclusive((PSRWLOCK)&mutex->srwlock); }
+
+void _fude_cond_init(_fude_cond* cond) { InitializeConditionVariable((PCONDITION_VARIABLE)&cond->cv); }
+void _fude_cond_destroy(_fude_cond* cond) { (void)cond; }
+void _fude_cond_wait(_fude_cond* cond, _fude_mutex* mutex)
+{
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&cond->cv, (PSRWLOCK)&mutex->srwlock, INFINITE, 0);
+}
+void _fude_cond_broadcast(_fude_cond* cond) { WakeAllConditionVariable((PCONDITION_VARIABLE)&cond->cv); }
+#else
+
+static void* _fude_thread_start(void* param)
+{
+    _fude_thread* thread = (_fude_thread*)param;
+    thread->proc(thread->user_data);
+    return NULL;
+}
+
+bool _fude_thread_create(_fude_thread* thread, _fude_thread_proc proc, void* user_data)
+{
+    thread->proc = proc;
+    thread->user_data = user_data;
+    return pthread_create(&thread->handle, NULL, _fude_thread_start, thread) == 0;
+}
+
+void _fude_thread_join(_fude_thread* thread) { pthread_join(thread->handle, NULL); }
+
+void _fude_mutex_init(_fude_mutex* mutex) { pthread_mutex_init(&mutex->handle, NULL); }
+void _fude_mutex_destroy(_fude_mutex* mutex) { pthread_mutex_destroy(&mutex->handle); }
+void _fude_mutex_lock(_fude_mutex* mutex) { pthread_mutex_lock(&mutex->handle); }
+void _fude_mutex_unlock(_fude_mutex* mutex) { pthread_mutex_unlock(&mutex->handle); }
+
+void _fude_cond_init(_fude_cond* cond) { pthread_cond_init(&cond->handle, NULL); }
+void _fude_cond_destroy(_fude_cond* cond) { pthread_cond_destroy(&cond->handle); }
+void _fude_cond_wait(_fude_cond* cond, _fude_mutex* mutex) { pthread_cond_wait(&cond->handle, &mutex->handle); }
+void _fude_cond_broadcast(_fude_cond* cond) { pthread_cond_broadcast(&cond->handle); }
+
+#endif
@@ -0,0 +1,212 @@
+#include "gm.h"
+#include "fude.h"
+#include "fude_internal.h"
+
+#include <math.h> // floorf()
+
+// every chunk of FUDE_TILEMAP_CHUNK_TILES x FUDE_TILEMAP_CHUNK_TILES tiles is a mesh built the first time it's
+// drawn after a change, so an edit costs one chunk rebuild and an unchanged map uploads nothing. Quads are in
+// map space, tile (x, y) covers [x, x + 1)*tile_size by [y, y + 1)*tile_size, and sample the tileset from slot 1
+#define FUDE_TILEMAP_TILESET_SLOT 1
+#define FUDE_TILEMAP_CHUNK_QUADS (FUDE_TILEMAP_CHUNK_TILES*FUDE_TILEMAP_CHUNK_TILES)
+
+typedef struct {
+    fude_mesh mesh;
+    bool created; // mesh holds buffers
+    bool dirty;   // tiles changed since the mesh was built
+} _fude_tilemap_chunk;
+
+struct fude_tilemap {
+    uint32_t width, height;
+    uint32_t chunks_x, chunks_y;
+    float tile_size;
+    fude_texture tileset;
+    uint32_t columns, rows;
+    uint16_t* tiles; // row-major, 0 is empty
+    _fude_tilemap_chunk* chunks;
+    fude_vertex* vertices; // scratch for one chunk
+    uint32_t* indices;     // the same for every chunk, only the count changes
+};
+
+fude_result f_create_tilemap(fude_tilemap** tilemap, const fude_tilemap_config* config)
+{
+    if(!tilemap || !config || config->width == 0 || config->height == 0 || !(config->tile_size > 0.0f) ||
+            config->columns == 0 || config->rows == 0)
+        return FUDE_INVALID_ARGUMENTS_ERROR;
+
+    fude_tilemap* result = f_malloc(sizeof(fude_tilemap));
+    if(!result) return FUDE_ERROR;
+    f_memzero(result, sizeof(fude_tilemap));
+    result->width = config->width;
+    result->height = config->height;
+    result->chunks_x = (config->width + FUDE_TILEMAP_CHUNK_TILES - 1)/FUDE_TILEMAP_CHUNK_TILES;
+    result->chunks_y = (config->height + FUDE_TILEMAP_CHUNK_TILES - 1)/FUDE_TILEMAP_CHUNK_TILES;
+    result->tile_size = config->tile_size;
+    result->tileset = config->tileset;
+    result->columns = config->columns;
+    result->rows = config->rows;
+
+    const uint64_t tile_count = (uint64_t)config->width*config->height;
+    const uint64_t chunk_count = (uint64_t)result->chunks_x*result->chunks_y;
+    result->tiles = f_malloc(tile_count*sizeof(uint16_t));
+    result->chunks = f_malloc(chunk_count*sizeof(_fude_tilemap_chunk));
+    result->vertices = f_malloc(FUDE_TILEMAP_CHUNK_QUADS*4*sizeof(fude_vertex));
+    result->indices = f_malloc(FUDE_TILEMAP_CHUNK_QUADS*6*sizeof(uint32_t));
+    if(!result->tiles || !result->chunks || !result->vertices || !result->indices) {
+        f_destroy_tilemap(NULL, result); // no chunk has a mesh yet
+        return FUDE_ERROR;
+    }
+    f_memzero(result->tiles, tile_count*sizeof(uint16_t));
+    f_memzero(result->chunks, chunk_count*sizeof(_fude_tilemap_chunk));
+    for(uint32_t i = 0; i < FUDE_TILEMAP_CHUNK_QUADS; ++i) {
+        uint32_t* indices = result->indices + i*6;
+        indices[0] = i*4 + 0;
+        indices[1] = i*4 + 1;
+        indices[2] = i*4 + 2;
+        indices[3] = i*4 + 2;
+        indices[4] = i*4 + 3;
+        indices[5] = i*4 + 0;
+    }
+
+    *tilemap = result;
+    return FUDE_OK;
+}
+
+// chunk meshes are GL buffers, destroy the tilemap while the context is still alive
+void f_destroy_tilemap(fude* app, fude_tilemap* tilemap)
+{
+    if(!tilemap) return;
+    if(tilemap->chunks) {
+        for(uint64_t i = 0; i < (uint64_t)tilemap->chunks_x*tilemap->chunks_y; ++i) {
+            if(tilemap->chunks[i].created) f_destroy_mesh(app, &tilemap->chunks[i].mesh);
+        }
+    }
+    f_free(tilemap->tiles);
+    f_free(tilemap->chunks);
+    f_free(tilemap->vertices);
+    f_free(tilemap->indices);
+    f_free(tilemap);
+}
+
+static void _fude_dirty_tile(fude_tilemap* tilemap, uint32_t x, uint32_t y)
+{
+    tilemap->chunks[(y/FUDE_TILEMAP_CHUNK_TILES)*tilemap->chunks_x + x/FUDE_TILEMAP_CHUNK_TILES].dirty = true;
+}
+
+// 0 clears the tile, out of bounds is ignored
+void f_set_tile(fude_tilemap* tilemap, uint32_t x, uint32_t y, uint16_t tile)
+{
+    if(!tilemap || x >= tilemap->width || y >= tilemap->height) return;
+    uint16_t* dst = tilemap->tiles + (size_t)y*tilemap->width + x;
+    if(*dst == tile) return;
+    *dst = tile;
+    _fude_dirty_tile(tilemap, x, y);
+}
+
+uint16_t f_get_tile(const fude_tilemap* tilemap, uint32_t x, uint32_t y)
+{
+    if(!tilemap || x >= tilemap->width || y >= tilemap->height) return 0;
+    return tilemap->tiles[(size_t)y*tilemap->width + x];
+}
+
+// tiles holds rect.width*rect.height ids row by row, the part of rect outside the map is skipped
+void f_set_tiles(fude_tilemap* tilemap, fude_rect rect, const uint16_t* tiles)
+{
+    if(!tilemap || !tiles || rect.width <= 0 || rect.height <= 0) return;
+    for(int row = 0; row < rect.height; ++row) {
+        const int64_t y = (int64_t)rect.y + row;
+        if(y < 0 || y >= tilemap->height) continue;
+        for(int column = 0; column < rect.width; ++column) {
+            const int64_t x = (int64_t)rect.x + column;
+            if(x < 0 || x >= tilemap->width) continue;
+            f_set_tile(tilemap, (uint32_t)x, (uint32_t)y, tiles[(size_t)row*rect.width + column]);
+        }
+    }
+}
+
+// empty chunks keep no buffers at all
+static void _fude_build_chunk(fude* app, fude_tilemap* tilemap, uint32_t chunk_x, uint32_t chunk_y)
+{
+    _fude_tilemap_chunk* chunk = tilemap->chunks + chunk_y*tilemap->chunks_x + chunk_x;
+    chunk->dirty = false;
+
+    const uint32_t x0 = chunk_x*FUDE_TILEMAP_CHUNK_TILES, y0 = chunk_y*FUDE_TILEMAP_CHUNK_TILES;
+    const uint32_t x1 = x0 + FUDE_TILEMAP_CHUNK_TILES < tilemap->width ? x0 + FUDE_TILEMAP_CHUNK_TILES : tilemap->width;
+    const uint32_t y1 = y0 + FUDE_TILEMAP_CHUNK_TILES < tilemap->height ? y0 + FUDE_TILEMAP_CHUNK_TILES : tilemap->height;
+    const uint32_t cells = tilemap->columns*tilemap->rows;
+    const float cell_u = 1.0f/(float)tilemap->columns, cell_v = 1.0f/(float)tilemap->rows;
+    const float size = tilemap->tile_size;
+    const V4f white = { .r = 1.0f, .g = 1.0f, .b = 1.0f, .a = 1.0f };
+    const float tex_index = (float)FUDE_TILEMAP_TILESET_SLOT;
+
+    uint32_t quads = 0;
+    for(uint32_t y = y0; y < y1; ++y) {
+        const uint16_t* row = tilemap->tiles + (size_t)y*tilemap->width;
+        for(uint32_t x = x0; x < x1; ++x) {
+            if(row[x] == 0 || row[x] > cells) continue;
+            const uint32_t cell = row[x] - 1u;
+            const float u0 = (float)(cell % tilemap->columns)*cell_u, v0 = (float)(cell/tilemap->columns)*cell_v;
+            const float px = (float)x*size, py = (float)y*size;
+            fude_vertex* vertices = tilemap->vertices + quads*4;
+            vertices[0] = (fude_vertex){ .position.x = px, .position.y = py, .color = white,
+                .tex_coords.u = u0, .tex_coords.v = v0, .tex_index = tex_index };
+            vertices[1] = (fude_vertex){ .position.x = px + size, .position.y = py, .color = white,
+                .tex_coords.u = u0 + cell_u, .tex_coords.v = v0, .tex_index = tex_index };
+            vertices[2] = (fude_vertex){ .position.x = px + size, .position.y = py + size, .color = white,
+                .tex_coords.u = u0 + cell_u, .tex_coords.v = v0 + cell_v, .tex_index = tex_index };
+            vertices[3] = (fude_vertex){ .position.x = px, .position.y = py + size, .color = white,
+                .tex_coords.u = u0, .tex_coords.v = v0 + cell_v, .tex_index = tex_index };
+            quads += 1;
+        }
+    }
+
+    if(quads == 0) {
+        if(chunk->created) f_destroy_mesh(app, &chunk->mesh);
+        chunk->created = false;
+        return;
+    }
+    fude_result result = chunk->created ?
+        f_update_mesh(app, &chunk->mesh, tilemap->vertices, quads*4, tilemap->indices, quads*6) :
+        f_create_mesh(app, &chunk->mesh, tilemap->vertices, quads*4, tilemap->indices, quads*6);
+    if(result != FUDE_OK) {
+        f_trace_log(FUDE_LOG_WARNING, "Failed to build tilemap chunk (%u, %u)", chunk_x, chunk_y);
+        chunk->created = false;
+        return;
+    }
+    chunk->created = true;
+    chunk->mesh.textures[FUDE_TILEMAP_TILESET_SLOT] = tilemap->tileset;
+}
+
+// (x, y) is where the map's top left corner goes, before the matrix stack. With the default shader's camera
+// and no matrix only the chunks overlapping its bounds are visited, each visible chunk that isn't empty is
+// one f_draw_mesh, which culls the others itself
+void f_draw_tilemap(fude* app, fude_tilemap* tilemap, float x, float y)
+{
+    if(!tilemap) return;
+    const fude_renderer* renderer = &app->renderer;
+    uint32_t cx0 = 0, cy0 = 0, cx1 = tilemap->chunks_x, cy1 = tilemap->chunks_y;
+    if(renderer->camera.active && renderer->camera.shader == renderer->default_shader.id &&
+            renderer->transform.current.kind == FUDE_TRANSFORM_IDENTITY) {
+        const float span = (float)FUDE_TILEMAP_CHUNK_TILES*tilemap->tile_size;
+        const float fx0 = floorf((renderer->camera.bounds.min.x - x)/span);
+        const float fy0 = floorf((renderer->camera.bounds.min.y - y)/span);
+        const float fx1 = floorf((renderer->camera.bounds.max.x - x)/span) + 1.0f;
+        const float fy1 = floorf((renderer->camera.bounds.max.y - y)/span) + 1.0f;
+        if(fx1 <= 0.0f || fy1 <= 0.0f || fx0 >= (float)cx1 || fy0 >= (float)cy1) return;
+        if(fx0 > 0.0f) cx0 = (uint32_t)fx0;
+        if(fy0 > 0.0f) cy0 = (uint32_t)fy0;
+        if(fx1 < (float)cx1) cx1 = (uint32_t)fx1;
+        if(fy1 < (float)cy1) cy1 = (uint32_t)fy1;
+    }
+
+    const M4f translation = m4f_translation(x, y, 0.0f);
+    const M4f* transform = x != 0.0f || y != 0.0f ? &translation : NULL;
+    for(uint32_t cy = cy0; cy < cy1; ++cy) {
+        for(uint32_t cx = cx0; cx < cx1; ++cx) {
+            _fude_tilemap_chunk* chunk = tilemap->chunks + cy*tilemap->chunks_x + cx;
+            if(chunk->dirty) _fude_build_chunk(app, tilemap, cx, cy);
+            if(!chunk->created) continue;
+            f_draw_mesh(app, &chunk->mesh, renderer->default_shader, transform);
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "fude.h"
+#include "fude_internal.h"
 
 #include <stdarg.h> // va_list
 #include <stdio.h> // fprintf()
@@ -25,6 +26,44 @@ void* f_memzero(void* ptr, size_t nbytes)
     return ptr;
 }
 
+// every growable array in the library: capacity doubles from 16 until needed fits, stopping at UINT32_MAX,
+// and the first count elements move over. Running out of memory or address space is fatal
+void* _fude_grow_array(void* data, uint32_t count, uint32_t* capacity, uint32_t needed, size_t stride)
+{
+    if(needed <= *capacity) return data;
+    uint64_t new_capacity = *capacity ? *capacity : 16;
+    while(new_capacity < needed)
+        new_capacity *= 2;
+    if(new_capacity > UINT32_MAX) new_capacity = UINT32_MAX;
+    f_expect(new_capacity <= SIZE_MAX/stride, "Can't grow to %llu elements of %zu bytes at %s (%d)",
+            (unsigned long long)new_capacity, stride, __FILE__, __LINE__);
+    void* new_data = f_malloc((size_t)new_capacity*stride);
+    f_expect(new_data != NULL, "Failed to grow to %llu elements at %s (%d)", (unsigned long long)new_capacity,
+            __FILE__, __LINE__);
+    if(data) {
+        f_memcpy(new_data, data, (size_t)count*stride);
+        f_free(data);
+    }
+    *capacity = (uint32_t)new_capacity;
+    return new_data;
+}
+
+// FNV-1a over little endian 32-bit words, a shorter tail goes in a byte at a time.
+// Start from FUDE_HASH_SEED, or from a previous result to hash several pieces as one
+uint64_t _fude_hash(uint64_t hash, const void* data, size_t nbytes)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t i = 0;
+    for(; i + 4 <= nbytes; i += 4) {
+        uint32_t word = (uint32_t)bytes[i] | (uint32_t)bytes[i + 1] << 8 | (uint32_t)bytes[i + 2] << 16 |
+            (uint32_t)bytes[i + 3] << 24;
+        hash = (hash ^ word)*0x100000001b3ull;
+    }
+    for(; i < nbytes; ++i)
+        hash = (hash ^ bytes[i])*0x100000001b3ull;
+    return hash;
+}
+
 void f_trace_log(int log_level, const char* fmt, ...)
 {
     FILE* file = NULL;
@@ -73,18 +112,24 @@ void* f_load_file_data(const char* file_path, size_t* file_size)
     if(!f)
         return NULL;
 
-    if(fseek(f, 0L, SEEK_END) != 0)
+    if(fseek(f, 0L, SEEK_END) != 0) {
+        fclose(f);
         return NULL;
+    }
     _file_size = ftell(f);
-    if(fseek(f, 0L, SEEK_SET) != 0) 
+    if(fseek(f, 0L, SEEK_SET) != 0) {
+        fclose(f);
         return NULL;
+    }
 
     uint8_t* result = f_malloc(_file_size + 1);
 
-    if(!result)
+    if(!result) {
+        fclose(f);
         return NULL;
+    }
     fread(result, 1, _file_size, f);
-    result[_file_size + 1] = 0;
+    result[_file_size] = 0;
     fclose(f);
     if(file_size)
         *file_size = _file_size;
@@ -100,6 +145,7 @@ void f_unload_file_data(void* data)
 #if FUDE_PLATFORM_WINDOWS
 #include <windows.h> // VirtualAllocEx(), MEM_COMMIT, MEM_RELEASE, MEM_RESERVE, 
                      // PAGE_READWRITE, GetCurrentProcess()
+#include <mmsystem.h> // timeBeginPeriod(), timeEndPeriod(), link winmm
 
 void* f_malloc(uint64_t nbytes)
 {
@@ -116,7 +162,47 @@ void f_free(void* ptr)
 {
     VirtualFreeEx(GetCurrentProcess(), (LPVOID)ptr, 0, MEM_RELEASE);
 }
+
+void _fude_sleep_ms(uint32_t milliseconds)
+{
+    Sleep(milliseconds);
+}
+
+// Sleep() rounds up to the system timer tick, 15.6ms by default, which would leave the frame limiter
+// spinning for most of every frame. Raised per fude instance and reference counted by the system
+bool _fude_begin_sleep_resolution(void)
+{
+    return timeBeginPeriod(1) == TIMERR_NOERROR;
+}
+
+void _fude_end_sleep_resolution(void)
+{
+    timeEndPeriod(1);
+}
+
+uint64_t _fude_timer_value(void)
+{
+    LARGE_INTEGER value;
+    QueryPerformanceCounter(&value);
+    return (uint64_t)value.QuadPart;
+}
+
+uint64_t _fude_timer_frequency(void)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)frequency.QuadPart;
+}
+
+uint32_t _fude_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t)info.dwNumberOfProcessors : 1;
+}
 #else
+#include <time.h> // nanosleep(), clock_gettime()
+#include <unistd.h> // sysconf()
 
 void* f_malloc(uint64_t nbytes)
 {
@@ -130,4 +216,40 @@ void f_free(void* ptr)
     free(ptr);
 }
 
+void _fude_sleep_ms(uint32_t milliseconds)
+{
+    struct timespec ts;
+    ts.tv_sec = milliseconds/1000;
+    ts.tv_nsec = (long)(milliseconds%1000)*1000000L;
+    nanosleep(&ts, NULL);
+}
+
+// nanosleep() already wakes within a fraction of a millisecond
+bool _fude_begin_sleep_resolution(void)
+{
+    return false;
+}
+
+void _fude_end_sleep_resolution(void)
+{
+}
+
+uint64_t _fude_timer_value(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t _fude_timer_frequency(void)
+{
+    return 1000000000ull;
+}
+
+uint32_t _fude_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
 #endif